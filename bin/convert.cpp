@@ -0,0 +1,855 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+    #include <direct.h>
+#else
+    #include <sys/stat.h>
+    #include <sys/types.h>
+#endif
+
+#include <dlisio/dlisio.h>
+#include <dlisio/types.h>
+
+#include <dlisio/ext/frame.hpp>
+#include <dlisio/ext/io.hpp>
+#include <dlisio/ext/types.hpp>
+
+/*
+ * dlis-convert - convert the frames of a DLIS file to columnar files
+ *
+ * The file is memory-mapped and indexed, only the CHANNEL and FRAME objects
+ * are parsed, and the FDATA of every frame is decoded column by column with
+ * the column_reader, a block of rows at a time, so memory use is bounded by
+ * the block size, no matter the size of the file. Frames are converted in
+ * parallel.
+ *
+ * Every frame is written to its own directory, <output>/<lf>/<frame>, where
+ * lf is the index of the logical file and frame is <name>.<origin>.<copy>:
+ *
+ *   metadata.json      the frame, its channels, and the files of the columns
+ *   <k>.bin            numeric column k, all rows back-to-back, native order
+ *   <k>.offsets        string column k, int64 offsets into <k>.data
+ *   <k>.data           string column k, the bytes of all the strings
+ *
+ * where k is the position of the channel in the frame. The offsets are the
+ * layout of arrow's large string arrays, i.e. string j is [offsets[j],
+ * offsets[j + 1]), and there are dimension strings per row. Validated floats
+ * are written as (value, abs_err) or (value, lower, upper) records, just like
+ * dlisio's native curves. Channels of object names, references and
+ * date-times are skipped, and listed as such in metadata.json.
+ *
+ * metadata.json is written last, so a frame directory without it is an
+ * incomplete conversion. Once all the frames of a logical file are converted,
+ * its records are dropped from the page cache, unless --keep-cache is given,
+ * so that converting a file much larger than memory does not push everything
+ * else out of it. Frames that cannot be converted, e.g. because their
+ * FDATA records are encrypted, are reported and skipped, and the exit status
+ * is 1.
+ */
+
+namespace {
+
+struct options {
+    std::string input;
+    std::string output;
+    int threads = (std::max)( 1, int(std::thread::hardware_concurrency()) );
+    int rows = 65536;
+    std::vector< std::string > frames;
+    bool quiet = false;
+    bool keep_cache = false;
+};
+
+struct fcloser {
+    void operator()( std::FILE* fp ) { if( fp ) std::fclose( fp ); }
+};
+
+using file_ptr = std::unique_ptr< std::FILE, fcloser >;
+
+file_ptr open_output( const std::string& path ) noexcept (false) {
+    file_ptr fp( std::fopen( path.c_str(), "wb" ) );
+    if (not fp) {
+        const auto err = std::strerror( errno );
+        throw std::runtime_error( "unable to open " + path + ": " + err );
+    }
+    return fp;
+}
+
+void write( std::FILE* fp, const void* ptr, std::size_t n ) noexcept (false) {
+    if (n == 0) return;
+    if (std::fwrite( ptr, 1, n, fp ) != n)
+        throw std::runtime_error( std::string("write failed: ")
+                                + std::strerror( errno ) );
+}
+
+void close( file_ptr& fp, const std::string& path ) noexcept (false) {
+    if (std::fclose( fp.release() ) != 0)
+        throw std::runtime_error( "unable to close " + path + ": "
+                                + std::strerror( errno ) );
+}
+
+void makedir( const std::string& path ) noexcept (false) {
+#ifdef _WIN32
+    const auto err = _mkdir( path.c_str() );
+#else
+    const auto err = mkdir( path.c_str(), 0777 );
+#endif
+    if (err == 0 or errno == EEXIST) return;
+    throw std::runtime_error( "unable to create directory " + path + ": "
+                            + std::strerror( errno ) );
+}
+
+/*
+ * A file name of str, where everything but letters, digits, '-' and '_' is
+ * replaced with '_', so that names like 'DEPTH/TIME' are still one directory
+ */
+std::string sanitize( const std::string& str ) {
+    std::string out = str;
+    for (auto& c : out) {
+        const auto ok = (c >= 'a' and c <= 'z')
+                     or (c >= 'A' and c <= 'Z')
+                     or (c >= '0' and c <= '9')
+                     or c == '-'
+                     or c == '_';
+        if (not ok) c = '_';
+    }
+    return out.empty() ? "_" : out;
+}
+
+/*
+ * JSON
+ *
+ * The metadata is a handful of strings and numbers, which is not worth a
+ * dependency. Bytes outside printable ASCII are escaped as latin-1 code
+ * points, so the output is always valid JSON, whatever the encoding of the
+ * strings in the file.
+ */
+std::string quote( const std::string& str ) {
+    std::string out = "\"";
+    for (const auto c : str) {
+        const auto u = static_cast< unsigned char >( c );
+        if      (c == '"')  out += "\\\"";
+        else if (c == '\\') out += "\\\\";
+        else if (u < 0x20 or u >= 0x7F) {
+            char buffer[ 8 ];
+            std::snprintf( buffer, sizeof(buffer), "\\u%04x", unsigned(u) );
+            out += buffer;
+        }
+        else out += c;
+    }
+    return out + "\"";
+}
+
+template < typename T >
+std::string array( const std::vector< T >& xs ) {
+    std::string out = "[";
+    for (std::size_t i = 0; i < xs.size(); ++i) {
+        if (i > 0) out += ", ";
+        out += std::to_string( xs[ i ] );
+    }
+    return out + "]";
+}
+
+/*
+ * Attribute values
+ *
+ * The standard says what the representation code of the common attributes
+ * should be, but files don't always agree, so accept any integer or string
+ * type
+ */
+template < typename T >
+long long integer( const T& x, std::true_type ) { return x; }
+template < typename T >
+long long integer( const T&, std::false_type ) {
+    throw std::invalid_argument( "not an integer" );
+}
+
+struct integers {
+    std::vector< long long > operator()( const mpark::monostate& ) const {
+        return {};
+    }
+
+    template < typename T >
+    std::vector< long long > operator()( const dl::small_vector< T >& xs )
+    const {
+        using value = typename std::decay<
+            decltype( dl::decay( std::declval< const T& >() ) )
+        >::type;
+
+        std::vector< long long > out;
+        for (const auto& x : xs)
+            out.push_back( integer( dl::decay( x ),
+                                    std::is_integral< value >() ) );
+        return out;
+    }
+};
+
+struct text {
+    template < typename T >
+    std::string operator()( const T& ) const { return ""; }
+
+    std::string operator()( const dl::small_vector< dl::ident >& xs )
+    const {
+        return xs.empty() ? "" : dl::decay( xs.front() );
+    }
+    std::string operator()( const dl::small_vector< dl::ascii >& xs )
+    const {
+        return xs.empty() ? "" : dl::decay( xs.front() );
+    }
+    std::string operator()( const dl::small_vector< dl::units >& xs )
+    const {
+        return xs.empty() ? "" : dl::decay( xs.front() );
+    }
+};
+
+const dl::object_attribute* find( const dl::basic_object& obj,
+                                  const std::string& label ) {
+    for (const auto& attr : obj.attributes)
+        if (dl::decay( attr.label ) == label) return &attr;
+    return nullptr;
+}
+
+std::vector< long long > integers_of( const dl::basic_object& obj,
+                                      const std::string& label ) {
+    const auto* attr = find( obj, label );
+    if (not attr) return {};
+    try {
+        return mpark::visit( integers(), attr->value );
+    } catch (const std::invalid_argument&) {
+        throw std::runtime_error( "attribute " + label + " of "
+                                + dl::decay( obj.object_name.id )
+                                + " is not an integer" );
+    }
+}
+
+std::string text_of( const dl::basic_object& obj, const std::string& label ) {
+    const auto* attr = find( obj, label );
+    if (not attr) return "";
+    return mpark::visit( text(), attr->value );
+}
+
+/*
+ * The format character of a representation code, see dlis_packf
+ */
+char fmtchar( long long reprc ) noexcept (false) {
+    switch (reprc) {
+        case DLIS_FSHORT: return DLIS_FMT_FSHORT;
+        case DLIS_FSINGL: return DLIS_FMT_FSINGL;
+        case DLIS_FSING1: return DLIS_FMT_FSING1;
+        case DLIS_FSING2: return DLIS_FMT_FSING2;
+        case DLIS_ISINGL: return DLIS_FMT_ISINGL;
+        case DLIS_VSINGL: return DLIS_FMT_VSINGL;
+        case DLIS_FDOUBL: return DLIS_FMT_FDOUBL;
+        case DLIS_FDOUB1: return DLIS_FMT_FDOUB1;
+        case DLIS_FDOUB2: return DLIS_FMT_FDOUB2;
+        case DLIS_CSINGL: return DLIS_FMT_CSINGL;
+        case DLIS_CDOUBL: return DLIS_FMT_CDOUBL;
+        case DLIS_SSHORT: return DLIS_FMT_SSHORT;
+        case DLIS_SNORM:  return DLIS_FMT_SNORM;
+        case DLIS_SLONG:  return DLIS_FMT_SLONG;
+        case DLIS_USHORT: return DLIS_FMT_USHORT;
+        case DLIS_UNORM:  return DLIS_FMT_UNORM;
+        case DLIS_ULONG:  return DLIS_FMT_ULONG;
+        case DLIS_UVARI:  return DLIS_FMT_UVARI;
+        case DLIS_IDENT:  return DLIS_FMT_IDENT;
+        case DLIS_ASCII:  return DLIS_FMT_ASCII;
+        case DLIS_DTIME:  return DLIS_FMT_DTIME;
+        case DLIS_ORIGIN: return DLIS_FMT_ORIGIN;
+        case DLIS_OBNAME: return DLIS_FMT_OBNAME;
+        case DLIS_OBJREF: return DLIS_FMT_OBJREF;
+        case DLIS_ATTREF: return DLIS_FMT_ATTREF;
+        case DLIS_STATUS: return DLIS_FMT_STATUS;
+        case DLIS_UNITS:  return DLIS_FMT_UNITS;
+        default:
+            throw std::runtime_error( "invalid representation code "
+                                    + std::to_string( reprc ) );
+    }
+}
+
+bool little_endian() noexcept (true) {
+    const std::uint16_t x = 1;
+    unsigned char c;
+    std::memcpy( &c, &x, 1 );
+    return c == 1;
+}
+
+/*
+ * The numpy dtype (as a JSON value) of a numeric column of format f, or an
+ * empty string if the column is not numeric
+ */
+std::string dtype( char f ) {
+    const std::string order = little_endian() ? "<" : ">";
+    const auto scalar = [&order]( const char* t ) {
+        return quote( order + t );
+    };
+    const auto fields = [&order]( const char* t, int n ) {
+        const char* names[] = { "V", "A", "B" };
+        std::string out = "[";
+        for (int i = 0; i < n; ++i) {
+            if (i > 0) out += ", ";
+            out += "[" + quote( names[ i ] ) + ", " + quote( order + t ) + "]";
+        }
+        return out + "]";
+    };
+
+    switch (f) {
+        case DLIS_FMT_FSHORT:
+        case DLIS_FMT_FSINGL:
+        case DLIS_FMT_ISINGL:
+        case DLIS_FMT_VSINGL: return scalar( "f4" );
+        case DLIS_FMT_FDOUBL: return scalar( "f8" );
+        case DLIS_FMT_CSINGL: return scalar( "c8" );
+        case DLIS_FMT_CDOUBL: return scalar( "c16" );
+        case DLIS_FMT_SSHORT: return quote( "|i1" );
+        case DLIS_FMT_SNORM:  return scalar( "i2" );
+        case DLIS_FMT_SLONG:  return scalar( "i4" );
+        case DLIS_FMT_USHORT: return quote( "|u1" );
+        case DLIS_FMT_UNORM:  return scalar( "u2" );
+        case DLIS_FMT_ULONG:
+        case DLIS_FMT_UVARI:
+        case DLIS_FMT_ORIGIN: return scalar( "u4" );
+        case DLIS_FMT_STATUS: return quote( "|b1" );
+        case DLIS_FMT_FSING1: return fields( "f4", 2 );
+        case DLIS_FMT_FSING2: return fields( "f4", 3 );
+        case DLIS_FMT_FDOUB1: return fields( "f8", 2 );
+        case DLIS_FMT_FDOUB2: return fields( "f8", 3 );
+        default:              return "";
+    }
+}
+
+bool is_string( char f ) noexcept (true) {
+    return f == DLIS_FMT_IDENT or f == DLIS_FMT_ASCII or f == DLIS_FMT_UNITS;
+}
+
+struct channel_info {
+    dl::obname name;
+    long long reprc = 0;
+    /* in the order of numpy, i.e. the reverse of the file */
+    std::vector< long long > shape;
+    std::string units;
+    std::string long_name;
+
+    long long samples() const noexcept (true) {
+        long long n = 1;
+        for (auto x : this->shape) n *= x;
+        return n;
+    }
+};
+
+struct frame_info {
+    int logical_file;
+    dl::obname name;
+    std::string index_type;
+    std::string direction;
+    std::vector< dl::obname > channels;
+    std::vector< int > records;
+};
+
+struct logical_file {
+    std::map< std::string, channel_info > channels;
+    std::vector< frame_info > frames;
+    /* the records [first, last) of the logical file */
+    int first = 0;
+    int last = 0;
+};
+
+/*
+ * Index the file, split it in logical files at the FILE-HEADERs just like
+ * dlisio.load, and find the frames, their channels and their FDATA records.
+ * Only the CHANNEL and FRAME sets are parsed.
+ */
+std::vector< logical_file > inventory( dl::stream& file,
+                                       const options& opts ) noexcept (false) {
+    /* the stream is memory-mapped, so index it from its own mapping */
+    auto& map = file.sources().front()->mapping();
+    const auto sul = dl::findsul( map );
+    const auto vrl = dl::findvrl( map, sul + 80 );
+    const auto ofs = dl::findoffsets( map, vrl, opts.threads );
+    const auto& tells = ofs.tells;
+    const auto& residuals = ofs.residuals;
+
+    std::vector< int > explicits;
+    std::vector< int > implicits;
+    for (std::size_t i = 0; i < tells.size(); ++i) {
+        if (ofs.explicits[ i ]) explicits.push_back( int(i) );
+        else                    implicits.push_back( int(i) );
+    }
+
+    file.reindex( tells, residuals );
+
+    dl::extract_policy policy;
+    policy.encrypted = false;
+    dl::record_batch batch;
+    file.extract( explicits, batch, policy );
+
+    /* the first record of every logical file */
+    std::vector< int > pivots = { 0 };
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        if (batch.types[ i ] == 0 and i > 0)
+            pivots.push_back( explicits[ i ] );
+    }
+    pivots.push_back( int(tells.size()) );
+
+    const dl::object_filter filter( { "CHANNEL", "FRAME" }, {}, "" );
+    std::vector< logical_file > lfs( pivots.size() - 1 );
+    std::size_t next = 0;
+    for (std::size_t k = 0; k + 1 < pivots.size(); ++k) {
+        auto& lf = lfs[ k ];
+        lf.first = pivots[ k ];
+        lf.last = pivots[ k + 1 ];
+        dl::record_batch part;
+        std::vector< int > candidates;
+        for (; next < explicits.size(); ++next) {
+            if (explicits[ next ] >= pivots[ k + 1 ]) break;
+            part.data.insert( part.data.end(),
+                              batch.begin( next ),
+                              batch.end( next ) );
+            part.offsets.push_back( part.data.size() );
+            part.types.push_back( batch.types[ next ] );
+            part.attributes.push_back( batch.attributes[ next ] );
+            part.consistent.push_back( batch.consistent[ next ] );
+        }
+        for (auto i : implicits) {
+            if (i >= pivots[ k ] and i < pivots[ k + 1 ])
+                candidates.push_back( i );
+        }
+
+        for (const auto& flat : dl::parse_flat_objects( part, filter )) {
+            const auto set = dl::unflatten( flat );
+            const auto& type = dl::decay( set.type );
+            for (const auto& obj : set.objects) {
+                if (type == "CHANNEL") {
+                    channel_info ch;
+                    ch.name = obj.object_name;
+                    const auto reprc = integers_of( obj,
+                                                    "REPRESENTATION-CODE" );
+                    ch.reprc = reprc.empty() ? 0 : reprc.front();
+                    const auto dim = integers_of( obj, "DIMENSION" );
+                    ch.shape.assign( dim.rbegin(), dim.rend() );
+                    /* no dimension is a scalar, like Channel.dtype in dlisio */
+                    if (ch.shape.empty()) ch.shape = { 1 };
+                    ch.units = text_of( obj, "UNITS" );
+                    ch.long_name = text_of( obj, "LONG-NAME" );
+                    const auto fp = ch.name.fingerprint( "CHANNEL" );
+                    lf.channels[ fp ] = std::move( ch );
+                    continue;
+                }
+
+                frame_info frame;
+                frame.logical_file = int(k);
+                frame.name = obj.object_name;
+                frame.index_type = text_of( obj, "INDEX-TYPE" );
+                frame.direction = text_of( obj, "DIRECTION" );
+                const auto* channels = find( obj, "CHANNELS" );
+                using obnames = dl::small_vector< dl::obname >;
+                if (channels) {
+                    const auto* names = mpark::get_if< obnames >(
+                        &channels->value
+                    );
+                    if (names) frame.channels.assign( names->begin(),
+                                                      names->end() );
+                }
+                lf.frames.push_back( std::move( frame ) );
+            }
+        }
+
+        const auto groups = dl::groupfdata( map,
+                                            candidates,
+                                            tells,
+                                            residuals );
+        for (auto& frame : lf.frames) {
+            const auto fp = frame.name.fingerprint( "FRAME" );
+            for (const auto& group : groups) {
+                if (group.fingerprint != fp) continue;
+                frame.records.assign( group.records.begin(),
+                                      group.records.end() );
+            }
+        }
+    }
+    return lfs;
+}
+
+bool selected( const frame_info& frame, const options& opts ) {
+    if (opts.frames.empty()) return true;
+    const auto& id = dl::decay( frame.name.id );
+    return std::find( opts.frames.begin(), opts.frames.end(), id )
+        != opts.frames.end();
+}
+
+/*
+ * The output of a single column
+ */
+struct column_output {
+    std::size_t position;
+    const channel_info* channel;
+    std::string fmt;
+    bool strings;
+    std::string path;
+    file_ptr values;
+    /* for string columns */
+    std::string offsets_path;
+    file_ptr offsets;
+    long long base = 0;
+    std::vector< std::int64_t > shifted;
+};
+
+std::string obname_json( const dl::obname& name ) {
+    return "\"name\": " + quote( dl::decay( name.id ) )
+         + ", \"origin\": " + std::to_string( dl::decay( name.origin ) )
+         + ", \"copy\": " + std::to_string( int(dl::decay( name.copy )) );
+}
+
+/* a JSON array of the items, one per line */
+std::string list( const std::string& items ) {
+    if (items.empty()) return "[]";
+    return "[\n" + items + "\n  ]";
+}
+
+struct converted {
+    std::string directory;
+    long long rows;
+    std::size_t columns;
+};
+
+converted convert( dl::stream& file,
+                   const logical_file& lf,
+                   const frame_info& frame,
+                   const options& opts ) noexcept (false) {
+    const auto lfdir = opts.output + "/" + std::to_string( frame.logical_file );
+    const auto name = sanitize( dl::decay( frame.name.id ) )
+                    + "." + std::to_string( dl::decay( frame.name.origin ) )
+                    + "." + std::to_string( int(dl::decay( frame.name.copy )) );
+    const auto dir = lfdir + "/" + name;
+    makedir( lfdir );
+    makedir( dir );
+
+    /*
+     * The format of every channel, which is needed to skip over the channels
+     * that are not converted, too
+     */
+    std::vector< std::string > fmts;
+    std::vector< const channel_info* > channels;
+    for (const auto& obname : frame.channels) {
+        const auto itr = lf.channels.find( obname.fingerprint( "CHANNEL" ) );
+        if (itr == lf.channels.end())
+            throw std::runtime_error( "channel " + dl::decay( obname.id )
+                                    + " is not in the file" );
+
+        const auto& ch = itr->second;
+        if (ch.samples() <= 0)
+            throw std::runtime_error( "channel " + dl::decay( obname.id )
+                                    + " has no samples" );
+
+        fmts.push_back( std::string( std::size_t(ch.samples()),
+                                     fmtchar( ch.reprc ) ) );
+        channels.push_back( &ch );
+    }
+
+    std::vector< int > selection;
+    std::vector< std::string > skipped;
+    for (std::size_t k = 0; k < fmts.size(); ++k) {
+        const auto f = fmts[ k ].front();
+        if (not dtype( f ).empty() or is_string( f ))
+            selection.push_back( int(k) );
+        else
+            skipped.push_back( "{" + obname_json( channels[ k ]->name )
+                             + ", \"position\": " + std::to_string( k )
+                             + ", \"representation_code\": "
+                             + std::to_string( channels[ k ]->reprc ) + "}" );
+    }
+
+    std::vector< column_output > outputs;
+    for (auto k : selection) {
+        column_output out;
+        out.position = std::size_t(k);
+        out.channel = channels[ k ];
+        out.fmt = fmts[ k ];
+        out.strings = is_string( out.fmt.front() );
+        if (out.strings) {
+            out.path = dir + "/" + std::to_string( k ) + ".data";
+            out.offsets_path = dir + "/" + std::to_string( k ) + ".offsets";
+            out.offsets = open_output( out.offsets_path );
+            const std::int64_t zero = 0;
+            write( out.offsets.get(), &zero, sizeof( zero ) );
+        } else {
+            out.path = dir + "/" + std::to_string( k ) + ".bin";
+        }
+        out.values = open_output( out.path );
+        outputs.push_back( std::move( out ) );
+    }
+
+    long long rows = 0;
+    if (not selection.empty() and not frame.records.empty()) {
+        auto projection = dl::compile_projection( fmts, selection, true );
+        dl::column_reader reader( file, frame.records, std::move( projection ) );
+
+        std::vector< std::vector< char > > buffers( reader.columns() );
+        std::vector< char* > dst( reader.columns(), nullptr );
+        for (std::size_t k = 0; k < reader.columns(); ++k) {
+            if (reader.strings_column( k )) continue;
+            const auto size = std::size_t(reader.column_size( k ));
+            buffers[ k ].resize( std::size_t(opts.rows) * size );
+            dst[ k ] = buffers[ k ].data();
+        }
+
+        while (true) {
+            const auto n = reader.read( dst, opts.rows );
+            if (n == 0) break;
+            rows += n;
+
+            for (std::size_t k = 0; k < outputs.size(); ++k) {
+                auto& out = outputs[ k ];
+                if (not out.strings) {
+                    const auto size = std::size_t(reader.column_size( k ));
+                    write( out.values.get(), dst[ k ], std::size_t(n) * size );
+                    continue;
+                }
+
+                const auto& column = reader.strings( k );
+                write( out.values.get(), column.data.data(), column.data.size() );
+                out.shifted.clear();
+                for (std::size_t j = 1; j < column.offsets.size(); ++j)
+                    out.shifted.push_back( out.base + column.offsets[ j ] );
+                write( out.offsets.get(),
+                       out.shifted.data(),
+                       out.shifted.size() * sizeof( std::int64_t ) );
+                out.base += column.offsets.back();
+            }
+        }
+    }
+
+    std::string columns;
+    for (auto& out : outputs) {
+        const auto& ch = *out.channel;
+        const auto file = [&dir]( const std::string& path ) {
+            return quote( path.substr( dir.size() + 1 ) );
+        };
+
+        if (not columns.empty()) columns += ",\n";
+        columns += "    {" + obname_json( ch.name )
+                 + ", \"position\": " + std::to_string( out.position )
+                 + ", \"representation_code\": " + std::to_string( ch.reprc )
+                 + ",\n     \"units\": " + quote( ch.units )
+                 + ", \"long_name\": " + quote( ch.long_name )
+                 + ",\n     \"shape\": "
+                 + array( ch.shape == std::vector< long long >{ 1 }
+                        ? std::vector< long long >() : ch.shape );
+
+        if (out.strings) {
+            columns += ", \"dtype\": \"string\", \"data\": " + file( out.path )
+                     + ", \"offsets\": " + file( out.offsets_path ) + "}";
+            close( out.offsets, out.offsets_path );
+        } else {
+            columns += ", \"dtype\": " + dtype( out.fmt.front() )
+                     + ", \"file\": " + file( out.path ) + "}";
+        }
+        close( out.values, out.path );
+    }
+
+    std::string skips;
+    for (const auto& skip : skipped) {
+        if (not skips.empty()) skips += ",\n";
+        skips += "    " + skip;
+    }
+
+    const auto json = std::string( "{\n" )
+        + "  \"frame\": {" + obname_json( frame.name )
+        + ", \"index_type\": " + quote( frame.index_type )
+        + ", \"direction\": " + quote( frame.direction ) + "},\n"
+        + "  \"logical_file\": " + std::to_string( frame.logical_file ) + ",\n"
+        + "  \"rows\": " + std::to_string( rows ) + ",\n"
+        + "  \"columns\": " + list( columns ) + ",\n"
+        + "  \"skipped\": " + list( skips ) + "\n"
+        + "}\n";
+
+    /*
+     * Write the metadata to a temporary, and move it in place when it is
+     * complete, so that metadata.json is never partially written
+     */
+    const auto tmp = dir + "/metadata.json.tmp";
+    const auto path = dir + "/metadata.json";
+    auto meta = open_output( tmp );
+    write( meta.get(), json.data(), json.size() );
+    close( meta, tmp );
+    std::remove( path.c_str() );
+    if (std::rename( tmp.c_str(), path.c_str() ) != 0)
+        throw std::runtime_error( "unable to write " + path + ": "
+                                + std::strerror( errno ) );
+
+    return { std::to_string( frame.logical_file ) + "/" + name,
+             rows,
+             outputs.size() };
+}
+
+/*
+ * Drop the records of the logical file from the page cache. This is only a
+ * hint, so failing to is not an error.
+ */
+void release( dl::stream& file, const logical_file& lf ) noexcept (true) {
+    try {
+        std::vector< int > records;
+        for (int i = lf.first; i < lf.last; ++i)
+            records.push_back( i );
+
+        const auto* first = records.data();
+        file.advise( first, first + records.size(), dl::access_hint::dontneed );
+    } catch (...) {}
+}
+
+int run( const options& opts ) noexcept (false) {
+    dl::stream file( opts.input, true );
+    const auto lfs = inventory( file, opts );
+
+    std::vector< std::pair< const logical_file*, const frame_info* > > work;
+    for (const auto& lf : lfs) {
+        for (const auto& frame : lf.frames)
+            if (selected( frame, opts )) work.emplace_back( &lf, &frame );
+    }
+
+    makedir( opts.output );
+
+    /*
+     * The frames of a logical file may share pages, so its records can only
+     * be dropped once the last of its frames is converted
+     */
+    std::vector< std::atomic< int > > remaining( lfs.size() );
+    for (const auto& job : work)
+        remaining[ job.second->logical_file ].fetch_add( 1 );
+
+    /*
+     * Frames are independent, so every thread takes the next frame to
+     * convert until there are none left. The stream is memory-mapped, so the
+     * threads can all read from it at once.
+     */
+    std::atomic< std::size_t > next( 0 );
+    std::atomic< int > failures( 0 );
+    std::mutex print;
+    const auto worker = [&] {
+        while (true) {
+            const auto i = next.fetch_add( 1 );
+            if (i >= work.size()) return;
+
+            const auto& lf = *work[ i ].first;
+            const auto& frame = *work[ i ].second;
+            try {
+                const auto out = convert( file, lf, frame, opts );
+                if (not opts.quiet) {
+                    std::lock_guard< std::mutex > lock( print );
+                    std::printf( "%s: %lld rows, %zu columns\n",
+                                 out.directory.c_str(),
+                                 out.rows,
+                                 out.columns );
+                }
+            } catch (const std::exception& e) {
+                failures.fetch_add( 1 );
+                std::lock_guard< std::mutex > lock( print );
+                std::fprintf( stderr, "%s: frame %s (logical file %d): %s\n",
+                              opts.input.c_str(),
+                              dl::decay( frame.name.id ).c_str(),
+                              frame.logical_file,
+                              e.what() );
+            }
+
+            auto& left = remaining[ frame.logical_file ];
+            if (left.fetch_sub( 1 ) == 1 and not opts.keep_cache)
+                release( file, lf );
+        }
+    };
+
+    const auto nthreads = (std::min)( std::size_t(opts.threads), work.size() );
+    std::vector< std::thread > threads;
+    for (std::size_t i = 1; i < nthreads; ++i)
+        threads.emplace_back( worker );
+    worker();
+    for (auto& t : threads) t.join();
+
+    return failures.load() == 0 ? 0 : 1;
+}
+
+void usage( const char* argv0 ) {
+    std::fprintf( stderr,
+        "usage: %s [options] INPUT OUTPUT\n"
+        "convert the frames of the DLIS file INPUT to columnar files in the\n"
+        "directory OUTPUT\n"
+        "  --threads=N        frames converted in parallel (default: #cpus)\n"
+        "  --rows=N           rows decoded at a time (default 65536)\n"
+        "  --frames=A,B,...   only convert the frames with these names\n"
+        "  --quiet            do not print the converted frames\n"
+        "  --keep-cache       do not drop the converted logical files from\n"
+        "                     the page cache\n",
+        argv0
+    );
+}
+
+std::vector< std::string > split( const std::string& str, char sep ) {
+    std::vector< std::string > out;
+    std::size_t start = 0;
+    while (true) {
+        const auto end = str.find( sep, start );
+        out.push_back( str.substr( start, end - start ) );
+        if (end == std::string::npos) return out;
+        start = end + 1;
+    }
+}
+
+}
+
+int main( int argc, char** argv ) {
+    options opts;
+    std::vector< std::string > positional;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[ i ];
+            if (arg.compare( 0, 2, "--" ) != 0) {
+                positional.push_back( arg );
+                continue;
+            }
+
+            const auto eq = arg.find( '=' );
+            const auto key = arg.substr( 0, eq );
+            const auto val = eq == std::string::npos ? "" : arg.substr( eq + 1 );
+
+            if      (key == "--threads") opts.threads = std::stoi( val );
+            else if (key == "--rows")    opts.rows    = std::stoi( val );
+            else if (key == "--frames")  opts.frames  = split( val, ',' );
+            else if (key == "--quiet")   opts.quiet   = true;
+            else if (key == "--keep-cache") opts.keep_cache = true;
+            else {
+                usage( argv[ 0 ] );
+                return 2;
+            }
+        }
+    } catch (const std::exception&) {
+        usage( argv[ 0 ] );
+        return 2;
+    }
+
+    if (positional.size() != 2 or opts.threads < 1 or opts.rows < 1) {
+        usage( argv[ 0 ] );
+        return 2;
+    }
+    opts.input = positional[ 0 ];
+    opts.output = positional[ 1 ];
+
+    try {
+        return run( opts );
+    } catch (const std::exception& e) {
+        std::fprintf( stderr, "%s: %s\n", opts.input.c_str(), e.what() );
+        return 1;
+    }
+}
@@ -0,0 +1,68 @@
+# Convert small files with dlis-convert, and check the metadata and the bytes
+# of the columns. Run with
+#
+#   cmake -DCONVERT=<dlis-convert> -DDATA=<dir> -DOUTPUT=<dir> -P convert.cmake
+#
+# where DATA is the directory of the test files, python/data
+
+function(convert input name)
+    execute_process(
+        COMMAND ${CONVERT} --quiet ${DATA}/${input} ${OUTPUT}/${name}
+        RESULT_VARIABLE status
+    )
+    if (NOT status EQUAL 0)
+        message(FATAL_ERROR "dlis-convert ${input} failed: ${status}")
+    endif ()
+endfunction()
+
+function(expect_metadata dir)
+    file(READ ${dir}/metadata.json meta)
+    foreach (expected ${ARGN})
+        string(FIND "${meta}" "${expected}" pos)
+        if (pos EQUAL -1)
+            message(FATAL_ERROR
+                "${dir}/metadata.json: expected '${expected}' in\n${meta}")
+        endif ()
+    endforeach ()
+endfunction()
+
+# the bytes of path, as hex, must be one of the expected hex strings
+function(expect_bytes path)
+    file(READ ${path} hex HEX)
+    list(FIND ARGN "${hex}" pos)
+    if (pos EQUAL -1)
+        message(FATAL_ERROR "${path}: expected ${ARGN}, was '${hex}'")
+    endif ()
+endfunction()
+
+file(REMOVE_RECURSE ${OUTPUT})
+file(MAKE_DIRECTORY ${OUTPUT})
+
+# two frames in one record, of numbers
+convert(chap4-7/iflr/reprcodes-x2/15-ushort.dlis ushort)
+set(dir ${OUTPUT}/ushort/0/FRAME-REPRCODE.10.0)
+expect_metadata(${dir}
+    "\"frame\": {\"name\": \"FRAME-REPRCODE\", \"origin\": 10, \"copy\": 0"
+    "\"logical_file\": 0"
+    "\"rows\": 2"
+    "{\"name\": \"CH15\", \"origin\": 10, \"copy\": 0, \"position\": 0"
+    "\"representation_code\": 15"
+    "\"shape\": [], \"dtype\": \"|u1\", \"file\": \"0.bin\"}"
+    "\"skipped\": []"
+)
+expect_bytes(${dir}/0.bin 06d9)
+
+# two frames in one record, of strings
+convert(chap4-7/iflr/reprcodes-x2/19-ident.dlis ident)
+set(dir ${OUTPUT}/ident/0/FRAME-REPRCODE.10.0)
+expect_metadata(${dir}
+    "\"rows\": 2"
+    "{\"name\": \"CH19\", \"origin\": 10, \"copy\": 0, \"position\": 0"
+    "\"dtype\": \"string\", \"data\": \"0.data\", \"offsets\": \"0.offsets\"}"
+)
+# "VALUE" and "SECOND-VALUE"
+expect_bytes(${dir}/0.data 56414c55455345434f4e442d56414c5545)
+expect_bytes(${dir}/0.offsets
+    000000000000000005000000000000001100000000000000
+    000000000000000000000000000000050000000000000011
+)
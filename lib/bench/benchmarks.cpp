@@ -0,0 +1,379 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <dlisio/dlisio.h>
+#include <dlisio/types.h>
+
+#include <dlisio/ext/frame.hpp>
+#include <dlisio/ext/io.hpp>
+#include <dlisio/ext/types.hpp>
+
+#include "synthetic.hpp"
+
+/*
+ * Benchmarks of the core decode paths
+ *
+ * A synthetic file is generated (see synthetic.hpp for the options), and then
+ * indexed, read and decoded in all the ways load and curves do. Every
+ * benchmark reports throughput in MB/s of input, and records/s.
+ */
+
+namespace {
+
+struct options {
+    dl::bench::synthetic file;
+    std::string path = "dlisio-benchmark.dlis";
+    bool keep = false;
+    int threads = 4;
+    /* least number of seconds to run the repeated benchmarks for */
+    double duration = 0.5;
+};
+
+using timer = std::chrono::steady_clock;
+
+double seconds_since( timer::time_point start ) {
+    const std::chrono::duration< double > elapsed = timer::now() - start;
+    return elapsed.count();
+}
+
+void report( const char* name, double secs, double bytes, double records ) {
+    std::printf( "%-36s %9.3f s %10.1f MB/s %14.0f records/s\n",
+                 name,
+                 secs,
+                 bytes / secs / (1024 * 1024),
+                 records / secs );
+}
+
+/*
+ * Run f repeatedly for at least duration seconds, and report the throughput,
+ * where every call processes bytes bytes and records records
+ */
+template < typename F >
+void repeat( const char* name,
+             double duration,
+             double bytes,
+             double records,
+             F f ) {
+    long long runs = 0;
+    const auto start = timer::now();
+    double secs;
+    do {
+        f();
+        ++runs;
+    } while ((secs = seconds_since( start )) < duration);
+
+    report( name, secs, bytes * runs, records * runs );
+}
+
+const char* frame_body( const dl::record_view& rec ) {
+    std::int32_t origin;
+    std::uint8_t copy;
+    std::int32_t frameno;
+    const auto* ptr = rec.begin();
+    ptr = dlis_obname( ptr, &origin, &copy, nullptr, nullptr );
+    return dlis_uvari( ptr, &frameno );
+}
+
+void bench( const options& opts ) {
+    mio::mmap_source file;
+    dl::map_source( file, opts.path );
+    const auto sul = dl::findsul( file );
+    const auto vrl = dl::findvrl( file, sul + 80 );
+    const double filesize = file.size();
+
+    dl::stream_offsets ofs;
+    const auto indexstart = timer::now();
+    ofs = dl::findoffsets( file, vrl );
+    report( "dlis_index_records (findoffsets)",
+            seconds_since( indexstart ),
+            filesize,
+            ofs.tells.size() );
+
+    const auto parallelstart = timer::now();
+    dl::findoffsets( file, vrl, opts.threads );
+    const auto parallel = "findoffsets (threads = "
+                        + std::to_string( opts.threads ) + ")";
+    report( parallel.c_str(),
+            seconds_since( parallelstart ),
+            filesize,
+            ofs.tells.size() );
+
+    /* explicits is non-zero for the explicitly formatted records */
+    const auto nrecords = int(ofs.tells.size());
+    std::vector< int > explicits;
+    std::vector< int > implicits;
+    for (int i = 0; i < nrecords; ++i) {
+        if (ofs.explicits[ i ]) explicits.push_back( i );
+        else                    implicits.push_back( i );
+    }
+
+    double recordbytes = 0;
+    {
+        dl::stream stream( opts.path );
+        stream.reindex( ofs.tells, ofs.residuals );
+        dl::record rec;
+        const auto start = timer::now();
+        for (int i = 0; i < nrecords; ++i) {
+            stream.at( i, rec );
+            recordbytes += rec.data.size();
+        }
+        report( "stream::at (pread)",
+                seconds_since( start ),
+                recordbytes,
+                nrecords );
+    }
+
+    {
+        std::vector< int > indices( nrecords );
+        for (int i = 0; i < nrecords; ++i) indices[ i ] = i;
+
+        dl::stream stream( opts.path );
+        stream.reindex( ofs.tells, ofs.residuals );
+        dl::record_view rec;
+        const auto start = timer::now();
+        dl::readahead records( stream, indices );
+        while (records.next( rec )) {}
+        report( "readahead (pread)",
+                seconds_since( start ),
+                recordbytes,
+                nrecords );
+    }
+
+    dl::stream stream( opts.path, true );
+    stream.reindex( ofs.tells, ofs.residuals );
+    {
+        dl::record_view rec;
+        const auto start = timer::now();
+        for (int i = 0; i < nrecords; ++i)
+            stream.at( i, rec );
+        report( "stream::at (mmap)",
+                seconds_since( start ),
+                recordbytes,
+                nrecords );
+    }
+
+    {
+        std::vector< int > indices( nrecords );
+        for (int i = 0; i < nrecords; ++i) indices[ i ] = i;
+
+        dl::record_batch batch;
+        const auto start = timer::now();
+        stream.extract( indices, batch );
+        report( "stream::extract (record_batch)",
+                seconds_since( start ),
+                recordbytes,
+                nrecords );
+    }
+
+    {
+        std::vector< dl::record > eflrs;
+        double bytes = 0;
+        for (auto i : explicits) {
+            eflrs.push_back( stream.at( i ) );
+            bytes += eflrs.back().data.size();
+        }
+
+        repeat( "parse_objects", opts.duration, bytes, eflrs.size(), [&] {
+            for (const auto& rec : eflrs) {
+                const auto* begin = rec.data.data();
+                dl::parse_objects( begin, begin + rec.data.size() );
+            }
+        });
+
+        repeat( "parse_flat_objects",
+                opts.duration,
+                bytes,
+                eflrs.size(),
+                [&] {
+            for (const auto& rec : eflrs) {
+                const auto* begin = rec.data.data();
+                dl::parse_flat_objects( begin, begin + rec.data.size() );
+            }
+        });
+    }
+
+    const auto fmt = dl::bench::synthetic_fmt( opts.file );
+    dl::record_view rec;
+    double fdatabytes = 0;
+    int packsize = 0;
+    for (auto i : implicits) {
+        stream.at( i, rec );
+        fdatabytes += rec.size();
+
+        int nread, nwrite;
+        dlis_packflen( fmt.c_str(), frame_body( rec ), &nread, &nwrite );
+        packsize = (std::max)( packsize, nwrite );
+    }
+
+    {
+        std::vector< char > dst( packsize );
+        const auto start = timer::now();
+        for (auto i : implicits) {
+            stream.at( i, rec );
+            dlis_packf( fmt.c_str(), frame_body( rec ), dst.data() );
+        }
+        report( "dlis_packf",
+                seconds_since( start ),
+                fdatabytes,
+                implicits.size() );
+    }
+
+    {
+        dlis_compiled_fmt* compiled;
+        if (dlis_compile_fmt( fmt.c_str(), &compiled ) != DLIS_OK)
+            throw std::runtime_error( "unable to compile " + fmt );
+
+        std::vector< char > dst( packsize );
+        const auto start = timer::now();
+        for (auto i : implicits) {
+            stream.at( i, rec );
+            dlis_packf_compiled( compiled, frame_body( rec ), dst.data(), 1,
+                                 nullptr, nullptr );
+        }
+        report( "dlis_packf_compiled",
+                seconds_since( start ),
+                fdatabytes,
+                implicits.size() );
+        dlis_free_fmt( compiled );
+    }
+
+    /*
+     * read_fdata (in the python extension) decodes numeric frames with the
+     * compiled projection - the frame_reader uses the same path, without
+     * writing to a numpy array
+     */
+    const auto layout = dl::compile_layout( fmt.c_str() );
+    if (not layout.numeric) {
+        std::printf( "%-36s skipped, frame is not numeric\n", "read_fdata" );
+        return;
+    }
+
+    {
+        const auto start = timer::now();
+        const auto plan = dl::plan_fdata( stream, implicits, fmt );
+        report( "plan_fdata",
+                seconds_since( start ),
+                fdatabytes,
+                plan.records() );
+    }
+
+    const int rows = 4096;
+    std::vector< char > block( std::size_t(rows) * layout.dst_size );
+
+    {
+        dl::frame_reader reader( stream, implicits, "", fmt, "" );
+        const auto start = timer::now();
+        while (reader.read( block.data(), rows ) > 0) {}
+        report( "read_fdata (all channels)",
+                seconds_since( start ),
+                fdatabytes,
+                implicits.size() );
+    }
+
+    {
+        std::vector< std::string > channels( 1, fmt.substr( 0, 1 ) );
+        for (int i = 1; i < opts.file.channels; ++i) {
+            const auto n = opts.file.dimension;
+            channels.push_back( fmt.substr( 1 + (i - 1) * n, n ) );
+        }
+
+        const std::vector< int > selected = { opts.file.channels - 1 };
+        auto projection = dl::compile_projection( channels, selected );
+        dl::frame_reader reader( stream, implicits, std::move( projection ) );
+        std::vector< char > column( std::size_t(rows) * reader.row_size() );
+        const auto start = timer::now();
+        while (reader.read( column.data(), rows ) > 0) {}
+        report( "read_fdata (last channel)",
+                seconds_since( start ),
+                fdatabytes,
+                implicits.size() );
+    }
+
+    {
+        std::vector< std::string > channels( 1, fmt.substr( 0, 1 ) );
+        for (int i = 1; i < opts.file.channels; ++i) {
+            const auto n = opts.file.dimension;
+            channels.push_back( fmt.substr( 1 + (i - 1) * n, n ) );
+        }
+
+        std::vector< int > selected( opts.file.channels );
+        for (int i = 0; i < opts.file.channels; ++i) selected[ i ] = i;
+
+        auto projection = dl::compile_projection( channels, selected );
+        dl::column_reader reader( stream, implicits, std::move( projection ) );
+        std::vector< std::vector< char > > columns( reader.columns() );
+        std::vector< char* > dst;
+        for (std::size_t k = 0; k < columns.size(); ++k) {
+            columns[ k ].resize( std::size_t(rows) * reader.column_size( k ) );
+            dst.push_back( columns[ k ].data() );
+        }
+
+        const auto start = timer::now();
+        while (reader.read( dst, rows ) > 0) {}
+        report( "column_reader (all channels)",
+                seconds_since( start ),
+                fdatabytes,
+                implicits.size() );
+    }
+}
+
+void usage( const char* argv0 ) {
+    std::fprintf( stderr,
+        "usage: %s [options]\n"
+        "  --file=PATH        synthetic file (default dlisio-benchmark.dlis)\n"
+        "  --keep=1           keep the synthetic file after benchmarking\n"
+        "  --threads=N        threads for the parallel benchmarks (default 4)\n"
+        "  --duration=S       least seconds for repeated benchmarks\n"
+        "%s",
+        argv0,
+        dl::bench::synthetic_usage()
+    );
+}
+
+}
+
+int main( int argc, char** argv ) {
+    options opts;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[ i ];
+            if (dl::bench::parse_synthetic_arg( arg, opts.file )) continue;
+
+            const auto eq = arg.find( '=' );
+            const auto key = arg.substr( 0, eq );
+            const auto val = eq == std::string::npos ? "" : arg.substr( eq + 1 );
+
+            if      (key == "--file")     opts.path     = val;
+            else if (key == "--keep")     opts.keep     = val != "0";
+            else if (key == "--threads")  opts.threads  = std::stoi( val );
+            else if (key == "--duration") opts.duration = std::stod( val );
+            else {
+                usage( argv[ 0 ] );
+                return 1;
+            }
+        }
+
+        const auto start = timer::now();
+        const auto frames = dl::bench::write_synthetic( opts.path, opts.file );
+        std::printf( "generated %s: %lld frames of %s in %.3f s\n\n",
+                     opts.path.c_str(),
+                     frames,
+                     dl::bench::synthetic_fmt( opts.file ).c_str(),
+                     seconds_since( start ) );
+
+        bench( opts );
+    } catch (const std::exception& e) {
+        std::fprintf( stderr, "%s\n", e.what() );
+        if (not opts.keep) std::remove( opts.path.c_str() );
+        return 1;
+    }
+
+    if (not opts.keep) std::remove( opts.path.c_str() );
+}
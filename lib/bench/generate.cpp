@@ -0,0 +1,33 @@
+#include <cstdio>
+#include <exception>
+#include <string>
+
+#include "synthetic.hpp"
+
+int main( int argc, char** argv ) {
+    if (argc < 2) {
+        std::fprintf( stderr, "usage: %s PATH [options]\n%s",
+                      argv[ 0 ], dl::bench::synthetic_usage() );
+        return 1;
+    }
+
+    try {
+        dl::bench::synthetic opts;
+        for (int i = 2; i < argc; ++i) {
+            if (dl::bench::parse_synthetic_arg( argv[ i ], opts )) continue;
+
+            std::fprintf( stderr, "unknown option %s\n%s",
+                          argv[ i ], dl::bench::synthetic_usage() );
+            return 1;
+        }
+
+        const auto frames = dl::bench::write_synthetic( argv[ 1 ], opts );
+        std::printf( "%s: %lld frames, format %s\n",
+                     argv[ 1 ],
+                     frames,
+                     dl::bench::synthetic_fmt( opts ).c_str() );
+    } catch (const std::exception& e) {
+        std::fprintf( stderr, "%s\n", e.what() );
+        return 1;
+    }
+}
@@ -0,0 +1,445 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include <dlisio/dlisio.h>
+#include <dlisio/types.h>
+
+#include "synthetic.hpp"
+
+namespace {
+
+/*
+ * A record body under construction, written to with the dlis_*o functions
+ */
+struct body {
+    std::vector< char > buf;
+
+    template < typename F, typename... Args >
+    void put( F f, Args... args ) {
+        char tmp[ 512 ];
+        const char* begin = tmp;
+        const char* end = static_cast< char* >( f( tmp, args... ) );
+        this->buf.insert( this->buf.end(), begin, end );
+    }
+
+    void ident( const std::string& s ) {
+        this->put( dlis_idento, std::uint8_t(s.size()), s.c_str() );
+    }
+
+    void ascii( const std::string& s ) {
+        this->put( dlis_asciio, std::int32_t(s.size()), s.c_str(), 0 );
+    }
+
+    void obname( int origin, int copy, const std::string& id ) {
+        this->put( dlis_obnameo, origin,
+                                 std::uint8_t(copy),
+                                 std::uint8_t(id.size()),
+                                 id.c_str() );
+    }
+
+    void ushort( int x ) {
+        this->put( dlis_ushorto, std::uint8_t(x) );
+    }
+
+    void uvari( int x ) {
+        this->put( dlis_uvario, x, 0 );
+    }
+
+    void raw( std::uint8_t x ) {
+        this->buf.push_back( char(x) );
+    }
+};
+
+/*
+ * Writes logical records, segmented and packed into visible records
+ */
+class recordwriter {
+public:
+    recordwriter( std::ofstream& out, const dl::bench::synthetic& opts ) :
+        out( out ),
+        visible_size( opts.visible_size ),
+        segment_size( opts.segment_size ),
+        padding( opts.padding )
+    {}
+
+    ~recordwriter() { this->flush(); }
+
+    void write( int type, bool isexplicit, const std::vector< char >& body );
+    void flush();
+
+    long long written = 0;
+
+private:
+    std::ofstream& out;
+    int visible_size;
+    int segment_size;
+    int padding;
+    std::vector< char > visible;
+};
+
+/* smallest segment allowed by RP66, header included */
+constexpr int min_segment = 16;
+
+void recordwriter::write( int type,
+                          bool isexplicit,
+                          const std::vector< char >& body ) {
+    std::size_t pos = 0;
+    bool first = true;
+
+    do {
+        /*
+         * The segment must fit in the remainder of the current visible
+         * record, and in segment_size, if set. Reserve a byte for padding the
+         * segment to even length.
+         */
+        auto avail = this->visible.empty()
+                   ? this->visible_size - DLIS_VRL_SIZE
+                   : this->visible_size - int(this->visible.size());
+        auto limit = avail;
+        if (this->segment_size > 0)
+            limit = (std::min)(limit, this->segment_size);
+
+        if (limit < min_segment + this->padding + 1) {
+            this->flush();
+            avail = this->visible_size - DLIS_VRL_SIZE;
+            limit = avail;
+            if (this->segment_size > 0)
+                limit = (std::min)(limit, this->segment_size);
+        }
+
+        const auto room = limit - DLIS_LRSH_SIZE - this->padding - 1;
+        const auto remaining = body.size() - pos;
+        const auto chunk = int((std::min)(remaining, std::size_t(room)));
+        const bool last = std::size_t(chunk) == remaining;
+
+        int pad = this->padding;
+        if ((DLIS_LRSH_SIZE + chunk + pad) % 2) ++pad;
+        if (DLIS_LRSH_SIZE + chunk + pad < min_segment)
+            pad = min_segment - DLIS_LRSH_SIZE - chunk;
+
+        std::uint8_t attrs = 0;
+        if (isexplicit) attrs |= DLIS_SEGATTR_EXFMTLR;
+        if (not first)  attrs |= DLIS_SEGATTR_PREDSEG;
+        if (not last)   attrs |= DLIS_SEGATTR_SUCCSEG;
+        if (pad > 0)    attrs |= DLIS_SEGATTR_PADDING;
+
+        const auto length = DLIS_LRSH_SIZE + chunk + pad;
+        auto& vr = this->visible;
+        if (vr.empty()) vr.resize( DLIS_VRL_SIZE );
+        vr.push_back( char(length >> 8) );
+        vr.push_back( char(length & 0xFF) );
+        vr.push_back( char(attrs) );
+        vr.push_back( char(type) );
+        vr.insert( vr.end(), body.begin() + pos, body.begin() + pos + chunk );
+        /* the last pad byte is the number of pad bytes */
+        if (pad > 0) {
+            vr.insert( vr.end(), pad - 1, '\0' );
+            vr.push_back( char(pad) );
+        }
+
+        pos += chunk;
+        first = false;
+    } while (pos < body.size());
+}
+
+void recordwriter::flush() {
+    auto& vr = this->visible;
+    if (vr.empty()) return;
+
+    const auto length = vr.size();
+    vr[ 0 ] = char(length >> 8);
+    vr[ 1 ] = char(length & 0xFF);
+    vr[ 2 ] = char(0xFF);
+    vr[ 3 ] = char(0x01);
+
+    this->out.write( vr.data(), vr.size() );
+    this->written += length;
+    vr.clear();
+}
+
+int reprcode( char f ) noexcept (false) {
+    switch (f) {
+        case DLIS_FMT_FSHORT: return DLIS_FSHORT;
+        case DLIS_FMT_FSINGL: return DLIS_FSINGL;
+        case DLIS_FMT_FSING1: return DLIS_FSING1;
+        case DLIS_FMT_FSING2: return DLIS_FSING2;
+        case DLIS_FMT_ISINGL: return DLIS_ISINGL;
+        case DLIS_FMT_VSINGL: return DLIS_VSINGL;
+        case DLIS_FMT_FDOUBL: return DLIS_FDOUBL;
+        case DLIS_FMT_FDOUB1: return DLIS_FDOUB1;
+        case DLIS_FMT_FDOUB2: return DLIS_FDOUB2;
+        case DLIS_FMT_CSINGL: return DLIS_CSINGL;
+        case DLIS_FMT_CDOUBL: return DLIS_CDOUBL;
+        case DLIS_FMT_SSHORT: return DLIS_SSHORT;
+        case DLIS_FMT_SNORM:  return DLIS_SNORM;
+        case DLIS_FMT_SLONG:  return DLIS_SLONG;
+        case DLIS_FMT_USHORT: return DLIS_USHORT;
+        case DLIS_FMT_UNORM:  return DLIS_UNORM;
+        case DLIS_FMT_ULONG:  return DLIS_ULONG;
+        case DLIS_FMT_UVARI:  return DLIS_UVARI;
+        case DLIS_FMT_IDENT:  return DLIS_IDENT;
+        case DLIS_FMT_ASCII:  return DLIS_ASCII;
+        case DLIS_FMT_ORIGIN: return DLIS_ORIGIN;
+        case DLIS_FMT_STATUS: return DLIS_STATUS;
+
+        default: {
+            const auto msg = "unsupported synthetic reprc '{}'";
+            throw std::invalid_argument( fmt::format( msg, f ) );
+        }
+    }
+}
+
+/*
+ * Write a plausible sample of reprc f to body
+ */
+template < typename Rng >
+void sample( body& b, char f, Rng& rng ) noexcept (false) {
+    std::uniform_real_distribution< float > real( -1000, 1000 );
+    std::uniform_int_distribution< int > integer( 0, 1 << 30 );
+    const auto x = real( rng );
+    const auto n = integer( rng );
+
+    switch (f) {
+        case DLIS_FMT_FSHORT:
+            /* no output function for fshort, any 2 bytes is valid */
+            b.raw( n >> 8 );
+            b.raw( n );
+            break;
+
+        case DLIS_FMT_FSINGL: b.put( dlis_fsinglo, x );              break;
+        case DLIS_FMT_FSING1: b.put( dlis_fsing1o, x, x / 100 );     break;
+        case DLIS_FMT_FSING2: b.put( dlis_fsing2o, x, x / 100, x );  break;
+        case DLIS_FMT_ISINGL: b.put( dlis_isinglo, x );              break;
+        case DLIS_FMT_VSINGL: b.put( dlis_vsinglo, x );              break;
+        case DLIS_FMT_FDOUBL: b.put( dlis_fdoublo, double(x) );      break;
+        case DLIS_FMT_FDOUB1: b.put( dlis_fdoub1o, double(x), 0.1 ); break;
+        case DLIS_FMT_FDOUB2: b.put( dlis_fdoub2o, double(x), 0.1, 0.2 );
+                              break;
+        case DLIS_FMT_CSINGL: b.put( dlis_csinglo, x, -x );          break;
+        case DLIS_FMT_CDOUBL: b.put( dlis_cdoublo, double(x), -1.0 ); break;
+        case DLIS_FMT_SSHORT: b.put( dlis_sshorto, std::int8_t(n) ); break;
+        case DLIS_FMT_SNORM:  b.put( dlis_snormo, std::int16_t(n) ); break;
+        case DLIS_FMT_SLONG:  b.put( dlis_slongo, std::int32_t(n) ); break;
+        case DLIS_FMT_USHORT: b.put( dlis_ushorto, std::uint8_t(n) ); break;
+        case DLIS_FMT_UNORM:  b.put( dlis_unormo, std::uint16_t(n) ); break;
+        case DLIS_FMT_ULONG:  b.put( dlis_ulongo, std::uint32_t(n) ); break;
+        case DLIS_FMT_UVARI:  b.uvari( n );                           break;
+        case DLIS_FMT_ORIGIN: b.put( dlis_origino, n );               break;
+        case DLIS_FMT_STATUS: b.put( dlis_statuso, n % 2 );           break;
+        case DLIS_FMT_IDENT:
+            b.ident( std::string( n % 16, 'a' + n % 26 ) );
+            break;
+        case DLIS_FMT_ASCII:
+            b.ascii( std::string( n % 64, 'A' + n % 26 ) );
+            break;
+
+        default:
+            reprcode( f );
+    }
+}
+
+std::string channelname( int i ) {
+    return i == 0 ? "INDEX" : fmt::format( "CH{}", i );
+}
+
+/* the template attribute component, with a label and a reprc */
+void attribute( body& b, const std::string& label, int reprc ) {
+    b.raw( DLIS_ROLE_ATTRIB | 1 << 4 | 1 << 2 );
+    b.ident( label );
+    b.ushort( reprc );
+}
+
+/* an object attribute component with a value and the default count */
+constexpr std::uint8_t value = DLIS_ROLE_ATTRIB | 1 << 0;
+/* an object attribute component with a count and values */
+constexpr std::uint8_t values = DLIS_ROLE_ATTRIB | 1 << 3 | 1 << 0;
+
+void set( body& b, const std::string& type ) {
+    b.raw( DLIS_ROLE_SET | 1 << 4 );
+    b.ident( type );
+}
+
+void object( body& b, const std::string& name ) {
+    b.raw( DLIS_ROLE_OBJECT | 1 << 4 );
+    b.obname( 1, 0, name );
+}
+
+}
+
+namespace dl { namespace bench {
+
+long long write_synthetic( const std::string& path, const synthetic& opts )
+noexcept (false) {
+    if (opts.channels < 1)
+        throw std::invalid_argument( "synthetic: channels must be >= 1" );
+    if (opts.dimension < 1)
+        throw std::invalid_argument( "synthetic: dimension must be >= 1" );
+    if (opts.reprc.empty())
+        throw std::invalid_argument( "synthetic: empty reprc" );
+    if (opts.visible_size < 64 or opts.visible_size > 0xFFFE
+                               or opts.visible_size % 2)
+        throw std::invalid_argument( "synthetic: visible_size must be an "
+                                     "even number in [64, 65534]" );
+    if (opts.segment_size != 0 and opts.segment_size < 48)
+        throw std::invalid_argument( "synthetic: segment_size must be 0 or "
+                                     ">= 48" );
+    if (opts.padding < 0 or opts.padding > 16)
+        throw std::invalid_argument( "synthetic: padding must be in [0, 16]" );
+
+    std::vector< char > channelfmt;
+    channelfmt.push_back( DLIS_FMT_FDOUBL );
+    for (int i = 1; i < opts.channels; ++i) {
+        const auto f = opts.reprc[ (i - 1) % opts.reprc.size() ];
+        /* throws on unsupported reprcs */
+        reprcode( f );
+        channelfmt.push_back( f );
+    }
+
+    std::ofstream out( path, std::ios::binary | std::ios::trunc );
+    if (not out) {
+        const auto msg = "synthetic: unable to open {}";
+        throw std::runtime_error( fmt::format( msg, path ) );
+    }
+
+    const auto sul = fmt::format( "{:>4}V1.00RECORD{:>5}{:<60}",
+                                  1, opts.visible_size, "Synthetic" );
+    out.write( sul.data(), sul.size() );
+
+    recordwriter writer( out, opts );
+    writer.written = sul.size();
+
+    {
+        body b;
+        set( b, "FILE-HEADER" );
+        attribute( b, "SEQUENCE-NUMBER", DLIS_ASCII );
+        attribute( b, "ID", DLIS_ASCII );
+        object( b, "5" );
+        b.raw( value ); b.ascii( "1" );
+        b.raw( value ); b.ascii( "synthetic" );
+        writer.write( DLIS_FHLR, true, b.buf );
+    }
+
+    {
+        body b;
+        set( b, "CHANNEL" );
+        attribute( b, "REPRESENTATION-CODE", DLIS_USHORT );
+        attribute( b, "DIMENSION", DLIS_UVARI );
+        for (int i = 0; i < opts.channels; ++i) {
+            object( b, channelname( i ) );
+            b.raw( value ); b.ushort( reprcode( channelfmt[ i ] ) );
+            b.raw( value ); b.uvari( i == 0 ? 1 : opts.dimension );
+        }
+        writer.write( DLIS_CHANNL, true, b.buf );
+    }
+
+    {
+        body b;
+        set( b, "FRAME" );
+        attribute( b, "INDEX-TYPE", DLIS_IDENT );
+        attribute( b, "CHANNELS", DLIS_OBNAME );
+        object( b, "MAIN" );
+        b.raw( value ); b.ident( "BOREHOLE-DEPTH" );
+        b.raw( values ); b.uvari( opts.channels );
+        for (int i = 0; i < opts.channels; ++i)
+            b.obname( 1, 0, channelname( i ) );
+        writer.write( DLIS_FRAME, true, b.buf );
+    }
+
+    std::mt19937 rng( opts.seed );
+    long long frames = 0;
+    body b;
+    while (writer.written < opts.size) {
+        ++frames;
+        if (frames > 0x3FFFFFFF)
+            throw std::invalid_argument( "synthetic: too many frames" );
+
+        b.buf.clear();
+        b.obname( 1, 0, "MAIN" );
+        b.uvari( int(frames) );
+        b.put( dlis_fdoublo, 0.1 * frames );
+        for (int i = 1; i < opts.channels; ++i) {
+            for (int k = 0; k < opts.dimension; ++k)
+                sample( b, channelfmt[ i ], rng );
+        }
+
+        /* FDATA is implicit record type 0 */
+        writer.write( 0, false, b.buf );
+    }
+
+    writer.flush();
+    if (not out) {
+        const auto msg = "synthetic: failed writing to {}";
+        throw std::runtime_error( fmt::format( msg, path ) );
+    }
+
+    return frames;
+}
+
+std::string synthetic_fmt( const synthetic& opts ) noexcept (false) {
+    std::string fmt( 1, DLIS_FMT_FDOUBL );
+    for (int i = 1; i < opts.channels; ++i) {
+        const auto f = opts.reprc.at( (i - 1) % opts.reprc.size() );
+        fmt.append( opts.dimension, f );
+    }
+    return fmt;
+}
+
+bool parse_synthetic_arg( const std::string& arg, synthetic& opts )
+noexcept (false) {
+    const auto eq = arg.find( '=' );
+    if (arg.compare( 0, 2, "--" ) != 0 or eq == std::string::npos)
+        return false;
+
+    const auto key = arg.substr( 2, eq - 2 );
+    const auto val = arg.substr( eq + 1 );
+
+    /* sizes can be given with a K, M or G suffix */
+    const auto size = [&val] {
+        std::size_t end;
+        auto x = std::stoll( val, &end );
+        const auto suffix = val.substr( end );
+        if      (suffix == "K") x <<= 10;
+        else if (suffix == "M") x <<= 20;
+        else if (suffix == "G") x <<= 30;
+        else if (not suffix.empty())
+            throw std::invalid_argument( "bad size suffix in " + val );
+        return x;
+    };
+
+    if      (key == "size")         opts.size         = size();
+    else if (key == "channels")     opts.channels     = std::stoi( val );
+    else if (key == "reprc")        opts.reprc        = val;
+    else if (key == "dimension")    opts.dimension    = std::stoi( val );
+    else if (key == "visible-size") opts.visible_size = int(size());
+    else if (key == "segment-size") opts.segment_size = int(size());
+    else if (key == "padding")      opts.padding      = std::stoi( val );
+    else if (key == "seed")         opts.seed         = std::stoul( val );
+    else return false;
+
+    return true;
+}
+
+const char* synthetic_usage() noexcept (true) {
+    return
+        "  --size=N           approximate file size, e.g. 2G (default 256M)\n"
+        "  --channels=N       channels in the frame, incl. index (default 16)\n"
+        "  --reprc=FMT        reprcs of the channels, as format characters,\n"
+        "                     cycled over the channels (default f)\n"
+        "  --dimension=N      samples per channel (default 1)\n"
+        "  --visible-size=N   max visible record length (default 8192)\n"
+        "  --segment-size=N   max segment length, 0 for unlimited (default 0)\n"
+        "  --padding=N        pad bytes per segment (default 0)\n"
+        "  --seed=N           seed for the sample values (default 0)\n"
+    ;
+}
+
+} }
@@ -0,0 +1,72 @@
+#ifndef DLISIO_BENCH_SYNTHETIC_HPP
+#define DLISIO_BENCH_SYNTHETIC_HPP
+
+#include <string>
+
+namespace dl { namespace bench {
+
+/*
+ * Parameters of a synthetic DLIS file
+ *
+ * The file is a single logical file, with a FILE-HEADER, a CHANNEL set, and
+ * a FRAME set of all the channels, followed by FDATA records of the frame
+ * until the file is (approximately) size bytes large. The first channel is
+ * the index, and is always an fdoubl of increasing values.
+ */
+struct synthetic {
+    /* approximate size of the file in bytes */
+    long long size = 256LL * 1024 * 1024;
+
+    /* number of channels in the frame, including the index */
+    int channels = 16;
+
+    /*
+     * the representation codes of the channels, as DLIS_FMT format
+     * characters, cycled over the non-index channels, e.g. "fFl" or "fs".
+     * Only fixed-size codes and strings (ident, ascii) are supported
+     */
+    std::string reprc = "f";
+
+    /* number of samples per channel, i.e. the channel dimension */
+    int dimension = 1;
+
+    /*
+     * maximum length of a visible record, and of a logical record segment,
+     * i.e. records longer than segment_size are split across segments. A
+     * segment_size of 0 means segments are only split at visible records
+     */
+    int visible_size = 8192;
+    int segment_size = 0;
+
+    /* pad bytes at the end of every segment, 0 for no padding */
+    int padding = 0;
+
+    /* seed for the values in the FDATA */
+    unsigned seed = 0;
+};
+
+/*
+ * Write the synthetic file described by opts to path, and return the number
+ * of FDATA records written
+ */
+long long write_synthetic( const std::string& path, const synthetic& opts )
+noexcept (false);
+
+/*
+ * The format string of a frame in the synthetic file described by opts
+ */
+std::string synthetic_fmt( const synthetic& opts ) noexcept (false);
+
+/*
+ * Parse a single --key=value command line argument into opts, and return
+ * false if the key is not a synthetic parameter
+ */
+bool parse_synthetic_arg( const std::string& arg, synthetic& opts )
+noexcept (false);
+
+/* usage text for the synthetic parameters */
+const char* synthetic_usage() noexcept (true);
+
+} }
+
+#endif // DLISIO_BENCH_SYNTHETIC_HPP
@@ -16,6 +16,15 @@ struct eof_error : public std::runtime_error {
     using std::runtime_error::runtime_error;
 };
 
+/*
+ * An FDATA record holds more than one frame, but was read without a plan
+ * (see dl::fdata_plan). Registered as core.MultipleFramesError, a
+ * NotImplementedError, so that callers can plan the records and read again.
+ */
+struct multiple_frames : public std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
 void runtime_warning( const char* msg ) {
     int err = PyErr_WarnEx( PyExc_RuntimeWarning, msg, 1 );
     if( err ) throw py::error_already_set();
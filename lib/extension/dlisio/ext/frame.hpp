@@ -0,0 +1,418 @@
+#ifndef DLISIO_EXT_FRAME_HPP
+#define DLISIO_EXT_FRAME_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <dlisio/ext/io.hpp>
+#include <dlisio/ext/types.hpp>
+
+namespace dl {
+
+/*
+ * Frame layout
+ *
+ * Every row in a frame (i.e. every frame in FDATA) is described by the same
+ * format string (see dlis_packf), and the layout never changes between rows.
+ * Interpreting the format string one character at a time for every row is
+ * wasteful, so instead compile it once into runs of consecutive values with
+ * the same representation code, and decode whole runs at a time.
+ *
+ * A run of N FSINGL values is then a single byte-swap of N*4 contiguous bytes,
+ * which is a lot faster than N calls to dlis_fsingl.
+ */
+struct layout_run {
+    char fmt;           /* DLIS_FMT_* of every value in the run */
+    int count;          /* number of consecutive values */
+    int src_size;       /* on-disk size of one value, 0 if variable */
+    int dst_size;       /* in-memory size of one value, 0 if variable */
+};
+
+struct frame_layout {
+    std::vector< layout_run > runs;
+
+    /*
+     * Size of a row on disk and in memory, respectively, or 0 if any value in
+     * the row is variable-sized. The frame number that precedes every row in
+     * FDATA is not a part of the layout.
+     */
+    int src_size = 0;
+    int dst_size = 0;
+
+    /*
+     * True if every value in the row is a plain number (integer, float or
+     * complex), i.e. no strings, object names, validated floats or date-times
+     */
+    bool numeric = true;
+
+    /*
+     * True if the row has object names that are decoded as codes in an
+     * obname_table, see compile_layout
+     */
+    bool interned = false;
+};
+
+/*
+ * Interned object names
+ *
+ * Object names in frames usually come from a handful of distinct values, e.g.
+ * the name of the tool in use, repeated in every row. The table assigns every
+ * distinct name a code, in the order they are first seen, so that a column of
+ * object names can be stored as a column of int32 codes and a short list of
+ * names, like a categorical.
+ */
+class obname_table {
+public:
+    std::int32_t intern( std::int32_t origin,
+                         std::uint8_t copy,
+                         const char* id,
+                         std::int32_t len ) noexcept (false);
+
+    const std::vector< obname >& names() const noexcept (true);
+
+private:
+    std::vector< obname > table;
+    std::unordered_map< std::string, std::int32_t > codes;
+    std::string key;
+};
+
+/*
+ * Compile the layout of the format string fmt.
+ *
+ * When native is true, values that python would otherwise make objects of are
+ * decoded as plain numbers:
+ *
+ * - validated floats (FSING1, FSING2, FDOUB1, FDOUB2) are written as
+ *   consecutive floats, i.e. (value, abs_err) or (value, lower, upper), like
+ *   dlis_packf does, and are numeric
+ * - object names (OBNAME) are written as the int32 code of the name in an
+ *   obname_table, and the layout is numeric and interned
+ */
+frame_layout compile_layout( const char* fmt, bool native = false )
+noexcept (false);
+
+/*
+ * Unpack a single row described by layout from src into dst, and return a
+ * pointer to the first byte past the row. The output is identical to
+ * dlis_packf with the format string the layout was compiled from.
+ *
+ * Object names in interned layouts are looked up in names, which must not be
+ * null then.
+ *
+ * Throws if the row would read past end.
+ */
+const char* unpack_row( const frame_layout& layout,
+                        const char* src,
+                        const char* end,
+                        char* dst,
+                        obname_table* names = nullptr ) noexcept (false);
+
+/*
+ * The bytes to skip over some channels in a frame. When all the skipped
+ * channels are fixed-width, size is the number of bytes, and nothing needs to
+ * be scanned. Otherwise, size is -1 and the bytes are found by scanning fmt
+ * with dlis_packflen.
+ */
+struct frame_skip {
+    int size = 0;
+    std::string fmt;
+};
+
+/*
+ * Skip over the channels in skip, starting at src, and return a pointer to
+ * the first byte past them. Throws if this would move past end.
+ */
+const char* skip( const frame_skip& skip,
+                  const char* src,
+                  const char* end ) noexcept (false);
+
+/*
+ * A subset of the channels in a frame, i.e. the columns to read, and the bytes
+ * inbetween them to skip.
+ */
+struct projected_column {
+    /* skip from the end of the previous column, or the start of the row */
+    frame_skip before;
+    std::string fmt;
+    frame_layout layout;
+};
+
+struct frame_projection {
+    std::vector< projected_column > columns;
+    /* skip from the end of the last column to the end of the row */
+    frame_skip after;
+
+    /* size of a projected row in memory, or 0 if it is variable-sized */
+    int dst_size = 0;
+    /* true if the layout of every column is numeric */
+    bool numeric = true;
+    /* true if the layout of any column is interned */
+    bool interned = false;
+};
+
+/*
+ * Compile the projection of the selected channels of a frame, where channels
+ * is the format string of every channel in the frame, in order. The selected
+ * indices must be strictly increasing, i.e. the columns are read in the order
+ * they appear in the frame.
+ *
+ * The bytes to skip are precomputed for runs of fixed-width channels, so that
+ * reading a few channels of a wide frame only costs as much as decoding those
+ * channels, and only variable-width channels (e.g. strings) must be scanned.
+ *
+ * The columns are compiled with compile_layout( fmt, native ).
+ */
+frame_projection compile_projection( const std::vector< std::string >& channels,
+                                     const std::vector< int >& selected,
+                                     bool native = false )
+noexcept (false);
+
+/*
+ * Like compile_projection, but for the frame pre_fmt + fmt + post_fmt, where
+ * fmt is read and the rest skipped
+ */
+frame_projection compile_projection( const std::string& pre_fmt,
+                                     const std::string& fmt,
+                                     const std::string& post_fmt,
+                                     bool native = false )
+noexcept (false);
+
+/*
+ * Unpack the projected columns of a single row from src into dst, and return
+ * a pointer to the end of the row, i.e. past the skipped trailing channels.
+ * The projection must be numeric, and names not null if it is interned.
+ */
+const char* project_row( const frame_projection& projection,
+                         const char* src,
+                         const char* end,
+                         char* dst,
+                         obname_table* names = nullptr ) noexcept (false);
+
+/*
+ * Row plan of the frames in a set of FDATA records
+ *
+ * An FDATA record usually holds a single frame (row), but may hold several,
+ * so the number of rows is not known from the number of records. When the
+ * rows are fixed-size on disk (frame_layout::src_size), the rows in a record
+ * are counted by stepping over the frame numbers and rows, without decoding
+ * anything. The output can then be allocated exactly once, and the
+ * destination of every record is known up front, also when decoding in
+ * parallel.
+ *
+ * first[k] is the first row of record k, and first.back() is the number of
+ * rows.
+ */
+struct fdata_plan {
+    std::vector< std::int64_t > first = { 0 };
+
+    std::int64_t rows() const noexcept (true);
+    std::int64_t rows( std::size_t k ) const noexcept (false);
+    std::size_t records() const noexcept (true);
+    /* true if every record holds exactly one row */
+    bool uniform() const noexcept (true);
+};
+
+/*
+ * The number of rows of src_size bytes in the FDATA record. Throws if the
+ * record does not hold a whole number of rows.
+ */
+int count_rows( const record_view& record, int src_size ) noexcept (false);
+
+/*
+ * The plan of the records at indices, where the frame is described by the
+ * format string fmt. Throws if the rows of fmt are not fixed-size.
+ */
+fdata_plan plan_fdata( stream& file,
+                       const std::vector< int >& indices,
+                       const std::string& fmt ) noexcept (false);
+
+fdata_plan plan_fdata( const record_batch& batch,
+                       const std::string& fmt ) noexcept (false);
+
+/*
+ * Block-wise reader of the frames in a set of FDATA records
+ *
+ * Reading all the frames of a long log at once needs memory for all of them,
+ * which for multi-dimensional (e.g. image) channels may be more than what is
+ * available. The frame_reader instead decodes n rows at a time into a buffer
+ * provided by the caller, so memory use is bounded by the buffer size, no
+ * matter the length of the log.
+ *
+ * Only the values in fmt are read, the values in pre_fmt and post_fmt are
+ * skipped. The layout of fmt must be numeric - everything else needs a host
+ * (i.e. python) representation, and must be read some other way.
+ *
+ * prefetch() starts decoding the next block in the background, so that the
+ * caller can process the previous block in the meantime. The blocks are
+ * decoded by a single worker thread, started by the first prefetch() and kept
+ * for the lifetime of the reader. The stream should be memory-mapped, or if
+ * it's not, it is read right away in prefetch() instead.
+ *
+ * The OS is advised to read the records of the block after the one being
+ * decoded ahead of time. With drop_behind, the records of a block are also
+ * dropped from the page cache once it's decoded, so that streaming through a
+ * file much larger than memory does not evict everything else. That only pays
+ * off if nothing else reads the same pages soon, e.g. another frame whose
+ * records are interleaved with this one's, so it is off by default.
+ */
+class frame_reader {
+public:
+    frame_reader( stream& file,
+                  std::vector< int > indices,
+                  const std::string& pre_fmt,
+                  const std::string& fmt,
+                  const std::string& post_fmt ) noexcept (false);
+
+    frame_reader( stream& file,
+                  std::vector< int > indices,
+                  frame_projection projection ) noexcept (false);
+
+    frame_reader( const frame_reader& ) = delete;
+    frame_reader& operator = ( const frame_reader& ) = delete;
+    ~frame_reader();
+
+    /*
+     * Read up to n rows into dst, which must hold at least n * row_size()
+     * bytes, and return the number of rows read. Returns 0 when all rows are
+     * read.
+     */
+    int read( char* dst, int n ) noexcept (false);
+
+    /*
+     * Start reading up to n rows into dst in the background. The rows are
+     * available when wait() returns, which returns the number of rows read,
+     * just like read(), or re-throws if the read failed. Nothing else should
+     * be done with the reader until wait() is called.
+     */
+    void prefetch( char* dst, int n ) noexcept (false);
+    int wait() noexcept (false);
+    bool pending() const noexcept (true);
+
+    /* size of a row in memory */
+    int row_size() const noexcept (true);
+    /*
+     * The number of records, and the index of the next record to read from.
+     * Records may hold more than one frame (row), and a read that stops in
+     * the middle of a record picks up the following frames in the next read,
+     * so tell() only moves past a record once all its frames are read. seek()
+     * moves to the first frame of a record.
+     */
+    std::size_t size() const noexcept (true);
+    std::size_t tell() const noexcept (true);
+    void seek( std::size_t record ) noexcept (false);
+
+    const frame_projection& projection() const noexcept (true);
+
+    bool drop_behind() const noexcept (true);
+    void drop_behind( bool ) noexcept (true);
+
+private:
+    stream* file;
+    std::vector< int > indices;
+    frame_projection plan;
+    std::size_t pos = 0;
+    /* the records before indices[advised] are already advised as willneed */
+    std::size_t advised = 0;
+    bool release = false;
+    record_view record;
+    /* the next frame in record, if the last read stopped in the middle of it */
+    const char* resume = nullptr;
+    std::future< int > next;
+
+    struct prefetch_job {
+        char* dst = nullptr;
+        int n = 0;
+        std::promise< int > rows;
+    };
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable cond;
+    prefetch_job job;
+    bool queued = false;
+    bool stop = false;
+
+    int decode( char* dst, int n ) noexcept (false);
+    void work() noexcept (true);
+};
+
+/*
+ * A column of strings, in the layout of arrow's string arrays, i.e. the k-th
+ * string is [data + offsets[k], data + offsets[k + 1])
+ */
+struct string_column {
+    std::vector< std::int32_t > offsets = { 0 };
+    std::vector< char > data;
+
+    std::size_t size() const noexcept (true);
+    void clear() noexcept (true);
+};
+
+/*
+ * Column-wise reader of the frames in a set of FDATA records
+ *
+ * The frame_reader writes rows, like numpy structured arrays. Columnar
+ * formats like arrow and parquet want a buffer per column though, and
+ * transposing the rows afterwards is another full copy. The column_reader
+ * decodes every projected column straight into its own buffer instead, n rows
+ * at a time.
+ *
+ * Columns of fixed-size values, i.e. the numeric columns, are written to a
+ * buffer provided by the caller, which holds column_size(k) bytes per row.
+ * Columns of strings (ident, ascii and units) are written to strings(k), which
+ * holds all the values of the column in the last block read, i.e. dimension
+ * values per row. No other representation codes are supported.
+ *
+ * The records are advised ahead of time, and optionally dropped behind, like
+ * for the frame_reader.
+ */
+class column_reader {
+public:
+    column_reader( stream& file,
+                   std::vector< int > indices,
+                   frame_projection projection ) noexcept (false);
+
+    /*
+     * Read up to n rows, where dst[k] is the buffer of column k, or nullptr
+     * for string columns, and return the number of rows read. Returns 0 when
+     * all rows are read.
+     */
+    int read( const std::vector< char* >& dst, int n ) noexcept (false);
+
+    std::size_t columns() const noexcept (true);
+    /* in-memory size of a row of column k, 0 for string columns */
+    int column_size( std::size_t k ) const noexcept (true);
+    bool strings_column( std::size_t k ) const noexcept (true);
+    const string_column& strings( std::size_t k ) const noexcept (false);
+
+    /* the number of records, and the index of the next, like frame_reader */
+    std::size_t size() const noexcept (true);
+    std::size_t tell() const noexcept (true);
+
+    const frame_projection& projection() const noexcept (true);
+
+    bool drop_behind() const noexcept (true);
+    void drop_behind( bool ) noexcept (true);
+
+private:
+    stream* file;
+    std::vector< int > indices;
+    frame_projection plan;
+    std::vector< string_column > text;
+    std::size_t pos = 0;
+    std::size_t advised = 0;
+    bool release = false;
+    record_view record;
+    const char* resume = nullptr;
+};
+
+}
+
+#endif //DLISIO_EXT_FRAME_HPP
@@ -2,13 +2,19 @@
 #define DLISIO_PYTHON_IO_HPP
 
 #include <array>
+#include <condition_variable>
+#include <exception>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <vector>
 
 #include <mio/mio.hpp>
 
+#include <dlisio/ext/stats.hpp>
 #include <dlisio/ext/types.hpp>
 
 namespace dl {
@@ -23,25 +29,380 @@ struct record {
     std::vector< char > data;
 };
 
+/*
+ * A record that does not (necessarily) own its data.
+ *
+ * When read from a memory-mapped stream, [ptr, ptr + len) points directly into
+ * the mapping for records that are contained in a single segment, and no bytes
+ * are copied. Only records that are split across segments are stitched
+ * together, in which case the body is copied into buffer, and ptr points into
+ * buffer. The view is only valid as long as the stream is open and the
+ * record_view is not used for reading another record.
+ *
+ * The buffer is kept around between reads, so re-using the same record_view
+ * for many records amortises the allocation.
+ */
+struct record_view {
+    bool isexplicit()  const noexcept (true);
+    bool isencrypted() const noexcept (true);
+
+    const char* begin() const noexcept (true);
+    const char* end()   const noexcept (true);
+    std::size_t size()  const noexcept (true);
+
+    int type;
+    std::uint8_t attributes;
+    bool consistent;
+    const char* ptr = nullptr;
+    std::size_t len = 0;
+    std::vector< char > buffer;
+};
+
+/*
+ * Many logical records, stored back-to-back in a single buffer.
+ *
+ * Record i is [data + offsets[i], data + offsets[i + 1]), and its headers are
+ * types[i], attributes[i] and consistent[i]. Extracting a batch of records
+ * makes (amortised) one allocation for all of them, rather than one
+ * std::vector per record, which dominates for files with lots of small
+ * records.
+ *
+ * Reading a batch with stream::extract clears it first, so the same batch can
+ * be re-used for many extractions.
+ */
+struct record_batch {
+    std::size_t size() const noexcept (true);
+    bool empty() const noexcept (true);
+
+    const char* begin( std::size_t i ) const noexcept (true);
+    const char* end( std::size_t i )   const noexcept (true);
+    std::size_t size( std::size_t i )  const noexcept (true);
+
+    bool isexplicit( std::size_t i )  const noexcept (true);
+    bool isencrypted( std::size_t i ) const noexcept (true);
+
+    /* a view of record i, which is valid for as long as the batch is */
+    record_view view( std::size_t i ) const noexcept (false);
+
+    void clear() noexcept (true);
+
+    std::vector< char > data;
+    std::vector< std::size_t > offsets = { 0 };
+    std::vector< int > types;
+    std::vector< std::uint8_t > attributes;
+    std::vector< std::uint8_t > consistent;
+};
+
+/*
+ * Parse the object sets of all the records in the batch, in order.
+ * Encrypted records are skipped.
+ */
+std::vector< object_set > parse_objects( const record_batch& )
+noexcept (false);
+
+/*
+ * Parse the flat object sets of the records in the batch that are selected by
+ * filter, in order. Sets of other types, and encrypted records, are skipped.
+ */
+std::vector< flat_object_set > parse_flat_objects( const record_batch&,
+                                                   const object_filter& )
+noexcept (false);
+
+std::vector< flat_object_set > parse_flat_objects( const std::vector< record >&,
+                                                   const object_filter& )
+noexcept (false);
+
+/*
+ * How a range of a file is about to be accessed, as a hint to the OS, e.g. to
+ * read ahead more aggressively, or to drop pages of the page cache that will
+ * not be read again.
+ */
+enum class access_hint {
+    normal,
+    sequential,
+    willneed,
+    dontneed,
+};
+
+/*
+ * Advise the OS of how the bytes [offset, offset + n) of the mapped file
+ * will be accessed, with madvise (and posix_fadvise) or PrefetchVirtualMemory.
+ * The range is rounded out to whole pages, except for dontneed, which is
+ * rounded in so that pages shared with the bytes around it are left alone.
+ *
+ * The hints are only hints - they never change what is read, and hints that
+ * are not supported by the platform, or out-of-range offsets, are ignored.
+ */
+void advise( const mio::mmap_source&,
+             long long offset,
+             long long n,
+             access_hint ) noexcept (true);
+
+/*
+ * Round [begin, end) of a file of size bytes out to whole pages of page bytes,
+ * or in if inner is true. The last page is only partially in the file, but the
+ * rest of it is not shared with anything, so a range that ends at end-of-file
+ * always includes it. Returns false if the range is empty after rounding.
+ */
+bool pagealign( long long& begin,
+                long long& end,
+                long long size,
+                long long page,
+                bool inner ) noexcept (true);
+
+/*
+ * A physical file, opened once and shared by all the streams that read from
+ * it, e.g. every logical file of a physical file, so that they don't each
+ * need their own descriptor, mapping and buffers.
+ *
+ * The file is either memory-mapped, or read with positional reads (pread),
+ * which don't move a shared file position. Reading does not modify the
+ * source, so any number of threads can read from it concurrently.
+ */
+class source {
+public:
+    source( const std::string& path, bool mapped ) noexcept (false);
+    ~source();
+
+    source( const source& ) = delete;
+    source& operator = ( const source& ) = delete;
+
+    /*
+     * Read n bytes at offset into dst. Throws if the file ends before
+     * offset + n.
+     */
+    void read( char* dst, long long offset, std::size_t n ) const
+        noexcept (false);
+
+    bool mapped() const noexcept (true);
+    const std::string& path() const noexcept (true);
+    long long size() const noexcept (true);
+
+    /* the mapping of the file, or nullptr if it is not mapped */
+    const char* data() const noexcept (true);
+    mio::mmap_source& mapping() noexcept (false);
+
+    /*
+     * Map the file again, or update the size for an unmapped file, so that
+     * bytes appended since the file was opened can be read. Any pointer
+     * into the old mapping is invalidated, for all the streams sharing it.
+     */
+    void remap() noexcept (false);
+
+    /*
+     * Unmap, or close, the file now. This closes the file for all the
+     * streams that share the source, which fail to read from it from then
+     * on, even if they are not closed themselves. To close the file once the
+     * last stream is done with it, close the streams instead, and the source
+     * goes away with its last stream.
+     */
+    void close() noexcept (true);
+
+    /*
+     * Advise the OS of how [offset, offset + n) will be accessed, see
+     * dl::advise. Unmapped files are advised with posix_fadvise, where
+     * available.
+     */
+    void advise( long long offset, long long n, access_hint ) const
+        noexcept (true);
+
+private:
+    std::string filepath;
+    mio::mmap_source map;
+    mio::file_handle_type handle = mio::invalid_handle;
+    long long filesize = 0;
+    bool is_mapped;
+};
+
+/*
+ * The extent of a record in the stream, i.e. the bytes of all its segments,
+ * headers, trailers and padding included, found from the segment headers
+ * alone without reading the bodies
+ */
+struct record_extent {
+    int index;
+    long long tell;
+    long long size;
+    int segments;
+
+    int type;
+    std::uint8_t attributes;
+    bool consistent;
+
+    bool isexplicit()  const noexcept (true);
+    bool isencrypted() const noexcept (true);
+};
+
+/*
+ * The records stream::extract reads the bodies of
+ *
+ * Whether to read a body is decided from the header of the first segment,
+ * i.e. the attributes and the type of the record, before anything else is
+ * read. The records that are not read are still in the batch, with their
+ * headers and an empty body, so that the batch lines up with the indices, but
+ * cost only a walk over their segment headers.
+ *
+ * Encrypted records can't be parsed anyway, and vendors sometimes put large
+ * amounts of data in them.
+ */
+struct extract_policy {
+    /* read the bodies of encrypted records */
+    bool encrypted = true;
+    /* only read the bodies of records of these types, or all if empty */
+    std::vector< int > types;
+
+    bool wants( int type, std::uint8_t attributes ) const noexcept (true);
+};
+
+/*
+ * A range of bytes of one of the physical files (sources) of a stream, with
+ * offset relative to the start of that file
+ */
+struct advice_range {
+    std::size_t file;
+    long long offset;
+    long long size;
+};
+
 class stream {
 public:
     explicit stream( const std::string& path ) noexcept (false);
+    /*
+     * Open the stream in memory-mapped mode if mapped is true. Records are
+     * then read directly from the mapping rather than with positional reads
+     * from the file, which is a lot faster for files with many records.
+     *
+     * A stream is not modified by reading records with at(), mapped or not,
+     * so multiple threads can read records from it concurrently, as long as
+     * every thread has its own record or record_view.
+     */
+    stream( const std::string& path, bool mapped ) noexcept (false);
+    /*
+     * Open the physical files of a storage set as a single memory-mapped
+     * stream. The files are laid out back-to-back, i.e. the file paths[k]
+     * starts at offsets()[k], which is the sum of the sizes of the files
+     * before it, and tells are offsets into this concatenation. A logical file
+     * that is segmented across physical files can then be read just like one
+     * that is not. No record can span two files.
+     */
+    explicit stream( const std::vector< std::string >& paths )
+        noexcept (false);
+    /*
+     * Read from the (shared) sources, laid out back-to-back like the paths of
+     * a storage set. The stream is mapped if all the sources are.
+     */
+    explicit stream( std::shared_ptr< source > file ) noexcept (false);
+    explicit stream( std::vector< std::shared_ptr< source > > files )
+        noexcept (false);
 
     record  at( int i ) noexcept (false);
     record& at( int i, record& ) noexcept (false);
+    record_view& at( int i, record_view& ) noexcept (false);
+
+    /*
+     * Read the records at indices into batch, in order
+     */
+    record_batch& extract( const std::vector< int >& indices,
+                           record_batch& batch )
+        noexcept (false);
+
+    /*
+     * Read the records at indices into batch, in order, but only the bodies of
+     * the records wanted by policy. The extents of the other records are
+     * appended to skipped, unless it is null.
+     */
+    record_batch& extract( const std::vector< int >& indices,
+                           record_batch& batch,
+                           const extract_policy& policy,
+                           std::vector< record_extent >* skipped = nullptr )
+        noexcept (false);
+
+    /*
+     * The extent of record i, from its segment headers. Only the headers are
+     * read, no matter the size of the record.
+     */
+    record_extent extent( int i ) noexcept (false);
 
     void reindex( const std::vector< long long >&,
                   const std::vector< int >& )
         noexcept (false);
 
+    /*
+     * Append records to the index, e.g. from tail_index::refresh, for
+     * records that were written after the stream was indexed
+     */
+    void extend( const std::vector< long long >&,
+                 const std::vector< int >& )
+        noexcept (false);
+
+    /*
+     * Map the files again, so that bytes appended to the (last) file since
+     * it was opened can be read. Only the last file of a storage set may
+     * grow.
+     *
+     * Any record_view into the old mapping is invalidated, so the stream, and
+     * any other stream sharing the source, must not be read from while it is
+     * re-mapped.
+     */
+    void remap() noexcept (false);
+
+    /*
+     * Release the sources. The files are closed when the last stream that
+     * shares them is closed or destroyed.
+     */
     void close();
 
     void read( char* dst, long long offset, int n );
 
+    /*
+     * Advise the OS of how the records [first, last) (indices, like for
+     * at()) are about to be accessed, e.g. willneed before decoding a block
+     * of FDATA, or dontneed once the block is consumed. Records that are
+     * adjacent in the file are advised as one range. Records that have not
+     * been indexed are ignored.
+     */
+    void advise( const int* first, const int* last, access_hint )
+        noexcept (true);
+
+    /*
+     * The byte ranges advise() hands to the sources, before they're rounded
+     * to pages
+     */
+    std::vector< advice_range >
+    advice_ranges( const int* first, const int* last, access_hint ) const
+        noexcept (false);
+
+    bool mapped() const noexcept (true);
+
+    /* offsets of the physical files in the stream */
+    const std::vector< long long >& offsets() const noexcept (true);
+
+    const std::vector< std::shared_ptr< source > >& sources() const
+        noexcept (true);
+
+    /*
+     * The records, segments and bytes read from this stream, and the time
+     * spent in extract. The stats are shared, so they can outlive the stream.
+     */
+    const std::shared_ptr< stats >& statistics() const noexcept (true);
+
 private:
-    std::fstream fs;
+    friend class readahead;
+
+    /*
+     * Walk the segment headers of record i into ext, like extent. If stop is
+     * not null, the walk stops after the header of the first segment if stop
+     * wants the record, and returns false, as ext is then incomplete.
+     */
+    bool walk_headers( int i, const extract_policy* stop, record_extent& ext )
+        noexcept (false);
+
+    std::vector< std::shared_ptr< source > > files;
+    std::vector< long long > bases = { 0 };
+    bool is_mapped = false;
     std::vector< long long > tells;
     std::vector< int > residuals;
+    std::shared_ptr< stats > counters = std::make_shared< stats >();
 
     /*
      * if this is true, there are no gaps inbetween tells, i.e. the file
@@ -53,6 +414,89 @@ private:
 };
 
 
+/*
+ * Tuning of the readahead. Records are read in chunks of (about) chunk_size
+ * bytes, and records that are at most max_gap bytes apart are read in the same
+ * chunk, which means reading (and discarding) the records inbetween is
+ * preferred over a seek. Up to depth chunks are read ahead of the consumer, by
+ * threads threads.
+ */
+struct readahead_options {
+    std::size_t chunk_size = 8 * 1024 * 1024;
+    long long max_gap = 64 * 1024;
+    int depth = 4;
+    int threads = 2;
+};
+
+/*
+ * Read the records at indices, in order, with the reads issued ahead of the
+ * consumer.
+ *
+ * stream::at on an unmapped stream is a couple of small reads per
+ * segment, which is slow on storage with high latency, like network file
+ * systems. The readahead instead plans large, coalesced reads of the byte
+ * ranges of the records up front, and a pool of threads keeps up to depth of
+ * them in flight, while the consumer decodes the records that are already
+ * read.
+ *
+ * The record_view from next() is only valid until the next call to next(). If
+ * a record can't be walked from the chunk it was read into, e.g. because the
+ * stream is indexed with non-contiguous offsets, it is read with stream::at,
+ * so errors are reported exactly like stream::at reports them. The stream
+ * must not be used by anyone else while the readahead is alive. For a
+ * memory-mapped stream, next() is just stream::at.
+ */
+class readahead {
+public:
+    readahead( stream& file,
+               std::vector< int > indices,
+               readahead_options opts = readahead_options() )
+        noexcept (false);
+
+    readahead( const readahead& ) = delete;
+    readahead& operator = ( const readahead& ) = delete;
+    ~readahead();
+
+    /*
+     * Read the next record into rec, and return false when all the records
+     * are read
+     */
+    bool next( record_view& rec ) noexcept (false);
+
+    /* number of records, and number of chunks read */
+    std::size_t size() const noexcept (true);
+    std::size_t chunks() const noexcept (true);
+
+private:
+    struct chunk {
+        long long begin;
+        long long end;
+    };
+
+    struct slot {
+        int chunk = -1;
+        std::vector< char > data;
+        std::exception_ptr error;
+    };
+
+    stream* file;
+    std::vector< int > indices;
+    readahead_options opts;
+    std::vector< chunk > plan;
+    std::vector< int > chunkof;
+    std::size_t pos = 0;
+
+    std::vector< slot > slots;
+    int nthreads = 0;
+    std::vector< std::thread > workers;
+    std::mutex mutex;
+    std::condition_variable cond;
+    int released = 0;
+    bool stop = false;
+
+    void work( int id ) noexcept (true);
+};
+
 struct stream_offsets {
     /*see dlis_index_records. only change is tells.
     tells here mean positive distance from the beginning of the file*/
@@ -72,6 +516,55 @@ stream_offsets findoffsets( mio::mmap_source& path,
                             long long from )
 noexcept (false);
 
+/*
+ * Find the offsets with up to threads threads, by splitting the file in
+ * chunks on visible record boundaries and indexing the chunks concurrently.
+ * The result is identical to the serial findoffsets, which is also used as a
+ * fallback when the chunks can't be stitched together.
+ */
+stream_offsets findoffsets( mio::mmap_source& path,
+                            long long from,
+                            int threads )
+noexcept (false);
+
+/*
+ * Incremental index of a file that is still being written.
+ *
+ * refresh() re-maps the file if its size has changed, and indexes only the
+ * bytes that were appended since the last refresh, resuming at the end of the
+ * last complete record.
+ * A record that is only partially written is not an error - the index stops
+ * before it, and picks it up again once the rest of it is written.
+ *
+ * The tells are offsets from the start of the file, like in findoffsets.
+ */
+class tail_index {
+public:
+    tail_index( const std::string& path, long long from ) noexcept (false);
+
+    /*
+     * Index the records appended since the last refresh, and return them.
+     * The offsets of all the records indexed so far are in offsets().
+     */
+    stream_offsets refresh() noexcept (false);
+
+    const stream_offsets& offsets() const noexcept (true);
+    mio::mmap_source& file() noexcept (true);
+
+    /* offset of the end of the last complete record */
+    long long indexed() const noexcept (true);
+    /* true if there is a partially written record after indexed() */
+    bool partial() const noexcept (true);
+
+private:
+    std::string path;
+    mio::mmap_source map;
+    stream_offsets ofs;
+    long long resume;
+    int residual = 0;
+    bool incomplete = false;
+};
+
 std::vector< std::pair< std::string, int > >
 findfdata(mio::mmap_source& file,
           const std::vector< int >& candidates,
@@ -79,6 +572,28 @@ findfdata(mio::mmap_source& file,
           const std::vector< int >& residuals)
 noexcept (false);
 
+/*
+ * The FDATA records of a frame, i.e. the indices of the records whose obname
+ * is the name of the frame, in file order
+ */
+struct fdata_group {
+    std::string fingerprint;
+    std::vector< std::int32_t > records;
+};
+
+/*
+ * Like findfdata, but grouped by frame. The frame of a record is identified
+ * by hashing (origin, copy, ident) straight from the file, so the fingerprint
+ * is only built once per frame, not once per record. The groups are ordered
+ * by the first record of the frame.
+ */
+std::vector< fdata_group >
+groupfdata(mio::mmap_source& file,
+           const std::vector< int >& candidates,
+           const std::vector< long long >& tells,
+           const std::vector< int >& residuals)
+noexcept (false);
+
 }
 
 #endif // DLISIO_PYTHON_IO_HPP
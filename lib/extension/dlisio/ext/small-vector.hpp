@@ -0,0 +1,480 @@
+#ifndef DLISIO_EXT_SMALL_VECTOR_HPP
+#define DLISIO_EXT_SMALL_VECTOR_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace dl {
+
+/*
+ * Vector with inline storage for a few small values
+ *
+ * Most attributes in a file are a single number, e.g. a float or an integer,
+ * and storing them in a std::vector means a heap allocation for a handful of
+ * bytes, for every attribute of every object. The small_vector stores up to
+ * inline_bytes of values inside the vector itself, and only allocates when
+ * there are more. It is the same size as a std::vector (on 64-bit), so it
+ * never costs more memory.
+ *
+ * Only trivially copyable values are stored inline, strings and other
+ * non-trivial types always go on the heap, just like in a std::vector.
+ *
+ * The interface is the subset of std::vector that dlisio uses, with the same
+ * semantics, except that iterators and references are invalidated by moving
+ * or swapping a vector that stores its values inline.
+ */
+template < typename T >
+class small_vector {
+public:
+    using value_type      = T;
+    using size_type       = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference       = T&;
+    using const_reference = const T&;
+    using pointer         = T*;
+    using const_pointer   = const T*;
+    using iterator        = T*;
+    using const_iterator  = const T*;
+
+    static constexpr std::size_t inline_bytes = 16;
+    static constexpr std::size_t inline_capacity =
+        std::is_trivially_copyable< T >::value
+        and alignof( T ) <= alignof( T* )
+        ? inline_bytes / sizeof( T )
+        : 0;
+
+    small_vector() noexcept (true) = default;
+    explicit small_vector( size_type n ) noexcept (false);
+    small_vector( size_type n, const T& x ) noexcept (false);
+    small_vector( std::initializer_list< T > ) noexcept (false);
+
+    template < typename InputIt,
+               typename = typename std::enable_if<
+                    not std::is_integral< InputIt >::value
+               >::type >
+    small_vector( InputIt first, InputIt last ) noexcept (false);
+
+    small_vector( const small_vector& ) noexcept (false);
+    small_vector( small_vector&& ) noexcept (true);
+    small_vector& operator = ( const small_vector& ) noexcept (false);
+    small_vector& operator = ( small_vector&& ) noexcept (true);
+    ~small_vector();
+
+    iterator begin() noexcept (true);
+    iterator end() noexcept (true);
+    const_iterator begin() const noexcept (true);
+    const_iterator end() const noexcept (true);
+    const_iterator cbegin() const noexcept (true);
+    const_iterator cend() const noexcept (true);
+
+    T* data() noexcept (true);
+    const T* data() const noexcept (true);
+
+    size_type size() const noexcept (true);
+    size_type capacity() const noexcept (true);
+    bool empty() const noexcept (true);
+    /* true if the values are stored in the vector itself */
+    bool local() const noexcept (true);
+
+    T& operator [] ( size_type i ) noexcept (true);
+    const T& operator [] ( size_type i ) const noexcept (true);
+    T& at( size_type i ) noexcept (false);
+    const T& at( size_type i ) const noexcept (false);
+    T& front() noexcept (true);
+    const T& front() const noexcept (true);
+    T& back() noexcept (true);
+    const T& back() const noexcept (true);
+
+    void reserve( size_type n ) noexcept (false);
+    void resize( size_type n ) noexcept (false);
+    void clear() noexcept (true);
+
+    void push_back( const T& x ) noexcept (false);
+    void push_back( T&& x ) noexcept (false);
+    template < typename... Args >
+    T& emplace_back( Args&&... args ) noexcept (false);
+    void pop_back() noexcept (true);
+
+    template < typename InputIt >
+    void assign( InputIt first, InputIt last ) noexcept (false);
+    void swap( small_vector& ) noexcept (true);
+
+    bool operator == ( const small_vector& ) const noexcept (true);
+    bool operator != ( const small_vector& ) const noexcept (true);
+
+private:
+    /*
+     * The inline buffer and the heap pointer share storage, the capacity
+     * tells which one is in use
+     */
+    union {
+        T* heap;
+        typename std::aligned_storage< inline_bytes, alignof( T* ) >::type
+            buffer;
+    };
+    std::uint32_t len = 0;
+    std::uint32_t cap = inline_capacity;
+
+    void grow( size_type n ) noexcept (false);
+    void take( small_vector& other ) noexcept (true);
+    void release() noexcept (true);
+};
+
+template < typename T >
+constexpr std::size_t small_vector< T >::inline_bytes;
+template < typename T >
+constexpr std::size_t small_vector< T >::inline_capacity;
+
+template < typename T >
+small_vector< T >::small_vector( size_type n ) noexcept (false) {
+    this->resize( n );
+}
+
+template < typename T >
+small_vector< T >::small_vector( size_type n, const T& x ) noexcept (false) {
+    this->reserve( n );
+    for (size_type i = 0; i < n; ++i)
+        this->push_back( x );
+}
+
+template < typename T >
+small_vector< T >::small_vector( std::initializer_list< T > xs )
+noexcept (false) {
+    this->assign( xs.begin(), xs.end() );
+}
+
+template < typename T >
+template < typename InputIt, typename >
+small_vector< T >::small_vector( InputIt first, InputIt last )
+noexcept (false) {
+    this->assign( first, last );
+}
+
+template < typename T >
+small_vector< T >::small_vector( const small_vector& other ) noexcept (false) {
+    if (inline_capacity > 0 and other.local()) {
+        std::memcpy( &this->buffer, &other.buffer, inline_bytes );
+        this->len = other.len;
+        return;
+    }
+
+    this->reserve( other.size() );
+    std::uninitialized_copy( other.begin(), other.end(), this->data() );
+    this->len = other.len;
+}
+
+template < typename T >
+small_vector< T >::small_vector( small_vector&& other ) noexcept (true) {
+    this->take( other );
+}
+
+template < typename T >
+small_vector< T >&
+small_vector< T >::operator = ( const small_vector& other ) noexcept (false) {
+    if (this != &other) {
+        small_vector tmp( other );
+        this->release();
+        this->take( tmp );
+    }
+    return *this;
+}
+
+template < typename T >
+small_vector< T >&
+small_vector< T >::operator = ( small_vector&& other ) noexcept (true) {
+    if (this != &other) {
+        this->release();
+        this->take( other );
+    }
+    return *this;
+}
+
+template < typename T >
+small_vector< T >::~small_vector() {
+    this->release();
+}
+
+template < typename T >
+typename small_vector< T >::iterator
+small_vector< T >::begin() noexcept (true) {
+    return this->data();
+}
+
+template < typename T >
+typename small_vector< T >::iterator
+small_vector< T >::end() noexcept (true) {
+    return this->data() + this->len;
+}
+
+template < typename T >
+typename small_vector< T >::const_iterator
+small_vector< T >::begin() const noexcept (true) {
+    return this->data();
+}
+
+template < typename T >
+typename small_vector< T >::const_iterator
+small_vector< T >::end() const noexcept (true) {
+    return this->data() + this->len;
+}
+
+template < typename T >
+typename small_vector< T >::const_iterator
+small_vector< T >::cbegin() const noexcept (true) {
+    return this->begin();
+}
+
+template < typename T >
+typename small_vector< T >::const_iterator
+small_vector< T >::cend() const noexcept (true) {
+    return this->end();
+}
+
+template < typename T >
+T* small_vector< T >::data() noexcept (true) {
+    if (this->local()) return reinterpret_cast< T* >( &this->buffer );
+    return this->heap;
+}
+
+template < typename T >
+const T* small_vector< T >::data() const noexcept (true) {
+    if (this->local()) return reinterpret_cast< const T* >( &this->buffer );
+    return this->heap;
+}
+
+template < typename T >
+std::size_t small_vector< T >::size() const noexcept (true) {
+    return this->len;
+}
+
+template < typename T >
+std::size_t small_vector< T >::capacity() const noexcept (true) {
+    return this->cap;
+}
+
+template < typename T >
+bool small_vector< T >::empty() const noexcept (true) {
+    return this->len == 0;
+}
+
+template < typename T >
+bool small_vector< T >::local() const noexcept (true) {
+    return this->cap <= inline_capacity;
+}
+
+template < typename T >
+T& small_vector< T >::operator [] ( size_type i ) noexcept (true) {
+    return this->data()[ i ];
+}
+
+template < typename T >
+const T& small_vector< T >::operator [] ( size_type i ) const noexcept (true) {
+    return this->data()[ i ];
+}
+
+template < typename T >
+T& small_vector< T >::at( size_type i ) noexcept (false) {
+    if (i >= this->size())
+        throw std::out_of_range( "small_vector::at: index out of range" );
+    return (*this)[ i ];
+}
+
+template < typename T >
+const T& small_vector< T >::at( size_type i ) const noexcept (false) {
+    if (i >= this->size())
+        throw std::out_of_range( "small_vector::at: index out of range" );
+    return (*this)[ i ];
+}
+
+template < typename T >
+T& small_vector< T >::front() noexcept (true) {
+    return *this->begin();
+}
+
+template < typename T >
+const T& small_vector< T >::front() const noexcept (true) {
+    return *this->begin();
+}
+
+template < typename T >
+T& small_vector< T >::back() noexcept (true) {
+    return *(this->end() - 1);
+}
+
+template < typename T >
+const T& small_vector< T >::back() const noexcept (true) {
+    return *(this->end() - 1);
+}
+
+template < typename T >
+void small_vector< T >::reserve( size_type n ) noexcept (false) {
+    if (n <= this->capacity()) return;
+
+    if (n > std::numeric_limits< std::uint32_t >::max())
+        throw std::length_error( "small_vector::reserve: too many elements" );
+
+    auto* values = static_cast< T* >( ::operator new( n * sizeof( T ) ) );
+    auto* src = this->data();
+    for (size_type i = 0; i < this->size(); ++i) {
+        ::new (values + i) T( std::move( src[ i ] ) );
+        src[ i ].~T();
+    }
+
+    /*
+     * The heap pointer overwrites the inline buffer, so only set it after
+     * the values are moved out
+     */
+    if (not this->local()) ::operator delete( this->heap );
+    this->heap = values;
+    this->cap = static_cast< std::uint32_t >( n );
+}
+
+template < typename T >
+void small_vector< T >::resize( size_type n ) noexcept (false) {
+    while (this->size() > n)
+        this->pop_back();
+
+    this->reserve( n );
+    auto* values = this->data();
+    for (size_type i = this->size(); i < n; ++i) {
+        ::new (values + i) T();
+        ++this->len;
+    }
+}
+
+template < typename T >
+void small_vector< T >::clear() noexcept (true) {
+    auto* values = this->data();
+    for (size_type i = 0; i < this->size(); ++i)
+        values[ i ].~T();
+    this->len = 0;
+}
+
+template < typename T >
+void small_vector< T >::push_back( const T& x ) noexcept (false) {
+    this->emplace_back( x );
+}
+
+template < typename T >
+void small_vector< T >::push_back( T&& x ) noexcept (false) {
+    this->emplace_back( std::move( x ) );
+}
+
+template < typename T >
+template < typename... Args >
+T& small_vector< T >::emplace_back( Args&&... args ) noexcept (false) {
+    if (this->size() < this->capacity()) {
+        auto* x = ::new (this->end()) T( std::forward< Args >( args )... );
+        ++this->len;
+        return *x;
+    }
+
+    /*
+     * The arguments may refer to values in this vector, which are moved when
+     * it grows, so make the new value first
+     */
+    T x( std::forward< Args >( args )... );
+    this->grow( this->size() + 1 );
+    auto* y = ::new (this->end()) T( std::move( x ) );
+    ++this->len;
+    return *y;
+}
+
+template < typename T >
+void small_vector< T >::pop_back() noexcept (true) {
+    this->back().~T();
+    --this->len;
+}
+
+template < typename T >
+template < typename InputIt >
+void small_vector< T >::assign( InputIt first, InputIt last ) noexcept (false) {
+    this->clear();
+    using traits = std::iterator_traits< InputIt >;
+    using category = typename traits::iterator_category;
+    if (std::is_base_of< std::forward_iterator_tag, category >::value)
+        this->reserve( std::size_t(std::distance( first, last )) );
+
+    for (; first != last; ++first)
+        this->emplace_back( *first );
+}
+
+template < typename T >
+void small_vector< T >::swap( small_vector& other ) noexcept (true) {
+    if (this == &other) return;
+    small_vector tmp;
+    tmp.take( other );
+    other.take( *this );
+    this->take( tmp );
+}
+
+template < typename T >
+bool small_vector< T >::operator == ( const small_vector& other )
+const noexcept (true) {
+    return this->size() == other.size()
+        && std::equal( this->begin(), this->end(), other.begin() );
+}
+
+template < typename T >
+bool small_vector< T >::operator != ( const small_vector& other )
+const noexcept (true) {
+    return !(*this == other);
+}
+
+template < typename T >
+void small_vector< T >::grow( size_type n ) noexcept (false) {
+    const auto doubled = 2 * this->capacity();
+    this->reserve( (std::max)( n, (std::max)( doubled, size_type(1) ) ) );
+}
+
+/*
+ * Steal the values of other, which must not be this, and leave it empty and
+ * without heap storage. This must be empty, and not own any heap storage.
+ */
+template < typename T >
+void small_vector< T >::take( small_vector& other ) noexcept (true) {
+    if (not other.local()) {
+        this->heap = other.heap;
+        this->len = other.len;
+        this->cap = other.cap;
+        other.len = 0;
+        other.cap = inline_capacity;
+        return;
+    }
+
+    /* inline values are trivially copyable, so just copy the buffer */
+    std::memcpy( &this->buffer, &other.buffer, inline_bytes );
+    this->len = other.len;
+    this->cap = inline_capacity;
+    other.len = 0;
+}
+
+/*
+ * Destroy the values and free the heap storage, if any, and make the vector
+ * empty
+ */
+template < typename T >
+void small_vector< T >::release() noexcept (true) {
+    this->clear();
+    if (not this->local()) ::operator delete( this->heap );
+    this->cap = inline_capacity;
+}
+
+template < typename T >
+void swap( small_vector< T >& lhs, small_vector< T >& rhs ) noexcept (true) {
+    lhs.swap( rhs );
+}
+
+}
+
+#endif //DLISIO_EXT_SMALL_VECTOR_HPP
@@ -0,0 +1,182 @@
+#ifndef DLISIO_EXT_STATS_HPP
+#define DLISIO_EXT_STATS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+/*
+ * Instrumentation of the hot paths, i.e. counters of the records, segments
+ * and bytes that are read, and the time spent in findoffsets, extract,
+ * parse_objects, findfdata and read_fdata.
+ *
+ * Collecting is on by default, and is compiled out by building with
+ * DLISIO_STATS=0, in which case the stats are always zero.
+ */
+#ifndef DLISIO_STATS
+    #define DLISIO_STATS 1
+#endif
+
+namespace dl {
+
+enum class counter {
+    bytes_indexed = 0,
+    records_indexed,
+    records_read,
+    segments_read,
+    records_stitched,
+    bytes_copied,
+    objects_parsed,
+    frames_decoded,
+    records_skipped,
+    bytes_skipped,
+};
+
+enum class phase {
+    findoffsets = 0,
+    extract,
+    parse_objects,
+    findfdata,
+    read_fdata,
+};
+
+constexpr std::size_t ncounters = 10;
+constexpr std::size_t nphases = 5;
+
+const char* name( counter ) noexcept (true);
+const char* name( phase ) noexcept (true);
+
+/*
+ * A set of counters and timers. Everything is an atomic, relaxed counter, so
+ * a stats can be added to by many threads at once, at the cost of an atomic
+ * add. Loops that count per record should collect in a stats_batch.
+ */
+class stats {
+public:
+    stats() noexcept (true);
+    stats( const stats& ) noexcept (true);
+    stats& operator = ( const stats& ) noexcept (true);
+
+    void add( counter, long long n ) noexcept (true);
+    /* add the time of one call to phase */
+    void add( phase, std::chrono::nanoseconds ) noexcept (true);
+    void merge( const stats& ) noexcept (true);
+    void reset() noexcept (true);
+
+    long long get( counter ) const noexcept (true);
+    long long calls( phase ) const noexcept (true);
+    double seconds( phase ) const noexcept (true);
+
+private:
+    std::array< std::atomic< long long >, ncounters > counters;
+    std::array< std::atomic< long long >, nphases > nanoseconds;
+    std::array< std::atomic< long long >, nphases > ncalls;
+};
+
+/*
+ * The stats of the calling thread, or nullptr if nothing is collected. The
+ * functions that don't have a stream to count to, like findoffsets and
+ * parse_objects, count to the current stats.
+ */
+stats* current_stats() noexcept (true);
+
+/*
+ * Make target the current stats of this thread, until the scope is destroyed.
+ * Scopes nest, and target can be nullptr, to collect nothing.
+ */
+class stats_scope {
+public:
+    explicit stats_scope( stats* target ) noexcept (true);
+    ~stats_scope() noexcept (true);
+
+    stats_scope( const stats_scope& ) = delete;
+    stats_scope& operator = ( const stats_scope& ) = delete;
+
+private:
+    stats* previous;
+};
+
+/*
+ * Collect the counts to target from this thread in plain counters, and add
+ * them to target when the batch is destroyed.
+ *
+ * Every record read is a handful of counts, and when many threads read from
+ * the same stream they would all add to the same atomics, i.e. the same cache
+ * line, once per record. The loops that read many records instead keep a
+ * batch alive, which costs a few atomic adds per loop. Batches nest like
+ * scopes, and counts to other stats than target are not batched.
+ */
+class stats_batch {
+public:
+    explicit stats_batch( stats* target ) noexcept (true);
+    ~stats_batch() noexcept (true);
+
+    stats_batch( const stats_batch& ) = delete;
+    stats_batch& operator = ( const stats_batch& ) = delete;
+
+    /* add the collected counts to target, and start over */
+    void flush() noexcept (true);
+
+#if DLISIO_STATS
+    stats* target() const noexcept (true) { return this->into; }
+
+    void add( counter c, long long n ) noexcept (true) {
+        this->counters[ static_cast< std::size_t >( c ) ] += n;
+    }
+
+private:
+    stats* into;
+    stats_batch* previous;
+    std::array< long long, ncounters > counters;
+#endif
+};
+
+/*
+ * The innermost batch of the calling thread, or nullptr
+ */
+stats_batch* current_batch() noexcept (true);
+
+/*
+ * Add the time from construction to destruction to phase of target
+ */
+class scoped_timer {
+public:
+    scoped_timer( stats* target, phase ) noexcept (true);
+    explicit scoped_timer( phase p ) noexcept (true);
+    ~scoped_timer() noexcept (true);
+
+    scoped_timer( const scoped_timer& ) = delete;
+    scoped_timer& operator = ( const scoped_timer& ) = delete;
+
+private:
+#if DLISIO_STATS
+    stats* target;
+    phase p;
+    std::chrono::steady_clock::time_point start;
+#endif
+};
+
+inline void count( stats* target, counter c, long long n = 1 ) noexcept (true) {
+#if DLISIO_STATS
+    if (not target) return;
+
+    auto* batch = current_batch();
+    if (batch and batch->target() == target) batch->add( c, n );
+    else                                     target->add( c, n );
+#else
+    (void) target; (void) c; (void) n;
+#endif
+}
+
+inline void count( counter c, long long n = 1 ) noexcept (true) {
+#if DLISIO_STATS
+    count( current_stats(), c, n );
+#else
+    (void) c; (void) n;
+#endif
+}
+
+}
+
+#endif // DLISIO_EXT_STATS_HPP
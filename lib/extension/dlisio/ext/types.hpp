@@ -4,6 +4,8 @@
 #include <complex>
 #include <cstdint>
 #include <exception>
+#include <regex>
+#include <string>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -13,6 +15,7 @@
 
 #include <dlisio/types.h>
 
+#include "small-vector.hpp"
 #include "strong-typedef.hpp"
 
 namespace dl {
@@ -358,36 +361,39 @@ template <> struct typeinfo< dl::units > {
  * the max-size-overhead isn't so bad (all vectors are the same size), but the
  * type-resolution only has to be done once, and the unstructuring of the
  * vector can be contained inside the visitor.
+ *
+ * The vectors are small_vectors, because most attributes are a single number,
+ * which is then stored in the variant itself instead of on the heap.
  */
 using value_vector = mpark::variant<
     mpark::monostate,
-    std::vector< fshort >,
-    std::vector< fsingl >,
-    std::vector< fsing1 >,
-    std::vector< fsing2 >,
-    std::vector< isingl >,
-    std::vector< vsingl >,
-    std::vector< fdoubl >,
-    std::vector< fdoub1 >,
-    std::vector< fdoub2 >,
-    std::vector< csingl >,
-    std::vector< cdoubl >,
-    std::vector< sshort >,
-    std::vector< snorm  >,
-    std::vector< slong  >,
-    std::vector< ushort >,
-    std::vector< unorm  >,
-    std::vector< ulong  >,
-    std::vector< uvari  >,
-    std::vector< ident  >,
-    std::vector< ascii  >,
-    std::vector< dtime  >,
-    std::vector< origin >,
-    std::vector< obname >,
-    std::vector< objref >,
-    std::vector< attref >,
-    std::vector< status >,
-    std::vector< units  >
+    small_vector< fshort >,
+    small_vector< fsingl >,
+    small_vector< fsing1 >,
+    small_vector< fsing2 >,
+    small_vector< isingl >,
+    small_vector< vsingl >,
+    small_vector< fdoubl >,
+    small_vector< fdoub1 >,
+    small_vector< fdoub2 >,
+    small_vector< csingl >,
+    small_vector< cdoubl >,
+    small_vector< sshort >,
+    small_vector< snorm  >,
+    small_vector< slong  >,
+    small_vector< ushort >,
+    small_vector< unorm  >,
+    small_vector< ulong  >,
+    small_vector< uvari  >,
+    small_vector< ident  >,
+    small_vector< ascii  >,
+    small_vector< dtime  >,
+    small_vector< origin >,
+    small_vector< obname >,
+    small_vector< objref >,
+    small_vector< attref >,
+    small_vector< status >,
+    small_vector< units  >
 >;
 
 /*
@@ -479,6 +485,78 @@ struct object_set {
     dl::object_vector objects;
 };
 
+/*
+ * Flat object sets
+ *
+ * Parsing an object_set makes a lot of small allocations - every object is a
+ * copy of the default object, every attribute a copy of the template
+ * attribute, and every value is a vector, often of strings. The
+ * flat_object_set stores the same information in a handful of contiguous
+ * buffers, which are allocated once per set rather than per attribute:
+ *
+ * - every string (idents, units, ascii, and the strings of obname, objref and
+ *   attref) is interned in a string table, and referred to by its id. The
+ *   empty string is always id 0
+ * - all values are packed back-to-back in a single values buffer, and
+ *   attributes refer to their value by offset. Numbers are stored as their
+ *   native type, and strings as their (int32) string id
+ * - objects only store the attributes that are set in the object itself, as
+ *   a slice of the attributes array, in the order they appear on disk. The
+ *   rest come from the template, just like in the object_set
+ *
+ * unflatten converts the flat set to an object_set. There is only the one
+ * parser - parse_objects and parse_template are parse_flat_objects followed by
+ * unflatten.
+ */
+struct string_table {
+    std::size_t size() const noexcept (true);
+    std::string at( std::int32_t ) const noexcept (false);
+
+    std::vector< char > chars;
+    std::vector< std::int32_t > offsets = { 0, 0 };
+};
+
+struct flat_attribute {
+    std::int32_t        label     = 0;
+    std::int32_t        count     = 1;
+    representation_code reprc     = representation_code::ident;
+    std::int32_t        units     = 0;
+    /* offset of the first element in values, or -1 if there is no value */
+    std::int32_t        value     = -1;
+    bool                invariant = false;
+    /* the attribute is marked absent (ABSATR) in the object */
+    bool                absent    = false;
+};
+
+struct flat_object {
+    std::int32_t origin;
+    std::uint8_t copy;
+    std::int32_t id;
+    /* the attributes set in this object are [first, first + size) */
+    std::int32_t first;
+    std::int32_t size;
+};
+
+struct flat_object_set {
+    int role;
+    std::int32_t type = 0;
+    std::int32_t name = 0;
+    std::vector< flat_attribute > tmpl;
+    std::vector< flat_object > objects;
+    std::vector< flat_attribute > attributes;
+    std::vector< char > values;
+    string_table strings;
+};
+
+flat_object_set parse_flat_objects( const char*, const char* )
+noexcept (false);
+
+/* the value of a single attribute in the flat object set */
+value_vector flat_value( const flat_object_set&, const flat_attribute& )
+noexcept (false);
+
+object_set unflatten( const flat_object_set& ) noexcept (false);
+
 const char* parse_template( const char* begin,
                             const char* end,
                             object_template& ) noexcept (false);
@@ -486,6 +564,62 @@ const char* parse_template( const char* begin,
 
 object_set parse_objects( const char*, const char* ) noexcept (false);
 
+/*
+ * Parse only the type of the set in the EFLR [begin, end), which is much
+ * cheaper than parsing the template and objects, and enough to decide if the
+ * set is interesting at all
+ */
+ident parse_set_type( const char*, const char* ) noexcept (false);
+
+/*
+ * Selection of the object sets and objects to parse
+ *
+ * Opening a file with lots of metadata is mostly spent parsing objects that
+ * are never looked at. The filter selects sets by type, and objects by name,
+ * which is decided from the set type and the object name alone. Sets of other
+ * types are skipped without parsing their template, and other objects are
+ * stepped over attribute by attribute, from the count and representation
+ * code, without decoding or storing any values.
+ *
+ * Without types, sets of any type are selected. Without names and pattern,
+ * objects of any name are selected, otherwise objects with one of the names,
+ * or with a name that matches pattern, are. Like dlis.match, the pattern is
+ * matched from the start of the name, and is not case-sensitive. Unlike
+ * dlis.match, which uses python's re, the pattern is a std::regex with the
+ * ECMAScript syntax, which does not have e.g. named groups or inline flags.
+ */
+class object_filter {
+public:
+    object_filter() = default;
+    object_filter( std::vector< std::string > types,
+                   std::vector< std::string > names,
+                   const std::string& pattern ) noexcept (false);
+
+    bool type( const char* str, std::int32_t len ) const noexcept (true);
+    bool name( const char* str, std::int32_t len ) const noexcept (false);
+    /* true if objects of any name are selected */
+    bool any_name() const noexcept (true);
+
+    const std::vector< std::string >& types() const noexcept (true);
+    const std::vector< std::string >& names() const noexcept (true);
+    const std::string& pattern() const noexcept (true);
+
+private:
+    std::vector< std::string > settypes;
+    std::vector< std::string > objnames;
+    std::string source;
+    std::regex regex;
+};
+
+/*
+ * Parse the set in [begin, end), but only the objects selected by filter. The
+ * set is parsed regardless of its type, see parse_flat_objects(batch, filter).
+ */
+flat_object_set parse_flat_objects( const char*,
+                                    const char*,
+                                    const object_filter& )
+noexcept (false);
+
 }
 
 #endif //DLISIO_EXT_TYPES_HPP
@@ -308,6 +308,66 @@ int dlis_packf( const char* fmt, const void* src, void* dst );
 DLISIO_API
 int dlis_packflen(const char* fmt, const void* src, int* nread, int* nwrite);
 
+/*
+ * Compiled format strings for dlis_packf
+ *
+ * dlis_packf interprets fmt one character at a time, for every call. When the
+ * same format is used over and over, e.g. for every frame in a file, the
+ * format can be compiled once with dlis_compile_fmt, and then applied with
+ * dlis_packf_compiled. Compiling resolves the specifiers up front, and fuses
+ * runs of fixed-size IEEE and integer types, e.g. "ffffl", into a single
+ * byte-swapping copy.
+ *
+ * dlis_packf_compiled unpacks nrows consecutive rows of fmt from src, and
+ * writes them back-to-back into dst, exactly as nrows calls to dlis_packf
+ * would. dst can be NULL, in which case nothing is written, and only nread and
+ * nwrite are computed, like dlis_packflen. nread and nwrite can be NULL.
+ *
+ * dlis_compile_fmt returns DLIS_INVALID_ARGS if fmt contains any invalid
+ * format specifier, and DLIS_BAD_SIZE if memory could not be allocated. On
+ * failure, out is untouched. A compiled format must be released with
+ * dlis_free_fmt.
+ *
+ * nread and nwrite are ints, so the rows of one call must be at most INT_MAX
+ * bytes. dlis_packf_compiled returns DLIS_BAD_SIZE for fixed-size formats
+ * with more rows than that. For formats with variable-sized values
+ * it is up to the caller to keep within the limit.
+ *
+ * Like dlis_packf, dlis_packf_compiled trusts src to hold all the rows. The
+ * C++ extension (dl::compile_layout) compiles formats on its own, because it
+ * checks every row against the end of its record, and decodes some types
+ * differently than dlis_packf, e.g. object names as codes in a table. Both
+ * are tested to unpack exactly like dlis_packf.
+ *
+ * Example:
+ *
+ * dlis_compiled_fmt* fmt;
+ * err = dlis_compile_fmt("Uffi", &fmt);
+ * if (err) exit(1);
+ *
+ * for (int i = 0; i < nframes; ++i) {
+ *     dlis_packf_compiled(fmt, frames[i], dst, 1, NULL, &nwrite);
+ *     dst += nwrite;
+ * }
+ *
+ * dlis_free_fmt(fmt);
+ */
+typedef struct dlis_compiled_fmt dlis_compiled_fmt;
+
+DLISIO_API
+int dlis_compile_fmt(const char* fmt, dlis_compiled_fmt** out);
+
+DLISIO_API
+void dlis_free_fmt(dlis_compiled_fmt* fmt);
+
+DLISIO_API
+int dlis_packf_compiled(const dlis_compiled_fmt* fmt,
+                        const void* src,
+                        void* dst,
+                        int nrows,
+                        int* nread,
+                        int* nwrite);
+
 /*
  * Check if a format string for packing is var-size or fixed-size
  *
@@ -46,6 +46,24 @@ DLISIO_API const char* dlis_cdoubl(const char*, double* R, double* I);
 
 DLISIO_API const char* dlis_uvari(const char*, int32_t* out);
 
+/*
+ * Array versions of the fixed-size types, which convert n consecutive values
+ * and return a pointer to the first character past them. The output is
+ * identical to calling the scalar function n times, and out is written as n
+ * native values, with no alignment requirement. If out is NULL, nothing is
+ * written.
+ *
+ * Long runs of values, like curves, are converted with vectorised kernels:
+ * AVX2 on x86 (when the CPU supports it, checked at runtime), and NEON on
+ * aarch64.
+ */
+DLISIO_API const char* dlis_snorm_n( const char*, int n, void* out);
+DLISIO_API const char* dlis_slong_n( const char*, int n, void* out);
+DLISIO_API const char* dlis_fsingl_n(const char*, int n, void* out);
+DLISIO_API const char* dlis_fdoubl_n(const char*, int n, void* out);
+DLISIO_API const char* dlis_isingl_n(const char*, int n, void* out);
+DLISIO_API const char* dlis_vsingl_n(const char*, int n, void* out);
+
 DLISIO_API const char* dlis_ident(const char*, int32_t* len, char* out);
 DLISIO_API const char* dlis_ascii(const char*, int32_t* len, char* out);
 
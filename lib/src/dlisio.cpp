@@ -6,9 +6,13 @@
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <limits>
+#include <new>
 #include <string>
 #include <vector>
 
+#include <endianness/endianness.h>
+
 #include <dlisio/dlisio.h>
 #include <dlisio/types.h>
 
@@ -667,6 +671,97 @@ noexcept (true)
     return interpret( cur, f, init< typename bless< Args >::type >() ... );
 }
 
+cursor ascii(cursor cur) noexcept (true) {
+    /*
+     * ascii is variable-length and practically unbounded, so the string can't
+     * go through a fixed-size buffer like ident does. It's stored verbatim
+     * after the length though, so copy it straight from src
+     */
+    std::int32_t len;
+    cur.src = dlis_ascii(cur.src, &len, nullptr);
+    const auto written = pack(cur.dst, &len, cur.src - len);
+    cur.advance(written);
+    return cur;
+}
+
+cursor packone(char f, cursor cur) noexcept (true) {
+    switch (f) {
+        case DLIS_FMT_FSHORT: return interpret(cur, dlis_fshort);
+        case DLIS_FMT_FSINGL: return interpret(cur, dlis_fsingl);
+        case DLIS_FMT_FSING1: return interpret(cur, dlis_fsing1);
+        case DLIS_FMT_FSING2: return interpret(cur, dlis_fsing2);
+        case DLIS_FMT_ISINGL: return interpret(cur, dlis_isingl);
+        case DLIS_FMT_VSINGL: return interpret(cur, dlis_vsingl);
+        case DLIS_FMT_FDOUBL: return interpret(cur, dlis_fdoubl);
+        case DLIS_FMT_FDOUB1: return interpret(cur, dlis_fdoub1);
+        case DLIS_FMT_FDOUB2: return interpret(cur, dlis_fdoub2);
+        case DLIS_FMT_CSINGL: return interpret(cur, dlis_csingl);
+        case DLIS_FMT_CDOUBL: return interpret(cur, dlis_cdoubl);
+        case DLIS_FMT_SSHORT: return interpret(cur, dlis_sshort);
+        case DLIS_FMT_SNORM:  return interpret(cur, dlis_snorm );
+        case DLIS_FMT_SLONG:  return interpret(cur, dlis_slong );
+        case DLIS_FMT_USHORT: return interpret(cur, dlis_ushort);
+        case DLIS_FMT_UNORM:  return interpret(cur, dlis_unorm );
+        case DLIS_FMT_ULONG:  return interpret(cur, dlis_ulong );
+        case DLIS_FMT_UVARI:  return interpret(cur, dlis_uvari );
+        case DLIS_FMT_IDENT:  return interpret(cur, dlis_ident );
+        case DLIS_FMT_DTIME:  return interpret(cur, dlis_dtime );
+        case DLIS_FMT_ORIGIN: return interpret(cur, dlis_origin);
+        case DLIS_FMT_OBNAME: return interpret(cur, dlis_obname);
+        case DLIS_FMT_OBJREF: return interpret(cur, dlis_objref);
+        case DLIS_FMT_ATTREF: return interpret(cur, dlis_attref);
+        case DLIS_FMT_STATUS: return interpret(cur, dlis_status);
+        case DLIS_FMT_UNITS:  return interpret(cur, dlis_units );
+
+        case DLIS_FMT_ASCII:  return ascii(cur);
+
+        default:
+            return cur.invalidate();
+    }
+}
+
+/*
+ * Kernels for compiled format strings. A kernel unpacks n consecutive values
+ * of the same kind.
+ *
+ * The fixed-size IEEE and integer types are all stored as big-endian words,
+ * and unpacked into native words of the same size, so any run of them is
+ * just a byte-swapping copy. E.g. fsing1 is two 4-byte words, and "ffbl" is
+ * a run of five. The swaps, and the IBM and VAX floats, are done by the
+ * (vectorised) array functions, e.g. dlis_isingl_n.
+ */
+using kernel = void (*)(cursor&, int);
+
+void copied(cursor& cur, int n) noexcept (true) {
+    if (cur.dst) std::memcpy(cur.dst, cur.src, n);
+    cur.src += n;
+    cur.advance(n);
+}
+
+template < const char* (*func)(const char*, int, void*), int size >
+void arrayed(cursor& cur, int n) noexcept (true) {
+    cur.src = func(cur.src, n, cur.dst);
+    cur.advance(size * n);
+}
+
+/*
+ * The kernel for runs of f that can be converted with an array function, i.e.
+ * a single word, or nullptr
+ */
+kernel arraykernel(char f) noexcept (true) {
+    switch (f) {
+        case DLIS_FMT_SNORM:
+        case DLIS_FMT_UNORM:  return arrayed< dlis_snorm_n,  2 >;
+        case DLIS_FMT_SLONG:
+        case DLIS_FMT_ULONG:  return arrayed< dlis_slong_n,  4 >;
+        case DLIS_FMT_FSINGL: return arrayed< dlis_fsingl_n, 4 >;
+        case DLIS_FMT_FDOUBL: return arrayed< dlis_fdoubl_n, 8 >;
+        case DLIS_FMT_ISINGL: return arrayed< dlis_isingl_n, 4 >;
+        case DLIS_FMT_VSINGL: return arrayed< dlis_vsingl_n, 4 >;
+        default:              return nullptr;
+    }
+}
+
 cursor packf(const char* fmt, const char* src, char* dst) noexcept (true) {
     /*
      * The public dlis_packf function assumes both src and dst are valid
@@ -674,65 +769,125 @@ cursor packf(const char* fmt, const char* src, char* dst) noexcept (true) {
      * addition, packflen is *essentially* packf, but it outputs the
      * byte-count, instead of doing writes.
      *
-     * This function implements both these operations
+     * This function implements both these operations. Runs of the same
+     * fixed-size number, e.g. "iiii", are converted in one go.
      */
     cursor cur = {src, dst, 0};
 
-    std::vector< char > ascii;
-    while (true) {
-        switch (*fmt++) {
-            case DLIS_FMT_EOL:
-                return cur;
-
-            case DLIS_FMT_FSHORT: cur = interpret(cur, dlis_fshort); break;
-            case DLIS_FMT_FSINGL: cur = interpret(cur, dlis_fsingl); break;
-            case DLIS_FMT_FSING1: cur = interpret(cur, dlis_fsing1); break;
-            case DLIS_FMT_FSING2: cur = interpret(cur, dlis_fsing2); break;
-            case DLIS_FMT_ISINGL: cur = interpret(cur, dlis_isingl); break;
-            case DLIS_FMT_VSINGL: cur = interpret(cur, dlis_vsingl); break;
-            case DLIS_FMT_FDOUBL: cur = interpret(cur, dlis_fdoubl); break;
-            case DLIS_FMT_FDOUB1: cur = interpret(cur, dlis_fdoub1); break;
-            case DLIS_FMT_FDOUB2: cur = interpret(cur, dlis_fdoub2); break;
-            case DLIS_FMT_CSINGL: cur = interpret(cur, dlis_csingl); break;
-            case DLIS_FMT_CDOUBL: cur = interpret(cur, dlis_cdoubl); break;
-            case DLIS_FMT_SSHORT: cur = interpret(cur, dlis_sshort); break;
-            case DLIS_FMT_SNORM:  cur = interpret(cur, dlis_snorm ); break;
-            case DLIS_FMT_SLONG:  cur = interpret(cur, dlis_slong ); break;
-            case DLIS_FMT_USHORT: cur = interpret(cur, dlis_ushort); break;
-            case DLIS_FMT_UNORM:  cur = interpret(cur, dlis_unorm ); break;
-            case DLIS_FMT_ULONG:  cur = interpret(cur, dlis_ulong ); break;
-            case DLIS_FMT_UVARI:  cur = interpret(cur, dlis_uvari ); break;
-            case DLIS_FMT_IDENT:  cur = interpret(cur, dlis_ident ); break;
-            case DLIS_FMT_DTIME:  cur = interpret(cur, dlis_dtime ); break;
-            case DLIS_FMT_ORIGIN: cur = interpret(cur, dlis_origin); break;
-            case DLIS_FMT_OBNAME: cur = interpret(cur, dlis_obname); break;
-            case DLIS_FMT_OBJREF: cur = interpret(cur, dlis_objref); break;
-            case DLIS_FMT_ATTREF: cur = interpret(cur, dlis_attref); break;
-            case DLIS_FMT_STATUS: cur = interpret(cur, dlis_status); break;
-            case DLIS_FMT_UNITS:  cur = interpret(cur, dlis_units ); break;
-
-            case DLIS_FMT_ASCII: {
-                /*
-                 * ascii is variable-length and practically unbounded, so it
-                 * needs dynamic memory to be correct.
-                 */
-                std::int32_t len;
-                dlis_ascii(cur.src, &len, nullptr);
-                ascii.resize(len);
-                cur.src = dlis_ascii(cur.src, &len, ascii.data());
-                const auto written = pack(cur.dst, &len, ascii.data());
-                cur.advance(written);
-                break;
-            }
-
-            default:
-                return cur.invalidate();
+    while (*fmt != DLIS_FMT_EOL) {
+        const auto array = arraykernel(*fmt);
+        if (array) {
+            int n = 1;
+            while (fmt[n] == *fmt) ++n;
+            array(cur, n);
+            fmt += n;
+            continue;
         }
+
+        cur = packone(*fmt++, cur);
+        if (cur.invalid()) return cur;
     }
+
+    return cur;
+}
+
+template < typename F, F func >
+void repeated(cursor& cur, int n) noexcept (true) {
+    /*
+     * func is a compile-time constant, so interpret is inlined, and this is a
+     * tight loop over a single dlis_type function
+     */
+    for (int i = 0; i < n; ++i)
+        cur = interpret(cur, func);
 }
 
+void repeated_ascii(cursor& cur, int n) noexcept (true) {
+    for (int i = 0; i < n; ++i)
+        cur = ascii(cur);
 }
 
+/*
+ * The word size of the fixed-size types, and the number of words per value, or
+ * 0 if the type can't be unpacked as a byte-swapping copy
+ */
+struct word {
+    int size;
+    int count;
+};
+
+word words(char f) noexcept (true) {
+    switch (f) {
+        case DLIS_FMT_SSHORT:
+        case DLIS_FMT_USHORT: return { 1, 1 };
+        case DLIS_FMT_SNORM:
+        case DLIS_FMT_UNORM:  return { 2, 1 };
+        case DLIS_FMT_FSINGL:
+        case DLIS_FMT_SLONG:
+        case DLIS_FMT_ULONG:  return { 4, 1 };
+        case DLIS_FMT_FSING1:
+        case DLIS_FMT_CSINGL: return { 4, 2 };
+        case DLIS_FMT_FSING2: return { 4, 3 };
+        case DLIS_FMT_FDOUBL: return { 8, 1 };
+        case DLIS_FMT_FDOUB1:
+        case DLIS_FMT_CDOUBL: return { 8, 2 };
+        case DLIS_FMT_FDOUB2: return { 8, 3 };
+        default:              return { 0, 0 };
+    }
+}
+
+kernel swapkernel(int size) noexcept (true) {
+    switch (size) {
+        case 1:  return copied;
+        case 2:  return arrayed< dlis_snorm_n,  2 >;
+        case 4:  return arrayed< dlis_slong_n,  4 >;
+        default: return arrayed< dlis_fdoubl_n, 8 >;
+    }
+}
+
+#define DLIS_REPEATED(func) repeated< decltype(&func), func >
+
+kernel repeatkernel(char f) noexcept (true) {
+    switch (f) {
+        case DLIS_FMT_FSHORT: return DLIS_REPEATED(dlis_fshort);
+        case DLIS_FMT_ISINGL: return arrayed< dlis_isingl_n, 4 >;
+        case DLIS_FMT_VSINGL: return arrayed< dlis_vsingl_n, 4 >;
+        case DLIS_FMT_UVARI:  return DLIS_REPEATED(dlis_uvari );
+        case DLIS_FMT_IDENT:  return DLIS_REPEATED(dlis_ident );
+        case DLIS_FMT_DTIME:  return DLIS_REPEATED(dlis_dtime );
+        case DLIS_FMT_ORIGIN: return DLIS_REPEATED(dlis_origin);
+        case DLIS_FMT_OBNAME: return DLIS_REPEATED(dlis_obname);
+        case DLIS_FMT_OBJREF: return DLIS_REPEATED(dlis_objref);
+        case DLIS_FMT_ATTREF: return DLIS_REPEATED(dlis_attref);
+        case DLIS_FMT_STATUS: return DLIS_REPEATED(dlis_status);
+        case DLIS_FMT_UNITS:  return DLIS_REPEATED(dlis_units );
+        case DLIS_FMT_ASCII:  return repeated_ascii;
+        default:              return nullptr;
+    }
+}
+
+#undef DLIS_REPEATED
+
+struct op {
+    kernel f;
+    int count;
+};
+
+}
+
+struct dlis_compiled_fmt {
+    std::vector< op > ops;
+    /*
+     * if all of fmt is a single run of same-sized words, consecutive rows are
+     * also just one run, and can be unpacked in one go
+     */
+    bool fused;
+    /*
+     * the bytes of a row, the larger of on disk and in memory, or 0 if the
+     * values are variable-sized
+     */
+    int rowsize;
+};
+
 int dlis_packf( const char* fmt, const void* src, void* dst ) {
     assert(src);
     assert(dst);
@@ -759,6 +914,92 @@ int dlis_packflen(const char* fmt, const void* src, int* nread, int* nwrite) {
     return DLIS_OK;
 }
 
+int dlis_compile_fmt(const char* fmt, dlis_compiled_fmt** out) {
+    assert(fmt);
+    assert(out);
+
+    int src = 0;
+    int dst = 0;
+    if (dlis_pack_size(fmt, &src, &dst) != DLIS_OK) src = dst = 0;
+    const int rowsize = (std::max)(src, dst);
+
+    std::vector< op > ops;
+    /* the word size of the current run of byte-swapped words, or 0 */
+    int runsize = 0;
+
+    try {
+        for (; *fmt != DLIS_FMT_EOL; ++fmt) {
+            const auto w = words(*fmt);
+            if (w.size != 0) {
+                if (w.size == runsize) {
+                    ops.back().count += w.count;
+                } else {
+                    ops.push_back({ swapkernel(w.size), w.count });
+                    runsize = w.size;
+                }
+                continue;
+            }
+
+            runsize = 0;
+            const auto f = repeatkernel(*fmt);
+            if (!f) return DLIS_INVALID_ARGS;
+
+            if (!ops.empty() && ops.back().f == f)
+                ops.back().count += 1;
+            else
+                ops.push_back({ f, 1 });
+        }
+
+        const bool fused = ops.size() == 1 && runsize != 0;
+        *out = new dlis_compiled_fmt{ std::move(ops), fused, rowsize };
+    } catch (const std::bad_alloc&) {
+        return DLIS_BAD_SIZE;
+    }
+
+    return DLIS_OK;
+}
+
+void dlis_free_fmt(dlis_compiled_fmt* fmt) {
+    delete fmt;
+}
+
+int dlis_packf_compiled(const dlis_compiled_fmt* fmt,
+                        const void* src,
+                        void* dst,
+                        int nrows,
+                        int* nread,
+                        int* nwrite) {
+    if (!fmt || !src) return DLIS_INVALID_ARGS;
+    if (nrows < 0)    return DLIS_INVALID_ARGS;
+
+    /*
+     * The counts of bytes (and values) are ints, all the way to nread and
+     * nwrite, so all the rows must be at most INT_MAX bytes
+     */
+    const auto maxsize = (std::numeric_limits< int >::max)();
+    if (std::int64_t(fmt->rowsize) * nrows > maxsize)
+        return DLIS_BAD_SIZE;
+
+    auto csrc = static_cast< const char* >(src);
+    auto cdst = static_cast< char* >(dst);
+    cursor cur = {csrc, cdst, 0};
+
+    if (fmt->fused) {
+        /* a fused row is at least a byte per value, so this fits too */
+        const auto& run = fmt->ops.front();
+        run.f(cur, run.count * nrows);
+    } else {
+        for (int row = 0; row < nrows; ++row) {
+            for (const auto& op : fmt->ops)
+                op.f(cur, op.count);
+        }
+    }
+
+    if (nread)  *nread  = std::distance(csrc, cur.src);
+    if (nwrite) *nwrite = cur.written;
+    return DLIS_OK;
+}
+
 int dlis_pack_varsize(const char* fmt, int* src, int* dst) {
     int srcvar = 0;
     while (true) {
@@ -0,0 +1,982 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include <dlisio/dlisio.h>
+#include <dlisio/types.h>
+
+#include <dlisio/ext/frame.hpp>
+
+namespace {
+
+/*
+ * Convert n values one at a time with the dlis_* function f, for the types
+ * that are more than a byte swap and have no array function (fshort)
+ */
+template < typename T >
+const char* convert_n( const char* src,
+                       int n,
+                       char*& dst,
+                       const char* f( const char*, T* ) ) noexcept (true) {
+    for (int i = 0; i < n; ++i) {
+        T x;
+        src = f( src, &x );
+        std::memcpy( dst, &x, sizeof( x ) );
+        dst += sizeof( x );
+    }
+    return src;
+}
+
+int uvari_size( const char* src ) noexcept (true) {
+    /* see dlis_uvari - the length is encoded in the two high bits */
+    const std::uint8_t high = src[ 0 ] & 0xC0;
+    switch (high) {
+        case 0xC0: return 4;
+        case 0x80: return 2;
+        default:   return 1;
+    }
+}
+
+void overflow() noexcept (false) {
+    const auto msg = "corrupted record: fmtstr would read past end";
+    throw std::runtime_error( msg );
+}
+
+void truncated_header() noexcept (false) {
+    const auto msg = "corrupted record: FDATA too short for its frame header";
+    throw std::runtime_error( msg );
+}
+
+/*
+ * Skip the obname at the start of FDATA, and the frame number at the start of
+ * a row. Neither are needed to decode the values, but they must be in the
+ * record - an empty record body would otherwise be read past its end.
+ */
+const char* skip_obname( const char* ptr, const char* end ) noexcept (false) {
+    /* origin (uvari), copy (ushort), ident (ushort length + chars) */
+    if (ptr >= end) truncated_header();
+    const auto origin = uvari_size( ptr );
+    if (std::distance( ptr, end ) < origin + 2) truncated_header();
+    const auto size = origin + 2 + std::uint8_t( ptr[ origin + 1 ] );
+    if (std::distance( ptr, end ) < size) truncated_header();
+    return ptr + size;
+}
+
+const char* skip_frameno( const char* ptr, const char* end ) noexcept (false) {
+    if (ptr >= end or std::distance( ptr, end ) < uvari_size( ptr ))
+        truncated_header();
+    return ptr + uvari_size( ptr );
+}
+
+bool is_numeric( char f ) noexcept (true) {
+    switch (f) {
+        case DLIS_FMT_FSHORT:
+        case DLIS_FMT_FSINGL:
+        case DLIS_FMT_ISINGL:
+        case DLIS_FMT_VSINGL:
+        case DLIS_FMT_FDOUBL:
+        case DLIS_FMT_CSINGL:
+        case DLIS_FMT_CDOUBL:
+        case DLIS_FMT_SSHORT:
+        case DLIS_FMT_SNORM:
+        case DLIS_FMT_SLONG:
+        case DLIS_FMT_USHORT:
+        case DLIS_FMT_UNORM:
+        case DLIS_FMT_ULONG:
+        case DLIS_FMT_UVARI:
+        case DLIS_FMT_ORIGIN:
+        case DLIS_FMT_STATUS:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+bool is_validated( char f ) noexcept (true) {
+    switch (f) {
+        case DLIS_FMT_FSING1:
+        case DLIS_FMT_FSING2:
+        case DLIS_FMT_FDOUB1:
+        case DLIS_FMT_FDOUB2:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+/*
+ * Unpack a run from src into dst, advance dst past the written values, and
+ * return a pointer to the first byte past the run
+ */
+const char* unpack_run( const dl::layout_run& run,
+                        const char* src,
+                        const char* end,
+                        char*& dst,
+                        dl::obname_table* names ) noexcept (false) {
+    const auto n = run.count;
+    const auto size = n * run.dst_size;
+
+    if (run.src_size > 0 and std::distance( src, end ) < n * run.src_size)
+        overflow();
+
+    switch (run.fmt) {
+        case DLIS_FMT_SSHORT:
+        case DLIS_FMT_USHORT:
+        case DLIS_FMT_STATUS:
+            std::memcpy( dst, src, n );
+            dst += size;
+            return src + n;
+
+        /*
+         * The multi-byte integers and IEEE floats are all just byte-swapped,
+         * so the signed array functions work for the unsigned types too, and
+         * complex and validated floats are two or three consecutive floats
+         */
+        case DLIS_FMT_SNORM:
+        case DLIS_FMT_UNORM:
+            src = dlis_snorm_n( src, n, dst );
+            dst += size;
+            return src;
+
+        case DLIS_FMT_SLONG:
+        case DLIS_FMT_ULONG:
+            src = dlis_slong_n( src, n, dst );
+            dst += size;
+            return src;
+
+        case DLIS_FMT_FSINGL:
+            src = dlis_fsingl_n( src, n, dst );
+            dst += size;
+            return src;
+
+        case DLIS_FMT_CSINGL:
+        case DLIS_FMT_FSING1:
+            src = dlis_fsingl_n( src, n * 2, dst );
+            dst += size;
+            return src;
+
+        case DLIS_FMT_FSING2:
+            src = dlis_fsingl_n( src, n * 3, dst );
+            dst += size;
+            return src;
+
+        case DLIS_FMT_FDOUBL:
+            src = dlis_fdoubl_n( src, n, dst );
+            dst += size;
+            return src;
+
+        case DLIS_FMT_CDOUBL:
+        case DLIS_FMT_FDOUB1:
+            src = dlis_fdoubl_n( src, n * 2, dst );
+            dst += size;
+            return src;
+
+        case DLIS_FMT_FDOUB2:
+            src = dlis_fdoubl_n( src, n * 3, dst );
+            dst += size;
+            return src;
+
+        case DLIS_FMT_FSHORT: return convert_n( src, n, dst, dlis_fshort );
+        case DLIS_FMT_ISINGL:
+            src = dlis_isingl_n( src, n, dst );
+            dst += size;
+            return src;
+
+        case DLIS_FMT_VSINGL:
+            src = dlis_vsingl_n( src, n, dst );
+            dst += size;
+            return src;
+
+        case DLIS_FMT_UVARI:
+        case DLIS_FMT_ORIGIN:
+            /*
+             * origin is just an uvari in disguise, so they can take the same
+             * code path
+             */
+            for (int i = 0; i < n; ++i) {
+                if (src >= end) overflow();
+                if (std::distance( src, end ) < uvari_size( src )) overflow();
+
+                std::int32_t x;
+                src = dlis_uvari( src, &x );
+                std::memcpy( dst, &x, sizeof( x ) );
+                dst += sizeof( x );
+            }
+            return src;
+
+        case DLIS_FMT_OBNAME:
+            if (not names) {
+                const auto msg = "unpack_run: OBNAME without obname_table";
+                throw std::logic_error( msg );
+            }
+
+            for (int i = 0; i < n; ++i) {
+                if (src >= end) overflow();
+
+                /* an obname is an origin (uvari), a copy and an ident */
+                const auto osize = uvari_size( src );
+                if (std::distance( src, end ) < osize + 2) overflow();
+                const auto idlen = std::uint8_t(src[ osize + 1 ]);
+                if (std::distance( src, end ) < osize + 2 + idlen) overflow();
+
+                std::int32_t origin;
+                std::uint8_t copy;
+                std::int32_t len;
+                char id[ 255 ];
+                src = dlis_obname( src, &origin, &copy, &len, id );
+
+                const auto x = names->intern( origin, copy, id, len );
+                std::memcpy( dst, &x, sizeof( x ) );
+                dst += sizeof( x );
+            }
+            return src;
+
+        default: {
+            /*
+             * Everything that is not a plain number goes through packf, one
+             * value at a time
+             */
+            const char fmt[] = { run.fmt, '\0' };
+            for (int i = 0; i < n; ++i) {
+                int nread, nwrite;
+                dlis_packflen( fmt, src, &nread, &nwrite );
+                if (std::distance( src, end ) < nread) overflow();
+                dlis_packf( fmt, src, dst );
+                src += nread;
+                dst += nwrite;
+            }
+            return src;
+        }
+    }
+}
+
+bool is_string( char f ) noexcept (true) {
+    switch (f) {
+        case DLIS_FMT_IDENT:
+        case DLIS_FMT_ASCII:
+        case DLIS_FMT_UNITS:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+/*
+ * Append the n strings of run from src to column, and return a pointer to the
+ * first byte past them
+ */
+const char* unpack_strings( const dl::layout_run& run,
+                            const char* src,
+                            const char* end,
+                            dl::string_column& column ) noexcept (false) {
+    for (int i = 0; i < run.count; ++i) {
+        if (src >= end) overflow();
+
+        std::int32_t len;
+        if (run.fmt == DLIS_FMT_ASCII) {
+            if (std::distance( src, end ) < uvari_size( src )) overflow();
+            src = dlis_uvari( src, &len );
+        } else {
+            len = std::uint8_t(*src++);
+        }
+
+        if (std::distance( src, end ) < len) overflow();
+        column.data.insert( column.data.end(), src, src + len );
+        column.offsets.push_back( std::int32_t(column.data.size()) );
+        src += len;
+    }
+
+    return src;
+}
+
+}
+
+namespace dl {
+
+std::int32_t obname_table::intern( std::int32_t origin,
+                                   std::uint8_t copy,
+                                   const char* id,
+                                   std::int32_t len ) noexcept (false) {
+    /*
+     * The key is the name, as (origin, copy, id), which is cheaper to build
+     * and hash than a dl::obname. It's re-used between calls, so no memory
+     * is allocated for names that are already seen.
+     */
+    auto& key = this->key;
+    key.assign( reinterpret_cast< const char* >( &origin ), sizeof( origin ) );
+    key.push_back( char(copy) );
+    key.append( id, len );
+
+    const auto itr = this->codes.find( key );
+    if (itr != this->codes.end()) return itr->second;
+
+    const auto code = std::int32_t(this->table.size());
+    this->table.push_back( obname {
+        dl::origin( origin ),
+        dl::ushort( copy ),
+        dl::ident( std::string( id, len ) ),
+    });
+    this->codes.emplace( key, code );
+    return code;
+}
+
+const std::vector< obname >& obname_table::names() const noexcept (true) {
+    return this->table;
+}
+
+frame_layout compile_layout( const char* fmt, bool native ) noexcept (false) {
+    frame_layout layout;
+    bool varsrc = false;
+    bool vardst = false;
+
+    for (const auto* f = fmt; *f; ++f) {
+        if (not layout.runs.empty() and layout.runs.back().fmt == *f) {
+            layout.runs.back().count += 1;
+            continue;
+        }
+
+        const char local[] = { *f, '\0' };
+        int src, dst;
+        const auto err = dlis_pack_size( local, &src, &dst );
+
+        switch (err) {
+            case DLIS_OK:
+                break;
+
+            case DLIS_INCONSISTENT:
+                /* variable-length on disk and in memory, e.g. ident */
+                src = 0;
+                dst = 0;
+                break;
+
+            default: {
+                const auto msg = "invalid format specifier '{}' in '{}'";
+                throw std::invalid_argument(fmt::format(msg, *f, fmt));
+            }
+        }
+
+        /* the code of an interned name */
+        if (native and *f == DLIS_FMT_OBNAME)
+            dst = sizeof( std::int32_t );
+
+        layout_run run;
+        run.fmt = *f;
+        run.count = 1;
+        run.src_size = src;
+        run.dst_size = dst;
+        layout.runs.push_back( run );
+    }
+
+    for (const auto& run : layout.runs) {
+        if (run.src_size == 0) varsrc = true;
+        if (run.dst_size == 0) vardst = true;
+
+        const auto interned = native and run.fmt == DLIS_FMT_OBNAME;
+        const auto validated = native and is_validated( run.fmt );
+        if (interned) layout.interned = true;
+        if (not is_numeric( run.fmt ) and not interned and not validated)
+            layout.numeric = false;
+
+        layout.src_size += run.count * run.src_size;
+        layout.dst_size += run.count * run.dst_size;
+    }
+
+    if (varsrc) layout.src_size = 0;
+    if (vardst) layout.dst_size = 0;
+    return layout;
+}
+
+const char* unpack_row( const frame_layout& layout,
+                        const char* src,
+                        const char* end,
+                        char* dst,
+                        obname_table* names ) noexcept (false) {
+
+    if (layout.src_size > 0 and std::distance( src, end ) < layout.src_size)
+        overflow();
+
+    for (const auto& run : layout.runs)
+        src = unpack_run( run, src, end, dst, names );
+
+    return src;
+}
+
+const char* skip( const frame_skip& skip,
+                  const char* src,
+                  const char* end ) noexcept (false) {
+    auto size = skip.size;
+    if (size < 0)
+        dlis_packflen( skip.fmt.c_str(), src, &size, nullptr );
+
+    if (std::distance( src, end ) < size) overflow();
+    return src + size;
+}
+
+frame_projection compile_projection( const std::vector< std::string >& channels,
+                                     const std::vector< int >& selected,
+                                     bool native )
+noexcept (false) {
+    const auto nchannels = int(channels.size());
+    frame_projection projection;
+    bool vardst = false;
+
+    /*
+     * Accumulate the channels to skip, and the size of them as long as they
+     * are fixed-width. A skip of an empty format string is a no-op, and fixed,
+     * even though its layout has src_size == 0.
+     */
+    frame_skip pending;
+    const auto accumulate = [&pending]( const std::string& fmt ) {
+        pending.fmt += fmt;
+        if (pending.size < 0) return;
+
+        const auto layout = compile_layout( fmt.c_str() );
+        if (layout.runs.empty()) return;
+
+        if (layout.src_size == 0) pending.size = -1;
+        else                      pending.size += layout.src_size;
+    };
+
+    int next = 0;
+    for (const auto index : selected) {
+        if (index < next or index >= nchannels) {
+            const auto msg = "selected channel {} is out-of-range or out of "
+                             "order (expected index in [{}, {}))";
+            throw std::invalid_argument(
+                fmt::format( msg, index, next, nchannels )
+            );
+        }
+
+        for (; next < index; ++next)
+            accumulate( channels[ next ] );
+
+        projected_column column;
+        column.before = std::move( pending );
+        column.fmt = channels[ index ];
+        column.layout = compile_layout( column.fmt.c_str(), native );
+        pending = frame_skip();
+        ++next;
+
+        if (not column.layout.numeric) projection.numeric = false;
+        if (column.layout.interned) projection.interned = true;
+        if (column.layout.dst_size == 0 and not column.layout.runs.empty())
+            vardst = true;
+
+        projection.dst_size += column.layout.dst_size;
+        projection.columns.push_back( std::move( column ) );
+    }
+
+    for (; next < nchannels; ++next)
+        accumulate( channels[ next ] );
+    projection.after = std::move( pending );
+
+    if (vardst) projection.dst_size = 0;
+    return projection;
+}
+
+frame_projection compile_projection( const std::string& pre_fmt,
+                                     const std::string& fmt,
+                                     const std::string& post_fmt,
+                                     bool native )
+noexcept (false) {
+    return compile_projection( { pre_fmt, fmt, post_fmt }, { 1 }, native );
+}
+
+const char* project_row( const frame_projection& projection,
+                         const char* src,
+                         const char* end,
+                         char* dst,
+                         obname_table* names ) noexcept (false) {
+    for (const auto& column : projection.columns) {
+        src = skip( column.before, src, end );
+        src = unpack_row( column.layout, src, end, dst, names );
+        dst += column.layout.dst_size;
+    }
+
+    return skip( projection.after, src, end );
+}
+
+std::int64_t fdata_plan::rows() const noexcept (true) {
+    return this->first.back();
+}
+
+std::int64_t fdata_plan::rows( std::size_t k ) const noexcept (false) {
+    return this->first.at( k + 1 ) - this->first.at( k );
+}
+
+std::size_t fdata_plan::records() const noexcept (true) {
+    return this->first.size() - 1;
+}
+
+bool fdata_plan::uniform() const noexcept (true) {
+    return this->rows() == std::int64_t(this->records());
+}
+
+int count_rows( const record_view& record, int src_size ) noexcept (false) {
+    if (record.isencrypted())
+        throw dl::not_implemented( "encrypted FDATA record" );
+
+    const auto* end = record.end();
+    const auto* ptr = skip_obname( record.begin(), end );
+
+    /*
+     * The frame number is a uvari, so its size may differ between the rows of
+     * a record, which means stepping over every row rather than just dividing
+     * the size of the record
+     */
+    int rows = 0;
+    while (ptr < end) {
+        ptr += uvari_size( ptr );
+        ptr += src_size;
+        ++rows;
+    }
+
+    if (ptr != end) {
+        const auto msg = "corrupted record: FDATA does not hold a whole "
+                         "number of frames (of {} bytes)";
+        throw std::runtime_error( fmt::format( msg, src_size ) );
+    }
+
+    return rows;
+}
+
+namespace {
+
+int fixed_size( const std::string& fmt ) noexcept (false) {
+    const auto layout = compile_layout( fmt.c_str() );
+    if (layout.src_size == 0) {
+        const auto msg = "plan_fdata: frame '{}' has variable-sized values";
+        throw std::invalid_argument( fmt::format( msg, fmt ) );
+    }
+    return layout.src_size;
+}
+
+/*
+ * Advise the records of the block of n rows from pos, and of the block after
+ * it, as willneed, so that the next block is read while this one is decoded.
+ * Records before advised are already advised, and the new mark is returned.
+ */
+std::size_t advise_ahead( stream& file,
+                          const std::vector< int >& indices,
+                          std::size_t pos,
+                          std::size_t advised,
+                          int n ) noexcept (true) {
+    const auto block = std::size_t((std::max)( n, 0 ));
+    const auto ahead = (std::min)( indices.size(), pos + 2 * block );
+    const auto from  = (std::max)( pos, advised );
+    if (from >= ahead) return advised;
+
+    const auto* first = indices.data();
+    file.advise( first + from, first + ahead, access_hint::willneed );
+    return ahead;
+}
+
+/*
+ * Drop the records [begin, end) of a decoded block from the page cache
+ */
+void drop_decoded( stream& file,
+                   const std::vector< int >& indices,
+                   std::size_t begin,
+                   std::size_t end ) noexcept (true) {
+    if (begin >= end) return;
+    const auto* first = indices.data();
+    file.advise( first + begin, first + end, access_hint::dontneed );
+}
+
+}
+
+fdata_plan plan_fdata( stream& file,
+                       const std::vector< int >& indices,
+                       const std::string& fmt ) noexcept (false) {
+    const auto src_size = fixed_size( fmt );
+
+    fdata_plan plan;
+    plan.first.reserve( indices.size() + 1 );
+    record_view record;
+    stats_batch batch( file.statistics().get() );
+
+    /*
+     * Without a mapping the records must be read anyway, so have the reads
+     * issued ahead, like read_fdata does
+     */
+    if (not file.mapped()) {
+        readahead records( file, indices );
+        while (records.next( record ))
+            plan.first.push_back( plan.rows() + count_rows( record, src_size ) );
+        return plan;
+    }
+
+    for (auto i : indices) {
+        file.at( i, record );
+        plan.first.push_back( plan.rows() + count_rows( record, src_size ) );
+    }
+    return plan;
+}
+
+fdata_plan plan_fdata( const record_batch& batch,
+                       const std::string& fmt ) noexcept (false) {
+    const auto src_size = fixed_size( fmt );
+
+    fdata_plan plan;
+    plan.first.reserve( batch.size() + 1 );
+    for (std::size_t k = 0; k < batch.size(); ++k) {
+        const auto record = batch.view( k );
+        plan.first.push_back( plan.rows() + count_rows( record, src_size ) );
+    }
+    return plan;
+}
+
+frame_reader::frame_reader( stream& f,
+                            std::vector< int > idx,
+                            const std::string& pre,
+                            const std::string& fmt,
+                            const std::string& post ) noexcept (false) :
+    frame_reader( f, std::move( idx ), compile_projection( pre, fmt, post ) )
+{}
+
+frame_reader::frame_reader( stream& f,
+                            std::vector< int > idx,
+                            frame_projection projection ) noexcept (false) :
+    file( &f ),
+    indices( std::move( idx ) ),
+    plan( std::move( projection ) )
+{
+    if (not this->plan.numeric or this->plan.dst_size == 0) {
+        const auto msg = "frame_reader: projection is not numeric";
+        throw std::invalid_argument( msg );
+    }
+
+    if (this->plan.interned) {
+        const auto msg = "frame_reader: interned projections are unsupported";
+        throw std::invalid_argument( msg );
+    }
+}
+
+frame_reader::~frame_reader() {
+    /*
+     * The background read writes to this object, so it must be done before
+     * the object goes away. Any error is of no interest anymore.
+     */
+    if (this->next.valid()) {
+        try { this->next.get(); } catch (...) {}
+    }
+
+    if (not this->worker.joinable()) return;
+    {
+        std::lock_guard< std::mutex > lock( this->mutex );
+        this->stop = true;
+    }
+    this->cond.notify_all();
+    this->worker.join();
+}
+
+int frame_reader::read( char* dst, int n ) noexcept (false) {
+    if (this->pending()) {
+        const auto msg = "frame_reader: read() while a prefetch is pending";
+        throw std::logic_error( msg );
+    }
+
+    return this->decode( dst, n );
+}
+
+int frame_reader::decode( char* dst, int n ) noexcept (false) {
+    const auto& plan = this->plan;
+    auto& record = this->record;
+    auto* counters = this->file->statistics().get();
+    scoped_timer timer( counters, phase::read_fdata );
+    stats_batch batch( counters );
+    int rows = 0;
+
+    const auto start = this->pos;
+    this->advised = advise_ahead( *this->file,
+                                  this->indices,
+                                  start,
+                                  this->advised,
+                                  n );
+
+    while (rows < n and this->pos < this->indices.size()) {
+        const auto* ptr = this->resume;
+        if (not ptr) {
+            this->file->at( this->indices[ this->pos ], record );
+
+            if (record.isencrypted())
+                throw dl::not_implemented( "encrypted FDATA record" );
+
+            ptr = skip_obname( record.begin(), record.end() );
+        }
+
+        const auto* end = record.end();
+        ptr = skip_frameno( ptr, end );
+        ptr = project_row( plan, ptr, end, dst );
+
+        dst += plan.dst_size;
+        ++rows;
+
+        /* the record holds more frames, which go in the next rows */
+        this->resume = (ptr != end) ? ptr : nullptr;
+        if (not this->resume) ++this->pos;
+    }
+
+    if (this->release)
+        drop_decoded( *this->file, this->indices, start, this->pos );
+
+    count( counters, counter::frames_decoded, rows );
+    return rows;
+}
+
+void frame_reader::prefetch( char* dst, int n ) noexcept (false) {
+    if (this->pending()) {
+        const auto msg = "frame_reader: prefetch() while a prefetch is pending";
+        throw std::logic_error( msg );
+    }
+
+    if (not this->file->mapped()) {
+        /*
+         * Reading from fstream is not thread safe, and would race with anyone
+         * else using the stream in the meantime. Read it now instead, and
+         * hand the result over in wait()
+         */
+        std::promise< int > p;
+        try {
+            p.set_value( this->decode( dst, n ) );
+        } catch (...) {
+            p.set_exception( std::current_exception() );
+        }
+        this->next = p.get_future();
+        return;
+    }
+
+    /*
+     * Prefetches come one block at a time for as long as the log is read,
+     * so hand them all to the same thread rather than starting one per block
+     */
+    if (not this->worker.joinable())
+        this->worker = std::thread( &frame_reader::work, this );
+
+    std::promise< int > p;
+    this->next = p.get_future();
+    {
+        std::lock_guard< std::mutex > lock( this->mutex );
+        this->job.dst = dst;
+        this->job.n = n;
+        this->job.rows = std::move( p );
+        this->queued = true;
+    }
+    this->cond.notify_all();
+}
+
+void frame_reader::work() noexcept (true) {
+    while (true) {
+        prefetch_job job;
+        {
+            std::unique_lock< std::mutex > lock( this->mutex );
+            this->cond.wait( lock, [this] {
+                return this->stop or this->queued;
+            });
+            if (this->stop) return;
+            job = std::move( this->job );
+            this->queued = false;
+        }
+
+        try {
+            job.rows.set_value( this->decode( job.dst, job.n ) );
+        } catch (...) {
+            job.rows.set_exception( std::current_exception() );
+        }
+    }
+}
+
+int frame_reader::wait() noexcept (false) {
+    if (not this->pending()) return 0;
+    return this->next.get();
+}
+
+bool frame_reader::pending() const noexcept (true) {
+    return this->next.valid();
+}
+
+int frame_reader::row_size() const noexcept (true) {
+    return this->plan.dst_size;
+}
+
+std::size_t frame_reader::size() const noexcept (true) {
+    return this->indices.size();
+}
+
+std::size_t frame_reader::tell() const noexcept (true) {
+    return this->pos;
+}
+
+void frame_reader::seek( std::size_t record ) noexcept (false) {
+    if (this->pending()) {
+        const auto msg = "frame_reader: seek() while a prefetch is pending";
+        throw std::logic_error( msg );
+    }
+
+    if (record > this->indices.size()) {
+        const auto msg = "frame_reader: seek to {}, but size is {}";
+        const auto size = this->indices.size();
+        throw std::out_of_range(fmt::format(msg, record, size));
+    }
+
+    this->pos = record;
+    this->advised = record;
+    this->resume = nullptr;
+}
+
+const frame_projection& frame_reader::projection() const noexcept (true) {
+    return this->plan;
+}
+
+bool frame_reader::drop_behind() const noexcept (true) {
+    return this->release;
+}
+
+void frame_reader::drop_behind( bool enable ) noexcept (true) {
+    this->release = enable;
+}
+
+std::size_t string_column::size() const noexcept (true) {
+    return this->offsets.size() - 1;
+}
+
+void string_column::clear() noexcept (true) {
+    this->offsets.resize( 1 );
+    this->data.clear();
+}
+
+column_reader::column_reader( stream& f,
+                              std::vector< int > idx,
+                              frame_projection projection ) noexcept (false) :
+    file( &f ),
+    indices( std::move( idx ) ),
+    plan( std::move( projection ) ),
+    text( this->plan.columns.size() )
+{
+    for (const auto& column : this->plan.columns) {
+        if (column.layout.numeric) continue;
+
+        const auto& runs = column.layout.runs;
+        if (runs.size() == 1 and is_string( runs.front().fmt )) continue;
+
+        const auto msg = "column_reader: channel format '{}' is not supported";
+        throw std::invalid_argument(fmt::format(msg, column.fmt));
+    }
+}
+
+int column_reader::read( const std::vector< char* >& dst, int n )
+noexcept (false) {
+    const auto& plan = this->plan;
+    auto& record = this->record;
+
+    if (dst.size() != plan.columns.size()) {
+        const auto msg = "column_reader: expected {} columns, was {}";
+        const auto str = fmt::format(msg, plan.columns.size(), dst.size());
+        throw std::invalid_argument(str);
+    }
+
+    for (auto& column : this->text)
+        column.clear();
+
+    auto* counters = this->file->statistics().get();
+    scoped_timer timer( counters, phase::read_fdata );
+    stats_batch batch( counters );
+    int rows = 0;
+
+    const auto start = this->pos;
+    this->advised = advise_ahead( *this->file,
+                                  this->indices,
+                                  start,
+                                  this->advised,
+                                  n );
+
+    while (rows < n and this->pos < this->indices.size()) {
+        const auto* ptr = this->resume;
+        if (not ptr) {
+            this->file->at( this->indices[ this->pos ], record );
+
+            if (record.isencrypted())
+                throw dl::not_implemented( "encrypted FDATA record" );
+
+            ptr = skip_obname( record.begin(), record.end() );
+        }
+
+        const auto* end = record.end();
+        ptr = skip_frameno( ptr, end );
+
+        for (std::size_t k = 0; k < plan.columns.size(); ++k) {
+            const auto& column = plan.columns[ k ];
+            ptr = dl::skip( column.before, ptr, end );
+
+            if (column.layout.numeric) {
+                const auto size = std::size_t(column.layout.dst_size);
+                auto* out = dst[ k ] + std::size_t(rows) * size;
+                ptr = unpack_row( column.layout, ptr, end, out );
+            } else {
+                const auto& run = column.layout.runs.front();
+                ptr = unpack_strings( run, ptr, end, this->text[ k ] );
+            }
+        }
+        ptr = dl::skip( plan.after, ptr, end );
+        ++rows;
+
+        this->resume = (ptr != end) ? ptr : nullptr;
+        if (not this->resume) ++this->pos;
+    }
+
+    if (this->release)
+        drop_decoded( *this->file, this->indices, start, this->pos );
+
+    count( counters, counter::frames_decoded, rows );
+    return rows;
+}
+
+std::size_t column_reader::columns() const noexcept (true) {
+    return this->plan.columns.size();
+}
+
+int column_reader::column_size( std::size_t k ) const noexcept (true) {
+    return this->plan.columns[ k ].layout.dst_size;
+}
+
+bool column_reader::strings_column( std::size_t k ) const noexcept (true) {
+    return not this->plan.columns[ k ].layout.numeric;
+}
+
+const string_column& column_reader::strings( std::size_t k ) const
+noexcept (false) {
+    return this->text.at( k );
+}
+
+std::size_t column_reader::size() const noexcept (true) {
+    return this->indices.size();
+}
+
+std::size_t column_reader::tell() const noexcept (true) {
+    return this->pos;
+}
+
+const frame_projection& column_reader::projection() const noexcept (true) {
+    return this->plan;
+}
+
+bool column_reader::drop_behind() const noexcept (true) {
+    return this->release;
+}
+
+void column_reader::drop_behind( bool enable ) noexcept (true) {
+    this->release = enable;
+}
+
+}
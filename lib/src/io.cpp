@@ -1,9 +1,15 @@
 #include <algorithm>
 #include <cerrno>
 #include <ciso646>
+#include <cstring>
+#include <exception>
 #include <fstream>
+#include <mutex>
+#include <new>
 #include <string>
 #include <system_error>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include <fmt/core.h>
@@ -15,6 +21,13 @@
 
 #include <dlisio/ext/io.hpp>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace dl {
 
 void stream_offsets::resize( std::size_t n ) noexcept (false) {
@@ -32,6 +45,201 @@ void map_source( mio::mmap_source& file, const std::string& path ) noexcept (fal
         throw std::invalid_argument( "non-existent or empty file" );
 }
 
+namespace {
+
+/*
+ * The size of the file at path, which is a lot cheaper to ask for than
+ * mapping the file
+ */
+long long file_size( const std::string& path ) noexcept (false) {
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA info;
+    if (not GetFileAttributesExA( path.c_str(),
+                                  GetFileExInfoStandard,
+                                  &info )) {
+        const auto err = std::error_code( GetLastError(),
+                                          std::system_category() );
+        throw std::system_error( err, "cannot stat file '" + path + "'" );
+    }
+    return (static_cast< long long >( info.nFileSizeHigh ) << 32)
+         | info.nFileSizeLow;
+#else
+    struct stat info;
+    if (::stat( path.c_str(), &info ) != 0)
+        throw fmt::system_error(errno, "cannot stat file '{}'", path);
+    return static_cast< long long >( info.st_size );
+#endif
+}
+
+/*
+ * Open the file at path for positional reads, see source::read
+ */
+mio::file_handle_type open_file( const std::string& path ) noexcept (false) {
+#ifdef _WIN32
+    const auto handle = CreateFileA( path.c_str(),
+                                     GENERIC_READ,
+                                     FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                     nullptr,
+                                     OPEN_EXISTING,
+                                     FILE_ATTRIBUTE_NORMAL,
+                                     nullptr );
+    if (handle == INVALID_HANDLE_VALUE) {
+        const auto err = std::error_code( GetLastError(),
+                                          std::system_category() );
+        throw std::system_error( err, "cannot open file '" + path + "'" );
+    }
+    return handle;
+#else
+    const auto fd = ::open( path.c_str(), O_RDONLY | O_CLOEXEC );
+    if (fd < 0)
+        throw fmt::system_error(errno, "cannot open file '{}'", path);
+    return fd;
+#endif
+}
+
+/*
+ * The size of the open file
+ */
+long long file_size( mio::file_handle_type handle ) noexcept (false) {
+#ifdef _WIN32
+    LARGE_INTEGER size;
+    if (not GetFileSizeEx( handle, &size )) {
+        const auto err = std::error_code( GetLastError(),
+                                          std::system_category() );
+        throw std::system_error( err, "cannot stat file" );
+    }
+    return static_cast< long long >( size.QuadPart );
+#else
+    struct stat info;
+    if (::fstat( handle, &info ) != 0)
+        throw fmt::system_error(errno, "cannot stat file");
+    return static_cast< long long >( info.st_size );
+#endif
+}
+
+long long pagesize() noexcept (true) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo( &info );
+    return info.dwPageSize;
+#else
+    const auto size = ::sysconf( _SC_PAGESIZE );
+    return size > 0 ? size : 4096;
+#endif
+}
+
+#if !defined(_WIN32) && defined(POSIX_FADV_NORMAL)
+void fadvise( int fd,
+              long long offset,
+              long long n,
+              access_hint hint ) noexcept (true) {
+    int advice = POSIX_FADV_NORMAL;
+    switch (hint) {
+        case access_hint::normal:     advice = POSIX_FADV_NORMAL;     break;
+        case access_hint::sequential: advice = POSIX_FADV_SEQUENTIAL; break;
+        case access_hint::willneed:   advice = POSIX_FADV_WILLNEED;   break;
+        case access_hint::dontneed:   advice = POSIX_FADV_DONTNEED;   break;
+    }
+    ::posix_fadvise( fd, offset, n, advice );
+}
+#endif
+
+}
+
+bool pagealign( long long& begin,
+                long long& end,
+                long long size,
+                long long page,
+                bool inner ) noexcept (true) {
+    const auto roundup = [page](long long x) {
+        return (x + page - 1) / page * page;
+    };
+    const auto rounddown = [page](long long x) { return x / page * page; };
+
+    if (inner) {
+        begin = roundup( begin );
+        end = end == size ? roundup( end ) : rounddown( end );
+    } else {
+        begin = rounddown( begin );
+        end = roundup( end );
+    }
+
+    return begin < end;
+}
+
+void advise( const mio::mmap_source& file,
+             long long offset,
+             long long n,
+             access_hint hint ) noexcept (true) {
+    if (not file.is_mapped()) return;
+
+    const long long size = file.size();
+    if (offset < 0 or n <= 0 or offset >= size) return;
+
+    long long begin = offset;
+    long long end = (std::min)( offset + n, size );
+    const auto dontneed = hint == access_hint::dontneed;
+    static const long long page = pagesize();
+    if (not pagealign( begin, end, size, page, dontneed )) return;
+
+    /*
+     * The mapping starts at offset 0 of the file, and so at a page boundary,
+     * which makes the file offsets page-aligned addresses too
+     */
+    auto* addr = const_cast< char* >( file.data() ) + begin;
+    const auto len = std::size_t( end - begin );
+
+#ifdef _WIN32
+    switch (hint) {
+        case access_hint::willneed: {
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+            WIN32_MEMORY_RANGE_ENTRY range;
+            range.VirtualAddress = addr;
+            range.NumberOfBytes  = len;
+            PrefetchVirtualMemory( GetCurrentProcess(), 1, &range, 0 );
+#endif
+            break;
+        }
+
+        case access_hint::dontneed:
+            /*
+             * Unlocking pages that are not locked removes them from the
+             * working set, which is the closest windows gets to dontneed
+             */
+            VirtualUnlock( addr, len );
+            break;
+
+        default:
+            break;
+    }
+#else
+    switch (hint) {
+        case access_hint::normal:
+            ::madvise( addr, len, MADV_NORMAL );
+            break;
+
+        case access_hint::sequential:
+            ::madvise( addr, len, MADV_SEQUENTIAL );
+            break;
+
+        case access_hint::willneed:
+            ::madvise( addr, len, MADV_WILLNEED );
+            break;
+
+        case access_hint::dontneed:
+            ::madvise( addr, len, MADV_DONTNEED );
+            /*
+             * madvise only drops the pages from this mapping, so have them
+             * dropped from the page cache too, now that they're not mapped
+             */
+#ifdef POSIX_FADV_DONTNEED
+            fadvise( file.file_handle(), begin, end - begin, hint );
+#endif
+            break;
+    }
+#endif
+}
+
 long long findsul( mio::mmap_source& file ) noexcept (false) {
     long long offset;
     const long long size = file.size();
@@ -99,12 +307,21 @@ long long findvrl( mio::mmap_source& file, long long from ) noexcept (false) {
     }
 }
 
-stream_offsets findoffsets( mio::mmap_source& file, long long from )
-noexcept (false)
-{
-    const auto* begin = file.data() + from;
-    const auto* end = file.data() + file.size();
+namespace {
 
+/*
+ * Index the records in [begin, end) with dlis_index_records, starting with
+ * residual bytes left of the current visible record, and append them to ofs,
+ * with the tells relative to end. On return, next is the end of the last
+ * complete record, residual is what was left of its visible record, and the
+ * error is that of dlis_index_records. The records up until the error are
+ * still appended.
+ */
+int index_records( const char* begin,
+                   const char* end,
+                   int& residual,
+                   const char*& next,
+                   stream_offsets& ofs ) noexcept (false) {
     constexpr std::size_t min_alloc_size = 2;
     constexpr auto resize_factor = 1.5;
     constexpr auto min_new_size = std::size_t(min_alloc_size * resize_factor);
@@ -113,48 +330,33 @@ noexcept (false)
 
     // by default, assume ~4K per record on average. This should be fairly few
     // reallocations, without overshooting too much
-    std::size_t alloc_size = std::max(file.size() / 4096, min_alloc_size);
+    const auto size = std::size_t(std::distance( begin, end ));
+    std::size_t alloc_size = std::max(size / 4096, min_alloc_size);
 
-    stream_offsets ofs;
-    ofs.resize( alloc_size );
+    const auto first = ofs.tells.size();
+    ofs.resize( first + alloc_size );
     auto& tells     = ofs.tells;
     auto& residuals = ofs.residuals;
     auto& explicits = ofs.explicits;
 
-    const char* next;
     int count = 0;
-    int initial_residual = 0;
+    next = begin;
 
     while (true) {
+        const auto at = first + count;
         int err = dlis_index_records( begin,
                                       end,
                                       alloc_size,
-                                      &initial_residual,
+                                      &residual,
                                       &next,
                                       &count,
-                                      count + tells.data(),
-                                      count + residuals.data(),
-                                      count + explicits.data() );
-
-        switch (err) {
-            case DLIS_OK: break;
-
-            case DLIS_TRUNCATED:
-                throw std::runtime_error( "file truncated" );
-
-            case DLIS_INCONSISTENT:
-                throw std::runtime_error( "inconsistensies in record sizes" );
-
-            case DLIS_UNEXPECTED_VALUE: {
-                // TODO: interrogate more?
-                const auto msg = "record-length in record {} corrupted";
-                throw std::runtime_error(fmt::format(msg, count));
-            }
+                                      at + tells.data(),
+                                      at + residuals.data(),
+                                      at + explicits.data() );
 
-            default: {
-                const auto msg = "dlis_index_records: unknown error {}";
-                throw std::runtime_error(fmt::format(msg, err));
-            }
+        if (err != DLIS_OK) {
+            ofs.resize( first + count );
+            return err;
         }
 
         if (next == end) break;
@@ -168,248 +370,1524 @@ noexcept (false)
         begin = next;
     }
 
-    ofs.resize( count );
-
-    const auto dist = file.size();
-    std::transform(tells.begin(), tells.end(), tells.begin(),
-            [ dist ]( long long t ) -> long long { return t += dist; } );
-    return ofs;
+    ofs.resize( first + count );
+    return DLIS_OK;
 }
 
-bool record::isexplicit() const noexcept (true) {
-    return this->attributes & DLIS_SEGATTR_EXFMTLR;
-}
+void index_error( int err, std::size_t count ) noexcept (false) {
+    switch (err) {
+        case DLIS_OK: return;
 
-bool record::isencrypted() const noexcept (true) {
-    return this->attributes & DLIS_SEGATTR_ENCRYPT;
+        case DLIS_TRUNCATED:
+            throw std::runtime_error( "file truncated" );
+
+        case DLIS_INCONSISTENT:
+            throw std::runtime_error( "inconsistensies in record sizes" );
+
+        case DLIS_UNEXPECTED_VALUE: {
+            // TODO: interrogate more?
+            const auto msg = "record-length in record {} corrupted";
+            throw std::runtime_error(fmt::format(msg, count));
+        }
+
+        default: {
+            const auto msg = "dlis_index_records: unknown error {}";
+            throw std::runtime_error(fmt::format(msg, err));
+        }
+    }
 }
 
-stream::stream( const std::string& path ) noexcept (false)
+stream_offsets index_serial( mio::mmap_source& file, long long from )
+noexcept (false)
 {
-    this->fs.exceptions( fs.exceptions()
-                       | std::ios::eofbit
-                       | std::ios::failbit
-                       );
+    const auto* begin = file.data() + from;
+    const auto* end = file.data() + file.size();
 
-    this->fs.open( path, std::ios::binary | std::ios::in );
+    stream_offsets ofs;
+    const char* next;
+    int initial_residual = 0;
 
-    if (!this->fs.good())
-        throw fmt::system_error(errno, "cannot to open file '{}'", path);
-}
+    const auto err = index_records( begin, end, initial_residual, next, ofs );
+    index_error( err, ofs.tells.size() );
 
-record stream::at( int i ) noexcept (false) {
-    record r;
-    r.data.reserve( 8192 );
-    return this->at( i, r );
+    auto& tells = ofs.tells;
+    const auto dist = file.size();
+    std::transform(tells.begin(), tells.end(), tells.begin(),
+            [ dist ]( long long t ) -> long long { return t += dist; } );
+    return ofs;
 }
 
-namespace {
+/*
+ * Parallel indexing
+ *
+ * The file is split in roughly equal chunks, and every chunk is indexed
+ * independently. Logical records don't respect visible record boundaries, and
+ * visible records don't respect chunk boundaries, so every chunk must first be
+ * synchronised:
+ *
+ * 1. find the first visible record at or after the chunk start. The envelope
+ *    is the pattern [len 0xFF 0x01], and a candidate is only accepted if
+ *    following the length fields lands on more valid envelopes
+ * 2. from that visible record, skip segments that continue a logical record
+ *    (that has a predecessor) until the first segment that starts one
+ *
+ * Every chunk is then indexed up until the first record of the next chunk. A
+ * chunk must end *exactly* at the start of the next one, with the same
+ * residual, or the synchronisation was fooled by data that looked like an
+ * envelope, and the result is discarded.
+ */
+struct chunk {
+    const char* begin;      /* first logical record in the chunk */
+    int residual;           /* bytes left in the visible record at begin */
+    stream_offsets ofs;
+    int count = 0;
+    bool ok = false;
+};
 
-bool consumed_record( long long tell,
-                      const std::vector< long long >& tells,
-                      int i ) noexcept (true) {
-    /*
-     * this was the last record, so have no idea how to determine that
-     * everything is properly consumed. Always true
-     */
-    if (std::size_t(i) == tells.size() - 1) return true;
+bool isenvelope( const char* ptr, const char* end, int hops ) noexcept (true) {
+    for (int i = 0; i < hops; ++i) {
+        if (ptr == end) return true;
+        if (std::distance( ptr, end ) < DLIS_VRL_SIZE + DLIS_LRSH_SIZE)
+            return false;
 
-    return tell == tells[ i + 1 ];
-}
+        const auto* u = reinterpret_cast< const unsigned char* >( ptr );
+        if (u[2] != 0xFF or u[3] != 0x01) return false;
 
-template < typename T >
-bool attr_consistent( const T& ) noexcept (true) {
-    // TODO: implement
-    // internal attributes should have both successor and predecessor
-    // first only successors, last only predecessors
-    return true;
-}
+        int len, version;
+        if (dlis_vrl( ptr, &len, &version ) != DLIS_OK) return false;
+        if (len < 20 or std::distance( ptr, end ) < len) return false;
+
+        int seglen, type;
+        std::uint8_t attrs;
+        const auto* seg = ptr + DLIS_VRL_SIZE;
+        if (dlis_lrsh( seg, &seglen, &attrs, &type ) != DLIS_OK) return false;
+        if (seglen < 16 or seglen > len - DLIS_VRL_SIZE) return false;
+
+        ptr += len;
+    }
 
-template < typename T >
-bool type_consistent( const T& ) noexcept (true) {
-    // TODO: implement
-    // should be all-equal
     return true;
 }
 
-void trim_segment(std::uint8_t attrs,
-                  const char* begin,
-                  int segment_size,
-                  std::vector< char >& segment)
-noexcept (false) {
-    int trim = 0;
-    const auto* end = begin + segment_size;
-    const auto err = dlis_trim_record_segment(attrs, begin, end, &trim);
-
-    switch (err) {
-        case DLIS_OK:
-            segment.resize(segment.size() - trim);
-            return;
+/*
+ * Find the first visible record envelope in [from, limit), or nullptr
+ */
+const char* resync( const char* from,
+                    const char* limit,
+                    const char* end ) noexcept (true) {
+    constexpr auto hops = 8;
+    const auto* cur = from;
+    while (cur < limit) {
+        long long offset;
+        const auto search = std::distance( cur, limit ) + DLIS_SIZEOF_UNORM;
+        const auto avail = std::distance( cur, end );
+        const auto err = dlis_find_vrl( cur, (std::min)(search, avail), &offset );
 
-        case DLIS_BAD_SIZE:
-            if (trim - segment_size != DLIS_LRSH_SIZE) {
-                const auto msg =
-                    "bad segment trim: padbytes (which is {}) "
-                    ">= segment.size() (which is {})";
-                throw std::runtime_error(fmt::format(msg, trim, segment_size));
+        switch (err) {
+            case DLIS_OK: {
+                const auto* candidate = cur + offset;
+                if (candidate >= limit) return nullptr;
+                if (isenvelope( candidate, end, hops )) return candidate;
+                cur = candidate + 1;
+                break;
             }
 
-            /*
-             * padbytes included the segment header. It's larger than
-             * the segment body, but only because it also counts the
-             * header. accept that, pretend the body was never added,
-             * and move on.
-             */
-            segment.resize(segment.size() - segment_size);
-            return;
+            case DLIS_INCONSISTENT:
+                /* the pattern is right at cur, no room for the length */
+                cur += 1;
+                break;
 
-        default:
-            throw std::invalid_argument("dlis_trim_record_segment");
+            default:
+                return nullptr;
+        }
     }
-}
 
+    return nullptr;
 }
 
 /*
- * store attributes in a string to use the short-string optimisation if
- * available. Just before commit, these are checked for consistency, i.e.
- * that segments don't report inconsistent information on encryption and
- * formatting.
+ * Starting at the visible record ptr, find the first segment that starts a
+ * logical record. Sets rec and residual to what dlis_index_records would
+ * report for that record, i.e. rec is the envelope if the record is the first
+ * thing in the visible record.
  */
-template < typename T >
-using shortvec = std::basic_string< T >;
+bool first_record( const char* ptr,
+                   const char* end,
+                   const char*& rec,
+                   int& residual ) noexcept (true) {
+    int remaining = 0;
+    while (ptr < end) {
+        const auto* envelope = ptr;
+        const auto fresh = remaining == 0;
+        if (fresh) {
+            if (std::distance( ptr, end ) < DLIS_VRL_SIZE) return false;
+            int len, version;
+            dlis_vrl( ptr, &len, &version );
+            if (len < 20) return false;
+            remaining = len - DLIS_VRL_SIZE;
+            ptr += DLIS_VRL_SIZE;
+        }
 
-record& stream::at( int i, record& rec ) noexcept (false) {
+        if (std::distance( ptr, end ) < DLIS_LRSH_SIZE) return false;
+        int len, type;
+        std::uint8_t attrs;
+        if (dlis_lrsh( ptr, &len, &attrs, &type ) != DLIS_OK) return false;
+        if (len < 16 or len > remaining) return false;
 
-    auto tell = this->tells.at( i );
-    auto remaining = this->residuals.at( i );
+        if (not (attrs & DLIS_SEGATTR_PREDSEG)) {
+            rec = fresh ? envelope : ptr;
+            residual = fresh ? 0 : remaining;
+            return true;
+        }
 
-    shortvec< std::uint8_t > attributes;
-    shortvec< int > types;
-    bool consistent = true;
+        ptr += len;
+        remaining -= len;
+    }
 
-    this->fs.seekg( tell );
+    return false;
+}
 
-    rec.data.clear();
+/*
+ * Index the records in c, up to (but not including) the record at limit,
+ * which must have residual limit_residual. If limit is end, all records to
+ * end-of-file are indexed.
+ */
+void index_chunk( chunk& c,
+                  const char* limit,
+                  int limit_residual,
+                  const char* end ) noexcept (false) {
+    constexpr std::size_t min_alloc_size = 64;
+    const auto stop = (long long)std::distance( end, limit );
+
+    const char* begin = c.begin;
+    const char* next = begin;
+    int initial_residual = c.residual;
+    auto& ofs = c.ofs;
 
     while (true) {
-        while (remaining > 0) {
-            int len, type;
-            std::uint8_t attrs;
-            char buffer[ DLIS_LRSH_SIZE ];
-            this->fs.read( buffer, DLIS_LRSH_SIZE );
-            const auto err = dlis_lrsh( buffer, &len, &attrs, &type );
+        if (next == limit) break;
+
+        // assume ~4K per record, like findoffsets. Estimating from what is
+        // left of the chunk keeps the overshoot into the next chunk small
+        const auto left = std::size_t(std::distance( next, limit ));
+        const auto alloc_size = (std::max)(left / 4096, min_alloc_size);
+        ofs.resize( c.count + alloc_size );
+
+        const auto prev = c.count;
+        const auto err = dlis_index_records( begin,
+                                             end,
+                                             alloc_size,
+                                             &initial_residual,
+                                             &next,
+                                             &c.count,
+                                             c.count + ofs.tells.data(),
+                                             c.count + ofs.residuals.data(),
+                                             c.count + ofs.explicits.data() );
+
+        /*
+         * Records past limit belong to the next chunk - if the next chunk
+         * starts at a record, truncate there and call it a day
+         */
+        const auto first = ofs.tells.begin() + prev;
+        const auto last  = ofs.tells.begin() + c.count;
+        const auto itr = std::lower_bound( first, last, stop );
+        if (itr != last) {
+            if (*itr != stop) return;
+            const auto i = std::distance( ofs.tells.begin(), itr );
+            if (ofs.residuals[ i ] != limit_residual) return;
+
+            c.count = int(i);
+            break;
+        }
 
-            remaining -= len;
-            len -= DLIS_LRSH_SIZE;
+        /*
+         * Any error before limit is reached means either a broken file, or
+         * that the chunk was poorly synchronised. Either way, let the serial
+         * indexer have a go, and report errors properly
+         */
+        if (err != DLIS_OK) return;
+        if (next == end) {
+            if (limit != end) return;
+            break;
+        }
+        if (next > limit) return;
 
-            if (err) consistent = false;
-            attributes.push_back( attrs );
-            types.push_back( type );
+        begin = next;
+    }
 
-            if (remaining < 0) {
-                /*
-                 * mismatch between visisble-record-length and segment length.
-                 * For now, just throw, but this could be reduced to a warning
-                 * with guide on which one to believe
-                 */
+    ofs.resize( c.count );
+    c.ok = true;
+}
 
-                const auto vrl_len = remaining + len;
-                const auto cur_tell = std::int64_t(this->fs.tellg()) - DLIS_LRSH_SIZE;
-                const auto msg = "visible record/segment inconsistency: "
-                                 "segment (which is {}) "
-                                 ">= visible (which is {}) "
-                                 "in record {} (at tell {})"
-                ;
-                const auto str = fmt::format(msg, len, vrl_len, i, cur_tell);
-                throw std::runtime_error(str);
-            }
+stream_offsets index_parallel( mio::mmap_source& file,
+                               long long from,
+                               int threads )
+noexcept (false) {
+    if (threads <= 1) return index_serial( file, from );
 
-            const auto prevsize = rec.data.size();
-            rec.data.resize( prevsize + len );
-            this->fs.read( rec.data.data() + prevsize, len );
+    const auto* begin = file.data() + from;
+    const auto* end = file.data() + file.size();
 
-            /*
-             * chop off trailing length and checksum for now
-             * TODO: verify integrity by checking trailing length
-             * TODO: calculate checksum
-             */
-            const auto* fst = rec.data.data() + prevsize;
-            trim_segment(attrs, fst, len, rec.data);
+    /*
+     * Chunks smaller than this are not worth a thread of their own
+     */
+    constexpr long long min_chunk_size = 1 << 20;
+    const auto size = (long long)std::distance( begin, end );
+    const auto nchunks = (std::min)((long long)threads, size / min_chunk_size);
+    if (nchunks <= 1) return index_serial( file, from );
 
-            /*if the whole segment is getting trimmed, it's unclear if
-              successor attribute should be erased or not.
-              For now ignoring. Suspecting issue will never occur as
-              whole "too many padbytes" problem might be caused by encryption
-            */
+    const auto chunk_size = size / nchunks;
 
-            const auto has_successor = attrs & DLIS_SEGATTR_SUCCSEG;
-            if (has_successor) continue;
+    std::vector< chunk > chunks( 1 );
+    chunks.front().begin = begin;
+    chunks.front().residual = 0;
 
-            /* read last segment - check consistency and wrap up */
-            if (this->contiguous and not consumed_record( this->fs.tellg(),
-                                                          this->tells,
-                                                          i )) {
-                /*
-                 * If this happens something is VERY wrong. Every new record
-                 * should start just after the previous, unless bytes have been
-                 * purposely skipped, because the file was otherwise broken.
-                 * This probably comes from consistent, but lying, length
-                 * attributes
-                 */
-                const auto msg = "non-contiguous record: "
-                                 "#{} (at tell {}) "
-                                 "ends prematurely at {}, "
-                                 "not at #{} (at tell {})"
-                ;
+    for (long long k = 1; k < nchunks; ++k) {
+        const auto* at = begin + k * chunk_size;
+        const auto* limit = begin + (k + 1) * chunk_size;
 
-                const auto tell1 = this->tells.at(i);
-                const auto tell2 = this->tells.at(i + 1);
-                const auto at    = this->fs.tellg();
-                const auto str   = fmt::format(msg, i, tell1, at, i+1, tell2);
-                throw std::runtime_error(msg);
-            }
+        const auto* envelope = resync( at, limit, end );
+        if (not envelope) continue;
 
+        chunk c;
+        if (not first_record( envelope, end, c.begin, c.residual )) continue;
+        if (c.begin <= chunks.back().begin) continue;
 
-            /*
-             * The record type only cares about encryption and formatting, so only
-             * extract those for checking consistency. Nothing else is interesting to
-             * users, as it only describes how to read this specific segment
-             */
-            static const auto fmtenc = DLIS_SEGATTR_EXFMTLR | DLIS_SEGATTR_ENCRYPT;
-            rec.attributes = attributes.front() & fmtenc;
-            rec.type = types.front();
+        chunks.push_back( std::move( c ) );
+    }
 
-            rec.consistent = consistent;
-            if (not attr_consistent( attributes )) rec.consistent = false;
-            if (not type_consistent( types ))      rec.consistent = false;
-            return rec;
+    if (chunks.size() == 1) return index_serial( file, from );
+
+    std::vector< std::exception_ptr > errors( chunks.size() );
+    const auto worker = [&]( std::size_t k ) noexcept (true) {
+        try {
+            const auto last = k + 1 == chunks.size();
+            const auto* limit = last ? end : chunks[ k + 1 ].begin;
+            const auto residual = last ? 0 : chunks[ k + 1 ].residual;
+            index_chunk( chunks[ k ], limit, residual, end );
+        } catch (...) {
+            errors[ k ] = std::current_exception();
         }
+    };
 
-        int len, version;
-        char buffer[ DLIS_VRL_SIZE ];
-        this->fs.read( buffer, DLIS_VRL_SIZE );
-        const auto err = dlis_vrl( buffer, &len, &version );
+    std::vector< std::thread > pool;
+    pool.reserve( chunks.size() - 1 );
+    for (std::size_t k = 1; k < chunks.size(); ++k)
+        pool.emplace_back( worker, k );
 
-        // TODO: for now record closest to VE gets the blame
-        if (err) consistent = false;
-        if (version != 1) consistent = false;
+    worker( 0 );
+    for (auto& t : pool) t.join();
 
-        remaining = len - DLIS_VRL_SIZE;
+    for (const auto& err : errors) {
+        if (err) std::rethrow_exception( err );
     }
-}
 
-void stream::reindex( const std::vector< long long >& tells,
-                      const std::vector< int >& residuals ) noexcept (false) {
-    if (tells.empty())
-        throw std::invalid_argument( "tells must be non-empty" );
+    const auto fallback = [](const chunk& c) { return not c.ok; };
+    if (std::any_of( chunks.begin(), chunks.end(), fallback ))
+        return index_serial( file, from );
 
-    if (residuals.empty())
-        throw std::invalid_argument( "residuals must be non-empty" );
+    std::size_t count = 0;
+    for (const auto& c : chunks)
+        count += c.count;
 
-    if (tells.size() != residuals.size()) {
-        const auto msg = "reindex requires tells.size() which is {}) "
-                         "== residuals.size() (which is {})"
+    stream_offsets ofs;
+    ofs.tells.reserve( count );
+    ofs.residuals.reserve( count );
+    ofs.explicits.reserve( count );
+
+    const auto dist = file.size();
+    for (const auto& c : chunks) {
+        for (auto tell : c.ofs.tells)
+            ofs.tells.push_back( tell + dist );
+
+        ofs.residuals.insert( ofs.residuals.end(),
+                              c.ofs.residuals.begin(),
+                              c.ofs.residuals.end() );
+        ofs.explicits.insert( ofs.explicits.end(),
+                              c.ofs.explicits.begin(),
+                              c.ofs.explicits.end() );
+    }
+
+    return ofs;
+}
+
+void count_indexed( const mio::mmap_source& file,
+                    long long from,
+                    const stream_offsets& ofs ) noexcept (true) {
+    const auto size = static_cast< long long >( file.size() );
+    count( counter::bytes_indexed, size - from );
+    count( counter::records_indexed, ofs.tells.size() );
+}
+
+}
+
+namespace {
+
+/*
+ * Advise sequential access of the file from an offset for as long as it is in
+ * scope, for the scan of the segment headers in findoffsets, which reads
+ * ahead more aggressively and lets the pages behind the scan be reclaimed
+ * sooner. The default is restored on exit.
+ */
+class sequential_scan {
+public:
+    sequential_scan( const mio::mmap_source& f, long long from ) :
+        file( f ),
+        offset( from ),
+        size( static_cast< long long >( f.size() ) - from )
+    {
+        advise( this->file, this->offset, this->size, access_hint::sequential );
+    }
+
+    ~sequential_scan() {
+        advise( this->file, this->offset, this->size, access_hint::normal );
+    }
+
+private:
+    const mio::mmap_source& file;
+    long long offset;
+    long long size;
+};
+
+}
+
+stream_offsets findoffsets( mio::mmap_source& file, long long from )
+noexcept (false) {
+    scoped_timer timer( phase::findoffsets );
+    sequential_scan scan( file, from );
+    auto ofs = index_serial( file, from );
+    count_indexed( file, from, ofs );
+    return ofs;
+}
+
+stream_offsets findoffsets( mio::mmap_source& file,
+                            long long from,
+                            int threads )
+noexcept (false) {
+    scoped_timer timer( phase::findoffsets );
+    sequential_scan scan( file, from );
+    auto ofs = index_parallel( file, from, threads );
+    count_indexed( file, from, ofs );
+    return ofs;
+}
+
+tail_index::tail_index( const std::string& p, long long from )
+noexcept (false)
+    : path( p )
+    , resume( from )
+{
+    if (from < 0) {
+        const auto msg = "expected from (which is {}) >= 0";
+        throw std::invalid_argument(fmt::format(msg, from));
+    }
+}
+
+stream_offsets tail_index::refresh() noexcept (false) {
+    scoped_timer timer( phase::findoffsets );
+
+    /*
+     * The mapping only covers the file as it was when it was mapped, so it
+     * must be re-mapped to see what is appended. Re-mapping is a lot more
+     * expensive than asking for the size though, so the file is only
+     * re-mapped when its size has changed since the last refresh.
+     */
+    stream_offsets fresh;
+    const auto current = file_size( this->path );
+    const auto mapped = static_cast< long long >( this->map.size() );
+    if (this->map.is_mapped() and current == mapped) return fresh;
+
+    map_source( this->map, this->path );
+    const auto size = static_cast< long long >( this->map.size() );
+    if (size <= this->resume) return fresh;
+
+    const auto* begin = this->map.data() + this->resume;
+    const auto* end = this->map.data() + size;
+    const char* next;
+    auto residual = this->residual;
+    const auto err = index_records( begin, end, residual, next, fresh );
+
+    /*
+     * The last record still being written is not an error, but any other
+     * problem is, and the index is left as it was so that the error is
+     * reported again on the next refresh
+     */
+    if (err != DLIS_OK and err != DLIS_TRUNCATED)
+        index_error( err, this->ofs.tells.size() + fresh.tells.size() );
+
+    for (auto& tell : fresh.tells)
+        tell += size;
+
+    this->ofs.tells.insert( this->ofs.tells.end(),
+                            fresh.tells.begin(),
+                            fresh.tells.end() );
+    this->ofs.residuals.insert( this->ofs.residuals.end(),
+                                fresh.residuals.begin(),
+                                fresh.residuals.end() );
+    this->ofs.explicits.insert( this->ofs.explicits.end(),
+                                fresh.explicits.begin(),
+                                fresh.explicits.end() );
+
+    const auto indexed = this->resume;
+    this->resume = std::distance( this->map.data(), next );
+    this->residual = residual;
+    this->incomplete = err == DLIS_TRUNCATED;
+
+    count( counter::bytes_indexed, this->resume - indexed );
+    count( counter::records_indexed, fresh.tells.size() );
+    return fresh;
+}
+
+const stream_offsets& tail_index::offsets() const noexcept (true) {
+    return this->ofs;
+}
+
+mio::mmap_source& tail_index::file() noexcept (true) {
+    return this->map;
+}
+
+long long tail_index::indexed() const noexcept (true) {
+    return this->resume;
+}
+
+bool tail_index::partial() const noexcept (true) {
+    return this->incomplete;
+}
+
+bool record::isexplicit() const noexcept (true) {
+    return this->attributes & DLIS_SEGATTR_EXFMTLR;
+}
+
+bool record::isencrypted() const noexcept (true) {
+    return this->attributes & DLIS_SEGATTR_ENCRYPT;
+}
+
+bool record_view::isexplicit() const noexcept (true) {
+    return this->attributes & DLIS_SEGATTR_EXFMTLR;
+}
+
+bool record_view::isencrypted() const noexcept (true) {
+    return this->attributes & DLIS_SEGATTR_ENCRYPT;
+}
+
+std::size_t record_batch::size() const noexcept (true) {
+    return this->types.size();
+}
+
+bool record_batch::empty() const noexcept (true) {
+    return this->types.empty();
+}
+
+const char* record_batch::begin( std::size_t i ) const noexcept (true) {
+    return this->data.data() + this->offsets[ i ];
+}
+
+const char* record_batch::end( std::size_t i ) const noexcept (true) {
+    return this->data.data() + this->offsets[ i + 1 ];
+}
+
+std::size_t record_batch::size( std::size_t i ) const noexcept (true) {
+    return this->offsets[ i + 1 ] - this->offsets[ i ];
+}
+
+bool record_batch::isexplicit( std::size_t i ) const noexcept (true) {
+    return this->attributes[ i ] & DLIS_SEGATTR_EXFMTLR;
+}
+
+bool record_batch::isencrypted( std::size_t i ) const noexcept (true) {
+    return this->attributes[ i ] & DLIS_SEGATTR_ENCRYPT;
+}
+
+record_view record_batch::view( std::size_t i ) const noexcept (false) {
+    if (i >= this->size()) {
+        const auto msg = "record_batch.view: index (which is {}) "
+                         ">= size (which is {})";
+        throw std::out_of_range(fmt::format(msg, i, this->size()));
+    }
+
+    record_view rec;
+    rec.type       = this->types[ i ];
+    rec.attributes = this->attributes[ i ];
+    rec.consistent = this->consistent[ i ];
+    rec.ptr        = this->begin( i );
+    rec.len        = this->size( i );
+    return rec;
+}
+
+void record_batch::clear() noexcept (true) {
+    this->data.clear();
+    this->offsets.assign( 1, 0 );
+    this->types.clear();
+    this->attributes.clear();
+    this->consistent.clear();
+}
+
+const char* record_view::begin() const noexcept (true) {
+    return this->ptr;
+}
+
+const char* record_view::end() const noexcept (true) {
+    return this->ptr + this->len;
+}
+
+std::size_t record_view::size() const noexcept (true) {
+    return this->len;
+}
+
+source::source( const std::string& path, bool mapped ) noexcept (false)
+    : filepath( path )
+    , is_mapped( mapped )
+{
+    if (mapped) {
+        map_source( this->map, path );
+        this->filesize = static_cast< long long >( this->map.size() );
+        return;
+    }
+
+    this->handle = open_file( path );
+    try {
+        this->remap();
+    } catch (...) {
+        this->close();
+        throw;
+    }
+}
+
+source::~source() {
+    this->close();
+}
+
+void source::read( char* dst, long long offset, std::size_t n ) const
+noexcept (false) {
+    if (offset < 0 or offset + static_cast< long long >( n ) > this->filesize) {
+        const auto msg = "unexpected end-of-file: reading {} bytes at offset "
+                         "{}, but file is {} bytes";
+        throw std::runtime_error(fmt::format(msg, n, offset, this->filesize));
+    }
+
+    if (this->is_mapped) {
+        std::memcpy( dst, this->map.data() + offset, n );
+        return;
+    }
+
+    if (this->handle == mio::invalid_handle)
+        throw std::runtime_error( "read from closed file" );
+
+    /*
+     * Positional reads don't use (or move) the file position, so they are
+     * safe to issue from many threads on the same handle
+     */
+    while (n > 0) {
+#ifdef _WIN32
+        OVERLAPPED at = {};
+        at.Offset     = static_cast< DWORD >( offset & 0xFFFFFFFF );
+        at.OffsetHigh = static_cast< DWORD >( offset >> 32 );
+        const auto chunk = static_cast< DWORD >(
+            (std::min)( n, std::size_t(1) << 30 )
+        );
+        DWORD got = 0;
+        if (not ReadFile( this->handle, dst, chunk, &got, &at )) {
+            const auto err = std::error_code( GetLastError(),
+                                              std::system_category() );
+            throw std::system_error( err, "read failed" );
+        }
+#else
+        const auto got = ::pread( this->handle, dst, n, offset );
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            throw fmt::system_error(errno, "read failed");
+        }
+#endif
+        if (got == 0) {
+            const auto msg = "unexpected end-of-file at offset {}";
+            throw std::runtime_error(fmt::format(msg, offset));
+        }
+
+        dst    += got;
+        offset += got;
+        n      -= got;
+    }
+}
+
+bool source::mapped() const noexcept (true) {
+    return this->is_mapped;
+}
+
+const std::string& source::path() const noexcept (true) {
+    return this->filepath;
+}
+
+long long source::size() const noexcept (true) {
+    return this->filesize;
+}
+
+const char* source::data() const noexcept (true) {
+    if (not this->is_mapped) return nullptr;
+    return this->map.data();
+}
+
+mio::mmap_source& source::mapping() noexcept (false) {
+    if (not this->is_mapped)
+        throw std::invalid_argument( "source is not memory-mapped" );
+    return this->map;
+}
+
+void source::remap() noexcept (false) {
+    if (this->is_mapped) {
+        map_source( this->map, this->filepath );
+        this->filesize = static_cast< long long >( this->map.size() );
+        return;
+    }
+
+    if (this->handle == mio::invalid_handle)
+        throw std::runtime_error( "remap of closed file" );
+    this->filesize = file_size( this->handle );
+}
+
+void source::close() noexcept (true) {
+    if (this->is_mapped) {
+        this->map.unmap();
+        this->filesize = 0;
+        return;
+    }
+
+    if (this->handle == mio::invalid_handle) return;
+#ifdef _WIN32
+    CloseHandle( this->handle );
+#else
+    ::close( this->handle );
+#endif
+    this->handle = mio::invalid_handle;
+    this->filesize = 0;
+}
+
+void source::advise( long long offset, long long n, access_hint hint ) const
+noexcept (true) {
+    if (this->is_mapped) {
+        dl::advise( this->map, offset, n, hint );
+        return;
+    }
+
+#if !defined(_WIN32) && defined(POSIX_FADV_NORMAL)
+    if (this->handle == mio::invalid_handle) return;
+    if (offset < 0 or n <= 0 or offset >= this->filesize) return;
+
+    n = (std::min)( n, this->filesize - offset );
+    fadvise( this->handle, offset, n, hint );
+#endif
+}
+
+stream::stream( const std::string& path ) noexcept (false)
+    : stream( std::make_shared< source >( path, false ) )
+{}
+
+stream::stream( const std::string& path, bool mapped ) noexcept (false)
+    : stream( std::make_shared< source >( path, mapped ) )
+{}
+
+stream::stream( const std::vector< std::string >& paths ) noexcept (false)
+    : stream( [&paths] {
+        std::vector< std::shared_ptr< source > > files;
+        files.reserve( paths.size() );
+        for (const auto& path : paths)
+            files.push_back( std::make_shared< source >( path, true ) );
+        return files;
+    }() )
+{}
+
+stream::stream( std::shared_ptr< source > file ) noexcept (false)
+    : stream( std::vector< std::shared_ptr< source > >{ std::move( file ) } )
+{}
+
+stream::stream( std::vector< std::shared_ptr< source > > xs ) noexcept (false)
+    : files( std::move( xs ) )
+{
+    if (this->files.empty())
+        throw std::invalid_argument( "paths must be non-empty" );
+
+    this->bases.clear();
+    this->is_mapped = true;
+
+    long long base = 0;
+    for (const auto& file : this->files) {
+        if (not file)
+            throw std::invalid_argument( "source must be non-null" );
+
+        this->bases.push_back( base );
+        base += file->size();
+        this->is_mapped = this->is_mapped and file->mapped();
+    }
+}
+
+bool stream::mapped() const noexcept (true) {
+    return this->is_mapped;
+}
+
+const std::vector< long long >& stream::offsets() const noexcept (true) {
+    return this->bases;
+}
+
+const std::vector< std::shared_ptr< source > >& stream::sources() const
+noexcept (true) {
+    return this->files;
+}
+
+const std::shared_ptr< stats >& stream::statistics() const noexcept (true) {
+    return this->counters;
+}
+
+record stream::at( int i ) noexcept (false) {
+    record r;
+    r.data.reserve( 8192 );
+    return this->at( i, r );
+}
+
+namespace {
+
+bool consumed_record( long long tell,
+                      const std::vector< long long >& tells,
+                      int i ) noexcept (true) {
+    /*
+     * this was the last record, so have no idea how to determine that
+     * everything is properly consumed. Always true
+     */
+    if (std::size_t(i) == tells.size() - 1) return true;
+
+    return tell == tells[ i + 1 ];
+}
+
+template < typename T >
+bool attr_consistent( const T& ) noexcept (true) {
+    // TODO: implement
+    // internal attributes should have both successor and predecessor
+    // first only successors, last only predecessors
+    return true;
+}
+
+template < typename T >
+bool type_consistent( const T& ) noexcept (true) {
+    // TODO: implement
+    // should be all-equal
+    return true;
+}
+
+int segment_trim(std::uint8_t attrs,
+                 const char* begin,
+                 int segment_size)
+noexcept (false) {
+    /*
+     * The number of bytes to chop off the end of the segment body, i.e.
+     * padbytes, trailing length and checksum
+     */
+    int trim = 0;
+    const auto* end = begin + segment_size;
+    const auto err = dlis_trim_record_segment(attrs, begin, end, &trim);
+
+    switch (err) {
+        case DLIS_OK:
+            return trim;
+
+        case DLIS_BAD_SIZE:
+            if (trim - segment_size != DLIS_LRSH_SIZE) {
+                const auto msg =
+                    "bad segment trim: padbytes (which is {}) "
+                    ">= segment.size() (which is {})";
+                throw std::runtime_error(fmt::format(msg, trim, segment_size));
+            }
+
+            /*
+             * padbytes included the segment header. It's larger than
+             * the segment body, but only because it also counts the
+             * header. accept that, pretend the body was never added,
+             * and move on.
+             */
+            return segment_size;
+
+        default:
+            throw std::invalid_argument("dlis_trim_record_segment");
+    }
+}
+
+void trim_segment(std::uint8_t attrs,
+                  const char* begin,
+                  int segment_size,
+                  std::vector< char >& segment)
+noexcept (false) {
+    const auto trim = segment_trim(attrs, begin, segment_size);
+    segment.resize(segment.size() - trim);
+}
+}
+
+/*
+ * store attributes in a string to use the short-string optimisation if
+ * available. Just before commit, these are checked for consistency, i.e.
+ * that segments don't report inconsistent information on encryption and
+ * formatting.
+ */
+template < typename T >
+using shortvec = std::basic_string< T >;
+
+namespace {
+
+template < typename Record >
+void commit( Record& rec,
+             const shortvec< std::uint8_t >& attributes,
+             const shortvec< int >& types,
+             bool consistent ) noexcept (true) {
+    /*
+     * The record type only cares about encryption and formatting, so only
+     * extract those for checking consistency. Nothing else is interesting to
+     * users, as it only describes how to read this specific segment
+     */
+    static const auto fmtenc = DLIS_SEGATTR_EXFMTLR | DLIS_SEGATTR_ENCRYPT;
+    rec.attributes = attributes.front() & fmtenc;
+    rec.type = types.front();
+
+    rec.consistent = consistent;
+    if (not attr_consistent( attributes )) rec.consistent = false;
+    if (not type_consistent( types ))      rec.consistent = false;
+}
+
+void noncontiguous( const std::vector< long long >& tells,
+                    int i,
+                    long long at ) noexcept (false) {
+    /*
+     * If this happens something is VERY wrong. Every new record should start
+     * just after the previous, unless bytes have been purposely skipped,
+     * because the file was otherwise broken. This probably comes from
+     * consistent, but lying, length attributes
+     */
+    const auto msg = "non-contiguous record: "
+                     "#{} (at tell {}) "
+                     "ends prematurely at {}, "
+                     "not at #{} (at tell {})"
+    ;
+
+    const auto tell1 = tells.at(i);
+    const auto tell2 = tells.at(i + 1);
+    const auto str   = fmt::format(msg, i, tell1, at, i+1, tell2);
+    throw std::runtime_error(str);
+}
+
+/*
+ * A range of bytes of the file, [offset, offset + size), that is in memory at
+ * data. For a memory-mapped file, this is the whole mapping.
+ */
+struct region {
+    const char* data;
+    long long offset;
+    long long size;
+};
+
+/*
+ * The index of the physical file that tell is in. Files are laid out
+ * back-to-back at bases, so this is the last file that starts before (or at)
+ * tell
+ */
+std::size_t fileof( const std::vector< std::shared_ptr< source > >& files,
+                    const std::vector< long long >& bases,
+                    long long tell ) noexcept (false) {
+    if (files.empty())
+        throw std::runtime_error( "I/O operation on closed stream" );
+
+    const auto next = std::upper_bound( bases.begin(), bases.end(), tell );
+    const auto k = (std::max)( std::distance( bases.begin(), next ) - 1,
+                               std::ptrdiff_t(0) );
+    return std::size_t(k);
+}
+
+/*
+ * The mapping of the physical file that tell is in
+ */
+region locate( const std::vector< std::shared_ptr< source > >& files,
+               const std::vector< long long >& bases,
+               long long tell ) noexcept (false) {
+    const auto k = fileof( files, bases, tell );
+    const auto& file = *files[ k ];
+    return { file.data(), bases[ k ], file.size() };
+}
+
+/*
+ * The last record of a physical file is not followed by the next record in
+ * the stream (but by the end of the file), so contiguity can't be checked
+ * for it
+ */
+bool last_in_file( const std::vector< long long >& tells,
+                   int i,
+                   const region& map ) noexcept (true) {
+    const auto next = std::size_t(i) + 1;
+    if (next >= tells.size()) return false;
+    return tells[ next ] >= map.offset + map.size;
+}
+
+/*
+ * The record runs past the end of the region. For a region that is the whole
+ * file the file is truncated, but a region that is only a chunk of it, like in
+ * the readahead, may just not hold all of the record.
+ */
+struct truncated_region : public std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+/*
+ * Walk the segments of record i directly in memory. This mirrors stream::at
+ * for the fstream, but instead of reading the segment bodies into a buffer,
+ * append(ptr, len) is called with the (trimmed) body of every segment, and the
+ * caller decides whether to copy or not. Returns the number of segments.
+ */
+template < typename Record, typename Append >
+int walk_mapped( const region& map,
+                  const std::vector< long long >& tells,
+                  long long tell,
+                  int remaining,
+                  int i,
+                  bool contiguous,
+                  Record& rec,
+                  Append append ) noexcept (false) {
+
+    const auto* const first = map.data;
+    const auto* const last  = map.data + map.size;
+
+    if (tell < map.offset or tell > map.offset + map.size) {
+        const auto msg = "record {} (at tell {}) is outside the file "
+                         "(which is {} bytes)";
+        const auto size = map.offset + map.size;
+        throw std::out_of_range(fmt::format(msg, i, tell, size));
+    }
+
+    const auto* cur = first + (tell - map.offset);
+    const auto require = [&]( int n ) {
+        if (n >= 0 and std::distance( cur, last ) >= n) return;
+
+        const auto msg = "unexpected end-of-file in record {} (at tell {})";
+        throw truncated_region(fmt::format(msg, i, tell));
+    };
+
+    shortvec< std::uint8_t > attributes;
+    shortvec< int > types;
+    bool consistent = true;
+    int segments = 0;
+
+    while (true) {
+        while (remaining > 0) {
+            int len, type;
+            std::uint8_t attrs;
+            require( DLIS_LRSH_SIZE );
+            const auto err = dlis_lrsh( cur, &len, &attrs, &type );
+            cur += DLIS_LRSH_SIZE;
+
+            remaining -= len;
+            len -= DLIS_LRSH_SIZE;
+
+            if (err) consistent = false;
+            attributes.push_back( attrs );
+            types.push_back( type );
+
+            if (remaining < 0) {
+                const auto vrl_len = remaining + len;
+                const auto cur_tell = map.offset
+                                    + std::distance( first, cur )
+                                    - DLIS_LRSH_SIZE;
+                const auto msg = "visible record/segment inconsistency: "
+                                 "segment (which is {}) "
+                                 ">= visible (which is {}) "
+                                 "in record {} (at tell {})"
+                ;
+                const auto str = fmt::format(msg, len, vrl_len, i, cur_tell);
+                throw std::runtime_error(str);
+            }
+
+            require( len );
+            const auto trim = segment_trim( attrs, cur, len );
+            append( cur, len - trim );
+            cur += len;
+            ++segments;
+
+            const auto has_successor = attrs & DLIS_SEGATTR_SUCCSEG;
+            if (has_successor) continue;
+
+            const auto at = map.offset + std::distance( first, cur );
+            if (contiguous and not consumed_record( at, tells, i ))
+                noncontiguous( tells, i, at );
+
+            commit( rec, attributes, types, consistent );
+            return segments;
+        }
+
+        int len, version;
+        require( DLIS_VRL_SIZE );
+        const auto err = dlis_vrl( cur, &len, &version );
+        cur += DLIS_VRL_SIZE;
+
+        // TODO: for now record closest to VE gets the blame
+        if (err) consistent = false;
+        if (version != 1) consistent = false;
+
+        remaining = len - DLIS_VRL_SIZE;
+    }
+}
+
+}
+
+record& stream::at( int i, record& rec ) noexcept (false) {
+
+    auto tell = this->tells.at( i );
+    auto remaining = this->residuals.at( i );
+
+    if (this->is_mapped) {
+        rec.data.clear();
+        const auto append = [&rec]( const char* ptr, int len ) {
+            rec.data.insert( rec.data.end(), ptr, ptr + len );
+        };
+
+        const auto map = locate( this->files, this->bases, tell );
+        const auto checked = this->contiguous
+                         and not last_in_file( this->tells, i, map );
+        const auto segments = walk_mapped( map,
+                                           this->tells,
+                                           tell,
+                                           remaining,
+                                           i,
+                                           checked,
+                                           rec,
+                                           append );
+
+        auto* counters = this->counters.get();
+        count( counters, counter::records_read );
+        count( counters, counter::segments_read, segments );
+        count( counters, counter::records_stitched, segments > 1 );
+        count( counters, counter::bytes_copied, rec.data.size() );
+        return rec;
+    }
+
+    shortvec< std::uint8_t > attributes;
+    shortvec< int > types;
+    bool consistent = true;
+    int segments = 0;
+
+    /*
+     * Read with positional reads from the source, and track the position
+     * here, so that streams (and threads) sharing the source don't interfere
+     */
+    const auto k = fileof( this->files, this->bases, tell );
+    const auto& file = *this->files[ k ];
+    const auto base = this->bases[ k ];
+    auto pos = tell - base;
+    const auto take = [&file, &pos]( char* dst, std::size_t n ) {
+        file.read( dst, pos, n );
+        pos += n;
+    };
+
+    const region map = { nullptr, base, file.size() };
+    const auto checked = this->contiguous
+                     and not last_in_file( this->tells, i, map );
+
+    rec.data.clear();
+
+    while (true) {
+        while (remaining > 0) {
+            int len, type;
+            std::uint8_t attrs;
+            char buffer[ DLIS_LRSH_SIZE ];
+            take( buffer, DLIS_LRSH_SIZE );
+            const auto err = dlis_lrsh( buffer, &len, &attrs, &type );
+
+            remaining -= len;
+            len -= DLIS_LRSH_SIZE;
+
+            if (err) consistent = false;
+            attributes.push_back( attrs );
+            types.push_back( type );
+
+            if (remaining < 0) {
+                /*
+                 * mismatch between visisble-record-length and segment length.
+                 * For now, just throw, but this could be reduced to a warning
+                 * with guide on which one to believe
+                 */
+
+                const auto vrl_len = remaining + len;
+                const auto cur_tell = base + pos - DLIS_LRSH_SIZE;
+                const auto msg = "visible record/segment inconsistency: "
+                                 "segment (which is {}) "
+                                 ">= visible (which is {}) "
+                                 "in record {} (at tell {})"
+                ;
+                const auto str = fmt::format(msg, len, vrl_len, i, cur_tell);
+                throw std::runtime_error(str);
+            }
+
+            const auto prevsize = rec.data.size();
+            rec.data.resize( prevsize + len );
+            take( rec.data.data() + prevsize, len );
+
+            /*
+             * chop off trailing length and checksum for now
+             * TODO: verify integrity by checking trailing length
+             * TODO: calculate checksum
+             */
+            const auto* fst = rec.data.data() + prevsize;
+            trim_segment(attrs, fst, len, rec.data);
+            ++segments;
+
+            /*if the whole segment is getting trimmed, it's unclear if
+              successor attribute should be erased or not.
+              For now ignoring. Suspecting issue will never occur as
+              whole "too many padbytes" problem might be caused by encryption
+            */
+
+            const auto has_successor = attrs & DLIS_SEGATTR_SUCCSEG;
+            if (has_successor) continue;
+
+            /* read last segment - check consistency and wrap up */
+            const auto at = base + pos;
+            if (checked and not consumed_record( at, this->tells, i ))
+                noncontiguous( this->tells, i, at );
+
+            commit( rec, attributes, types, consistent );
+
+            auto* counters = this->counters.get();
+            count( counters, counter::records_read );
+            count( counters, counter::segments_read, segments );
+            count( counters, counter::records_stitched, segments > 1 );
+            count( counters, counter::bytes_copied, rec.data.size() );
+            return rec;
+        }
+
+        int len, version;
+        char buffer[ DLIS_VRL_SIZE ];
+        take( buffer, DLIS_VRL_SIZE );
+        const auto err = dlis_vrl( buffer, &len, &version );
+
+        // TODO: for now record closest to VE gets the blame
+        if (err) consistent = false;
+        if (version != 1) consistent = false;
+
+        remaining = len - DLIS_VRL_SIZE;
+    }
+}
+
+namespace {
+
+/*
+ * Read record i from map into rec. Point into the region for the first
+ * segment, and only start copying to the buffer when it is clear the record
+ * spans more than one segment
+ */
+record_view& view_region( const region& map,
+                          const std::vector< long long >& tells,
+                          const std::vector< int >& residuals,
+                          int i,
+                          bool contiguous,
+                          record_view& rec,
+                          stats* counters ) noexcept (false) {
+    const auto tell = tells.at( i );
+    const auto remaining = residuals.at( i );
+
+    const char* first = nullptr;
+    std::size_t firstlen = 0;
+    int segments = 0;
+    rec.buffer.clear();
+    const auto append = [&]( const char* ptr, int len ) {
+        if (segments == 0) {
+            first = ptr;
+            firstlen = len;
+        } else {
+            if (segments == 1)
+                rec.buffer.assign( first, first + firstlen );
+            rec.buffer.insert( rec.buffer.end(), ptr, ptr + len );
+        }
+        ++segments;
+    };
+
+    walk_mapped( map, tells, tell, remaining, i, contiguous, rec, append );
+
+    if (segments > 1) {
+        rec.ptr = rec.buffer.data();
+        rec.len = rec.buffer.size();
+        count( counters, counter::records_stitched );
+        count( counters, counter::bytes_copied, rec.len );
+    } else {
+        rec.ptr = first;
+        rec.len = firstlen;
+    }
+
+    count( counters, counter::records_read );
+    count( counters, counter::segments_read, segments );
+    return rec;
+}
+
+}
+
+record_view& stream::at( int i, record_view& rec ) noexcept (false) {
+    if (not this->is_mapped) {
+        /*
+         * Without a mapping there is nothing to point into, so read the
+         * record as usual, but into the buffer of the view
+         */
+        record tmp;
+        tmp.data.swap( rec.buffer );
+        this->at( i, tmp );
+        rec.buffer.swap( tmp.data );
+
+        rec.type       = tmp.type;
+        rec.attributes = tmp.attributes;
+        rec.consistent = tmp.consistent;
+        rec.ptr        = rec.buffer.data();
+        rec.len        = rec.buffer.size();
+        return rec;
+    }
+
+    const auto map = locate( this->files, this->bases, this->tells.at( i ) );
+    const auto checked = this->contiguous
+                     and not last_in_file( this->tells, i, map );
+    return view_region( map,
+                        this->tells,
+                        this->residuals,
+                        i,
+                        checked,
+                        rec,
+                        this->counters.get() );
+}
+
+
+namespace {
+
+/*
+ * The headers of a record in a record_batch, for walk_mapped to commit to
+ */
+struct batch_header {
+    int type;
+    std::uint8_t attributes;
+    bool consistent;
+};
+
+void push_header( record_batch& batch,
+                  int type,
+                  std::uint8_t attributes,
+                  bool consistent ) noexcept (false) {
+    batch.types.push_back( type );
+    batch.attributes.push_back( attributes );
+    batch.consistent.push_back( consistent );
+    batch.offsets.push_back( batch.data.size() );
+}
+
+}
+
+bool record_extent::isexplicit() const noexcept (true) {
+    return this->attributes & DLIS_SEGATTR_EXFMTLR;
+}
+
+bool record_extent::isencrypted() const noexcept (true) {
+    return this->attributes & DLIS_SEGATTR_ENCRYPT;
+}
+
+bool extract_policy::wants( int type, std::uint8_t attributes ) const
+noexcept (true) {
+    if (not this->encrypted and (attributes & DLIS_SEGATTR_ENCRYPT))
+        return false;
+
+    if (this->types.empty()) return true;
+    const auto itr = std::find( this->types.begin(), this->types.end(), type );
+    return itr != this->types.end();
+}
+
+record_extent stream::extent( int i ) noexcept (false) {
+    record_extent ext;
+    this->walk_headers( i, nullptr, ext );
+    return ext;
+}
+
+bool stream::walk_headers( int i,
+                           const extract_policy* stop,
+                           record_extent& ext ) noexcept (false) {
+    const auto tell = this->tells.at( i );
+    auto remaining = this->residuals.at( i );
+
+    shortvec< std::uint8_t > attributes;
+    shortvec< int > types;
+    bool consistent = true;
+
+    ext.index = i;
+    ext.tell = tell;
+    ext.segments = 0;
+
+    auto pos = tell;
+    while (true) {
+        while (remaining > 0) {
+            int len, type;
+            std::uint8_t attrs;
+            char buffer[ DLIS_LRSH_SIZE ];
+            this->read( buffer, pos, DLIS_LRSH_SIZE );
+            const auto err = dlis_lrsh( buffer, &len, &attrs, &type );
+
+            if (err) consistent = false;
+            attributes.push_back( attrs );
+            types.push_back( type );
+
+            if (len < DLIS_LRSH_SIZE or len > remaining) {
+                const auto msg = "visible record/segment inconsistency: "
+                                 "segment (which is {}) "
+                                 ">= visible (which is {}) "
+                                 "in record {} (at tell {})"
+                ;
+                const auto str = fmt::format(msg, len, remaining, i, pos);
+                throw std::runtime_error(str);
+            }
+
+            if (stop and ext.segments == 0 and stop->wants( type, attrs ))
+                return false;
+
+            remaining -= len;
+            pos += len;
+            ++ext.segments;
+
+            const auto has_successor = attrs & DLIS_SEGATTR_SUCCSEG;
+            if (has_successor) continue;
+
+            const auto map = locate( this->files, this->bases, tell );
+            const auto checked = this->contiguous
+                             and not last_in_file( this->tells, i, map );
+            if (checked and not consumed_record( pos, this->tells, i ))
+                noncontiguous( this->tells, i, pos );
+
+            commit( ext, attributes, types, consistent );
+            ext.size = pos - tell;
+            return true;
+        }
+
+        int len, version;
+        char buffer[ DLIS_VRL_SIZE ];
+        this->read( buffer, pos, DLIS_VRL_SIZE );
+        const auto err = dlis_vrl( buffer, &len, &version );
+        pos += DLIS_VRL_SIZE;
+
+        if (err) consistent = false;
+        if (version != 1) consistent = false;
+
+        remaining = len - DLIS_VRL_SIZE;
+    }
+}
+
+record_batch& stream::extract( const std::vector< int >& indices,
+                               record_batch& batch ) noexcept (false) {
+    return this->extract( indices, batch, extract_policy() );
+}
+
+record_batch& stream::extract( const std::vector< int >& indices,
+                               record_batch& batch,
+                               const extract_policy& policy,
+                               std::vector< record_extent >* skipped )
+noexcept (false) {
+    auto* counters = this->counters.get();
+    scoped_timer timer( counters, phase::extract );
+
+    batch.clear();
+    batch.offsets.reserve( indices.size() + 1 );
+    batch.types.reserve( indices.size() );
+    batch.attributes.reserve( indices.size() );
+    batch.consistent.reserve( indices.size() );
+
+    /*
+     * Only look at the header of the first segment when the policy could
+     * reject the record, and when it does, walk the segment headers to find
+     * the extent, but leave the body alone
+     */
+    const auto everything = policy.encrypted and policy.types.empty();
+    long long nskipped = 0;
+    long long bytes_skipped = 0;
+    const auto skip = [&]( int i ) {
+        if (everything) return false;
+
+        record_extent ext;
+        if (not this->walk_headers( i, &policy, ext )) return false;
+
+        push_header( batch, ext.type, ext.attributes, ext.consistent );
+        if (skipped) skipped->push_back( ext );
+        nskipped += 1;
+        bytes_skipped += ext.size;
+        return true;
+    };
+
+    const auto count_skipped = [&] {
+        count( counters, counter::records_skipped, nskipped );
+        count( counters, counter::bytes_skipped, bytes_skipped );
+    };
+
+    if (not this->is_mapped) {
+        record rec;
+        rec.data.reserve( 8192 );
+        for (auto i : indices) {
+            if (skip( i )) continue;
+            this->at( i, rec );
+            batch.data.insert( batch.data.end(),
+                               rec.data.begin(),
+                               rec.data.end() );
+            push_header( batch, rec.type, rec.attributes, rec.consistent );
+        }
+        count_skipped();
+        return batch;
+    }
+
+    /*
+     * The distance between two tells is an upper bound of the size of the
+     * record, since it also includes headers and padding, so in the common
+     * case where all records but the last are followed by another the data is
+     * allocated once
+     */
+    std::size_t capacity = 0;
+    for (auto i : indices) {
+        const auto next = std::size_t(i) + 1;
+        if (i >= 0 and next < this->tells.size())
+            capacity += this->tells[ next ] - this->tells[ i ];
+    }
+    batch.data.reserve( capacity );
+
+    const auto append = [&batch]( const char* ptr, int len ) {
+        batch.data.insert( batch.data.end(), ptr, ptr + len );
+    };
+
+    long long segments = 0;
+    long long stitched = 0;
+    for (auto i : indices) {
+        if (skip( i )) continue;
+        batch_header header;
+        const auto tell = this->tells.at( i );
+        const auto map = locate( this->files, this->bases, tell );
+        const auto checked = this->contiguous
+                         and not last_in_file( this->tells, i, map );
+        const auto n = walk_mapped( map,
+                                    this->tells,
+                                    tell,
+                                    this->residuals.at( i ),
+                                    i,
+                                    checked,
+                                    header,
+                                    append );
+        push_header( batch, header.type, header.attributes, header.consistent );
+        segments += n;
+        stitched += n > 1;
+    }
+
+    const auto nread = static_cast< long long >( indices.size() ) - nskipped;
+    count( counters, counter::records_read, nread );
+    count( counters, counter::segments_read, segments );
+    count( counters, counter::records_stitched, stitched );
+    count( counters, counter::bytes_copied, batch.data.size() );
+    count_skipped();
+    return batch;
+}
+
+void stream::reindex( const std::vector< long long >& tells,
+                      const std::vector< int >& residuals ) noexcept (false) {
+    if (tells.empty())
+        throw std::invalid_argument( "tells must be non-empty" );
+
+    if (residuals.empty())
+        throw std::invalid_argument( "residuals must be non-empty" );
+
+    if (tells.size() != residuals.size()) {
+        const auto msg = "reindex requires tells.size() which is {}) "
+                         "== residuals.size() (which is {})"
         ;
         const auto str = fmt::format(msg, tells.size(), residuals.size());
         throw std::invalid_argument(str);
@@ -420,8 +1898,104 @@ void stream::reindex( const std::vector< long long >& tells,
     this->residuals = residuals;
 }
 
+void stream::extend( const std::vector< long long >& tells,
+                     const std::vector< int >& residuals ) noexcept (false) {
+    if (tells.size() != residuals.size()) {
+        const auto msg = "extend requires tells.size() which is {}) "
+                         "== residuals.size() (which is {})"
+        ;
+        const auto str = fmt::format(msg, tells.size(), residuals.size());
+        throw std::invalid_argument(str);
+    }
+
+    this->tells.insert( this->tells.end(), tells.begin(), tells.end() );
+    this->residuals.insert( this->residuals.end(),
+                            residuals.begin(),
+                            residuals.end() );
+}
+
+void stream::remap() noexcept (false) {
+    if (this->files.empty()) return;
+    this->files.back()->remap();
+}
+
 void stream::close() {
-    this->fs.close();
+    this->files.clear();
+}
+
+void stream::advise( const int* first, const int* last, access_hint hint )
+noexcept (true) {
+    std::vector< advice_range > ranges;
+    try {
+        ranges = this->advice_ranges( first, last, hint );
+    } catch (const std::bad_alloc&) {
+        /* the hints are only hints, so don't bother */
+        return;
+    }
+
+    for (const auto& range : ranges)
+        this->files[ range.file ]->advise( range.offset, range.size, hint );
+}
+
+std::vector< advice_range >
+stream::advice_ranges( const int* first, const int* last, access_hint hint )
+const noexcept (false) {
+    std::vector< advice_range > ranges;
+    if (this->files.empty()) return ranges;
+
+    /*
+     * Records that are only a little apart are advised as one range, like
+     * readahead reads them in one chunk. Pages are only dropped if they're
+     * wholly inside the records though, so those ranges must be adjacent.
+     */
+    const auto gap = hint == access_hint::dontneed
+                   ? 0
+                   : readahead_options().max_gap;
+
+    const auto ntells = this->tells.size();
+    const auto end_of_stream = this->bases.back() + this->files.back()->size();
+
+    std::size_t file = 0;
+    long long begin = 0;
+    long long end = 0;
+    const auto flush = [&] {
+        if (begin >= end) return;
+        const auto base = this->bases[ file ];
+        ranges.push_back( { file, begin - base, end - begin } );
+    };
+
+    for (auto itr = first; itr != last; ++itr) {
+        const auto i = *itr;
+        if (i < 0 or std::size_t(i) >= ntells) continue;
+
+        const auto tell = this->tells[ i ];
+        const auto k = fileof( this->files, this->bases, tell );
+        const auto end_of_file = this->bases[ k ] + this->files[ k ]->size();
+
+        /*
+         * A record ends where the next one starts, and no record spans two
+         * files. Without contiguous tells the next one may be further away,
+         * but that only means advising some bytes more than necessary.
+         */
+        auto next = std::size_t(i) + 1 < ntells ? this->tells[ i + 1 ]
+                                                : end_of_stream;
+        next = (std::min)( next, end_of_file );
+        if (next <= tell) continue;
+
+        const auto pending = begin < end;
+        if (pending and k == file and tell >= begin and tell <= end + gap) {
+            end = (std::max)( end, next );
+            continue;
+        }
+
+        flush();
+        file  = k;
+        begin = tell;
+        end   = next;
+    }
+
+    flush();
+    return ranges;
 }
 
 void stream::read( char* dst, long long offset, int n ) {
@@ -435,8 +2009,220 @@ void stream::read( char* dst, long long offset, int n ) {
         throw std::invalid_argument(fmt::format(msg, offset));
     }
 
-    this->fs.seekg( offset );
-    this->fs.read( dst, n );
+    const auto k = fileof( this->files, this->bases, offset );
+    const auto& file = *this->files[ k ];
+    const auto base = this->bases[ k ];
+
+    if (this->is_mapped) {
+        const auto end = base + file.size();
+        if (offset + n > end) {
+            const auto msg = "reading {} bytes at offset {} would read past "
+                             "end-of-file (which is {})";
+            throw std::out_of_range(fmt::format(msg, n, offset, end));
+        }
+    }
+
+    file.read( dst, offset - base, n );
+}
+
+readahead::readahead( stream& f,
+                      std::vector< int > idx,
+                      readahead_options o ) noexcept (false)
+    : file( &f )
+    , indices( std::move( idx ) )
+    , opts( o )
+{
+    if (this->opts.depth < 1 or this->opts.threads < 1) {
+        const auto msg = "expected depth (which is {}) >= 1 and "
+                         "threads (which is {}) >= 1";
+        const auto str = fmt::format(msg, this->opts.depth, this->opts.threads);
+        throw std::invalid_argument(str);
+    }
+
+    if (this->file->mapped()) return;
+
+    const auto& tells = this->file->tells;
+    for (auto i : this->indices) {
+        if (i < 0 or i >= int(tells.size())) {
+            const auto msg = "index {} out of range [0, {})";
+            throw std::out_of_range(fmt::format(msg, i, tells.size()));
+        }
+    }
+
+    /*
+     * The byte range of record i is [tells[i], tells[i + 1]), which holds
+     * for contiguous streams. Should it not, e.g. for the last record in a
+     * file with garbage at the end, the record is not contained in the chunk,
+     * and next() falls back to stream::at. Chunks never span two files.
+     */
+    const auto& files = this->file->files;
+    const auto& bases = this->file->bases;
+    const auto chunk_size = static_cast< long long >( this->opts.chunk_size );
+    this->chunkof.reserve( this->indices.size() );
+    for (auto i : this->indices) {
+        const auto begin = tells[ i ];
+        const auto k = fileof( files, bases, begin );
+        const auto filesize = bases[ k ] + files[ k ]->size();
+        auto end = filesize;
+        if (i + 1 < int(tells.size()))
+            end = (std::min)( tells[ i + 1 ], filesize );
+        end = (std::max)( begin, end );
+
+        if (not this->plan.empty()) {
+            auto& back = this->plan.back();
+            const auto coalesce = begin >= back.end
+                              and back.begin >= bases[ k ]
+                              and begin - back.end <= this->opts.max_gap
+                              and end - back.begin <= chunk_size
+            ;
+
+            if (coalesce) {
+                back.end = end;
+                this->chunkof.push_back( int(this->plan.size()) - 1 );
+                continue;
+            }
+        }
+
+        this->plan.push_back( { begin, end } );
+        this->chunkof.push_back( int(this->plan.size()) - 1 );
+    }
+
+    this->nthreads = (std::min)( this->opts.threads, int(this->plan.size()) );
+    this->slots.resize( this->opts.depth );
+    this->workers.reserve( this->nthreads );
+    try {
+        for (int id = 0; id < this->nthreads; ++id)
+            this->workers.emplace_back( &readahead::work, this, id );
+    } catch (...) {
+        {
+            std::lock_guard< std::mutex > lock( this->mutex );
+            this->stop = true;
+        }
+        this->cond.notify_all();
+        for (auto& worker : this->workers) worker.join();
+        throw;
+    }
+}
+
+readahead::~readahead() {
+    {
+        std::lock_guard< std::mutex > lock( this->mutex );
+        this->stop = true;
+    }
+    this->cond.notify_all();
+    for (auto& worker : this->workers) worker.join();
+}
+
+void readahead::work( int id ) noexcept (true) {
+    const auto nchunks = int(this->plan.size());
+    const auto depth = this->opts.depth;
+
+    for (int c = id; c < nchunks; c += this->nthreads) {
+        {
+            std::unique_lock< std::mutex > lock( this->mutex );
+            this->cond.wait( lock, [&] {
+                return this->stop or c < this->released + depth;
+            });
+            if (this->stop) return;
+        }
+
+        /*
+         * The consumer is done with chunk c - depth, which was in this slot
+         * before, so nobody else touches the slot until it is published
+         */
+        auto& slot = this->slots[ c % depth ];
+        const auto& chunk = this->plan[ c ];
+        slot.error = nullptr;
+        try {
+            /*
+             * Sources are read with positional reads, so all the workers can
+             * read from the same one at once
+             */
+            const auto& files = this->file->files;
+            const auto& bases = this->file->bases;
+            const auto k = fileof( files, bases, chunk.begin );
+            slot.data.resize( chunk.end - chunk.begin );
+            files[ k ]->read( slot.data.data(),
+                              chunk.begin - bases[ k ],
+                              slot.data.size() );
+        } catch (...) {
+            slot.error = std::current_exception();
+        }
+
+        {
+            std::lock_guard< std::mutex > lock( this->mutex );
+            slot.chunk = c;
+        }
+        this->cond.notify_all();
+    }
+}
+
+bool readahead::next( record_view& rec ) noexcept (false) {
+    if (this->pos == this->indices.size()) return false;
+
+    const auto i = this->indices[ this->pos ];
+    if (this->file->mapped()) {
+        this->file->at( i, rec );
+        ++this->pos;
+        return true;
+    }
+
+    const auto c = this->chunkof[ this->pos ];
+    auto& slot = this->slots[ c % this->opts.depth ];
+    {
+        std::unique_lock< std::mutex > lock( this->mutex );
+        if (this->released < c) {
+            this->released = c;
+            this->cond.notify_all();
+        }
+        this->cond.wait( lock, [&] { return slot.chunk == c; } );
+    }
+
+    /*
+     * If the chunk could not be read, or the record is not all in it, the
+     * record is read with stream::at instead, which then reports any error
+     * like it always does. Any other error in the record is reported right
+     * away.
+     */
+    bool read = false;
+    if (not slot.error) {
+        const region chunk = {
+            slot.data.data(),
+            this->plan[ c ].begin,
+            static_cast< long long >( slot.data.size() ),
+        };
+
+        /* contiguity is checked exactly like in stream::at */
+        const auto& tells = this->file->tells;
+        const auto map = locate( this->file->files, this->file->bases,
+                                 tells[ i ] );
+        const auto checked = this->file->contiguous
+                         and not last_in_file( tells, i, map );
+
+        try {
+            view_region( chunk,
+                         tells,
+                         this->file->residuals,
+                         i,
+                         checked,
+                         rec,
+                         this->file->counters.get() );
+            read = true;
+        } catch (const truncated_region&) {}
+    }
+
+    if (not read) this->file->at( i, rec );
+
+    ++this->pos;
+    return true;
+}
+
+std::size_t readahead::size() const noexcept (true) {
+    return this->indices.size();
+}
+
+std::size_t readahead::chunks() const noexcept (true) {
+    return this->plan.size();
 }
 
 std::vector< std::pair< std::string, int > >
@@ -445,6 +2231,7 @@ findfdata(mio::mmap_source& file,
           const std::vector< long long >& tells,
           const std::vector< int >& residuals)
 noexcept (false) {
+    scoped_timer timer( phase::findfdata );
 
     const auto* ptr = file.data();
     const auto* end = file.data() + file.size();
@@ -481,4 +2268,118 @@ noexcept (false) {
     return xs;
 }
 
+namespace {
+
+/*
+ * The identity of a frame, i.e. the decoded obname, with the ident pointing
+ * into the file
+ */
+struct frameid {
+    std::int32_t origin;
+    std::uint8_t copy;
+    std::int32_t idlen;
+    const char* ident;
+
+    bool operator == ( const frameid& other ) const noexcept (true) {
+        return this->origin == other.origin
+           and this->copy   == other.copy
+           and this->idlen  == other.idlen
+           and std::memcmp( this->ident, other.ident, this->idlen ) == 0;
+    }
+};
+
+/*
+ * FNV-1a of (origin, copy, ident). The origin is hashed as the decoded value,
+ * not the UVARI bytes, since the same origin can be written in 1, 2 or 4 bytes
+ */
+std::uint64_t hash( const frameid& id ) noexcept (true) {
+    std::uint64_t h = 14695981039346656037ULL;
+    const auto mix = [&h]( unsigned char c ) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    };
+
+    const auto origin = std::uint32_t(id.origin);
+    for (int i = 0; i < 4; ++i) mix( (origin >> (8 * i)) & 0xFF );
+    mix( id.copy );
+    for (std::int32_t i = 0; i < id.idlen; ++i) mix( id.ident[ i ] );
+    return h;
+}
+
+}
+
+std::vector< fdata_group >
+groupfdata(mio::mmap_source& file,
+           const std::vector< int >& candidates,
+           const std::vector< long long >& tells,
+           const std::vector< int >& residuals)
+noexcept (false) {
+    scoped_timer timer( phase::findfdata );
+
+    const auto* ptr = file.data();
+    const auto* end = file.data() + file.size();
+
+    std::vector< fdata_group > groups;
+    /* the frameid of every group, same order as groups */
+    std::vector< frameid > ids;
+    /* hash -> group, of the first group with that hash */
+    std::unordered_map< std::uint64_t, std::size_t > known;
+
+    /*
+     * Records of a frame are mostly consecutive, so check the group of the
+     * previous record before hashing
+     */
+    std::size_t last = 0;
+
+    for (auto i : candidates) {
+        const auto tell = tells[i];
+        const auto resi = residuals[i];
+        int offset = resi == 0 ? 8 : 4;
+
+        // read LRSH type-field
+        // 0 == FDATA
+        if (*(ptr + tell + offset - 1) != 0) continue;
+
+        frameid id;
+        const char* body = ptr + tell + offset;
+        auto cur = dlis_obname(body, &id.origin, &id.copy, &id.idlen, nullptr);
+        if (std::distance( cur, end ) < 0)
+        {
+            auto msg = "File corrupted. Error on reading fdata obname";
+            throw std::runtime_error(msg);
+        }
+        id.ident = cur - id.idlen;
+
+        if (not groups.empty() and ids[last] == id) {
+            groups[last].records.push_back( i );
+            continue;
+        }
+
+        const auto h = hash( id );
+        const auto itr = known.find( h );
+        std::size_t g = groups.size();
+        if (itr != known.end()) {
+            /* a hash collision is all but impossible, but be correct */
+            if (ids[itr->second] == id) g = itr->second;
+            else for (std::size_t k = 0; k < ids.size(); ++k)
+                if (ids[k] == id) { g = k; break; }
+        }
+
+        if (g == groups.size()) {
+            dl::obname name{ dl::origin{ id.origin },
+                             dl::ushort{ id.copy },
+                             dl::ident{ std::string{ id.ident,
+                                                     id.ident + id.idlen } } };
+            groups.push_back( fdata_group{ name.fingerprint("FRAME"), {} } );
+            ids.push_back( id );
+            known.emplace( h, g );
+        }
+
+        groups[g].records.push_back( i );
+        last = g;
+    }
+
+    return groups;
+}
+
 }
@@ -2,11 +2,17 @@
 #include <bitset>
 #include <cstdlib>
 #include <cstring>
+#include <regex>
+#include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <fmt/core.h>
 
 #include <dlisio/dlisio.h>
+#include <dlisio/ext/io.hpp>
+#include <dlisio/ext/stats.hpp>
 #include <dlisio/ext/types.hpp>
 
 namespace {
@@ -331,23 +337,6 @@ const char* cast( const char* xs, dl::ident& id ) {
     return parse_ident( xs, id );
 }
 
-const char* cast( const char* xs, dl::units& id ) {
-    return parse_ident( xs, id );
-}
-
-const char* cast( const char* xs, dl::ascii& ascii ) noexcept (false) {
-    std::vector< char > str;
-    std::int32_t len;
-
-    dlis_ascii( xs, &len, nullptr );
-    str.resize( len );
-    xs = dlis_ascii( xs, &len, str.data() );
-
-    dl::ascii tmp{ std::string{ str.begin(), str.end() } };
-    swap( ascii, tmp );
-    return xs;
-}
-
 const char* cast( const char* xs, dl::origin& origin ) noexcept (true) {
     dl::origin::value_type x;
     xs = dlis_origin( xs, &x );
@@ -355,81 +344,6 @@ const char* cast( const char* xs, dl::origin& origin ) noexcept (true) {
     return xs;
 }
 
-const char* cast( const char* xs, dl::obname& obname ) noexcept (false) {
-    char str[ 256 ];
-    std::int32_t len;
-
-    std::int32_t orig;
-    std::uint8_t copy;
-
-    xs = dlis_obname( xs, &orig, &copy, &len, str );
-
-    dl::obname tmp{ dl::origin{ orig },
-                    dl::ushort{ copy },
-                    dl::ident{ std::string{ str, str + len } } };
-    swap( obname, tmp );
-    return xs;
-}
-
-const char* cast( const char* xs, dl::objref& objref ) noexcept (false) {
-    char iden[ 256 ];
-    char name[ 256 ];
-    std::int32_t ident_len;
-    std::int32_t origin;
-    std::uint8_t copy_number;
-    std::int32_t obname_len;
-
-    xs = dlis_objref( xs, &ident_len,
-                          iden,
-                          &origin,
-                          &copy_number,
-                          &obname_len,
-                          name );
-
-    dl::objref tmp{ dl::ident{ std::string{ iden, iden + ident_len } },
-                    dl::obname{
-                        dl::origin{ origin },
-                        dl::ushort{ copy_number },
-                        dl::ident{ std::string{ name, name + obname_len } }
-                    }
-    };
-
-    swap( objref, tmp );
-    return xs;
-}
-
-const char* cast( const char* xs, dl::attref& attref ) noexcept (false) {
-    char id1[ 256 ];
-    char obj[ 256 ];
-    char id2[ 256 ];
-    std::int32_t ident1_len;
-    std::int32_t origin;
-    std::uint8_t copy_number;
-    std::int32_t obname_len;
-    std::int32_t ident2_len;
-
-    xs = dlis_attref( xs, &ident1_len,
-                          id1,
-                          &origin,
-                          &copy_number,
-                          &obname_len,
-                          obj,
-                          &ident2_len,
-                          id2 );
-
-    dl::attref tmp{ dl::ident{ std::string{ id1, id1 + ident1_len } },
-                    dl::obname{
-                        dl::origin{ origin },
-                        dl::ushort{ copy_number },
-                        dl::ident{ std::string{ obj, obj + obname_len } }
-                    },
-                    dl::ident{ std::string{ id2, id2 + ident2_len } }
-    };
-
-    swap( attref, tmp );
-    return xs;
-}
-
 
 const char* cast( const char* xs, dl::dtime& dtime ) noexcept (true) {
     dl::dtime dt;
@@ -462,76 +376,8 @@ const char* cast( const char* xs,
 }
 
 template < typename T >
-const char* extract( std::vector< T >& vec,
-                     std::int32_t count,
-                     const char* xs ) noexcept (false) {
-
-    T elem;
-    std::vector< T > tmp;
-    for( std::int32_t i = 0; i < count; ++i ) {
-        xs = cast( xs, elem );
-        tmp.push_back( std::move( elem ) );
-    }
-
-    vec.swap( tmp );
-    return xs;
-}
-
-template < typename T >
-std::vector< T >& reset( dl::value_vector& value ) noexcept (false) {
-    return value.emplace< std::vector< T > >();
-}
-
-const char* elements( const char* xs,
-                      dl::uvari count,
-                      dl::representation_code reprc,
-                      dl::value_vector& vec ) {
-
-    const auto n = dl::decay( count );
-
-    if (n == 0) {
-        vec = mpark::monostate{};
-        return xs;
-    }
-
-    using rpc = dl::representation_code;
-    switch (reprc) {
-        case rpc::fshort: return extract( reset< dl::fshort >( vec ), n, xs );
-        case rpc::fsingl: return extract( reset< dl::fsingl >( vec ), n, xs );
-        case rpc::fsing1: return extract( reset< dl::fsing1 >( vec ), n, xs );
-        case rpc::fsing2: return extract( reset< dl::fsing2 >( vec ), n, xs );
-        case rpc::isingl: return extract( reset< dl::isingl >( vec ), n, xs );
-        case rpc::vsingl: return extract( reset< dl::vsingl >( vec ), n, xs );
-        case rpc::fdoubl: return extract( reset< dl::fdoubl >( vec ), n, xs );
-        case rpc::fdoub1: return extract( reset< dl::fdoub1 >( vec ), n, xs );
-        case rpc::fdoub2: return extract( reset< dl::fdoub2 >( vec ), n, xs );
-        case rpc::csingl: return extract( reset< dl::csingl >( vec ), n, xs );
-        case rpc::cdoubl: return extract( reset< dl::cdoubl >( vec ), n, xs );
-        case rpc::sshort: return extract( reset< dl::sshort >( vec ), n, xs );
-        case rpc::snorm : return extract( reset< dl::snorm  >( vec ), n, xs );
-        case rpc::slong : return extract( reset< dl::slong  >( vec ), n, xs );
-        case rpc::ushort: return extract( reset< dl::ushort >( vec ), n, xs );
-        case rpc::unorm : return extract( reset< dl::unorm  >( vec ), n, xs );
-        case rpc::ulong : return extract( reset< dl::ulong  >( vec ), n, xs );
-        case rpc::uvari : return extract( reset< dl::uvari  >( vec ), n, xs );
-        case rpc::ident:  return extract( reset< dl::ident  >( vec ), n, xs );
-        case rpc::ascii : return extract( reset< dl::ascii  >( vec ), n, xs );
-        case rpc::dtime : return extract( reset< dl::dtime  >( vec ), n, xs );
-        case rpc::origin: return extract( reset< dl::origin >( vec ), n, xs );
-        case rpc::obname: return extract( reset< dl::obname >( vec ), n, xs );
-        case rpc::objref: return extract( reset< dl::objref >( vec ), n, xs );
-        case rpc::attref: return extract( reset< dl::attref >( vec ), n, xs );
-        case rpc::status: return extract( reset< dl::status >( vec ), n, xs );
-        case rpc::units : return extract( reset< dl::units  >( vec ), n, xs );
-        default: {
-            const auto msg = "unable to interpret attribute: "
-                             "unknown representation code {}";
-            const auto code = static_cast< int >(reprc);
-            throw std::runtime_error(fmt::format(msg, code));
-        }
-    }
-
-    return xs;
+dl::small_vector< T >& reset( dl::value_vector& value ) noexcept (false) {
+    return value.emplace< dl::small_vector< T > >();
 }
 
 struct variant_equal {
@@ -541,8 +387,8 @@ struct variant_equal {
     }
 
     template < typename T >
-    bool operator () (const std::vector< T >& lhs,
-                      const std::vector< T >& rhs)
+    bool operator () (const dl::small_vector< T >& lhs,
+                      const dl::small_vector< T >& rhs)
     const noexcept (true) {
         return (lhs.size() == rhs.size())
             && std::equal(lhs.begin(), lhs.end(), rhs.begin());
@@ -674,223 +520,556 @@ bool basic_object::operator != (const basic_object& o) const noexcept (true) {
     return !(*this == o);
 }
 
-const char* parse_template( const char* cur,
-                            const char* end,
-                            object_template& out ) noexcept (false) {
-    object_template tmp;
+ident parse_set_type( const char* cur, const char* end ) noexcept (false) {
+    if (std::distance( cur, end ) <= 0)
+        throw std::out_of_range( "eflr must be non-empty" );
 
-    while (true) {
-        if (cur >= end)
-            throw std::out_of_range( "unexpected end-of-record in template" );
+    const auto flags = parse_set_descriptor( cur );
+    cur += DLIS_DESCRIPTOR_SIZE;
 
-        const auto flags = parse_attribute_descriptor( cur );
-        if (flags.object) {
-            swap( tmp, out );
-            return cur;
-        }
+    ident type;
+    if (not flags.type) return type;
 
-        /* decriptor read, so advance the cursor */
-        cur += DLIS_DESCRIPTOR_SIZE;
+    /*
+     * The type is the first thing after the descriptor, and it is just an
+     * ident, i.e. a length-prefixed string
+     */
+    if (std::distance( cur, end ) <= 0
+     or std::distance( cur, end ) <= std::uint8_t(*cur)) {
+        const auto msg = "unexpected end-of-record in SET type";
+        throw std::out_of_range( msg );
+    }
 
-        if (flags.absent) {
-            user_warning( "ABSATR in object template - skipping" );
-            continue;
+    cast( cur, type );
+    return type;
+}
+
+std::size_t string_table::size() const noexcept (true) {
+    return this->offsets.size() - 1;
+}
+
+std::string string_table::at( std::int32_t id ) const noexcept (false) {
+    if (id < 0 or std::size_t(id) >= this->size()) {
+        const auto msg = "string_table.at: id (which is {}) "
+                         "out of range (size is {})";
+        throw std::out_of_range(fmt::format(msg, id, this->size()));
+    }
+
+    const auto* begin = this->chars.data() + this->offsets[ id ];
+    const auto* end   = this->chars.data() + this->offsets[ id + 1 ];
+    return std::string( begin, end );
+}
+
+namespace {
+
+/*
+ * Build a flat_object_set, and intern its strings. The strings are indexed in
+ * an open-addressing hash table of string ids, so looking up a string already
+ * in the table makes no allocation
+ */
+struct flat_builder {
+    explicit flat_builder( flat_object_set& s ) : set( s ) {
+        this->buckets.assign( 64, -1 );
+        this->buckets[ this->slot( nullptr, 0 ) ] = 0;
+    }
+
+    std::int32_t intern( const char* str, std::int32_t len ) noexcept (false);
+
+    template < typename T >
+    void put( const T& x ) noexcept (false) {
+        const auto* ptr = reinterpret_cast< const char* >( &x );
+        this->set.values.insert( this->set.values.end(), ptr, ptr + sizeof(T) );
+    }
+
+    std::int32_t tell() const noexcept (true) {
+        return std::int32_t( this->set.values.size() );
+    }
+
+    flat_object_set& set;
+
+private:
+    std::vector< std::int32_t > buckets;
+    std::size_t used = 1;
+
+    static std::uint32_t hash( const char* str, std::int32_t len )
+    noexcept (true) {
+        /* FNV-1a */
+        std::uint32_t h = 2166136261u;
+        for (std::int32_t i = 0; i < len; ++i) {
+            h ^= std::uint8_t( str[ i ] );
+            h *= 16777619u;
         }
+        return h;
+    }
 
-        object_attribute attr;
+    bool equal( std::int32_t id, const char* str, std::int32_t len ) const
+    noexcept (true) {
+        const auto& offsets = this->set.strings.offsets;
+        const auto size = offsets[ id + 1 ] - offsets[ id ];
+        if (size != len) return false;
+        const auto* chars = this->set.strings.chars.data() + offsets[ id ];
+        return std::equal( chars, chars + len, str );
+    }
 
-        if (!flags.label) {
-            /*
-             * 3.2.2.2 Component usage
-             *  All Components in the Template must have distinct, non-null
-             *  Labels.
-             *
-             *  Assume that if this isn't set properly it's a corrupted
-             *  descriptor, so just try to read the label anyway
-             */
-            user_warning( "Label not set, but must be non-null" );
+    /*
+     * The bucket of str, which either holds the id of str, or is empty (-1)
+     * if str is not yet interned
+     */
+    std::size_t slot( const char* str, std::int32_t len ) const
+    noexcept (true) {
+        const auto mask = this->buckets.size() - 1;
+        auto i = hash( str, len ) & mask;
+        while (true) {
+            const auto id = this->buckets[ i ];
+            if (id < 0 or this->equal( id, str, len )) return i;
+            i = (i + 1) & mask;
         }
+    }
 
-                         cur = cast( cur, attr.label );
-        if (flags.count) cur = cast( cur, attr.count );
-        if (flags.reprc) cur = cast( cur, attr.reprc );
-        if (flags.units) cur = cast( cur, attr.units );
-        if (flags.value) cur = elements( cur, attr.count,
-                                              attr.reprc,
-                                              attr.value );
-        attr.invariant = flags.invariant;
+    void grow() noexcept (false);
+};
 
-        tmp.push_back( std::move( attr ) );
+std::int32_t flat_builder::intern( const char* str, std::int32_t len )
+noexcept (false) {
+    auto i = this->slot( str, len );
+    if (this->buckets[ i ] >= 0) return this->buckets[ i ];
 
-        if (cur == end){
-            debug_warning("Set contains no objects");
-            swap( tmp, out );
-            return cur;
-        }
+    auto& strings = this->set.strings;
+    const auto id = std::int32_t( strings.size() );
+    strings.chars.insert( strings.chars.end(), str, str + len );
+    strings.offsets.push_back( std::int32_t( strings.chars.size() ) );
+
+    if (2 * (this->used + 1) > this->buckets.size()) {
+        this->grow();
+        i = this->slot( str, len );
     }
+
+    this->buckets[ i ] = id;
+    this->used += 1;
+    return id;
 }
 
-namespace {
+void flat_builder::grow() noexcept (false) {
+    this->buckets.assign( 2 * this->buckets.size(), -1 );
+    const auto& strings = this->set.strings;
+    const auto mask = this->buckets.size() - 1;
+    for (std::int32_t id = 0; id < std::int32_t(strings.size()); ++id) {
+        const auto* str = strings.chars.data() + strings.offsets[ id ];
+        const auto len = strings.offsets[ id + 1 ] - strings.offsets[ id ];
+        auto i = hash( str, len ) & mask;
+        while (this->buckets[ i ] >= 0) i = (i + 1) & mask;
+        this->buckets[ i ] = id;
+    }
+}
 
-basic_object defaulted_object( const object_template& tmpl ) noexcept (false) {
-    basic_object def;
-    for (const auto& attr : tmpl)
-        def.set( attr );
+/*
+ * Interning readers for the string types, which read the string straight from
+ * the record, without making a std::string first
+ */
+const char* flat_ident( const char* xs, flat_builder& b, std::int32_t& id )
+noexcept (false) {
+    std::int32_t len;
+    xs = dlis_ident( xs, &len, nullptr );
+    id = b.intern( xs - len, len );
+    return xs;
+}
 
-    return def;
+const char* flat_obname( const char* xs, flat_builder& b ) noexcept (false) {
+    std::int32_t origin;
+    std::uint8_t copy;
+    std::int32_t len;
+    xs = dlis_obname( xs, &origin, &copy, &len, nullptr );
+    b.put( origin );
+    b.put( std::int32_t( copy ) );
+    b.put( b.intern( xs - len, len ) );
+    return xs;
+}
 
+template < typename T >
+const char* flat_element( const char* xs, flat_builder& b ) noexcept (false) {
+    T x;
+    xs = cast( xs, x );
+    b.put( x );
+    return xs;
 }
 
-struct len {
-    template < typename Vec >
-    std::size_t operator () ( const Vec& vec ) const {
-        return vec.size();
-    }
+template <>
+const char* flat_element< dl::ident >( const char* xs, flat_builder& b )
+noexcept (false) {
+    std::int32_t id;
+    xs = flat_ident( xs, b, id );
+    b.put( id );
+    return xs;
+}
 
-    std::size_t operator () ( const mpark::monostate& ) const {
-        throw std::invalid_argument( "patch: len() called on monostate" );
-    }
-};
+template <>
+const char* flat_element< dl::units >( const char* xs, flat_builder& b )
+noexcept (false) {
+    return flat_element< dl::ident >( xs, b );
+}
 
-struct shrink {
-    std::size_t size;
-    explicit shrink( std::size_t sz ) : size( sz ) {}
+template <>
+const char* flat_element< dl::ascii >( const char* xs, flat_builder& b )
+noexcept (false) {
+    std::int32_t len;
+    xs = dlis_ascii( xs, &len, nullptr );
+    b.put( b.intern( xs - len, len ) );
+    return xs;
+}
 
-    template < typename T >
-    void operator () ( std::vector< T >& vec ) const {
-        vec.resize(this->size);
+template <>
+const char* flat_element< dl::obname >( const char* xs, flat_builder& b )
+noexcept (false) {
+    return flat_obname( xs, b );
+}
+
+template <>
+const char* flat_element< dl::objref >( const char* xs, flat_builder& b )
+noexcept (false) {
+    std::int32_t type;
+    xs = flat_ident( xs, b, type );
+    b.put( type );
+    return flat_obname( xs, b );
+}
+
+template <>
+const char* flat_element< dl::attref >( const char* xs, flat_builder& b )
+noexcept (false) {
+    std::int32_t type;
+    xs = flat_ident( xs, b, type );
+    b.put( type );
+    xs = flat_obname( xs, b );
+
+    std::int32_t label;
+    xs = flat_ident( xs, b, label );
+    b.put( label );
+    return xs;
+}
+
+/*
+ * The default (empty) element, for patching attributes without a value, see
+ * patch_missing_value
+ */
+template < typename T >
+void flat_default( flat_builder& b ) noexcept (false) {
+    b.put( T() );
+}
+
+template <>
+void flat_default< dl::ident >( flat_builder& b ) noexcept (false) {
+    b.put( std::int32_t( 0 ) );
+}
+
+template <>
+void flat_default< dl::units >( flat_builder& b ) noexcept (false) {
+    flat_default< dl::ident >( b );
+}
+
+template <>
+void flat_default< dl::ascii >( flat_builder& b ) noexcept (false) {
+    flat_default< dl::ident >( b );
+}
+
+template <>
+void flat_default< dl::obname >( flat_builder& b ) noexcept (false) {
+    b.put( std::int32_t( 0 ) );
+    b.put( std::int32_t( 0 ) );
+    b.put( std::int32_t( 0 ) );
+}
+
+template <>
+void flat_default< dl::objref >( flat_builder& b ) noexcept (false) {
+    b.put( std::int32_t( 0 ) );
+    flat_default< dl::obname >( b );
+}
+
+template <>
+void flat_default< dl::attref >( flat_builder& b ) noexcept (false) {
+    flat_default< dl::objref >( b );
+    b.put( std::int32_t( 0 ) );
+}
+
+/*
+ * Read count elements of T into the values, and return the offset of the
+ * first. If xs is nullptr, write count default elements instead
+ */
+template < typename T >
+std::int32_t flat_extract( const char*& xs,
+                           std::int32_t count,
+                           flat_builder& b ) noexcept (false) {
+    const auto offset = b.tell();
+    for (std::int32_t i = 0; i < count; ++i) {
+        if (xs) xs = flat_element< T >( xs, b );
+        else    flat_default< T >( b );
     }
+    return offset;
+}
 
-    void operator () ( const mpark::monostate& ) const  {
-        throw std::invalid_argument( "patch: shrink() called on monostate" );
+std::int32_t flat_elements( const char*& xs,
+                            std::int32_t count,
+                            dl::representation_code reprc,
+                            flat_builder& b,
+                            const char* errmsg ) noexcept (false) {
+    using rpc = dl::representation_code;
+    switch (reprc) {
+        case rpc::fshort: return flat_extract< dl::fshort >( xs, count, b );
+        case rpc::fsingl: return flat_extract< dl::fsingl >( xs, count, b );
+        case rpc::fsing1: return flat_extract< dl::fsing1 >( xs, count, b );
+        case rpc::fsing2: return flat_extract< dl::fsing2 >( xs, count, b );
+        case rpc::isingl: return flat_extract< dl::isingl >( xs, count, b );
+        case rpc::vsingl: return flat_extract< dl::vsingl >( xs, count, b );
+        case rpc::fdoubl: return flat_extract< dl::fdoubl >( xs, count, b );
+        case rpc::fdoub1: return flat_extract< dl::fdoub1 >( xs, count, b );
+        case rpc::fdoub2: return flat_extract< dl::fdoub2 >( xs, count, b );
+        case rpc::csingl: return flat_extract< dl::csingl >( xs, count, b );
+        case rpc::cdoubl: return flat_extract< dl::cdoubl >( xs, count, b );
+        case rpc::sshort: return flat_extract< dl::sshort >( xs, count, b );
+        case rpc::snorm : return flat_extract< dl::snorm  >( xs, count, b );
+        case rpc::slong : return flat_extract< dl::slong  >( xs, count, b );
+        case rpc::ushort: return flat_extract< dl::ushort >( xs, count, b );
+        case rpc::unorm : return flat_extract< dl::unorm  >( xs, count, b );
+        case rpc::ulong : return flat_extract< dl::ulong  >( xs, count, b );
+        case rpc::uvari : return flat_extract< dl::uvari  >( xs, count, b );
+        case rpc::ident : return flat_extract< dl::ident  >( xs, count, b );
+        case rpc::ascii : return flat_extract< dl::ascii  >( xs, count, b );
+        case rpc::dtime : return flat_extract< dl::dtime  >( xs, count, b );
+        case rpc::origin: return flat_extract< dl::origin >( xs, count, b );
+        case rpc::obname: return flat_extract< dl::obname >( xs, count, b );
+        case rpc::objref: return flat_extract< dl::objref >( xs, count, b );
+        case rpc::attref: return flat_extract< dl::attref >( xs, count, b );
+        case rpc::status: return flat_extract< dl::status >( xs, count, b );
+        case rpc::units : return flat_extract< dl::units  >( xs, count, b );
+        default: {
+            const auto code = static_cast< int >(reprc);
+            throw std::runtime_error(fmt::format(errmsg, code));
+        }
     }
-};
+}
 
-void patch_missing_value( dl::value_vector& value,
-                          std::size_t count,
-                          dl::representation_code reprc )
-noexcept (false)
-{
-    /*
-     * value is *NOT* monostate, i.e. there is a default value.  if count !=
-     * values.size(), resize it.
-     */
-    if (!mpark::holds_alternative< mpark::monostate >(value)) {
-        const auto size = mpark::visit( len(), value );
-        /* same size, so return */
-        if (size == count) return;
-
-        /* smaller, shrink and all is fine */
-        if (size > count) {
-            mpark::visit( shrink( count ), value );
-            return;
+/*
+ * Read the value of attr from xs, mirroring elements()
+ */
+const char* flat_value( const char* xs,
+                        flat_attribute& attr,
+                        flat_builder& b ) noexcept (false) {
+    if (attr.count == 0) {
+        attr.value = -1;
+        return xs;
+    }
+
+    const auto msg = "unable to interpret attribute: "
+                     "unknown representation code {}";
+    attr.value = flat_elements( xs, attr.count, attr.reprc, b, msg );
+    return xs;
+}
+
+flat_attribute flat_attribute_from( const flat_attribute& tmpl ) {
+    auto attr = tmpl;
+    attr.invariant = false;
+    return attr;
+}
+
+const char* parse_flat_template( const char* cur,
+                                 const char* end,
+                                 flat_builder& b ) noexcept (false) {
+    /* see parse_template */
+    auto& tmpl = b.set.tmpl;
+    while (true) {
+        if (cur >= end)
+            throw std::out_of_range( "unexpected end-of-record in template" );
+
+        const auto flags = parse_attribute_descriptor( cur );
+        if (flags.object) return cur;
+
+        cur += DLIS_DESCRIPTOR_SIZE;
+
+        if (flags.absent) {
+            user_warning( "ABSATR in object template - skipping" );
+            continue;
         }
 
+        flat_attribute attr;
+        if (!flags.label)
+            user_warning( "Label not set, but must be non-null" );
+
+        dl::uvari count{ 1 };
+                         cur = flat_ident( cur, b, attr.label );
+        if (flags.count) cur = cast( cur, count );
+        if (flags.reprc) cur = cast( cur, attr.reprc );
+        if (flags.units) cur = flat_ident( cur, b, attr.units );
+        attr.count = dl::decay( count );
+        if (flags.value) cur = flat_value( cur, attr, b );
+        attr.invariant = flags.invariant;
+
+        tmpl.push_back( attr );
+
+        if (cur == end) {
+            debug_warning("Set contains no objects");
+            return cur;
+        }
+    }
+}
+
+void patch_flat_value( flat_attribute& attr,
+                       const flat_attribute& tmpl,
+                       flat_builder& b ) noexcept (false) {
+    /* see patch_missing_value */
+    if (attr.value >= 0) {
         /*
-         * count is larger, so insert default values, maybe? for now, throw
-         * exception and consider what to do when a file actually uses this
-         * behaviour
+         * The default value is count elements, so using the first (fewer)
+         * elements is just a matter of lowering count
          */
+        const auto size = tmpl.count;
+        if (size >= attr.count) return;
+
         const auto msg = "object attribute without no explicit value, but "
                          "count (which is {}) > size (which is {})"
         ;
-        throw dl::not_implemented(fmt::format(msg, count, size));
+        throw dl::not_implemented(fmt::format(msg, attr.count, size));
     }
 
-    /*
-     * value *is* monstate, so initialize a default value that corresponds to
-     * whatever type is there.
-     *
-     * 3.2.2 EFLR: Component Structure declares ident with the empty string as
-     * a default type, but this is already stored in the defaulted reprc,
-     * making this switch work in the general case
-     */
+    const auto msg = "unable to patch attribute with no value: "
+                     "unknown representation code {}";
+    const char* xs = nullptr;
+    attr.value = flat_elements( xs, attr.count, attr.reprc, b, msg );
+}
+
+/*
+ * Step over count elements of reprc, without decoding them
+ */
+const char* skip_elements( const char* xs,
+                           std::int32_t count,
+                           dl::representation_code reprc ) noexcept (false) {
+    const auto code = static_cast< int >( reprc );
+    const auto size = dlis_sizeof_type( code );
+    if (size > 0) return xs + std::size_t( size ) * std::size_t( count );
 
+    std::int32_t len;
+    std::int32_t origin;
+    std::uint8_t copy;
     using rpc = dl::representation_code;
-    switch (reprc) {
-        case rpc::fshort: reset< dl::fshort >(value).resize(count); return;
-        case rpc::fsingl: reset< dl::fsingl >(value).resize(count); return;
-        case rpc::fsing1: reset< dl::fsing1 >(value).resize(count); return;
-        case rpc::fsing2: reset< dl::fsing2 >(value).resize(count); return;
-        case rpc::isingl: reset< dl::isingl >(value).resize(count); return;
-        case rpc::vsingl: reset< dl::vsingl >(value).resize(count); return;
-        case rpc::fdoubl: reset< dl::fdoubl >(value).resize(count); return;
-        case rpc::fdoub1: reset< dl::fdoub1 >(value).resize(count); return;
-        case rpc::fdoub2: reset< dl::fdoub2 >(value).resize(count); return;
-        case rpc::csingl: reset< dl::csingl >(value).resize(count); return;
-        case rpc::cdoubl: reset< dl::cdoubl >(value).resize(count); return;
-        case rpc::sshort: reset< dl::sshort >(value).resize(count); return;
-        case rpc::snorm:  reset< dl::snorm  >(value).resize(count); return;
-        case rpc::slong:  reset< dl::slong  >(value).resize(count); return;
-        case rpc::ushort: reset< dl::ushort >(value).resize(count); return;
-        case rpc::unorm:  reset< dl::unorm  >(value).resize(count); return;
-        case rpc::ulong:  reset< dl::ulong  >(value).resize(count); return;
-        case rpc::uvari:  reset< dl::uvari  >(value).resize(count); return;
-        case rpc::ident:  reset< dl::ident  >(value).resize(count); return;
-        case rpc::ascii:  reset< dl::ascii  >(value).resize(count); return;
-        case rpc::dtime:  reset< dl::dtime  >(value).resize(count); return;
-        case rpc::origin: reset< dl::origin >(value).resize(count); return;
-        case rpc::obname: reset< dl::obname >(value).resize(count); return;
-        case rpc::objref: reset< dl::objref >(value).resize(count); return;
-        case rpc::attref: reset< dl::attref >(value).resize(count); return;
-        case rpc::status: reset< dl::status >(value).resize(count); return;
-        case rpc::units:  reset< dl::units  >(value).resize(count); return;
-        default: {
-            const auto msg = "unable to patch attribute with no value: "
-                             "unknown representation code {}";
-            const auto code = static_cast< int >(reprc);
-            throw std::runtime_error(fmt::format(msg, code));
+    for (std::int32_t i = 0; i < count; ++i) {
+        switch (reprc) {
+            case rpc::uvari:
+            case rpc::origin:
+                xs = dlis_uvari( xs, &len );
+                break;
+            case rpc::ident:
+            case rpc::units:
+                xs = dlis_ident( xs, &len, nullptr );
+                break;
+            case rpc::ascii:
+                xs = dlis_ascii( xs, &len, nullptr );
+                break;
+            case rpc::obname:
+                xs = dlis_obname( xs, &origin, &copy, &len, nullptr );
+                break;
+            case rpc::objref:
+                xs = dlis_ident( xs, &len, nullptr );
+                xs = dlis_obname( xs, &origin, &copy, &len, nullptr );
+                break;
+            case rpc::attref:
+                xs = dlis_ident( xs, &len, nullptr );
+                xs = dlis_obname( xs, &origin, &copy, &len, nullptr );
+                xs = dlis_ident( xs, &len, nullptr );
+                break;
+            default: {
+                const auto msg = "unable to interpret attribute: "
+                                 "unknown representation code {}";
+                throw std::runtime_error( fmt::format( msg, code ) );
+            }
         }
     }
+    return xs;
 }
 
-object_vector parse_objects( const object_template& tmpl,
-                             const char* cur,
-                             const char* end ) noexcept (false) {
+/*
+ * Step over the attributes of an object that is not selected, mirroring
+ * parse_flat_objects, but without interning or storing anything
+ */
+const char* skip_flat_object( const char* cur,
+                              const char* end,
+                              const std::vector< flat_attribute >& tmpl )
+noexcept (false) {
+    for (const auto& template_attr : tmpl) {
+        if (template_attr.invariant) continue;
+        if (cur == end) break;
 
-    object_vector objs;
-    const auto default_object = defaulted_object( tmpl );
+        const auto flags = parse_attribute_descriptor( cur );
+        if (flags.object) break;
 
+        cur += DLIS_DESCRIPTOR_SIZE;
+        if (flags.absent) continue;
+
+        auto count = template_attr.count;
+        auto reprc = template_attr.reprc;
+        std::int32_t len;
+        if (flags.count) {
+            dl::uvari x;
+            cur = cast( cur, x );
+            count = dl::decay( x );
+        }
+        if (flags.reprc) cur = cast( cur, reprc );
+        if (flags.units) cur = dlis_units( cur, &len, nullptr );
+        if (flags.value) cur = skip_elements( cur, count, reprc );
+
+        if (std::distance( cur, end ) < 0)
+            throw std::out_of_range( "unexpected end-of-record in object" );
+    }
+
+    return cur;
+}
+
+void parse_flat_objects( const char* cur,
+                         const char* end,
+                         flat_builder& b,
+                         const object_filter& filter ) noexcept (false) {
+    /* see parse_objects */
+    auto& set = b.set;
+    const auto every = filter.any_name();
     while (true) {
         if (std::distance( cur, end ) <= 0)
             throw std::out_of_range( "unexpected end-of-record" );
 
-        auto object_flags = parse_object_descriptor( cur );
+        const auto object_flags = parse_object_descriptor( cur );
         cur += DLIS_DESCRIPTOR_SIZE;
 
-        auto current = default_object;
-        if (object_flags.name) cur = cast( cur, current.object_name );
+        flat_object object = { 0, 0, 0, 0, 0 };
+        object.first = std::int32_t( set.attributes.size() );
+        const char* name = nullptr;
+        std::int32_t len = 0;
+        if (object_flags.name) {
+            std::uint8_t copy;
+            cur = dlis_obname( cur, &object.origin, &copy, &len, nullptr );
+            object.copy = copy;
+            name = cur - len;
+        }
+
+        if (not every and not filter.name( name, len )) {
+            cur = skip_flat_object( cur, end, set.tmpl );
+            if (cur == end) break;
+            continue;
+        }
+
+        if (object_flags.name) object.id = b.intern( name, len );
 
-        for (const auto& template_attr : tmpl) {
+        for (const auto& template_attr : set.tmpl) {
             if (template_attr.invariant) continue;
             if (cur == end) break;
 
             const auto flags = parse_attribute_descriptor( cur );
             if (flags.object) break;
 
-
-            /*
-             * only advance after this is surely not a new object, because if
-             * it's the next object we want to read it again
-             */
             cur += DLIS_DESCRIPTOR_SIZE;
 
-            auto attr = template_attr;
-            // absent means no meaning, so *unset* whatever is there
+            auto attr = flat_attribute_from( template_attr );
             if (flags.absent) {
-                current.remove( attr );
+                attr.absent = true;
+                set.attributes.push_back( attr );
                 continue;
             }
 
             if (flags.invariant) {
-                /*
-                 * 3.2.2.2 Component Usage
-                 *  Invariant Attribute Components, which may only appear in
-                 *  the Template [...]
-                 *
-                 * Assume this is a mistake, assume it was a regular
-                 * non-invariant attribute
-                 */
                 user_warning("ATTRIB:invariant in attribute, "
                              "but should only be in template");
             }
@@ -899,65 +1078,137 @@ object_vector parse_objects( const object_template& tmpl,
                 user_warning( "ATTRIB:label set, but must be null");
             }
 
-            if (flags.count) cur = cast( cur, attr.count );
+            if (flags.count) {
+                dl::uvari count;
+                cur = cast( cur, count );
+                attr.count = dl::decay( count );
+            }
             if (flags.reprc) cur = cast( cur, attr.reprc );
-            if (flags.units) cur = cast( cur, attr.units );
-            if (flags.value) cur = elements( cur, attr.count,
-                                                  attr.reprc,
-                                                  attr.value );
+            if (flags.units) cur = flat_ident( cur, b, attr.units );
+            if (flags.value) cur = flat_value( cur, attr, b );
 
-            const auto count = dl::decay( attr.count );
-
-            /*
-             * 3.2.2.1 Component Descriptor
-             * When an object attribute count is zero, the value is explicitly
-             * undefined, even if a default exists.
-             *
-             * This is functionally equivalent to the value being marked absent
-             */
-            if (count == 0) {
-                attr.value = mpark::monostate{};
+            if (attr.count == 0) {
+                attr.value = -1;
             } else if (!flags.value) {
-                /*
-                 * Count is non-zero, but there's no value for this attribute.
-                 * Expand what's already defaulted, and if it is monostate, set
-                 * the default of that value
-                 *
-                 * For non-zero count we should check default values only when
-                 * representation code is not changed.
-                 *
-                 * TODO: in the future it's possible to allow promotion between
-                 * certain codes (ident -> ascii), but is no need for now
-                 */
-
                 if (flags.reprc && attr.reprc != template_attr.reprc) {
                     const auto msg = "count ({}) isn't 0 and representation "
                         "code ({}) changed, but value is not explicitly set";
                     const auto code = static_cast< int >(attr.reprc);
-                    throw std::runtime_error(fmt::format(msg, count, code));
+                    throw std::runtime_error(
+                        fmt::format(msg, attr.count, code)
+                    );
                 }
 
-                patch_missing_value( attr.value, count, attr.reprc );
+                patch_flat_value( attr, template_attr, b );
             }
 
-            current.set(attr);
+            set.attributes.push_back( attr );
         }
 
-        objs.push_back( std::move( current ) );
+        object.size = std::int32_t( set.attributes.size() ) - object.first;
+        set.objects.push_back( object );
 
         if (cur == end) break;
     }
+}
 
-    return objs;
+/*
+ * Readers for the flat values, the inverse of flat_element
+ */
+template < typename T >
+const char* unflat( const char* xs, const string_table&, T& x ) {
+    std::memcpy( &x, xs, sizeof(T) );
+    return xs + sizeof(T);
 }
 
+std::int32_t getint( const char*& xs ) noexcept (true) {
+    std::int32_t x;
+    std::memcpy( &x, xs, sizeof(x) );
+    xs += sizeof(x);
+    return x;
 }
 
-object_set parse_objects( const char* cur, const char* end ) {
+template < typename T >
+T unflat_string( const char*& xs, const string_table& strings ) {
+    return T{ strings.at( getint( xs ) ) };
+}
+
+const char* unflat( const char* xs, const string_table& s, dl::ident& x ) {
+    x = unflat_string< dl::ident >( xs, s );
+    return xs;
+}
+
+const char* unflat( const char* xs, const string_table& s, dl::units& x ) {
+    x = unflat_string< dl::units >( xs, s );
+    return xs;
+}
+
+const char* unflat( const char* xs, const string_table& s, dl::ascii& x ) {
+    x = unflat_string< dl::ascii >( xs, s );
+    return xs;
+}
+
+const char* unflat( const char* xs, const string_table& s, dl::obname& x ) {
+    x.origin = dl::origin{ getint( xs ) };
+    x.copy   = dl::ushort( getint( xs ) );
+    x.id     = unflat_string< dl::ident >( xs, s );
+    return xs;
+}
+
+const char* unflat( const char* xs, const string_table& s, dl::objref& x ) {
+    x.type = unflat_string< dl::ident >( xs, s );
+    return unflat( xs, s, x.name );
+}
+
+const char* unflat( const char* xs, const string_table& s, dl::attref& x ) {
+    x.type  = unflat_string< dl::ident >( xs, s );
+    xs      = unflat( xs, s, x.name );
+    x.label = unflat_string< dl::ident >( xs, s );
+    return xs;
+}
+
+template < typename T >
+void unflat_values( const flat_object_set& set,
+                    const flat_attribute& attr,
+                    dl::value_vector& value ) noexcept (false) {
+    auto& vec = reset< T >( value );
+    vec.resize( attr.count );
+
+    const auto* xs = set.values.data() + attr.value;
+    for (auto& x : vec)
+        xs = unflat( xs, set.strings, x );
+}
+
+basic_object defaulted_object( const object_template& tmpl ) noexcept (false) {
+    basic_object def;
+    for (const auto& attr : tmpl)
+        def.set( attr );
+
+    return def;
+}
+
+dl::object_attribute unflatten( const flat_object_set& set,
+                                const flat_attribute& flat )
+noexcept (false) {
+    dl::object_attribute attr;
+    attr.label     = dl::ident{ set.strings.at( flat.label ) };
+    attr.count     = dl::uvari{ flat.count };
+    attr.reprc     = flat.reprc;
+    attr.units     = dl::units{ set.strings.at( flat.units ) };
+    attr.value     = flat_value( set, flat );
+    attr.invariant = flat.invariant;
+    return attr;
+}
+
+flat_object_set parse_flat_set( const char* cur,
+                                const char* end,
+                                const object_filter& filter )
+noexcept (false) {
     if (std::distance( cur, end ) <= 0)
         throw std::out_of_range( "eflr must be non-empty" );
 
-    object_set set;
+    flat_object_set set;
+    flat_builder b( set );
 
     const auto flags = parse_set_descriptor( cur );
     cur += DLIS_DESCRIPTOR_SIZE;
@@ -967,23 +1218,256 @@ object_set parse_objects( const char* cur, const char* end ) {
         throw std::out_of_range( msg );
     }
 
-    /*
-     * TODO: check for every read that inside [begin,end)?
-     */
     set.role = flags.role;
-    if (flags.type) cur = cast( cur, set.type );
-    if (flags.name) cur = cast( cur, set.name );
+    if (flags.type) cur = flat_ident( cur, b, set.type );
+    if (flags.name) cur = flat_ident( cur, b, set.name );
 
-    cur = parse_template( cur, end, set.tmpl );
+    cur = parse_flat_template( cur, end, b );
 
-    /*
-    Return if set has no objects
-    */
     if (std::distance( cur, end ) == 0)
-         return set;
+        return set;
 
-    set.objects = parse_objects( set.tmpl, cur, end );
+    parse_flat_objects( cur, end, b, filter );
+    count( counter::objects_parsed, set.objects.size() );
     return set;
 }
 
+const object_filter& everything() noexcept (true) {
+    static const object_filter filter;
+    return filter;
+}
+
+}
+
+flat_object_set parse_flat_objects( const char* cur, const char* end )
+noexcept (false) {
+    scoped_timer timer( phase::parse_objects );
+    return parse_flat_set( cur, end, everything() );
+}
+
+flat_object_set parse_flat_objects( const char* cur,
+                                    const char* end,
+                                    const object_filter& filter )
+noexcept (false) {
+    scoped_timer timer( phase::parse_objects );
+    return parse_flat_set( cur, end, filter );
+}
+
+value_vector flat_value( const flat_object_set& set,
+                         const flat_attribute& attr ) noexcept (false) {
+    dl::value_vector value;
+    if (attr.value < 0 or attr.count == 0) return value;
+
+    using rpc = dl::representation_code;
+    switch (attr.reprc) {
+        case rpc::fshort: unflat_values< dl::fshort >( set, attr, value ); break;
+        case rpc::fsingl: unflat_values< dl::fsingl >( set, attr, value ); break;
+        case rpc::fsing1: unflat_values< dl::fsing1 >( set, attr, value ); break;
+        case rpc::fsing2: unflat_values< dl::fsing2 >( set, attr, value ); break;
+        case rpc::isingl: unflat_values< dl::isingl >( set, attr, value ); break;
+        case rpc::vsingl: unflat_values< dl::vsingl >( set, attr, value ); break;
+        case rpc::fdoubl: unflat_values< dl::fdoubl >( set, attr, value ); break;
+        case rpc::fdoub1: unflat_values< dl::fdoub1 >( set, attr, value ); break;
+        case rpc::fdoub2: unflat_values< dl::fdoub2 >( set, attr, value ); break;
+        case rpc::csingl: unflat_values< dl::csingl >( set, attr, value ); break;
+        case rpc::cdoubl: unflat_values< dl::cdoubl >( set, attr, value ); break;
+        case rpc::sshort: unflat_values< dl::sshort >( set, attr, value ); break;
+        case rpc::snorm : unflat_values< dl::snorm  >( set, attr, value ); break;
+        case rpc::slong : unflat_values< dl::slong  >( set, attr, value ); break;
+        case rpc::ushort: unflat_values< dl::ushort >( set, attr, value ); break;
+        case rpc::unorm : unflat_values< dl::unorm  >( set, attr, value ); break;
+        case rpc::ulong : unflat_values< dl::ulong  >( set, attr, value ); break;
+        case rpc::uvari : unflat_values< dl::uvari  >( set, attr, value ); break;
+        case rpc::ident : unflat_values< dl::ident  >( set, attr, value ); break;
+        case rpc::ascii : unflat_values< dl::ascii  >( set, attr, value ); break;
+        case rpc::dtime : unflat_values< dl::dtime  >( set, attr, value ); break;
+        case rpc::origin: unflat_values< dl::origin >( set, attr, value ); break;
+        case rpc::obname: unflat_values< dl::obname >( set, attr, value ); break;
+        case rpc::objref: unflat_values< dl::objref >( set, attr, value ); break;
+        case rpc::attref: unflat_values< dl::attref >( set, attr, value ); break;
+        case rpc::status: unflat_values< dl::status >( set, attr, value ); break;
+        case rpc::units : unflat_values< dl::units  >( set, attr, value ); break;
+        default: {
+            const auto msg = "flat_value: unknown representation code {}";
+            const auto code = static_cast< int >(attr.reprc);
+            throw std::runtime_error(fmt::format(msg, code));
+        }
+    }
+
+    return value;
+}
+
+object_set unflatten( const flat_object_set& flat ) noexcept (false) {
+    object_set set;
+    set.role = flat.role;
+    set.type = dl::ident{ flat.strings.at( flat.type ) };
+    set.name = dl::ident{ flat.strings.at( flat.name ) };
+
+    set.tmpl.reserve( flat.tmpl.size() );
+    for (const auto& attr : flat.tmpl)
+        set.tmpl.push_back( unflatten( flat, attr ) );
+
+    const auto default_object = defaulted_object( set.tmpl );
+    set.objects.reserve( flat.objects.size() );
+    for (const auto& object : flat.objects) {
+        auto current = default_object;
+        current.object_name = dl::obname{
+            dl::origin{ object.origin },
+            dl::ushort{ object.copy },
+            dl::ident{ flat.strings.at( object.id ) },
+        };
+
+        const auto* first = flat.attributes.data() + object.first;
+        for (const auto* attr = first; attr != first + object.size; ++attr) {
+            if (attr->absent) current.remove( unflatten( flat, *attr ) );
+            else              current.set( unflatten( flat, *attr ) );
+        }
+
+        set.objects.push_back( std::move( current ) );
+    }
+
+    return set;
+}
+
+const char* parse_template( const char* cur,
+                            const char* end,
+                            object_template& out ) noexcept (false) {
+    flat_object_set set;
+    flat_builder b( set );
+    cur = parse_flat_template( cur, end, b );
+
+    object_template tmpl;
+    tmpl.reserve( set.tmpl.size() );
+    for (const auto& attr : set.tmpl)
+        tmpl.push_back( unflatten( set, attr ) );
+
+    swap( tmpl, out );
+    return cur;
+}
+
+object_set parse_objects( const char* cur, const char* end ) noexcept (false) {
+    scoped_timer timer( phase::parse_objects );
+    return unflatten( parse_flat_set( cur, end, everything() ) );
+}
+
+std::vector< object_set > parse_objects( const record_batch& batch )
+noexcept (false) {
+    std::vector< object_set > sets;
+    sets.reserve( batch.size() );
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        if (batch.isencrypted( i )) continue;
+        sets.push_back( parse_objects( batch.begin( i ), batch.end( i ) ) );
+    }
+    return sets;
+}
+
+namespace {
+
+/*
+ * Parse the set in [begin, end) into sets, unless filter skips its type
+ */
+void parse_selected( const char* begin,
+                     const char* end,
+                     const object_filter& filter,
+                     std::vector< flat_object_set >& sets ) noexcept (false) {
+    const auto set = parse_set_type( begin, end );
+    const auto& type = dl::decay( set );
+    if (not filter.type( type.data(), std::int32_t( type.size() ) ))
+        return;
+
+    sets.push_back( parse_flat_objects( begin, end, filter ) );
+}
+
+}
+
+std::vector< flat_object_set > parse_flat_objects( const record_batch& batch,
+                                                   const object_filter& filter )
+noexcept (false) {
+    std::vector< flat_object_set > sets;
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        if (batch.isencrypted( i )) continue;
+        parse_selected( batch.begin( i ), batch.end( i ), filter, sets );
+    }
+    return sets;
+}
+
+std::vector< flat_object_set >
+parse_flat_objects( const std::vector< record >& recs,
+                    const object_filter& filter )
+noexcept (false) {
+    std::vector< flat_object_set > sets;
+    for (const auto& rec : recs) {
+        if (rec.isencrypted()) continue;
+        const auto* begin = rec.data.data();
+        parse_selected( begin, begin + rec.data.size(), filter, sets );
+    }
+    return sets;
+}
+
+object_filter::object_filter( std::vector< std::string > types,
+                              std::vector< std::string > names,
+                              const std::string& pattern ) noexcept (false)
+    : settypes( std::move( types ) )
+    , objnames( std::move( names ) )
+    , source( pattern )
+{
+    if (this->source.empty()) return;
+
+    try {
+        const auto flags = std::regex::ECMAScript | std::regex::icase;
+        this->regex = std::regex( this->source, flags );
+    } catch (const std::regex_error& e) {
+        const auto msg = "invalid regex '{}': {}";
+        throw std::invalid_argument( fmt::format( msg, pattern, e.what() ) );
+    }
+}
+
+namespace {
+
+bool contains( const std::vector< std::string >& xs,
+               const char* str,
+               std::int32_t len ) noexcept (true) {
+    for (const auto& x : xs) {
+        if (x.size() != std::size_t( len )) continue;
+        if (std::equal( x.begin(), x.end(), str )) return true;
+    }
+    return false;
+}
+
+}
+
+bool object_filter::type( const char* str, std::int32_t len ) const
+noexcept (true) {
+    if (this->settypes.empty()) return true;
+    return contains( this->settypes, str, len );
+}
+
+bool object_filter::name( const char* str, std::int32_t len ) const
+noexcept (false) {
+    if (this->any_name()) return true;
+    if (contains( this->objnames, str, len )) return true;
+    if (this->source.empty()) return false;
+
+    const auto flags = std::regex_constants::match_continuous;
+    return std::regex_search( str, str + len, this->regex, flags );
+}
+
+bool object_filter::any_name() const noexcept (true) {
+    return this->objnames.empty() and this->source.empty();
+}
+
+const std::vector< std::string >& object_filter::types() const
+noexcept (true) {
+    return this->settypes;
+}
+
+const std::vector< std::string >& object_filter::names() const
+noexcept (true) {
+    return this->objnames;
+}
+
+const std::string& object_filter::pattern() const noexcept (true) {
+    return this->source;
+}
+
 }
@@ -0,0 +1,193 @@
+#include <chrono>
+#include <cstddef>
+
+#include <dlisio/ext/stats.hpp>
+
+namespace dl {
+
+namespace {
+
+#if DLISIO_STATS
+thread_local stats* current = nullptr;
+thread_local stats_batch* batch = nullptr;
+#endif
+
+}
+
+const char* name( counter c ) noexcept (true) {
+    switch (c) {
+        case counter::bytes_indexed:    return "bytes_indexed";
+        case counter::records_indexed:  return "records_indexed";
+        case counter::records_read:     return "records_read";
+        case counter::segments_read:    return "segments_read";
+        case counter::records_stitched: return "records_stitched";
+        case counter::bytes_copied:     return "bytes_copied";
+        case counter::objects_parsed:   return "objects_parsed";
+        case counter::frames_decoded:   return "frames_decoded";
+        case counter::records_skipped:  return "records_skipped";
+        case counter::bytes_skipped:    return "bytes_skipped";
+    }
+    return "unknown";
+}
+
+const char* name( phase p ) noexcept (true) {
+    switch (p) {
+        case phase::findoffsets:   return "findoffsets";
+        case phase::extract:       return "extract";
+        case phase::parse_objects: return "parse_objects";
+        case phase::findfdata:     return "findfdata";
+        case phase::read_fdata:    return "read_fdata";
+    }
+    return "unknown";
+}
+
+stats::stats() noexcept (true) {
+    this->reset();
+}
+
+stats::stats( const stats& other ) noexcept (true) {
+    this->reset();
+    this->merge( other );
+}
+
+stats& stats::operator = ( const stats& other ) noexcept (true) {
+    if (this == &other) return *this;
+    this->reset();
+    this->merge( other );
+    return *this;
+}
+
+void stats::add( counter c, long long n ) noexcept (true) {
+    const auto i = static_cast< std::size_t >( c );
+    this->counters[ i ].fetch_add( n, std::memory_order_relaxed );
+}
+
+void stats::add( phase p, std::chrono::nanoseconds elapsed ) noexcept (true) {
+    const auto i = static_cast< std::size_t >( p );
+    this->nanoseconds[ i ].fetch_add( elapsed.count(),
+                                      std::memory_order_relaxed );
+    this->ncalls[ i ].fetch_add( 1, std::memory_order_relaxed );
+}
+
+void stats::merge( const stats& other ) noexcept (true) {
+    constexpr auto relaxed = std::memory_order_relaxed;
+    for (std::size_t i = 0; i < ncounters; ++i)
+        this->counters[ i ].fetch_add( other.counters[ i ].load( relaxed ),
+                                       relaxed );
+
+    for (std::size_t i = 0; i < nphases; ++i) {
+        this->nanoseconds[ i ].fetch_add( other.nanoseconds[ i ].load( relaxed ),
+                                          relaxed );
+        this->ncalls[ i ].fetch_add( other.ncalls[ i ].load( relaxed ),
+                                     relaxed );
+    }
+}
+
+void stats::reset() noexcept (true) {
+    for (auto& x : this->counters)    x.store( 0, std::memory_order_relaxed );
+    for (auto& x : this->nanoseconds) x.store( 0, std::memory_order_relaxed );
+    for (auto& x : this->ncalls)      x.store( 0, std::memory_order_relaxed );
+}
+
+long long stats::get( counter c ) const noexcept (true) {
+    const auto i = static_cast< std::size_t >( c );
+    return this->counters[ i ].load( std::memory_order_relaxed );
+}
+
+long long stats::calls( phase p ) const noexcept (true) {
+    const auto i = static_cast< std::size_t >( p );
+    return this->ncalls[ i ].load( std::memory_order_relaxed );
+}
+
+double stats::seconds( phase p ) const noexcept (true) {
+    const auto i = static_cast< std::size_t >( p );
+    const auto ns = this->nanoseconds[ i ].load( std::memory_order_relaxed );
+    return double(ns) * 1e-9;
+}
+
+stats* current_stats() noexcept (true) {
+#if DLISIO_STATS
+    return current;
+#else
+    return nullptr;
+#endif
+}
+
+stats_batch* current_batch() noexcept (true) {
+#if DLISIO_STATS
+    return batch;
+#else
+    return nullptr;
+#endif
+}
+
+#if DLISIO_STATS
+
+stats_batch::stats_batch( stats* t ) noexcept (true)
+    : into( t )
+    , previous( batch )
+{
+    this->counters.fill( 0 );
+    batch = this;
+}
+
+stats_batch::~stats_batch() noexcept (true) {
+    this->flush();
+    batch = this->previous;
+}
+
+void stats_batch::flush() noexcept (true) {
+    if (not this->into) return;
+
+    for (std::size_t i = 0; i < ncounters; ++i) {
+        if (this->counters[ i ] == 0) continue;
+        this->into->add( static_cast< counter >( i ), this->counters[ i ] );
+        this->counters[ i ] = 0;
+    }
+}
+
+stats_scope::stats_scope( stats* target ) noexcept (true)
+    : previous( current )
+{
+    current = target;
+}
+
+stats_scope::~stats_scope() noexcept (true) {
+    current = this->previous;
+}
+
+scoped_timer::scoped_timer( stats* t, phase x ) noexcept (true)
+    : target( t )
+    , p( x )
+{
+    if (this->target) this->start = std::chrono::steady_clock::now();
+}
+
+scoped_timer::scoped_timer( phase x ) noexcept (true)
+    : scoped_timer( current_stats(), x )
+{}
+
+scoped_timer::~scoped_timer() noexcept (true) {
+    if (not this->target) return;
+
+    const auto elapsed = std::chrono::steady_clock::now() - this->start;
+    using ns = std::chrono::nanoseconds;
+    this->target->add( this->p, std::chrono::duration_cast< ns >( elapsed ) );
+}
+
+#else
+
+stats_batch::stats_batch( stats* ) noexcept (true) {}
+stats_batch::~stats_batch() noexcept (true) {}
+void stats_batch::flush() noexcept (true) {}
+
+stats_scope::stats_scope( stats* ) noexcept (true) : previous( nullptr ) {}
+stats_scope::~stats_scope() noexcept (true) {}
+
+scoped_timer::scoped_timer( stats*, phase ) noexcept (true) {}
+scoped_timer::scoped_timer( phase ) noexcept (true) {}
+scoped_timer::~scoped_timer() noexcept (true) {}
+
+#endif
+
+}
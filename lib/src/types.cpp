@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 #include <cstdlib>
@@ -9,6 +10,30 @@
 
 #include <dlisio/types.h>
 
+/*
+ * The vectorised array conversions (dlis_isingl_n and friends) are AVX2 on
+ * x86, selected at runtime, so the library still runs on CPUs without it, and
+ * NEON on aarch64, which always has it. Without AVX2, the byte swaps fall back
+ * to SSE2, which is always there on x86-64. The kernels assume a
+ * little-endian host.
+ */
+#if !defined(HOST_BIG_ENDIAN)
+    #if (defined(__GNUC__) || defined(__clang__)) \
+        && (defined(__x86_64__) || defined(__i386__))
+        #define DLISIO_TYPES_AVX2
+        #include <immintrin.h>
+    #elif defined(__aarch64__)
+        #define DLISIO_TYPES_NEON
+        #include <arm_neon.h>
+    #endif
+
+    #if defined(__SSE2__) || defined(_M_X64) \
+        || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #define DLISIO_TYPES_SSE2
+        #include <emmintrin.h>
+    #endif
+#endif
+
 namespace {
 
 /*
@@ -406,6 +431,417 @@ const char* dlis_units( const char* xs, std::int32_t* len, char* out ) {
     return xs + ln;
 }
 
+namespace {
+
+/*
+ * Array conversion kernels
+ *
+ * Every kernel converts as many values as it can in whole vectors, and returns
+ * how many it did. The rest is converted with the scalar functions, which are
+ * also the reference - the kernels must give bit-identical results.
+ */
+enum class kernel { swap16, swap32, swap64, isingl, vsingl };
+
+#if defined(DLISIO_TYPES_SSE2)
+
+/*
+ * SSE2 has no byte shuffle, so reverse the bytes by swapping the halves of
+ * every word, recursively
+ */
+__m128i swap_lanes( __m128i v, std::uint16_t ) noexcept (true) {
+    return _mm_or_si128( _mm_slli_epi16( v, 8 ), _mm_srli_epi16( v, 8 ) );
+}
+
+__m128i swap_lanes( __m128i v, std::uint32_t ) noexcept (true) {
+    v = _mm_shufflelo_epi16( v, _MM_SHUFFLE( 2, 3, 0, 1 ) );
+    v = _mm_shufflehi_epi16( v, _MM_SHUFFLE( 2, 3, 0, 1 ) );
+    return swap_lanes( v, std::uint16_t() );
+}
+
+__m128i swap_lanes( __m128i v, std::uint64_t ) noexcept (true) {
+    v = _mm_shuffle_epi32( v, _MM_SHUFFLE( 2, 3, 0, 1 ) );
+    return swap_lanes( v, std::uint32_t() );
+}
+
+template < typename T >
+int swap_sse2( const char* src, int n, char* dst ) noexcept (true) {
+    constexpr int lanes = sizeof( __m128i ) / sizeof( T );
+    int i = 0;
+    for (; i + lanes <= n; i += lanes) {
+        const auto offset = i * sizeof( T );
+        const auto* in = reinterpret_cast< const __m128i* >( src + offset );
+        auto* out = reinterpret_cast< __m128i* >( dst + offset );
+        _mm_storeu_si128( out, swap_lanes( _mm_loadu_si128( in ), T() ) );
+    }
+    return i;
+}
+
+int vectorised_sse2( kernel k, const char* src, int n, char* dst )
+noexcept (true) {
+    switch (k) {
+        case kernel::swap16: return swap_sse2< std::uint16_t >( src, n, dst );
+        case kernel::swap32: return swap_sse2< std::uint32_t >( src, n, dst );
+        case kernel::swap64: return swap_sse2< std::uint64_t >( src, n, dst );
+        default:             return 0;
+    }
+}
+
+#elif !defined(DLISIO_TYPES_NEON)
+
+int vectorised_sse2( kernel, const char*, int, char* ) noexcept (true) {
+    return 0;
+}
+
+#endif
+
+#if defined(DLISIO_TYPES_AVX2)
+
+#define DLISIO_AVX2 __attribute__((target("avx2")))
+
+bool has_avx2() noexcept (true) {
+    static const bool avx2 = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports( "avx2" ) != 0;
+    }();
+    return avx2;
+}
+
+/*
+ * Shuffle mask that reverses every size-byte word in a 128-bit lane, the
+ * granularity of _mm256_shuffle_epi8
+ */
+DLISIO_AVX2
+__m256i swap_mask( int size ) noexcept (true) {
+    alignas( 32 ) std::uint8_t mask[ 32 ];
+    for (int i = 0; i < 32; ++i) {
+        const auto lane = i % 16;
+        mask[ i ] = std::uint8_t( lane / size * size + size - 1 - lane % size );
+    }
+    return _mm256_load_si256( reinterpret_cast< const __m256i* >( mask ) );
+}
+
+DLISIO_AVX2
+__m256i load( const char* src ) noexcept (true) {
+    return _mm256_loadu_si256( reinterpret_cast< const __m256i* >( src ) );
+}
+
+DLISIO_AVX2
+void store( char* dst, __m256i x ) noexcept (true) {
+    _mm256_storeu_si256( reinterpret_cast< __m256i* >( dst ), x );
+}
+
+DLISIO_AVX2
+int swap_avx2( const char* src, int n, char* dst, int size ) noexcept (true) {
+    const auto mask = swap_mask( size );
+    const int lanes = 32 / size;
+    int i = 0;
+    for (; i + lanes <= n; i += lanes) {
+        const auto offset = i * size;
+        store( dst + offset, _mm256_shuffle_epi8( load( src + offset ), mask ) );
+    }
+    return i;
+}
+
+/*
+ * dlis_isingl, but 8 values at a time. The table lookups it[ix] and mt[ix]
+ * are a shift of 0-3, where it[ix] = 0x20c00000 + (shift << 22) and
+ * mt[ix] = 1 << shift.
+ */
+DLISIO_AVX2
+int isingl_avx2( const char* src, int n, char* dst ) noexcept (true) {
+    const auto mask   = swap_mask( 4 );
+    const auto shifts = _mm256_setr_epi32( 3, 2, 1, 1, 0, 0, 0, 0 );
+
+    const auto mantissa = _mm256_set1_epi32( 0x00FFFFFF );
+    const auto exponent = _mm256_set1_epi32( 0x7F000000 );
+    const auto itbase   = _mm256_set1_epi32( 0x20C00000 );
+    const auto absmask  = _mm256_set1_epi32( 0x7FFFFFFF );
+    const auto signmask = _mm256_set1_epi32( int( 0x80000000 ) );
+    const auto iemaxib  = _mm256_set1_epi32( 0x611FFFFF );
+    const auto ieminib  = _mm256_set1_epi32( 0x21200000 );
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const auto u = _mm256_shuffle_epi8( load( src + i * 4 ), mask );
+
+        auto manthi = _mm256_and_si256( u, mantissa );
+        const auto ix = _mm256_srli_epi32( manthi, 21 );
+        const auto shift = _mm256_permutevar8x32_epi32( shifts, ix );
+        const auto it = _mm256_add_epi32( itbase,
+                                          _mm256_slli_epi32( shift, 22 ) );
+
+        auto iexp = _mm256_and_si256( u, exponent );
+        iexp = _mm256_slli_epi32( _mm256_sub_epi32( iexp, it ), 1 );
+        manthi = _mm256_add_epi32( _mm256_sllv_epi32( manthi, shift ), iexp );
+
+        /* both operands are non-negative, so signed compare is fine */
+        const auto inabs = _mm256_and_si256( u, absmask );
+        const auto over  = _mm256_cmpgt_epi32( inabs, iemaxib );
+        const auto under = _mm256_cmpgt_epi32( ieminib, inabs );
+
+        manthi = _mm256_blendv_epi8( manthi, absmask, over );
+        manthi = _mm256_or_si256( manthi, _mm256_and_si256( u, signmask ) );
+        store( dst + i * 4, _mm256_andnot_si256( under, manthi ) );
+    }
+    return i;
+}
+
+/*
+ * dlis_vsingl, but 8 values at a time. The scalar function computes
+ * (0.5 + frac / 2^23) * 2^(exp - 128) exactly, and rounds once when storing
+ * it as a float. The sum is exact in float, the scale is a power of two (2^-127
+ * is subnormal), and a float multiply rounds the exact product once, the
+ * same way.
+ */
+DLISIO_AVX2
+int vsingl_avx2( const char* src, int n, char* dst ) noexcept (true) {
+    /* the words are two little-endian 16-bit halves, high half first */
+    const auto mask = _mm256_setr_epi8(
+        2, 3, 0, 1,  6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+        2, 3, 0, 1,  6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13
+    );
+
+    const float nan = std::nanf( "" );
+    std::int32_t nanbits;
+    std::memcpy( &nanbits, &nan, sizeof( nan ) );
+
+    const auto fracmask = _mm256_set1_epi32( 0x007FFFFF );
+    const auto expmask  = _mm256_set1_epi32( 0xFF );
+    const auto signmask = _mm256_set1_epi32( int( 0x80000000 ) );
+    const auto one      = _mm256_set1_epi32( 1 );
+    const auto tiny     = _mm256_set1_epi32( 0x00400000 );
+    const auto zero     = _mm256_setzero_si256();
+    const auto nans     = _mm256_set1_epi32( nanbits );
+    const auto half     = _mm256_set1_ps( 0.5f );
+    const auto ulp      = _mm256_set1_ps( 1.0f / 8388608.0f );
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const auto v = _mm256_shuffle_epi8( load( src + i * 4 ), mask );
+
+        const auto frac = _mm256_and_si256( v, fracmask );
+        const auto exp  = _mm256_and_si256( _mm256_srli_epi32( v, 23 ),
+                                            expmask );
+        const auto sign = _mm256_and_si256( v, signmask );
+
+        auto sum = _mm256_mul_ps( _mm256_cvtepi32_ps( frac ), ulp );
+        sum = _mm256_add_ps( half, sum );
+        sum = _mm256_xor_ps( sum, _mm256_castsi256_ps( sign ) );
+
+        /* 2^(exp - 128) */
+        auto scale = _mm256_slli_epi32( _mm256_sub_epi32( exp, one ), 23 );
+        scale = _mm256_blendv_epi8( scale, tiny, _mm256_cmpeq_epi32( exp, one ) );
+
+        auto x = _mm256_castps_si256(
+            _mm256_mul_ps( sum, _mm256_castsi256_ps( scale ) )
+        );
+
+        /* zero exponent is 0, or nan if the sign bit is set */
+        const auto special = _mm256_and_si256( _mm256_srai_epi32( v, 31 ),
+                                               nans );
+        x = _mm256_blendv_epi8( x, special, _mm256_cmpeq_epi32( exp, zero ) );
+        store( dst + i * 4, x );
+    }
+    return i;
+}
+
+#undef DLISIO_AVX2
+
+int vectorised( kernel k, const char* src, int n, char* dst ) noexcept (true) {
+    if (!has_avx2()) return vectorised_sse2( k, src, n, dst );
+
+    switch (k) {
+        case kernel::swap16: return swap_avx2( src, n, dst, 2 );
+        case kernel::swap32: return swap_avx2( src, n, dst, 4 );
+        case kernel::swap64: return swap_avx2( src, n, dst, 8 );
+        case kernel::isingl: return isingl_avx2( src, n, dst );
+        case kernel::vsingl: return vsingl_avx2( src, n, dst );
+    }
+    return 0;
+}
+
+#elif defined(DLISIO_TYPES_NEON)
+
+const std::uint8_t* bytes( const char* src ) noexcept (true) {
+    return reinterpret_cast< const std::uint8_t* >( src );
+}
+
+template < int size >
+int swap_neon( const char* src, int n, char* dst ) noexcept (true) {
+    constexpr int lanes = 16 / size;
+    int i = 0;
+    for (; i + lanes <= n; i += lanes) {
+        const auto x = vld1q_u8( bytes( src + i * size ) );
+        auto* out = reinterpret_cast< std::uint8_t* >( dst + i * size );
+        switch (size) {
+            case 2:  vst1q_u8( out, vrev16q_u8( x ) ); break;
+            case 4:  vst1q_u8( out, vrev32q_u8( x ) ); break;
+            default: vst1q_u8( out, vrev64q_u8( x ) ); break;
+        }
+    }
+    return i;
+}
+
+/*
+ * See isingl_avx2. The shift is the number of leading zeros of the 3-bit ix,
+ * capped at 3, which NEON can compute directly.
+ */
+int isingl_neon( const char* src, int n, char* dst ) noexcept (true) {
+    const auto three    = vdupq_n_u32( 3 );
+    const auto mantissa = vdupq_n_u32( 0x00FFFFFF );
+    const auto exponent = vdupq_n_u32( 0x7F000000 );
+    const auto itbase   = vdupq_n_u32( 0x20C00000 );
+    const auto absmask  = vdupq_n_u32( 0x7FFFFFFF );
+    const auto signmask = vdupq_n_u32( 0x80000000 );
+    const auto iemaxib  = vdupq_n_u32( 0x611FFFFF );
+    const auto ieminib  = vdupq_n_u32( 0x21200000 );
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const auto u = vreinterpretq_u32_u8(
+            vrev32q_u8( vld1q_u8( bytes( src + i * 4 ) ) )
+        );
+
+        auto manthi = vandq_u32( u, mantissa );
+        const auto ix = vshrq_n_u32( manthi, 21 );
+        const auto shift = vminq_u32( vsubq_u32( vclzq_u32( ix ),
+                                                 vdupq_n_u32( 29 ) ),
+                                      three );
+        const auto it = vaddq_u32( itbase, vshlq_n_u32( shift, 22 ) );
+
+        auto iexp = vandq_u32( u, exponent );
+        iexp = vshlq_n_u32( vsubq_u32( iexp, it ), 1 );
+        manthi = vshlq_u32( manthi, vreinterpretq_s32_u32( shift ) );
+        manthi = vaddq_u32( manthi, iexp );
+
+        const auto inabs = vandq_u32( u, absmask );
+        manthi = vbslq_u32( vcgtq_u32( inabs, iemaxib ), absmask, manthi );
+        manthi = vorrq_u32( manthi, vandq_u32( u, signmask ) );
+        manthi = vbicq_u32( manthi, vcltq_u32( inabs, ieminib ) );
+
+        vst1q_u8( reinterpret_cast< std::uint8_t* >( dst + i * 4 ),
+                  vreinterpretq_u8_u32( manthi ) );
+    }
+    return i;
+}
+
+/* See vsingl_avx2 */
+int vsingl_neon( const char* src, int n, char* dst ) noexcept (true) {
+    const float nan = std::nanf( "" );
+    std::uint32_t nanbits;
+    std::memcpy( &nanbits, &nan, sizeof( nan ) );
+
+    const auto fracmask = vdupq_n_u32( 0x007FFFFF );
+    const auto signmask = vdupq_n_u32( 0x80000000 );
+    const auto one      = vdupq_n_u32( 1 );
+    const auto tiny     = vdupq_n_u32( 0x00400000 );
+    const auto nans     = vdupq_n_u32( nanbits );
+    const auto half     = vdupq_n_f32( 0.5f );
+    const auto ulp      = vdupq_n_f32( 1.0f / 8388608.0f );
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        /* swap the 16-bit halves of every word */
+        const auto v = vreinterpretq_u32_u16( vrev32q_u16(
+            vreinterpretq_u16_u8( vld1q_u8( bytes( src + i * 4 ) ) )
+        ));
+
+        const auto frac = vandq_u32( v, fracmask );
+        const auto exp  = vshrq_n_u32( vshlq_n_u32( v, 1 ), 24 );
+        const auto sign = vandq_u32( v, signmask );
+
+        auto sum = vmulq_f32( vcvtq_f32_u32( frac ), ulp );
+        sum = vaddq_f32( half, sum );
+        const auto signed_sum = veorq_u32( vreinterpretq_u32_f32( sum ), sign );
+
+        auto scale = vshlq_n_u32( vsubq_u32( exp, one ), 23 );
+        scale = vbslq_u32( vceqq_u32( exp, one ), tiny, scale );
+
+        auto x = vreinterpretq_u32_f32( vmulq_f32(
+            vreinterpretq_f32_u32( signed_sum ),
+            vreinterpretq_f32_u32( scale )
+        ));
+
+        const auto special = vandq_u32( vtstq_u32( v, signmask ), nans );
+        x = vbslq_u32( vceqzq_u32( exp ), special, x );
+
+        vst1q_u8( reinterpret_cast< std::uint8_t* >( dst + i * 4 ),
+                  vreinterpretq_u8_u32( x ) );
+    }
+    return i;
+}
+
+int vectorised( kernel k, const char* src, int n, char* dst ) noexcept (true) {
+    switch (k) {
+        case kernel::swap16: return swap_neon< 2 >( src, n, dst );
+        case kernel::swap32: return swap_neon< 4 >( src, n, dst );
+        case kernel::swap64: return swap_neon< 8 >( src, n, dst );
+        case kernel::isingl: return isingl_neon( src, n, dst );
+        case kernel::vsingl: return vsingl_neon( src, n, dst );
+    }
+    return 0;
+}
+
+#else
+
+int vectorised( kernel k, const char* src, int n, char* dst ) noexcept (true) {
+    return vectorised_sse2( k, src, n, dst );
+}
+
+#endif
+
+/*
+ * Convert n values with the vectorised kernel k, and the rest with the scalar
+ * function f
+ */
+template < typename T >
+const char* convert_n( kernel k,
+                       const char* xs,
+                       int n,
+                       void* out,
+                       const char* f( const char*, T* ) ) noexcept (true) {
+    if (!out || n <= 0) return xs + std::max( n, 0 ) * int(sizeof( T ));
+
+    auto* dst = static_cast< char* >( out );
+    const auto done = vectorised( k, xs, n, dst );
+    xs  += done * sizeof( T );
+    dst += done * sizeof( T );
+
+    for (int i = done; i < n; ++i) {
+        T x;
+        xs = f( xs, &x );
+        std::memcpy( dst, &x, sizeof( T ) );
+        dst += sizeof( T );
+    }
+    return xs;
+}
+
+}
+
+const char* dlis_snorm_n( const char* xs, int n, void* out ) {
+    return convert_n< std::int16_t >( kernel::swap16, xs, n, out, dlis_snorm );
+}
+
+const char* dlis_slong_n( const char* xs, int n, void* out ) {
+    return convert_n< std::int32_t >( kernel::swap32, xs, n, out, dlis_slong );
+}
+
+const char* dlis_fsingl_n( const char* xs, int n, void* out ) {
+    return convert_n< float >( kernel::swap32, xs, n, out, dlis_fsingl );
+}
+
+const char* dlis_fdoubl_n( const char* xs, int n, void* out ) {
+    return convert_n< double >( kernel::swap64, xs, n, out, dlis_fdoubl );
+}
+
+const char* dlis_isingl_n( const char* xs, int n, void* out ) {
+    return convert_n< float >( kernel::isingl, xs, n, out, dlis_isingl );
+}
+
+const char* dlis_vsingl_n( const char* xs, int n, void* out ) {
+    return convert_n< float >( kernel::vsingl, xs, n, out, dlis_vsingl );
+}
+
 /*
  * output functions
  */
@@ -545,7 +981,7 @@ void* dlis_uvario( void* xs, std::int32_t x, int width ) {
         return (char*)xs + sizeof( v );
     }
 
-    if( x <= 0xBFFF && width <= 2 ) {
+    if( x <= 0x3FFF && width <= 2 ) {
         std::uint16_t v = x;
         v |= 0x8000;
         v = hton( v );
@@ -0,0 +1,81 @@
+#ifndef DLISIO_TEST_FILES_HPP
+#define DLISIO_TEST_FILES_HPP
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <mio/mio.hpp>
+
+#include <dlisio/ext/io.hpp>
+
+#include "../bench/synthetic.hpp"
+
+namespace test {
+
+/*
+ * A file in the working directory, which is removed when it goes out of scope
+ */
+struct scratch_file {
+    scratch_file() {
+        static int count = 0;
+        this->path = "dlisio-test-" + std::to_string( count++ ) + ".dlis";
+    }
+
+    scratch_file( const scratch_file& ) = delete;
+    scratch_file& operator = ( const scratch_file& ) = delete;
+    ~scratch_file() { std::remove( this->path.c_str() ); }
+
+    void write( const std::vector< char >& bytes ) const {
+        std::ofstream out( this->path, std::ios::binary | std::ios::trunc );
+        out.write( bytes.data(), bytes.size() );
+        if (not out) throw std::runtime_error( "unable to write " + path );
+    }
+
+    std::string path;
+};
+
+/*
+ * The offsets of the records in a file, indexed like dlisio.load does, from
+ * the visible record at from, or the first one after the storage unit label
+ * if from is negative
+ */
+inline dl::stream_offsets index( const std::string& path, long long from = -1 ) {
+    mio::mmap_source file;
+    dl::map_source( file, path );
+    if (from < 0) from = dl::findvrl( file, dl::findsul( file ) + 80 );
+    return dl::findoffsets( file, from );
+}
+
+/*
+ * A synthetic file (see dl::bench::synthetic), written and indexed
+ */
+struct synthetic_file {
+    explicit synthetic_file( const dl::bench::synthetic& opts ) :
+        fmt( dl::bench::synthetic_fmt( opts ) )
+    {
+        dl::bench::write_synthetic( this->file.path, opts );
+        this->offsets = index( this->file.path );
+        const auto& explicits = this->offsets.explicits;
+        for (int i = 0; i < int(explicits.size()); ++i)
+            if (explicits[ i ] == 0) this->fdata.push_back( i );
+    }
+
+    const std::string& path() const { return this->file.path; }
+
+    void reindex( dl::stream& s ) const {
+        s.reindex( this->offsets.tells, this->offsets.residuals );
+    }
+
+    scratch_file file;
+    std::string fmt;
+    dl::stream_offsets offsets;
+    /* indices of the FDATA records */
+    std::vector< int > fdata;
+};
+
+}
+
+#endif // DLISIO_TEST_FILES_HPP
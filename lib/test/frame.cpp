@@ -0,0 +1,421 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include <dlisio/dlisio.h>
+#include <dlisio/types.h>
+
+#include <dlisio/ext/frame.hpp>
+#include <dlisio/ext/io.hpp>
+
+#include "files.hpp"
+
+namespace {
+
+std::vector< char > random_bytes( std::size_t size ) {
+    std::vector< char > src;
+    std::uint32_t x = 2463534242;
+    while (src.size() < size) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        src.push_back( char(x) );
+    }
+    return src;
+}
+
+/*
+ * Unpack a single row of fmt from src with both dlis_packf and unpack_row, and
+ * check that the bytes written, and read, are the same
+ */
+void check_unpack( const std::string& fmt, const std::vector< char >& src ) {
+    INFO( "fmt: " << fmt );
+
+    int nread, nwrite;
+    REQUIRE( dlis_packflen( fmt.c_str(), src.data(), &nread, &nwrite )
+             == DLIS_OK );
+    REQUIRE( std::size_t(nread) <= src.size() );
+
+    std::vector< char > expected( nwrite );
+    REQUIRE( dlis_packf( fmt.c_str(), src.data(), expected.data() )
+             == DLIS_OK );
+
+    const auto layout = dl::compile_layout( fmt.c_str() );
+    CHECK( layout.dst_size == nwrite );
+
+    /* write at an odd offset, to check that dst needs no alignment */
+    std::vector< char > out( nwrite + 1 );
+    const auto* end = src.data() + nread;
+    const auto* next = dl::unpack_row( layout,
+                                       src.data(),
+                                       end,
+                                       out.data() + 1 );
+    CHECK( next == end );
+    CHECK( std::memcmp( out.data() + 1, expected.data(), nwrite ) == 0 );
+}
+
+/*
+ * A visible record with a single FDATA record of body. Segments are at least
+ * 16 bytes, so short bodies are padded, which is how an FDATA with less than
+ * a frame header can come about in the first place.
+ */
+std::vector< char > fdata_file( const std::vector< char >& body ) {
+    const auto pad = (std::max)( 0, 12 - int(body.size()) );
+    const auto segment = 4 + int(body.size()) + pad;
+    const auto visible = 4 + segment;
+    std::vector< char > bytes( 8 + body.size() );
+    bytes[ 0 ] = char(visible >> 8);
+    bytes[ 1 ] = char(visible & 0xFF);
+    bytes[ 2 ] = '\xFF';
+    bytes[ 3 ] = '\x01';
+    bytes[ 4 ] = char(segment >> 8);
+    bytes[ 5 ] = char(segment & 0xFF);
+    bytes[ 6 ] = char(pad ? 0x01 : 0x00);
+    bytes[ 7 ] = 0;
+    for (std::size_t i = 0; i < body.size(); ++i)
+        bytes[ 8 + i ] = body[ i ];
+    bytes.resize( bytes.size() + pad, char(pad) );
+    return bytes;
+}
+
+/*
+ * Read all the rows of reader, n at a time, with read() or prefetch()
+ */
+std::vector< char > read_all( dl::frame_reader& reader, int n, bool prefetch ) {
+    std::vector< char > rows( reader.size() * reader.row_size() );
+    auto* dst = rows.data();
+    while (true) {
+        int read;
+        if (prefetch) {
+            reader.prefetch( dst, n );
+            CHECK( reader.pending() );
+            read = reader.wait();
+        } else {
+            read = reader.read( dst, n );
+        }
+
+        if (read == 0) break;
+        dst += read * reader.row_size();
+    }
+    CHECK( dst == rows.data() + rows.size() );
+    return rows;
+}
+
+}
+
+TEST_CASE( "compile_layout merges runs of the same code", "[frame]" ) {
+    const auto layout = dl::compile_layout( "fffFlf" );
+
+    REQUIRE( layout.runs.size() == 4 );
+    CHECK( layout.runs[ 0 ].fmt == DLIS_FMT_FSINGL );
+    CHECK( layout.runs[ 0 ].count == 3 );
+    CHECK( layout.runs[ 0 ].src_size == 4 );
+    CHECK( layout.runs[ 0 ].dst_size == 4 );
+    CHECK( layout.runs[ 1 ].fmt == DLIS_FMT_FDOUBL );
+    CHECK( layout.runs[ 1 ].count == 1 );
+    CHECK( layout.runs[ 2 ].fmt == DLIS_FMT_SLONG );
+    CHECK( layout.runs[ 3 ].fmt == DLIS_FMT_FSINGL );
+    CHECK( layout.runs[ 3 ].count == 1 );
+
+    CHECK( layout.src_size == 3 * 4 + 8 + 4 + 4 );
+    CHECK( layout.dst_size == 3 * 4 + 8 + 4 + 4 );
+    CHECK( layout.numeric );
+    CHECK( not layout.interned );
+}
+
+TEST_CASE( "compile_layout of variable-sized values", "[frame]" ) {
+    const auto layout = dl::compile_layout( "fsf" );
+
+    REQUIRE( layout.runs.size() == 3 );
+    CHECK( layout.runs[ 1 ].src_size == 0 );
+    CHECK( layout.runs[ 1 ].dst_size == 0 );
+    CHECK( layout.src_size == 0 );
+    CHECK( layout.dst_size == 0 );
+    CHECK( not layout.numeric );
+}
+
+TEST_CASE( "compile_layout of native validated floats and names", "[frame]" ) {
+    SECTION( "not native" ) {
+        const auto layout = dl::compile_layout( "bo" );
+        CHECK( not layout.numeric );
+        CHECK( not layout.interned );
+    }
+
+    SECTION( "native" ) {
+        const auto layout = dl::compile_layout( "bo", true );
+        REQUIRE( layout.runs.size() == 2 );
+        CHECK( layout.runs[ 0 ].dst_size == 8 );
+        CHECK( layout.runs[ 1 ].dst_size == 4 );
+        CHECK( layout.numeric );
+        CHECK( layout.interned );
+        /* obnames are variable-sized on disk */
+        CHECK( layout.src_size == 0 );
+    }
+}
+
+TEST_CASE( "compile_layout rejects invalid format specifiers", "[frame]" ) {
+    CHECK_THROWS_AS( dl::compile_layout( "ff?" ), std::invalid_argument );
+}
+
+TEST_CASE( "unpack_row is identical to packf", "[frame]" ) {
+    const auto src = random_bytes( 4096 );
+
+    /*
+     * Runs of every length up to a few vectors, so that all the bulk
+     * conversions are checked both with and without a scalar tail
+     */
+    SECTION( "runs of one representation code" ) {
+        for (const char f : std::string( "rfbBxVFzZcCdDluUL" )) {
+            for (int n = 1; n <= 40; ++n)
+                check_unpack( std::string( n, f ), src );
+        }
+    }
+
+    SECTION( "mixed runs" ) {
+        check_unpack( "fffffDDDlllllllllFFFuuuuuL", src );
+        check_unpack( "ffffffffffffffffffffffffffffffffF", src );
+        check_unpack( "xxxxxxxxxfVVVVVVVVVVVVVVVVVVVVVl", src );
+    }
+
+    SECTION( "uvari" ) {
+        std::vector< char > uvaris( 64 );
+        auto* ptr = uvaris.data();
+        ptr = static_cast< char* >( dlis_uvario( ptr, 1, 1 ) );
+        ptr = static_cast< char* >( dlis_uvario( ptr, 200, 2 ) );
+        ptr = static_cast< char* >( dlis_uvario( ptr, 70000, 4 ) );
+        ptr = static_cast< char* >( dlis_fsinglo( ptr, 1.5f ) );
+        dlis_uvario( ptr, 3, 1 );
+        check_unpack( "iiifi", uvaris );
+    }
+}
+
+TEST_CASE( "unpack_row throws on rows past the end", "[frame]" ) {
+    const auto src = random_bytes( 64 );
+    const auto layout = dl::compile_layout( "ffff" );
+    std::vector< char > out( layout.dst_size );
+
+    CHECK_THROWS_AS(
+        dl::unpack_row( layout, src.data(), src.data() + 15, out.data() ),
+        std::runtime_error
+    );
+
+    const auto uvari = dl::compile_layout( "i" );
+    const char twobytes[] = { '\x80', '\x10' };
+    CHECK_THROWS_AS(
+        dl::unpack_row( uvari, twobytes, twobytes + 1, out.data() ),
+        std::runtime_error
+    );
+}
+
+TEST_CASE( "project_row reads only the selected channels", "[frame]" ) {
+    /* f s ff l F, where s is the ident "abc" */
+    std::vector< char > row( 64 );
+    auto* ptr = row.data();
+    ptr = static_cast< char* >( dlis_fsinglo( ptr, 1.0f ) );
+    ptr = static_cast< char* >( dlis_idento( ptr, 3, "abc" ) );
+    ptr = static_cast< char* >( dlis_fsinglo( ptr, 2.0f ) );
+    ptr = static_cast< char* >( dlis_fsinglo( ptr, 3.0f ) );
+    ptr = static_cast< char* >( dlis_slongo( ptr, -4 ) );
+    ptr = static_cast< char* >( dlis_fdoublo( ptr, 5.0 ) );
+    const auto* end = ptr;
+
+    const std::vector< std::string > channels = { "f", "s", "ff", "l", "F" };
+
+    SECTION( "columns after a variable-sized channel" ) {
+        const auto projection = dl::compile_projection( channels, { 2, 4 } );
+        REQUIRE( projection.columns.size() == 2 );
+        CHECK( projection.numeric );
+        CHECK( projection.dst_size == 2 * 4 + 8 );
+
+        /* the ident must be scanned, the slong is just 4 bytes */
+        CHECK( projection.columns[ 0 ].before.size == -1 );
+        CHECK( projection.columns[ 1 ].before.size == 4 );
+        CHECK( projection.after.size == 0 );
+
+        std::vector< char > out( projection.dst_size );
+        const auto* next = dl::project_row( projection,
+                                            row.data(),
+                                            end,
+                                            out.data() );
+        CHECK( next == end );
+
+        float f[ 2 ];
+        double d;
+        std::memcpy( f, out.data(), sizeof( f ) );
+        std::memcpy( &d, out.data() + sizeof( f ), sizeof( d ) );
+        CHECK( f[ 0 ] == 2.0f );
+        CHECK( f[ 1 ] == 3.0f );
+        CHECK( d == 5.0 );
+    }
+
+    SECTION( "the skipped channels after the last column" ) {
+        const auto projection = dl::compile_projection( channels, { 0 } );
+        CHECK( projection.after.size == -1 );
+
+        float f;
+        const auto* next = dl::project_row( projection,
+                                            row.data(),
+                                            end,
+                                            reinterpret_cast< char* >( &f ) );
+        CHECK( next == end );
+        CHECK( f == 1.0f );
+    }
+
+    SECTION( "pre, fmt and post" ) {
+        const auto projection = dl::compile_projection( "fs", "ff", "lF" );
+        std::vector< char > out( projection.dst_size );
+        CHECK( dl::project_row( projection, row.data(), end, out.data() )
+               == end );
+
+        float f[ 2 ];
+        std::memcpy( f, out.data(), sizeof( f ) );
+        CHECK( f[ 0 ] == 2.0f );
+        CHECK( f[ 1 ] == 3.0f );
+    }
+
+    SECTION( "truncated row" ) {
+        const auto projection = dl::compile_projection( channels, { 4 } );
+        std::vector< char > out( projection.dst_size );
+        CHECK_THROWS_AS(
+            dl::project_row( projection, row.data(), end - 1, out.data() ),
+            std::runtime_error
+        );
+    }
+
+    SECTION( "out-of-order selection" ) {
+        CHECK_THROWS_AS( dl::compile_projection( channels, { 2, 1 } ),
+                         std::invalid_argument );
+        CHECK_THROWS_AS( dl::compile_projection( channels, { 5 } ),
+                         std::invalid_argument );
+    }
+}
+
+TEST_CASE( "frame_reader prefetch is the same as read", "[frame]" ) {
+    dl::bench::synthetic opts;
+    opts.size = 512 * 1024;
+    opts.channels = 5;
+    opts.reprc = "fFl";
+    const test::synthetic_file file( opts );
+    REQUIRE( file.fdata.size() > 100 );
+
+    for (const bool mapped : { false, true }) {
+        INFO( "mapped: " << mapped );
+        dl::stream stream( file.path(), mapped );
+        file.reindex( stream );
+
+        dl::frame_reader plain( stream, file.fdata, "", file.fmt, "" );
+        const auto expected = read_all( plain, 37, false );
+
+        /* all blocks go through the same reader, and the same worker */
+        dl::frame_reader fetched( stream, file.fdata, "", file.fmt, "" );
+        CHECK( read_all( fetched, 37, true ) == expected );
+
+        fetched.seek( 0 );
+        CHECK( read_all( fetched, 1000, true ) == expected );
+    }
+}
+
+TEST_CASE( "frame_reader prefetch re-throws in wait", "[frame]" ) {
+    test::scratch_file file;
+    file.write( fdata_file( {} ) );
+    const auto offsets = test::index( file.path, 0 );
+
+    dl::stream stream( file.path, true );
+    stream.reindex( offsets.tells, offsets.residuals );
+
+    dl::frame_reader reader( stream, { 0 }, "", "f", "" );
+    std::vector< char > row( reader.row_size() );
+    reader.prefetch( row.data(), 1 );
+    CHECK_THROWS_WITH( reader.wait(), Catch::Contains( "frame header" ) );
+    CHECK( not reader.pending() );
+}
+
+TEST_CASE( "frame_reader checks the frame header", "[frame]" ) {
+    /* origin 1, copy 0, ident "A", and then a frame number */
+    const std::vector< char > obname = { '\x01', '\x00', '\x01', 'A' };
+
+    SECTION( "empty record body" ) {
+        test::scratch_file file;
+        file.write( fdata_file( {} ) );
+        const auto offsets = test::index( file.path, 0 );
+        dl::stream stream( file.path, true );
+        stream.reindex( offsets.tells, offsets.residuals );
+
+        dl::frame_reader reader( stream, { 0 }, "", "f", "" );
+        std::vector< char > row( reader.row_size() );
+        CHECK_THROWS_WITH( reader.read( row.data(), 1 ),
+                           Catch::Contains( "frame header" ) );
+    }
+
+    SECTION( "no frame number" ) {
+        test::scratch_file file;
+        file.write( fdata_file( obname ) );
+        const auto offsets = test::index( file.path, 0 );
+        dl::stream stream( file.path, true );
+        stream.reindex( offsets.tells, offsets.residuals );
+
+        dl::frame_reader reader( stream, { 0 }, "", "f", "" );
+        std::vector< char > row( reader.row_size() );
+        CHECK_THROWS_WITH( reader.read( row.data(), 1 ),
+                           Catch::Contains( "frame header" ) );
+    }
+}
+
+TEST_CASE( "readers continue in records with several frames", "[frame]" ) {
+    /* origin 1, copy 0, ident "A", and three frames of a single slong */
+    const std::vector< char > body = {
+        '\x01', '\x00', '\x01', 'A',
+        '\x01', '\x00', '\x00', '\x00', '\x0A',
+        '\x02', '\x00', '\x00', '\x00', '\x0B',
+        '\x03', '\x00', '\x00', '\x00', '\x0C',
+    };
+
+    test::scratch_file file;
+    file.write( fdata_file( body ) );
+    const auto offsets = test::index( file.path, 0 );
+
+    for (const bool mapped : { false, true }) {
+        INFO( "mapped: " << mapped );
+        dl::stream stream( file.path, mapped );
+        stream.reindex( offsets.tells, offsets.residuals );
+
+        {
+            dl::frame_reader reader( stream, { 0 }, "", "l", "" );
+            std::int32_t rows[ 3 ] = {};
+            CHECK( reader.read( reinterpret_cast< char* >( rows ), 2 ) == 2 );
+            CHECK( reader.tell() == 0 );
+            CHECK( reader.read( reinterpret_cast< char* >( rows + 2 ), 2 )
+                   == 1 );
+            CHECK( reader.tell() == 1 );
+            CHECK( reader.read( reinterpret_cast< char* >( rows ), 2 ) == 0 );
+            CHECK( rows[ 0 ] == 10 );
+            CHECK( rows[ 1 ] == 11 );
+            CHECK( rows[ 2 ] == 12 );
+
+            reader.seek( 0 );
+            std::int32_t again[ 3 ] = {};
+            CHECK( reader.read( reinterpret_cast< char* >( again ), 3 ) == 3 );
+            CHECK( std::equal( again, again + 3, rows ) );
+        }
+
+        {
+            auto projection = dl::compile_projection( { "l" }, { 0 } );
+            dl::column_reader reader( stream, { 0 }, std::move( projection ) );
+            std::int32_t rows[ 3 ] = {};
+            std::vector< char* > dst = { reinterpret_cast< char* >( rows ) };
+            CHECK( reader.read( dst, 1 ) == 1 );
+            dst[ 0 ] += sizeof( std::int32_t );
+            CHECK( reader.read( dst, 5 ) == 2 );
+            CHECK( reader.tell() == 1 );
+            CHECK( reader.read( dst, 5 ) == 0 );
+            CHECK( rows[ 0 ] == 10 );
+            CHECK( rows[ 1 ] == 11 );
+            CHECK( rows[ 2 ] == 12 );
+        }
+    }
+}
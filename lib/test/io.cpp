@@ -0,0 +1,459 @@
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <tuple>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include <dlisio/ext/io.hpp>
+
+#include "files.hpp"
+
+namespace {
+
+struct bytes {
+    int type;
+    std::vector< char > data;
+
+    bool operator == ( const bytes& other ) const {
+        return this->type == other.type and this->data == other.data;
+    }
+};
+
+std::vector< bytes > read_all( dl::readahead& records ) {
+    std::vector< bytes > out;
+    dl::record_view rec;
+    while (records.next( rec ))
+        out.push_back( { rec.type, { rec.begin(), rec.end() } } );
+    return out;
+}
+
+std::vector< bytes > read_all( dl::stream& file,
+                               const std::vector< int >& indices ) {
+    std::vector< bytes > out;
+    dl::record_view rec;
+    for (const auto i : indices) {
+        file.at( i, rec );
+        out.push_back( { rec.type, { rec.begin(), rec.end() } } );
+    }
+    return out;
+}
+
+}
+
+TEST_CASE( "readahead is the same as stream::at", "[io]" ) {
+    dl::bench::synthetic opts;
+    opts.size = 512 * 1024;
+    opts.channels = 5;
+    opts.segment_size = 1000;
+    const test::synthetic_file file( opts );
+    REQUIRE( file.fdata.size() > 100 );
+
+    /* every other record, so the chunks have gaps to read past */
+    std::vector< int > every_other;
+    for (std::size_t i = 0; i < file.fdata.size(); i += 2)
+        every_other.push_back( file.fdata[ i ] );
+
+    std::vector< int > everything;
+    for (int i = 0; i < int(file.offsets.tells.size()); ++i)
+        everything.push_back( i );
+
+    dl::readahead_options small;
+    small.chunk_size = 16 * 1024;
+    small.max_gap = 512;
+    small.depth = 3;
+    small.threads = 2;
+
+    for (const auto& indices : { file.fdata, every_other, everything }) {
+        dl::stream plain( file.path(), false );
+        file.reindex( plain );
+        const auto expected = read_all( plain, indices );
+
+        {
+            dl::stream stream( file.path(), false );
+            file.reindex( stream );
+            dl::readahead records( stream, indices );
+            CHECK( records.size() == indices.size() );
+            CHECK( read_all( records ) == expected );
+        }
+
+        {
+            dl::stream stream( file.path(), false );
+            file.reindex( stream );
+            dl::readahead records( stream, indices, small );
+            CHECK( read_all( records ) == expected );
+            CHECK( records.chunks() > 1 );
+        }
+
+        {
+            dl::stream stream( file.path(), true );
+            file.reindex( stream );
+            dl::readahead records( stream, indices, small );
+            CHECK( read_all( records ) == expected );
+        }
+    }
+}
+
+TEST_CASE( "readahead checks its arguments", "[io]" ) {
+    dl::bench::synthetic opts;
+    opts.size = 64 * 1024;
+    const test::synthetic_file file( opts );
+
+    dl::stream stream( file.path(), false );
+    file.reindex( stream );
+
+    dl::readahead_options bad;
+    SECTION( "depth" ) {
+        bad.depth = 0;
+        CHECK_THROWS_AS( dl::readahead( stream, file.fdata, bad ),
+                         std::invalid_argument );
+    }
+
+    SECTION( "threads" ) {
+        bad.threads = 0;
+        CHECK_THROWS_AS( dl::readahead( stream, file.fdata, bad ),
+                         std::invalid_argument );
+    }
+
+    SECTION( "index out of range" ) {
+        const int size = file.offsets.tells.size();
+        CHECK_THROWS_AS( dl::readahead( stream, { 0, size } ),
+                         std::out_of_range );
+        CHECK_THROWS_AS( dl::readahead( stream, { -1 } ),
+                         std::out_of_range );
+    }
+}
+
+TEST_CASE( "tail_index indexes what is appended", "[io]" ) {
+    dl::bench::synthetic opts;
+    opts.size = 256 * 1024;
+    const test::synthetic_file full( opts );
+
+    std::vector< char > bytes;
+    {
+        std::ifstream in( full.path(), std::ios::binary );
+        bytes.assign( std::istreambuf_iterator< char >( in ),
+                      std::istreambuf_iterator< char >() );
+    }
+    REQUIRE( bytes.size() > 1024 );
+
+    const auto from = full.offsets.tells.front();
+    const auto cut = bytes.begin() + bytes.size() / 2 + 7;
+
+    test::scratch_file file;
+    file.write( { bytes.begin(), cut } );
+
+    dl::tail_index tail( file.path, from );
+    const auto first = tail.refresh();
+    CHECK( not first.tells.empty() );
+    CHECK( tail.partial() );
+
+    /* nothing is appended, so there is nothing new */
+    const auto indexed = tail.indexed();
+    CHECK( tail.refresh().tells.empty() );
+    CHECK( tail.indexed() == indexed );
+    CHECK( tail.partial() );
+
+    file.write( bytes );
+    const auto rest = tail.refresh();
+    CHECK( not rest.tells.empty() );
+    CHECK( not tail.partial() );
+    CHECK( tail.indexed() == std::int64_t(bytes.size()) );
+
+    const auto& ofs = tail.offsets();
+    CHECK( ofs.tells == full.offsets.tells );
+    CHECK( ofs.residuals == full.offsets.residuals );
+    CHECK( ofs.explicits == full.offsets.explicits );
+    CHECK( first.tells.size() + rest.tells.size() == ofs.tells.size() );
+}
+
+TEST_CASE( "source is closed for every stream that shares it", "[io]" ) {
+    dl::bench::synthetic opts;
+    opts.size = 64 * 1024;
+    const test::synthetic_file file( opts );
+
+    for (const bool mapped : { false, true }) {
+        INFO( "mapped: " << mapped );
+        auto src = std::make_shared< dl::source >( file.path(), mapped );
+        std::ifstream in( file.path(), std::ios::binary | std::ios::ate );
+        CHECK( src->size() == std::int64_t(in.tellg()) );
+
+        dl::stream first( src );
+        dl::stream second( src );
+        file.reindex( first );
+        file.reindex( second );
+
+        dl::record_view rec;
+        first.at( file.fdata.front(), rec );
+        second.at( file.fdata.front(), rec );
+
+        src->close();
+        CHECK( src->size() == 0 );
+        CHECK_THROWS( first.at( file.fdata.front(), rec ) );
+        CHECK_THROWS( second.at( file.fdata.front(), rec ) );
+    }
+}
+
+TEST_CASE( "source reports files it cannot open", "[io]" ) {
+    const std::string path = "dlisio-test-does-not-exist.dlis";
+    CHECK_THROWS_AS( dl::source( path, false ), std::system_error );
+    CHECK_THROWS_AS( dl::source( path, true ), std::system_error );
+}
+
+#if DLISIO_STATS
+TEST_CASE( "stats_batch adds its counts when destroyed", "[io]" ) {
+    dl::bench::synthetic opts;
+    opts.size = 64 * 1024;
+    const test::synthetic_file file( opts );
+
+    dl::stream stream( file.path(), true );
+    file.reindex( stream );
+    auto* counters = stream.statistics().get();
+
+    dl::record_view rec;
+    for (const auto i : file.fdata) stream.at( i, rec );
+    const auto records = counters->get( dl::counter::records_read );
+    const auto segments = counters->get( dl::counter::segments_read );
+    counters->reset();
+
+    {
+        dl::stats_batch batch( counters );
+        CHECK( dl::current_batch() == &batch );
+        for (const auto i : file.fdata) stream.at( i, rec );
+        CHECK( counters->get( dl::counter::records_read ) == 0 );
+    }
+
+    CHECK( dl::current_batch() == nullptr );
+    CHECK( counters->get( dl::counter::records_read ) == records );
+    CHECK( counters->get( dl::counter::segments_read ) == segments );
+}
+#endif
+
+TEST_CASE( "extract skips records from their segment headers", "[io]" ) {
+    const std::vector< unsigned char > bytes = {
+        /* visible record, version 1 */
+        0x00, 0x24, 0xFF, 0x01,
+        /* record 0: explicit, type 0 */
+        0x00, 0x10, 0x80, 0x00,
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B,
+        /* record 1: explicit, encrypted, type 3, first segment */
+        0x00, 0x10, 0xB0, 0x03,
+        0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B,
+        /* visible record, version 2, which makes record 1 inconsistent */
+        0x00, 0x14, 0xFF, 0x02,
+        /* record 1: last segment */
+        0x00, 0x10, 0xD0, 0x03,
+        0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B,
+        /* visible record, version 1 */
+        0x00, 0x14, 0xFF, 0x01,
+        /* record 2: explicit, type 5 */
+        0x00, 0x10, 0x80, 0x05,
+        0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B,
+    };
+
+    test::scratch_file file;
+    file.write( { bytes.begin(), bytes.end() } );
+    const auto offsets = test::index( file.path, 0 );
+    REQUIRE( offsets.tells.size() == 3 );
+
+    for (const bool mapped : { false, true }) {
+        INFO( "mapped: " << mapped );
+        dl::stream stream( file.path, mapped );
+        stream.reindex( offsets.tells, offsets.residuals );
+
+        const auto ext = stream.extent( 1 );
+        CHECK( ext.index == 1 );
+        CHECK( ext.tell == 20 );
+        CHECK( ext.size == 16 + 4 + 16 );
+        CHECK( ext.segments == 2 );
+        CHECK( ext.type == 3 );
+        CHECK( ext.isencrypted() );
+        CHECK( not ext.consistent );
+
+        dl::extract_policy policy;
+        policy.encrypted = false;
+        dl::record_batch batch;
+        std::vector< dl::record_extent > skipped;
+        stream.extract( { 0, 1, 2 }, batch, policy, &skipped );
+
+        REQUIRE( batch.size() == 3 );
+        CHECK( batch.size( 0 ) == 12 );
+        CHECK( batch.size( 1 ) == 0 );
+        CHECK( batch.size( 2 ) == 12 );
+        CHECK( batch.types == std::vector< int >({ 0, 3, 5 }) );
+        CHECK( not batch.consistent[ 1 ] );
+        CHECK( batch.begin( 2 )[ 0 ] == 0x30 );
+
+        REQUIRE( skipped.size() == 1 );
+        CHECK( skipped[ 0 ].index == ext.index );
+        CHECK( skipped[ 0 ].tell == ext.tell );
+        CHECK( skipped[ 0 ].size == ext.size );
+        CHECK( skipped[ 0 ].segments == ext.segments );
+        CHECK( skipped[ 0 ].attributes == ext.attributes );
+
+        policy.encrypted = true;
+        policy.types = { 5 };
+        skipped.clear();
+        stream.extract( { 0, 1, 2 }, batch, policy, &skipped );
+        CHECK( batch.size( 0 ) == 0 );
+        CHECK( batch.size( 1 ) == 0 );
+        CHECK( batch.size( 2 ) == 12 );
+        CHECK( skipped.size() == 2 );
+    }
+}
+
+TEST_CASE( "pagealign rounds ranges to whole pages", "[io]" ) {
+    const long long page = 4096;
+    const long long size = 10000;
+
+    const auto align = [&]( long long begin, long long end, bool inner ) {
+        const auto nonempty = dl::pagealign( begin, end, size, page, inner );
+        return std::make_tuple( nonempty, begin, end );
+    };
+
+    SECTION( "outward" ) {
+        CHECK( align(    0,  4096, false ) == std::make_tuple( true, 0,  4096 ) );
+        CHECK( align(  100,   200, false ) == std::make_tuple( true, 0,  4096 ) );
+        CHECK( align( 4000,  4200, false ) == std::make_tuple( true, 0,  8192 ) );
+        CHECK( align( 9000, 10000, false )
+            == std::make_tuple( true, 8192, 12288 ) );
+    }
+
+    SECTION( "inward" ) {
+        CHECK( align( 4096, 8192, true ) == std::make_tuple( true, 4096, 8192 ) );
+        CHECK( align(  100, 9000, true ) == std::make_tuple( true, 4096, 8192 ) );
+        /* no page is wholly inside */
+        CHECK( not std::get< 0 >( align(  100, 5000, true ) ) );
+        CHECK( not std::get< 0 >( align( 4097, 8191, true ) ) );
+    }
+
+    SECTION( "the page at end-of-file is only shared with the range" ) {
+        CHECK( align( 4000, 10000, true )
+            == std::make_tuple( true, 4096, 12288 ) );
+        CHECK( align( 8192, 10000, true )
+            == std::make_tuple( true, 8192, 12288 ) );
+        /* but the start of it still is shared with the bytes before */
+        CHECK( not std::get< 0 >( align( 8300, 10000, true ) ) );
+    }
+}
+
+TEST_CASE( "stream::advise merges nearby records", "[io]" ) {
+    dl::bench::synthetic opts;
+    opts.size = 512 * 1024;
+    const test::synthetic_file file( opts );
+
+    const auto& tells = file.offsets.tells;
+    const int n = tells.size();
+    REQUIRE( n > 10 );
+    const long long gap = dl::readahead_options().max_gap;
+    REQUIRE( tells[ 4 ] - tells[ 3 ] <= gap );
+    REQUIRE( tells[ n - 1 ] - tells[ 3 ] > gap );
+
+    std::ifstream in( file.path(), std::ios::binary | std::ios::ate );
+    const long long size = in.tellg();
+
+    dl::stream stream( file.path(), false );
+    file.reindex( stream );
+
+    using range = std::tuple< std::size_t, long long, long long >;
+    const auto ranges = [&]( const std::vector< int >& indices,
+                             dl::access_hint hint ) {
+        const auto* first = indices.data();
+        const auto xs = stream.advice_ranges( first,
+                                              first + indices.size(),
+                                              hint );
+        std::vector< range > out;
+        for (const auto& x : xs)
+            out.emplace_back( x.file, x.offset, x.size );
+        return out;
+    };
+
+    const auto span = [&]( int first, int last ) {
+        return range( 0, tells[ first ], tells[ last ] - tells[ first ] );
+    };
+
+    SECTION( "records a little apart are one range" ) {
+        const auto xs = ranges( { 1, 2, 4 }, dl::access_hint::willneed );
+        CHECK( xs == std::vector< range >({ span( 1, 5 ) }) );
+    }
+
+    SECTION( "records far apart are separate ranges" ) {
+        const auto xs = ranges( { 1, 2, n - 2 }, dl::access_hint::willneed );
+        CHECK( xs == std::vector< range >({ span( 1, 3 ),
+                                            span( n - 2, n - 1 ) }) );
+    }
+
+    SECTION( "dontneed only merges adjacent records" ) {
+        const auto xs = ranges( { 1, 2, 4 }, dl::access_hint::dontneed );
+        CHECK( xs == std::vector< range >({ span( 1, 3 ), span( 4, 5 ) }) );
+    }
+
+    SECTION( "the last record ends at end-of-file" ) {
+        const auto xs = ranges( { n - 1 }, dl::access_hint::dontneed );
+        const auto expected = range( 0, tells[ n - 1 ], size - tells[ n - 1 ] );
+        CHECK( xs == std::vector< range >({ expected }) );
+
+        const auto tail = ranges( { n - 3, n - 2, n - 1 },
+                                  dl::access_hint::dontneed );
+        CHECK( tail == std::vector< range >({
+            range( 0, tells[ n - 3 ], size - tells[ n - 3 ] )
+        }) );
+    }
+
+    SECTION( "records that are not indexed are ignored" ) {
+        CHECK( ranges( { -1, n }, dl::access_hint::willneed ).empty() );
+        CHECK( ranges( {}, dl::access_hint::dontneed ).empty() );
+    }
+}
+
+TEST_CASE( "streams read the last record of every source", "[io]" ) {
+    dl::bench::synthetic opts;
+    opts.size = 64 * 1024;
+    const test::synthetic_file file( opts );
+
+    std::ifstream in( file.path(), std::ios::binary | std::ios::ate );
+    const long long size = in.tellg();
+
+    /* the same file twice, like a storage set of two physical files */
+    auto tells = file.offsets.tells;
+    auto residuals = file.offsets.residuals;
+    const auto n = tells.size();
+    for (std::size_t i = 0; i < n; ++i) {
+        tells.push_back( tells[ i ] + size );
+        residuals.push_back( residuals[ i ] );
+    }
+
+    std::vector< int > indices;
+    for (int i = 0; i < int(tells.size()); ++i)
+        indices.push_back( i );
+
+    dl::stream single( file.path(), true );
+    file.reindex( single );
+    std::vector< int > once;
+    for (int i = 0; i < int(n); ++i)
+        once.push_back( i );
+    const auto first = read_all( single, once );
+    auto expected = first;
+    expected.insert( expected.end(), first.begin(), first.end() );
+
+    for (const auto& mapped : { std::make_pair( false, false ),
+                                std::make_pair( true,  false ),
+                                std::make_pair( true,  true ) }) {
+        INFO( "mapped: " << mapped.first << ", " << mapped.second );
+        dl::stream stream( {
+            std::make_shared< dl::source >( file.path(), mapped.first ),
+            std::make_shared< dl::source >( file.path(), mapped.second ),
+        } );
+        stream.reindex( tells, residuals );
+
+        CHECK( read_all( stream, indices ) == expected );
+
+        dl::readahead records( stream, indices );
+        CHECK( read_all( records ) == expected );
+    }
+}
@@ -1,6 +1,8 @@
+#include <algorithm>
 #include <array>
 #include <cstdint>
 #include <cstring>
+#include <limits>
 #include <string>
 #include <vector>
 
@@ -22,6 +24,48 @@ struct check_packflen {
         CHECK(err == DLIS_OK);
         CHECK(nread == source.size());
         CHECK(nwrite == buffer.size());
+
+        check_compiled();
+    }
+
+    void check_compiled() {
+        /*
+         * the compiled format must unpack exactly like dlis_packf does, also
+         * when rows are back-to-back
+         */
+        std::vector< char > expected(buffer.size());
+        auto err = dlis_packf(fmt, source.data(), expected.data());
+        REQUIRE(err == DLIS_OK);
+
+        dlis_compiled_fmt* compiled;
+        err = dlis_compile_fmt(fmt, &compiled);
+        REQUIRE(err == DLIS_OK);
+
+        const int rows = 3;
+        std::vector< unsigned char > src;
+        for (int i = 0; i < rows; ++i)
+            src.insert(src.end(), source.begin(), source.end());
+
+        int nread, nwrite;
+        std::vector< char > dst(buffer.size() * rows);
+        err = dlis_packf_compiled(compiled, src.data(), dst.data(), rows,
+                                  &nread, &nwrite);
+        CHECK(err == DLIS_OK);
+        CHECK(nread  == src.size());
+        CHECK(nwrite == dst.size());
+
+        for (int i = 0; i < rows; ++i) {
+            const auto row = dst.begin() + i * buffer.size();
+            CHECK(std::equal(expected.begin(), expected.end(), row));
+        }
+
+        err = dlis_packf_compiled(compiled, src.data(), nullptr, rows,
+                                  &nread, &nwrite);
+        CHECK(err == DLIS_OK);
+        CHECK(nread  == src.size());
+        CHECK(nwrite == dst.size());
+
+        dlis_free_fmt(compiled);
     }
 };
 
@@ -839,3 +883,82 @@ TEST_CASE("pack size single values inconsistent") {
     CHECK( dlis_pack_size( "A" , nullptr, nullptr ) == DLIS_INCONSISTENT );
     CHECK( dlis_pack_size( "Q" , nullptr, nullptr ) == DLIS_INCONSISTENT );
 }
+
+TEST_CASE("compiled pack fails with invalid specifier", "[pack]") {
+    dlis_compiled_fmt* compiled = nullptr;
+    CHECK( dlis_compile_fmt( "fw", &compiled ) == DLIS_INVALID_ARGS );
+    CHECK( dlis_compile_fmt( "w",  &compiled ) == DLIS_INVALID_ARGS );
+    CHECK( dlis_compile_fmt( "iiw",  &compiled ) == DLIS_INVALID_ARGS );
+    CHECK( compiled == nullptr );
+}
+
+TEST_CASE("compiled pack of strings and numbers", "[pack]") {
+    const unsigned char source[] = {
+        0x3F, 0x80, 0x00, 0x00,             // 1.0 fsingl
+        0x04, 0x54, 0x45, 0x53, 0x54,       // "TEST" ident
+        0x03, 0x41, 0x42, 0x43,             // "ABC" ascii
+        0x00, 0x00, 0x00, 0x02,             // 2 slong
+        0x00, 0x00, 0x00, 0x03,             // 3 slong
+        0x81, 0x00,                         // 256 uvari
+        0x00,                               // "" ascii
+    };
+
+    const char* fmt = "fsSlliS";
+    unsigned char expected[ 4 + 8 + 7 + 4 + 4 + 4 + 4 ];
+    unsigned char dst[ sizeof(expected) ];
+
+    REQUIRE( dlis_packf( fmt, source, expected ) == DLIS_OK );
+
+    dlis_compiled_fmt* compiled;
+    REQUIRE( dlis_compile_fmt( fmt, &compiled ) == DLIS_OK );
+
+    int nread, nwrite;
+    const auto err = dlis_packf_compiled( compiled, source, dst, 1,
+                                          &nread, &nwrite );
+    dlis_free_fmt( compiled );
+
+    CHECK( err == DLIS_OK );
+    CHECK( nread  == sizeof(source) );
+    CHECK( nwrite == sizeof(dst) );
+    CHECK( std::memcmp( dst, expected, sizeof(dst) ) == 0 );
+}
+
+TEST_CASE("compiled pack of zero rows", "[pack]") {
+    dlis_compiled_fmt* compiled;
+    REQUIRE( dlis_compile_fmt( "fi", &compiled ) == DLIS_OK );
+
+    int nread = -1, nwrite = -1;
+    const unsigned char source[] = { 0x00 };
+    const auto err = dlis_packf_compiled( compiled, source, nullptr, 0,
+                                          &nread, &nwrite );
+    dlis_free_fmt( compiled );
+
+    CHECK( err == DLIS_OK );
+    CHECK( nread  == 0 );
+    CHECK( nwrite == 0 );
+}
+
+TEST_CASE("compiled pack rejects more than INT_MAX bytes", "[pack]") {
+    const unsigned char source[] = { 0x00 };
+    const auto maxsize = (std::numeric_limits< int >::max)();
+
+    /* one fused run of words, and a row with a uvari, which is not fused */
+    for (const auto* fmt : { "ffff", "fi" }) {
+        INFO( "fmt: " << fmt );
+        int rowsize;
+        REQUIRE( dlis_pack_size( fmt, nullptr, &rowsize ) == DLIS_OK );
+
+        dlis_compiled_fmt* compiled;
+        REQUIRE( dlis_compile_fmt( fmt, &compiled ) == DLIS_OK );
+
+        int nread = -1, nwrite = -1;
+        const auto rows = maxsize / rowsize + 1;
+        const auto err = dlis_packf_compiled( compiled, source, nullptr, rows,
+                                              &nread, &nwrite );
+        dlis_free_fmt( compiled );
+
+        CHECK( err == DLIS_BAD_SIZE );
+        CHECK( nread  == -1 );
+        CHECK( nwrite == -1 );
+    }
+}
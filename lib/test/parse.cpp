@@ -0,0 +1,208 @@
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include <dlisio/dlisio.h>
+
+#include <dlisio/ext/io.hpp>
+#include <dlisio/ext/types.hpp>
+
+namespace {
+
+/*
+ * A CHANNEL set with the template
+ *
+ *   A: fsingl
+ *   B: ident
+ *   I: ident "inv", invariant
+ *
+ * and the objects ONE, TWO, THREE and FOUR, which between them have count,
+ * representation code and units set in the object, absent attributes, and an
+ * object that ends before its last attribute
+ */
+const std::vector< char > channels = {
+    '\xF0', 0x07, 'C', 'H', 'A', 'N', 'N', 'E', 'L',
+
+    '\x34', 0x01, 'A', 0x02,
+    '\x30', 0x01, 'B',
+    '\x51', 0x01, 'I', 0x03, 'i', 'n', 'v',
+
+    /* ONE: A = 1.0, B = "b1" */
+    '\x70', 0x01, 0x00, 0x03, 'O', 'N', 'E',
+    '\x21', '\x3F', '\x80', 0x00, 0x00,
+    '\x21', 0x02, 'b', '1',
+
+    /* TWO: A = [2.0, 3.0, 4.0], B = [1.5, 2.5] fdoubl in m */
+    '\x70', 0x01, 0x00, 0x03, 'T', 'W', 'O',
+    '\x29', 0x03,
+        '\x40', 0x00, 0x00, 0x00,
+        '\x40', '\x40', 0x00, 0x00,
+        '\x40', '\x80', 0x00, 0x00,
+    '\x2F', 0x02, 0x07, 0x01, 'm',
+        '\x3F', '\xF8', 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        '\x40', 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+
+    /* THREE: A absent, B = "b3" */
+    '\x70', 0x02, 0x01, 0x05, 'T', 'H', 'R', 'E', 'E',
+    '\x00',
+    '\x21', 0x02, 'b', '3',
+
+    /* FOUR: A = "hi" ascii, and no B */
+    '\x70', 0x01, 0x00, 0x04, 'F', 'O', 'U', 'R',
+    '\x25', 0x14, 0x02, 'h', 'i',
+};
+
+/* A FRAME set with a single object, F, without attributes */
+const std::vector< char > frames = {
+    '\xF0', 0x05, 'F', 'R', 'A', 'M', 'E',
+    '\x30', 0x01, 'X',
+    '\x70', 0x01, 0x00, 0x01, 'F',
+};
+
+dl::object_set parse( const std::vector< char >& set,
+                      const dl::object_filter& filter ) {
+    const auto* begin = set.data();
+    const auto* end = begin + set.size();
+    return dl::unflatten( dl::parse_flat_objects( begin, end, filter ) );
+}
+
+std::vector< std::string > names( const dl::object_set& set ) {
+    std::vector< std::string > xs;
+    for (const auto& object : set.objects)
+        xs.push_back( dl::decay( object.object_name.id ) );
+    return xs;
+}
+
+/*
+ * object_attribute::operator == never considers attributes without a value
+ * equal, so compare those by everything but the value
+ */
+bool same( const dl::object_attribute& lhs, const dl::object_attribute& rhs ) {
+    if (lhs.value.index() != 0 or rhs.value.index() != 0) return lhs == rhs;
+    return lhs.label == rhs.label
+       and lhs.count == rhs.count
+       and lhs.reprc == rhs.reprc
+       and lhs.units == rhs.units;
+}
+
+bool same( const std::vector< dl::object_attribute >& lhs,
+           const std::vector< dl::object_attribute >& rhs ) {
+    if (lhs.size() != rhs.size()) return false;
+    for (std::size_t i = 0; i < lhs.size(); ++i)
+        if (not same( lhs[ i ], rhs[ i ] )) return false;
+    return true;
+}
+
+bool same( const dl::basic_object& lhs, const dl::basic_object& rhs ) {
+    return lhs.object_name == rhs.object_name
+       and same( lhs.attributes, rhs.attributes );
+}
+
+dl::record eflr( const std::vector< char >& data ) {
+    dl::record rec;
+    rec.type = 3;
+    rec.attributes = DLIS_SEGATTR_EXFMTLR;
+    rec.consistent = true;
+    rec.data = data;
+    return rec;
+}
+
+}
+
+TEST_CASE( "object_filter selects objects by name", "[parse]" ) {
+    const auto everything = parse( channels, dl::object_filter() );
+    REQUIRE( names( everything )
+             == std::vector< std::string >({ "ONE", "TWO", "THREE", "FOUR" }) );
+
+    SECTION( "by exact name" ) {
+        const dl::object_filter filter( {}, { "TWO", "FOUR" }, "" );
+        const auto set = parse( channels, filter );
+        REQUIRE( names( set ) == std::vector< std::string >({ "TWO", "FOUR" }) );
+        CHECK( same( set.objects[ 0 ], everything.objects[ 1 ] ) );
+        CHECK( same( set.objects[ 1 ], everything.objects[ 3 ] ) );
+        CHECK( same( set.tmpl, everything.tmpl ) );
+    }
+
+    SECTION( "names are case-sensitive" ) {
+        const dl::object_filter filter( {}, { "two" }, "" );
+        CHECK( parse( channels, filter ).objects.empty() );
+    }
+
+    SECTION( "the pattern is matched from the start, ignoring case" ) {
+        const dl::object_filter filter( {}, {}, "t" );
+        const auto set = parse( channels, filter );
+        REQUIRE( names( set ) == std::vector< std::string >({ "TWO", "THREE" }) );
+        CHECK( same( set.objects[ 0 ], everything.objects[ 1 ] ) );
+        CHECK( same( set.objects[ 1 ], everything.objects[ 2 ] ) );
+
+        CHECK( parse( channels, dl::object_filter( {}, {}, "WO" ) )
+               .objects.empty() );
+    }
+
+    SECTION( "names and pattern" ) {
+        const dl::object_filter filter( {}, { "ONE" }, "F.UR$" );
+        const auto set = parse( channels, filter );
+        CHECK( names( set ) == std::vector< std::string >({ "ONE", "FOUR" }) );
+    }
+
+    SECTION( "skipping every object" ) {
+        const dl::object_filter filter( {}, { "NONE" }, "" );
+        const auto set = parse( channels, filter );
+        CHECK( set.objects.empty() );
+        CHECK( same( set.tmpl, everything.tmpl ) );
+    }
+
+    SECTION( "truncated object that is skipped" ) {
+        const dl::object_filter filter( {}, { "ONE" }, "" );
+        /* cut in the middle of the values of TWO */
+        const std::vector< char > cut( channels.begin(), channels.begin() + 50 );
+        const auto* begin = cut.data();
+        const auto* end = begin + cut.size();
+        CHECK_THROWS_AS( dl::parse_flat_objects( begin, end, filter ),
+                         std::out_of_range );
+    }
+
+    SECTION( "invalid pattern" ) {
+        CHECK_THROWS_AS( dl::object_filter( {}, {}, "T(" ),
+                         std::invalid_argument );
+    }
+}
+
+TEST_CASE( "object_filter selects sets by type", "[parse]" ) {
+    const std::vector< dl::record > recs = { eflr( channels ), eflr( frames ) };
+
+    dl::record_batch batch;
+    for (const auto& rec : recs) {
+        batch.data.insert( batch.data.end(), rec.data.begin(), rec.data.end() );
+        batch.offsets.push_back( batch.data.size() );
+        batch.types.push_back( rec.type );
+        batch.attributes.push_back( rec.attributes );
+        batch.consistent.push_back( rec.consistent );
+    }
+
+    const auto check = [&]( const dl::object_filter& filter,
+                            const std::vector< std::int32_t >& expected ) {
+        for (const auto& sets : { dl::parse_flat_objects( recs, filter ),
+                                  dl::parse_flat_objects( batch, filter ) }) {
+            std::vector< std::int32_t > objects;
+            for (const auto& set : sets)
+                objects.push_back( std::int32_t( set.objects.size() ) );
+            CHECK( objects == expected );
+        }
+    };
+
+    check( dl::object_filter(), { 4, 1 } );
+    check( dl::object_filter( { "FRAME" }, {}, "" ), { 1 } );
+    check( dl::object_filter( { "CHANNEL", "FRAME" }, { "F" }, "" ), { 0, 1 } );
+    check( dl::object_filter( { "TOOL" }, {}, "" ), {} );
+
+    /* encrypted records are skipped */
+    auto encrypted = recs;
+    encrypted.front().attributes |= DLIS_SEGATTR_ENCRYPT;
+    const auto sets = dl::parse_flat_objects( encrypted, dl::object_filter() );
+    REQUIRE( sets.size() == 1 );
+    CHECK( sets.front().objects.size() == 1 );
+}
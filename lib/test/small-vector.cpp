@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include <dlisio/ext/small-vector.hpp>
+#include <dlisio/ext/types.hpp>
+
+namespace {
+
+/*
+ * Non-trivial type that counts its live instances, so that the tests can
+ * check that every value that is constructed is also destroyed
+ */
+struct counted {
+    static int live;
+
+    counted() : counted( 0 ) {}
+    counted( int x ) : value( x ) { ++live; }
+    counted( const counted& other ) : value( other.value ) { ++live; }
+    counted& operator = ( const counted& ) = default;
+    ~counted() { --live; }
+
+    bool operator == ( const counted& other ) const {
+        return this->value == other.value;
+    }
+
+    int value;
+};
+
+int counted::live = 0;
+
+template < typename T >
+T make( int i );
+
+template <>
+std::int32_t make( int i ) {
+    return i;
+}
+
+template <>
+double make( int i ) {
+    return i + 0.5;
+}
+
+template <>
+dl::ident make( int i ) {
+    return dl::ident( "IDENT-" + std::to_string( i ) );
+}
+
+template <>
+dl::obname make( int i ) {
+    dl::obname name;
+    name.origin = dl::origin( i );
+    name.copy = dl::ushort( i % 2 );
+    name.id = make< dl::ident >( i );
+    return name;
+}
+
+template <>
+counted make( int i ) {
+    return counted( i );
+}
+
+template < typename T >
+std::vector< T > values( int n, int first = 0 ) {
+    std::vector< T > xs;
+    for (int i = first; i < first + n; ++i)
+        xs.push_back( make< T >( i ) );
+    return xs;
+}
+
+template < typename T >
+bool same( const dl::small_vector< T >& xs,
+           const std::vector< typename dl::small_vector< T >::value_type >& ys ) {
+    return xs.size() == ys.size()
+       and std::equal( xs.begin(), xs.end(), ys.begin() );
+}
+
+/*
+ * Sizes that are empty, inline, exactly full inline, and on the heap. For
+ * types that are never stored inline the middle ones are on the heap too.
+ */
+template < typename T >
+std::vector< int > sizes() {
+    const int n = dl::small_vector< T >::inline_capacity;
+    return { 0, 1, n, n + 1, 2 * n + 3 };
+}
+
+template < typename T >
+bool local( int n ) {
+    return n == 0 or std::size_t(n) <= dl::small_vector< T >::inline_capacity;
+}
+
+template < typename T >
+void check_transitions() {
+    for (const auto n : sizes< T >())
+    for (const auto m : sizes< T >()) {
+        INFO( "from " << n << " to " << m << " elements" );
+        const auto xs = values< T >( n );
+        const auto ys = values< T >( m, 100 );
+        const dl::small_vector< T > from( xs.begin(), xs.end() );
+        REQUIRE( same( from, xs ) );
+        CHECK( from.local() == local< T >( n ) );
+
+        {
+            dl::small_vector< T > copy( from );
+            CHECK( same( copy, xs ) );
+            CHECK( copy.local() == local< T >( n ) );
+            CHECK( same( from, xs ) );
+        }
+
+        {
+            dl::small_vector< T > to( ys.begin(), ys.end() );
+            to = from;
+            CHECK( same( to, xs ) );
+            CHECK( same( from, xs ) );
+            to.push_back( make< T >( -1 ) );
+            CHECK( to.back() == make< T >( -1 ) );
+            CHECK( same( from, xs ) );
+        }
+
+        {
+            dl::small_vector< T > src( from );
+            dl::small_vector< T > moved( std::move( src ) );
+            CHECK( same( moved, xs ) );
+            CHECK( moved.local() == local< T >( n ) );
+            CHECK( src.empty() );
+            CHECK( src.local() );
+            /* a moved-from vector is usable */
+            src.push_back( make< T >( 7 ) );
+            CHECK( same( src, values< T >( 1, 7 ) ) );
+        }
+
+        {
+            dl::small_vector< T > src( from );
+            dl::small_vector< T > to( ys.begin(), ys.end() );
+            to = std::move( src );
+            CHECK( same( to, xs ) );
+            CHECK( src.empty() );
+        }
+
+        {
+            dl::small_vector< T > lhs( from );
+            dl::small_vector< T > rhs( ys.begin(), ys.end() );
+            lhs.swap( rhs );
+            CHECK( same( lhs, ys ) );
+            CHECK( same( rhs, xs ) );
+            CHECK( lhs.local() == local< T >( m ) );
+            CHECK( rhs.local() == local< T >( n ) );
+
+            using std::swap;
+            swap( lhs, rhs );
+            CHECK( same( lhs, xs ) );
+            CHECK( same( rhs, ys ) );
+        }
+
+        {
+            dl::small_vector< T > to( from );
+            to.assign( ys.begin(), ys.end() );
+            CHECK( same( to, ys ) );
+            /* assign never gives back the heap storage */
+            CHECK( to.local() == (local< T >( n ) and local< T >( m )) );
+        }
+    }
+}
+
+}
+
+TEST_CASE( "small_vector stores short values inline", "[small-vector]" ) {
+    CHECK( dl::small_vector< std::int32_t >::inline_capacity == 4 );
+    CHECK( dl::small_vector< double >::inline_capacity == 2 );
+    CHECK( dl::small_vector< dl::fdoub1 >::inline_capacity == 1 );
+    CHECK( dl::small_vector< dl::ident >::inline_capacity == 0 );
+    CHECK( dl::small_vector< dl::obname >::inline_capacity == 0 );
+    CHECK( sizeof( dl::small_vector< std::uint8_t > )
+        == sizeof( std::vector< std::uint8_t > ) );
+
+    dl::small_vector< std::int32_t > xs;
+    CHECK( xs.empty() );
+    CHECK( xs.local() );
+    CHECK( xs.capacity() == 4 );
+
+    for (int i = 0; i < 4; ++i) xs.push_back( i );
+    CHECK( xs.local() );
+    CHECK( xs.capacity() == 4 );
+
+    xs.push_back( 4 );
+    CHECK( not xs.local() );
+    CHECK( xs.capacity() >= 5 );
+    CHECK( same( xs, values< std::int32_t >( 5 ) ) );
+
+    /* pushing a value of the vector itself while it grows */
+    dl::small_vector< std::int32_t > ys = { 1, 2, 3, 4 };
+    ys.push_back( ys.front() );
+    CHECK( same( ys, { 1, 2, 3, 4, 1 } ) );
+
+    CHECK_THROWS_AS( ys.at( 5 ), std::out_of_range );
+}
+
+TEST_CASE( "small_vector copies, moves and swaps inline and heap values",
+           "[small-vector]" ) {
+    SECTION( "int32" )  { check_transitions< std::int32_t >(); }
+    SECTION( "double" ) { check_transitions< double >(); }
+    SECTION( "ident" )  { check_transitions< dl::ident >(); }
+    SECTION( "obname" ) { check_transitions< dl::obname >(); }
+    SECTION( "counted" ) {
+        check_transitions< counted >();
+        CHECK( counted::live == 0 );
+    }
+}
+
+TEST_CASE( "small_vector resize grows and shrinks", "[small-vector]" ) {
+    SECTION( "inline" ) {
+        dl::small_vector< std::int32_t > xs = { 1, 2, 3 };
+        xs.resize( 1 );
+        CHECK( same( xs, { 1 } ) );
+        CHECK( xs.local() );
+        xs.resize( 3 );
+        CHECK( same( xs, { 1, 0, 0 } ) );
+        xs.resize( 0 );
+        CHECK( xs.empty() );
+    }
+
+    SECTION( "heap to fewer than fit inline" ) {
+        dl::small_vector< std::int32_t > xs = { 1, 2, 3, 4, 5, 6 };
+        const auto capacity = xs.capacity();
+        xs.resize( 2 );
+        CHECK( same( xs, { 1, 2 } ) );
+        /* like std::vector, shrinking keeps the storage */
+        CHECK( not xs.local() );
+        CHECK( xs.capacity() == capacity );
+        xs.push_back( 9 );
+        CHECK( same( xs, { 1, 2, 9 } ) );
+    }
+
+    SECTION( "non-trivial values" ) {
+        {
+            dl::small_vector< counted > xs( 6 );
+            CHECK( counted::live == 6 );
+            xs.resize( 2 );
+            CHECK( counted::live == 2 );
+            xs.resize( 4 );
+            CHECK( counted::live == 4 );
+            CHECK( xs.back() == counted( 0 ) );
+        }
+        CHECK( counted::live == 0 );
+
+        dl::small_vector< dl::ident > ids( 3, dl::ident( "ID" ) );
+        ids.resize( 1 );
+        CHECK( same( ids, { dl::ident( "ID" ) } ) );
+    }
+}
+
+TEST_CASE( "small_vector survives self-assignment", "[small-vector]" ) {
+    const auto check = []( std::initializer_list< dl::ident > ids ) {
+        const std::vector< dl::ident > expected( ids );
+        dl::small_vector< dl::ident > xs( ids );
+        auto& alias = xs;
+
+        xs = alias;
+        CHECK( same( xs, expected ) );
+        xs = std::move( alias );
+        CHECK( same( xs, expected ) );
+        xs.swap( alias );
+        CHECK( same( xs, expected ) );
+    };
+
+    check( {} );
+    check( { dl::ident( "ONE" ) } );
+    check( { dl::ident( "ONE" ), dl::ident( "TWO" ) } );
+
+    dl::small_vector< std::int32_t > inline_values = { 1, 2 };
+    auto& alias = inline_values;
+    inline_values = alias;
+    CHECK( same( inline_values, { 1, 2 } ) );
+    inline_values = std::move( alias );
+    CHECK( same( inline_values, { 1, 2 } ) );
+
+    dl::small_vector< std::int32_t > heap_values = { 1, 2, 3, 4, 5 };
+    auto& heap_alias = heap_values;
+    heap_values = heap_alias;
+    CHECK( same( heap_values, { 1, 2, 3, 4, 5 } ) );
+    heap_values = std::move( heap_alias );
+    CHECK( same( heap_values, { 1, 2, 3, 4, 5 } ) );
+}
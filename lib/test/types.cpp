@@ -7,6 +7,7 @@
 #include <limits>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include <catch2/catch.hpp>
 
@@ -419,6 +420,26 @@ TEST_CASE("variable-length unsigned int", "[type]") {
         }
     }
 
+    SECTION("minimal width") {
+        /* only 14 bits fit in the 2-byte representation */
+        const std::array< std::int32_t, 6 > values = {
+            0, 127, 128, 16383, 16384, 49151,
+        };
+        const std::array< std::size_t, values.size() > widths = {
+            1, 1, 2, 2, 4, 4,
+        };
+
+        for( std::size_t i = 0; i < values.size(); ++i ) {
+            char buf[ 4 ];
+            const void* end = dlis_uvario( buf, values[ i ], 0 );
+            CHECK( std::size_t((const char*)end - buf) == widths[ i ] );
+
+            std::int32_t v;
+            dlis_uvari( buf, &v );
+            CHECK( v == values[ i ] );
+        }
+    }
+
     SECTION("4-byte") {
         const std::array< bytes<4>, 9 > in = {{
             { 0xC0, 0x00, 0x00, 0x00 }, // 0
@@ -1480,6 +1501,86 @@ TEST_CASE( "attref", "[type]" ) {
     }
 }
 
+namespace {
+
+/*
+ * Check that the array function fn gives the same values as calling the scalar
+ * function f on every value in src
+ */
+template < typename T, typename Array, typename Scalar >
+void check_array( const std::vector< char >& src, Array fn, Scalar f ) {
+    const auto size = int(sizeof( T ));
+    const auto count = int(src.size()) / size;
+
+    for (const int n : { 0, 1, 7, 8, 9, 31, count }) {
+        std::vector< T > expected( n );
+        for (int i = 0; i < n; ++i)
+            f( src.data() + i * size, &expected[ i ] );
+
+        /* write at an odd offset, to check that out needs no alignment */
+        std::vector< char > out( n * size + 1 );
+        const char* end = fn( src.data(), n, out.data() + 1 );
+        CHECK( end == src.data() + n * size );
+        /* expected.data() may be null when n is 0 */
+        if (n > 0)
+            CHECK( std::memcmp( out.data() + 1, expected.data(), n * size )
+                   == 0 );
+
+        CHECK( fn( src.data(), n, nullptr ) == src.data() + n * size );
+    }
+}
+
+}
+
+TEST_CASE( "array conversions match the scalar ones", "[type]" ) {
+    /*
+     * Random-ish bytes, with the interesting IBM and VAX patterns in front:
+     * zero, negative zero, under- and overflow and the smallest exponents
+     */
+    std::vector< char > src = {
+        '\x00', '\x00', '\x00', '\x00',
+        '\x80', '\x00', '\x00', '\x00',
+        '\x21', '\x1F', '\xFF', '\xFF',
+        '\x61', '\x20', '\x00', '\x00',
+        '\xFF', '\xFF', '\xFF', '\xFF',
+        '\x80', '\x00', '\x00', '\x00',
+        '\x80', '\x00', '\xFF', '\x00',
+        '\x00', '\x01', '\x00', '\x00',
+    };
+
+    std::uint32_t x = 2463534242;
+    while (src.size() < 4096) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        src.push_back( char(x) );
+    }
+
+    SECTION( "snorm" ) {
+        check_array< std::int16_t >( src, dlis_snorm_n, dlis_snorm );
+    }
+
+    SECTION( "slong" ) {
+        check_array< std::int32_t >( src, dlis_slong_n, dlis_slong );
+    }
+
+    SECTION( "fsingl" ) {
+        check_array< float >( src, dlis_fsingl_n, dlis_fsingl );
+    }
+
+    SECTION( "fdoubl" ) {
+        check_array< double >( src, dlis_fdoubl_n, dlis_fdoubl );
+    }
+
+    SECTION( "isingl" ) {
+        check_array< float >( src, dlis_isingl_n, dlis_isingl );
+    }
+
+    SECTION( "vsingl" ) {
+        check_array< float >( src, dlis_vsingl_n, dlis_vsingl );
+    }
+}
+
 TEST_CASE( "size-of", "[type]" ) {
     CHECK( dlis_sizeof_type( DLIS_FSHORT ) == 2 );
     CHECK( dlis_sizeof_type( DLIS_FSINGL ) == 4 );
@@ -1,9 +1,18 @@
 from collections import defaultdict, OrderedDict
+from concurrent.futures import ThreadPoolExecutor
+from contextlib import contextmanager
 from io import StringIO
 import logging
+import os
 import re
+import time
+
+import numpy as np
 
 from . import core
+from . import cache
+from . import export
+from . import indexcache
 from . import plumbing
 
 try:
@@ -49,7 +58,18 @@ class dlis(object):
     indexedobject : dict
         A full inventory of all objects in the logical file, indexed by type.
         Note that there are more handy ways of accessing objects than through
-        this dictionary.
+        this dictionary. For lazily loaded files, accessing indexedobjects
+        forces every object set to be parsed.
+
+    cache : dlisio.cache.Cache
+        The recently read FDATA records and curves, so that reading the same
+        curves again is free. Set cache.budget to change how many bytes it
+        may hold, or to 0 to disable it.
+
+    filter : dlisio.core.object_filter or None
+        The object types and names selected by dlisio.load, or None if all
+        objects are loaded. Objects that are not selected are never parsed,
+        and are not in the logical file at all.
     """
     types = {
         'AXIS'                   : plumbing.Axis,
@@ -126,17 +146,41 @@ class dlis(object):
        to link the content of attributes to other objects.
     """
 
-    def __init__(self, stream, explicits, attic, implicits, sul_offset = 80):
+    backlinks = {
+        'CHANNEL' : ['FRAME'],
+    }
+    """dict: Object-types that must be loaded together with a type, because
+    they modify the objects of that type when linked. Frame.link sets
+    Channel.frame, so channels are not complete without the frames.
+
+    Only used for lazily loaded files.
+    """
+
+    def __init__(self, stream, explicits, attic, implicits, sul_offset = 80,
+                 lazy = False, sets = None, stats = None, filter = None):
         self.file = stream
         self.explicit_indices = explicits
         self.attic = attic
         self.sul_offset = sul_offset
         self.fdata_index = implicits
 
+        # the work done for this logical file that is not done through its
+        # stream, e.g. indexing and parsing, see dlis.stats
+        self.counters = core.stats()
+        if stats is not None: self.counters.merge(stats)
+        # name -> [seconds, calls, depth] of the python phases, see timer
+        self.timers = {}
+        self.cache = cache.Cache()
+        self.filter = filter
+
         self.indexedobjects = defaultdict(dict)
         self.problematic = []
 
-        self.load()
+        # object-type -> records not yet parsed
+        self.unparsed = {}
+
+        if lazy: self.defer()
+        else:    self.load(sets)
 
     def __enter__(self):
         return self
@@ -152,6 +196,7 @@ class dlis(object):
         previously-closed file will raise `IOError`.
         """
         self.file.close()
+        self.cache.clear()
 
     def __repr__(self):
         try:
@@ -160,13 +205,68 @@ class dlis(object):
             desc = 'Unknown'
         return 'dlis({})'.format(desc)
 
+    @property
+    def stats(self):
+        """ Counters and timings of the work done for this logical file
+
+        The counters are the bytes and records indexed, the records and
+        segments read, the records stitched together from multiple segments,
+        the bytes copied, the objects parsed, the frames decoded, and the
+        records and bytes skipped without reading the bodies (e.g. encrypted
+        records). The seconds and calls are the total time spent in, and the
+        number of calls to, findoffsets, extract, parse_objects, findfdata and
+        read_fdata, and the python phases load (the dlisio.load call), create
+        and link.
+
+        The physical file is indexed once for all its logical files, so the
+        indexing is included in the stats of every one of them.
+
+        The stats of the cache, i.e. its size and the hits, misses and
+        evictions, are in stats['cache'], see dlisio.cache.Cache.stats.
+
+        If dlisio is built with DLISIO_STATS=0, the counters and the timings
+        of the C++ phases are always zero, see dlisio.core.stats.enabled.
+
+        Returns
+        -------
+        stats : dict
+
+        Examples
+        --------
+
+        >>> with dlisio.load(path) as (f, *_):
+        ...     for frame in f.frames:
+        ...         curves = frame.curves()
+        ...     f.stats['frames_decoded']
+        ...     f.stats['seconds']['read_fdata']
+        """
+        total = core.stats()
+        total.merge(self.counters)
+        total.merge(self.file.stats)
+
+        stats = total.asdict()
+        for name, (seconds, calls, _) in self.timers.items():
+            stats['seconds'][name] = seconds
+            stats['calls'][name] = calls
+        stats['cache'] = self.cache.stats
+        return stats
+
+    @property
+    def indexedobjects(self):
+        self.loadtypes(list(self.unparsed.keys()))
+        return self._indexedobjects
+
+    @indexedobjects.setter
+    def indexedobjects(self, objects):
+        self._indexedobjects = objects
+
     class IndexedObjectDescriptor:
         """ Return all objects of this type"""
         def __init__(self, t):
             self.t = t
 
         def __get__(self, instance, owner):
-            return instance.indexedobjects[self.t].values()
+            return instance.objectsof(self.t).values()
 
     @property
     def fileheader(self):
@@ -177,7 +277,7 @@ class dlis(object):
         fileheader : Fileheader
 
         """
-        values = list(self.indexedobjects['FILE-HEADER'].values())
+        values = list(self.objectsof('FILE-HEADER').values())
 
         if len(values) != 1:
             msg = "Expected exactly one fileheader. Was: {}"
@@ -213,9 +313,9 @@ class dlis(object):
         """ Return all objects that are unknown to dlisio. I.e. vendor-specific
         objects. """
         return (obj
-            for typename, object_set in self.indexedobjects.items()
-            for obj in object_set.values()
+            for typename in self.typenames()
             if typename not in self.types
+            for obj in self.objectsof(typename).values()
         )
 
 
@@ -305,9 +405,9 @@ class dlis(object):
 
         objs = {}
         ctype = compileregex(type)
-        for key, value in self.indexedobjects.items():
+        for key in self.typenames():
             if not re.match(ctype, key): continue
-            objs.update(value)
+            objs.update(self.objectsof(key))
 
         cpattern = compileregex(pattern)
         for obj in objs.values():
@@ -363,7 +463,7 @@ class dlis(object):
         else:
             fingerprint = core.fingerprint(type, name, origin, copynr)
             try:
-                return self.indexedobjects[type][fingerprint]
+                return self.objectsof(type)[fingerprint]
             except KeyError:
                 msg = "Object {}.{}.{} of type {} is not found"
                 raise ValueError(msg.format(name, origin, copynr, type))
@@ -437,6 +537,46 @@ class dlis(object):
         live-patching of features so that dlisio is useful, even when something
         in particular is not merged upstream.
 
+        """
+        if sets is None:
+            if self.attic is None:
+                self.attic = self.file.extract_batch(self.explicit_indices,
+                                                     encrypted = False)
+            # the flat sets have the same interface as the raw object sets,
+            # but are a lot cheaper to parse
+            with self.counters:
+                if self.filter is None:
+                    sets = core.parse_flat_objects(self.attic)
+                else:
+                    sets = core.parse_flat_objects(self.attic, self.filter)
+
+        with timer(self.timers, 'create'):
+            objects, problematic = self.create(sets)
+
+        indexedobjects = defaultdict(dict)
+        for fingerprint, obj in objects.items():
+            indexedobjects[obj.type][fingerprint] = obj
+
+        with timer(self.timers, 'link'):
+            for obj in objects.values():
+                obj.link(objects)
+
+        self.unparsed = {}
+        self.indexedobjects = indexedobjects
+        self.problematic = problematic
+        return self
+
+    def create(self, sets):
+        """ Create python objects from raw object sets
+
+        Returns
+        -------
+
+        objects : dict
+            fingerprint -> object
+
+        problematic : list
+            pairs of objects with the same fingerprint, but different content
         """
         problem = 'multiple distinct objects '
         where = 'in set {} ({}). Duplicate fingerprint = {}'
@@ -444,12 +584,8 @@ class dlis(object):
         duplicate = 'duplicate fingerprint {}'
 
         objects = {}
-        indexedobjects = defaultdict(dict)
         problematic = []
 
-        if sets is None:
-            sets = self.raw_objectsets()
-
         for os in sets:
             # TODO: handle replacement sets
             for name, o in os.objects.items():
@@ -471,15 +607,86 @@ class dlis(object):
                         problematic.append((original, obj))
 
                 objects[fingerprint] = obj
-                indexedobjects[obj.type][fingerprint] = obj
 
-        for obj in objects.values():
-            obj.link(objects)
+        return objects, problematic
 
-        self.indexedobjects = indexedobjects
-        self.problematic = problematic
+    def defer(self):
+        """ Defer parsing of object sets until they are accessed
+
+        Only the type of every object set is read, and the sets are parsed,
+        created and linked by type, the first time objects of that type are
+        accessed through the logical file.
+
+        Notes
+        -----
+        Objects of different types reference each other, and linking an object
+        loads the types it references. Objects that are never accessed, or
+        referenced by accessed objects, are never parsed at all.
+        """
+        if self.attic is None:
+            self.attic = self.file.extract_batch(self.explicit_indices,
+                                                 encrypted = False)
+
+        unparsed = defaultdict(list)
+        for rec, settype in zip(self.attic, core.set_types(self.attic)):
+            # encrypted records are skipped, just like parse_objects does
+            if settype is None: continue
+            # sets of types not selected by the filter are never parsed
+            if self.filter and self.filter.types:
+                if settype not in self.filter.types: continue
+            unparsed[settype].append(rec)
+
+        self.unparsed = dict(unparsed)
+        self.indexedobjects = defaultdict(dict)
+        self.problematic = []
         return self
 
+    def typenames(self):
+        """ All object-types in the logical file, loaded or not """
+        types = list(self._indexedobjects.keys())
+        return types + [t for t in self.unparsed if t not in types]
+
+    def objectsof(self, type):
+        """ All objects of type, as a dict of fingerprint -> object
+
+        For lazily loaded files, this parses the object sets of this type first,
+        if they're not already parsed
+        """
+        self.loadtypes([type])
+        return self._indexedobjects[type]
+
+    def loadtypes(self, types):
+        """ Parse, create and link the deferred object sets of types """
+        types = [t for t in types if t in self.unparsed]
+        if not types: return
+
+        records = []
+        for t in types:
+            records.extend(self.unparsed.pop(t))
+
+        with self.counters:
+            if self.filter is None:
+                sets = core.parse_flat_objects(records)
+            else:
+                sets = core.parse_flat_objects(records, self.filter)
+
+        with timer(self.timers, 'create'):
+            objects, problematic = self.create(sets)
+
+        for fingerprint, obj in objects.items():
+            self._indexedobjects[obj.type][fingerprint] = obj
+        self.problematic.extend(problematic)
+
+        # linking loads the referenced types, so for lazily loaded files the
+        # link time includes creating (and linking) the referenced types
+        pool = lazypool(self)
+        with timer(self.timers, 'link'):
+            for obj in objects.values():
+                obj.link(pool)
+
+        for t in types:
+            self.loadtypes(self.backlinks.get(t, []))
+
     def storage_label(self):
         """Return the storage label of the physical file
 
@@ -491,6 +698,33 @@ class dlis(object):
         blob = self.file.get(bytearray(80), self.sul_offset, 80)
         return core.storage_label(blob)
 
+    def encrypted_records(self):
+        """ The encrypted records of the logical file
+
+        Encrypted records can't be parsed, so load only reads their headers,
+        and the bodies are never read. This reports where the records are, and
+        how large they are, e.g. to audit what the file holds that dlisio
+        can't read.
+
+        Returns
+        -------
+        records : list of dlisio.core.record_extent
+            The index, tell, size (in bytes, headers included) and type of
+            every encrypted explicitly formatted record, in file order
+
+        Examples
+        --------
+
+        >>> sum(rec.size for rec in f.encrypted_records())
+        4096
+        """
+        if self.attic is None:
+            self.attic = self.file.extract_batch(self.explicit_indices,
+                                                 encrypted = False)
+
+        indices = zip(self.explicit_indices, self.attic.encrypted)
+        return [self.file.extent(i) for i, encrypted in indices if encrypted]
+
     def raw_objectsets(self):
         """ Return the objects as represented on disk
 
@@ -505,13 +739,61 @@ class dlis(object):
         types. If they are of interest, the preferred way of accessing them is
         through the attic attribute of this class, or the attic attribute of
         the rich objects.
+
+        The parsed objects are kept in the cache, so repeated calls return
+        the same (read-only) objects without parsing again, in a new list.
         """
+        key = (None, 'objectsets')
+        sets = self.cache.get(key)
+        if sets is not None: return list(sets)
+
         if self.attic is None:
-            self.attic = self.file.extract(self.explicit_indices)
+            self.attic = self.file.extract_batch(self.explicit_indices,
+                                                 encrypted = False)
+
+        with self.counters:
+            sets = core.parse_objects(self.attic)
+
+        self.cache.put(key, tuple(sets), self.attic.nbytes)
+        return sets
+
+@contextmanager
+def timer(timers, name):
+    """ For internal use.
+    Add the time spent in the with-block, and a call, to timers[name]. The
+    phases are re-entered when linking lazily loaded files, and only the
+    outermost block of a phase is counted.
+    """
+    entry = timers.setdefault(name, [0.0, 0, 0])
+    entry[2] += 1
+    start = time.perf_counter()
+    try:
+        yield
+    finally:
+        entry[2] -= 1
+        if entry[2] == 0:
+            entry[0] += time.perf_counter() - start
+            entry[1] += 1
+
+class lazypool(object):
+    """ Object pool for linking objects of lazily loaded files
+
+    Looking up a fingerprint loads the objects of the type that the
+    fingerprint refers to, which may be any type in the file.
+    """
+    def __init__(self, f):
+        self.f = f
 
-        return core.parse_objects(self.attic)
+    def __getitem__(self, fingerprint):
+        for t in self.f.typenames():
+            if fingerprint.startswith('T.{}-I.'.format(t)):
+                objects = self.f.objectsof(t)
+                if fingerprint in objects:
+                    return objects[fingerprint]
 
-def open(path):
+        raise KeyError(fingerprint)
+
+def open(path, mapped = False):
     """ Open a file
 
     Open a low-level file handle. This is not intended for end-users - rather,
@@ -520,6 +802,9 @@ def open(path):
     Parameters
     ----------
     path : str_like
+    mapped : bool
+        Memory-map the file, and read records directly from the mapping
+        instead of through a regular file handle
 
     Returns
     -------
@@ -529,9 +814,28 @@ def open(path):
     --------
     dlisio.load
     """
-    return core.stream(str(path))
+    return core.stream(str(path), mapped = mapped)
+
+def objectfilter(types = None, names = None):
+    """ The core.object_filter of types and names, see load
+
+    Returns None when everything is selected, which is cheaper than a filter
+    that selects everything, as it is not consulted at all.
+    """
+    if types is None and names is None: return None
+
+    pattern = ''
+    if names is None:
+        names = []
+    elif isinstance(names, str):
+        pattern, names = names, []
+    else:
+        names = list(names)
 
-def load(path):
+    # an invalid pattern raises ValueError
+    return core.object_filter(list(types or []), names, pattern)
+
+def load(path, index = None, lazy = False, types = None, names = None):
     """ Loads a file and returns one filehandle pr logical file.
 
     The dlis standard have a concept of logical files. A logical file is a
@@ -558,6 +862,39 @@ def load(path):
 
     path : str_like
 
+    index : str_like, optional
+        Path to an index sidecar file. Loading a file requires scanning all of
+        it, which is slow for large files. If the sidecar exists and was made
+        from this very file, the scan is skipped and the index is read from the
+        sidecar instead. Otherwise the file is scanned as usual, and the index
+        is written to the sidecar for the next time.
+
+    lazy : bool, optional
+        Defer parsing of objects until they are accessed. By default, all the
+        objects in the file are parsed by load. With lazy, objects are parsed
+        by type the first time objects of that type are accessed, which is
+        much faster when only a few of the types are needed.
+
+    types : list of str, optional
+        Only load objects of these types, e.g. ['CHANNEL', 'FRAME']. Object
+        sets of other types are skipped without being parsed, and the objects
+        are not in the logical files at all. Objects may refer to objects that
+        are not loaded, and such references are not resolved, just like
+        references to objects that are missing from the file.
+
+    names : str or list of str, optional
+        Only load objects with these names. A str is a regular expression,
+        which like dlis.match is matched from the start of the name and is not
+        case-sensitive, a list is the exact names. Objects with other names are
+        stepped over without decoding their attributes.
+
+        The regular expression is matched by the C++ standard library, with
+        the ECMAScript (javascript) syntax, and not by python's re like in
+        dlis.match. The common syntax, e.g. '.', '*', '|', character classes
+        and groups, is the same, but python-only syntax like named groups
+        (?P<name>...) and inline flags like (?i) is an error, or means
+        something else.
+
     Examples
     --------
 
@@ -580,47 +917,102 @@ def load(path):
     to be stored in tail. Use len(tail) to check how many extra logical files
     there are.
 
+    Keep the index next to the file, so that subsequent loads don't have to
+    scan it
+
+    >>> with dlisio.load(filename, index = filename + '.idx') as files:
+    ...     pass
+
+    Only parse the objects that are actually used
+
+    >>> with dlisio.load(filename, lazy = True) as (f, *tail):
+    ...     channels = f.channels
+
+    Only load the channels and frames, or only the depth channels
+
+    >>> with dlisio.load(filename, types = ['CHANNEL', 'FRAME']) as files:
+    ...     pass
+    >>> with dlisio.load(filename, types = ['CHANNEL'],
+    ...                  names = 'DEPT|TDEP') as files:
+    ...     pass
+
     Returns
     -------
 
     dlis : tuple(dlisio.dlis)
     """
+    start = time.perf_counter()
     path = str(path)
+    counters = core.stats()
+    selection = objectfilter(types, names)
+
+    # The file is mapped once, and the mapping is shared by the index and the
+    # streams of all the logical files
+    source = core.source(path)
+    mmap = source.mmap
+
+    cached = None
+    if index is not None:
+        index = str(index)
+        key = indexcache.filekey(path)
+        cached = indexcache.read(index, key)
+
+    if cached is not None:
+        sulpos    = cached.sulpos
+        vrlpos    = cached.vrlpos
+        tells     = cached.tells
+        residuals = cached.residuals
+        explicits = cached.explicits
+    else:
+        with counters:
+            sulpos = core.findsul(mmap)
+            vrlpos = core.findvrl(mmap, sulpos + 80)
+            threads = os.cpu_count() or 1
+            tells, residuals, explicits = core.findoffsets(mmap,
+                                                           vrlpos,
+                                                           threads)
 
-    mmap = core.mmap_source()
-    mmap.map(path)
-
-    sulpos = core.findsul(mmap)
-    vrlpos = core.findvrl(mmap, sulpos + 80)
-
-    tells, residuals, explicits = core.findoffsets(mmap, vrlpos)
     exi = [i for i, explicit in enumerate(explicits) if explicit != 0]
 
+    # Encrypted records are never parsed, so only their headers are read, and
+    # their bodies are left on disk, see dlis.encrypted_records
+    stream = core.stream(source)
     try:
-        stream = open(path)
         stream.reindex(tells, residuals)
-
-        records = stream.extract(exi)
+        records = stream.extract_batch(exi, encrypted = False)
+        counters.merge(stream.stats)
+    finally:
         stream.close()
-    except:
-        stream.close()
-        raise
 
     split_at = find_fileheaders(records, exi)
+    parts = list(partition(records, explicits, tells, residuals, split_at))
+
+    fdata = None
+    if cached is not None and len(cached.fdata) == len(parts):
+        fdata = cached.fdata
 
+    found = []
     batch = []
-    for part in partition(records, explicits, tells, residuals, split_at):
+    for n, part in enumerate(parts):
+        stream = core.stream(source)
         try:
-            stream = open(path)
             stream.reindex(part['tells'], part['residuals'])
 
-            implicits = defaultdict(list)
-            for key, val in core.findfdata(mmap,
-                    part['implicits'], part['tells'], part['residuals']):
-                implicits[key].append(val)
+            partstats = core.stats()
+            partstats.merge(counters)
+            if fdata is not None:
+                groups = fdata[n]
+            else:
+                with partstats:
+                    groups = findfdata(mmap,
+                        part['implicits'], part['tells'], part['residuals'])
+            found.append(groups)
+
+            implicits = defaultdict(noindices, groups)
 
             f = dlis(stream, part['explicits'],
-                    part['records'], implicits, sul_offset=sulpos)
+                    part['records'], implicits, sul_offset=sulpos,
+                    lazy=lazy, stats=partstats, filter=selection)
             batch.append(f)
         except:
             stream.close()
@@ -628,8 +1020,428 @@ def load(path):
                 stream.close()
             raise
 
+    if index is not None and fdata is None:
+        idx = indexcache.Index(sulpos, vrlpos,
+                               tells, residuals, explicits,
+                               found)
+        try:
+            indexcache.write(index, key, idx)
+        except (IOError, OSError) as e:
+            msg = 'unable to write index to {}: {}'
+            logging.warning(msg.format(index, e))
+
+    elapsed = time.perf_counter() - start
+    for f in batch:
+        f.timers['load'] = [elapsed, 1, 0]
+
     return Batch(batch)
 
+def load_many(paths, lazy = False, threads = None):
+    """ Loads many files, and returns one filehandle pr logical file
+
+    Like dlisio.load, but for many physical files at once, e.g. all the files
+    of a well. The files are indexed, and their objects parsed, concurrently
+    by up to threads threads, so loading a directory of files takes time
+    proportional to its size divided by the number of threads, rather than
+    to the number of files.
+
+    The paths are assumed to be ordered like the physical files of the
+    storage set. A logical file can span multiple physical files, in which
+    case the FILE-HEADER is not repeated. When a physical file does not start
+    with a FILE-HEADER, its first logical file is a continuation of the last
+    logical file of the previous path, and the two are returned as a single
+    logical file.
+
+    Parameters
+    ----------
+
+    paths : iterable of str_like
+
+    lazy : bool, optional
+        Defer parsing of objects until they are accessed, see dlisio.load
+
+    threads : int, optional
+        Number of threads to load with. Defaults to the number of CPUs
+
+    Examples
+    --------
+
+    Load all the files in a directory
+
+    >>> paths = sorted(glob.glob('well/*.dlis'))
+    >>> with dlisio.load_many(paths) as files:
+    ...     for f in files:
+    ...         header = f.fileheader
+
+    Returns
+    -------
+
+    dlis : tuple(dlisio.dlis)
+
+    See Also
+    --------
+    dlisio.load
+    """
+    start = time.perf_counter()
+    paths = [str(path) for path in paths]
+    if threads is None: threads = os.cpu_count() or 1
+    threads = max(1, min(threads, len(paths)))
+
+    with ThreadPoolExecutor(max_workers = threads) as pool:
+        scans = list(pool.map(scan, paths))
+
+        # Every physical file holds at least one (maybe partial) logical file,
+        # and a partial logical file at the start of a physical file continues
+        # the last logical file of the previous one
+        pieces = []
+        for n, s in enumerate(scans):
+            segmented = n > 0 and s['segmented']
+            split_at = find_fileheaders(s['records'], s['exi'], segmented)
+            parts = partition(s['records'],
+                              s['explicits'],
+                              s['tells'],
+                              s['residuals'],
+                              split_at)
+
+            for k, part in enumerate(parts):
+                if k == 0 and segmented:
+                    pieces[-1].append((s, part))
+                else:
+                    pieces.append([(s, part)])
+
+        # Wait for every logical file, also when some fail, so the streams of
+        # the ones that were opened can be closed before re-raising
+        futures = [pool.submit(assemble_logical_file, xs, lazy)
+                   for xs in pieces]
+        logical, error = [], None
+        for future in futures:
+            try:
+                logical.append(future.result())
+            except BaseException as e:
+                if error is None: error = e
+
+    if error is not None:
+        for stream, *_ in logical:
+            stream.close()
+        raise error
+
+    batch = []
+    try:
+        for stream, explicits, records, groups, sul_offset, sets, stats \
+                in logical:
+            implicits = defaultdict(noindices, groups)
+
+            f = dlis(stream, explicits, records, implicits,
+                     sul_offset = sul_offset, lazy = lazy, sets = sets,
+                     stats = stats)
+            batch.append(f)
+    except:
+        for stream, *_ in logical:
+            stream.close()
+        raise
+
+    elapsed = time.perf_counter() - start
+    for f in batch:
+        f.timers['load'] = [elapsed, 1, 0]
+
+    return Batch(batch)
+
+class follow(object):
+    """ Follow a file that is still being written
+
+    During acquisition, a file grows while logging continues, and re-loading
+    it with dlisio.load re-scans the whole file every time. A follow handle
+    instead keeps the index of the file, and refresh re-maps the file and only
+    indexes the bytes appended since the last refresh, so refreshing takes
+    time proportional to the new data, not the size of the file.
+
+    The last record is usually only partially written, which is not an error.
+    It is left out of the index, and picked up by the refresh after the rest
+    of it is written.
+
+    New objects, e.g. a new FRAME, are added to their logical file, and a new
+    FILE-HEADER starts a new logical file. References to objects that are not
+    written yet are logged as missing, and linked when the objects arrive.
+
+    Parameters
+    ----------
+
+    path : str_like
+
+    lazy : bool, optional
+        Defer parsing of objects until they are accessed, see dlisio.load
+
+    Attributes
+    ----------
+
+    files : list of dlisio.dlis
+        The logical files found so far
+
+    Examples
+    --------
+
+    Poll a file, and process the new samples as they arrive
+
+    >>> with dlisio.follow(path) as live:
+    ...     while logging:
+    ...         for frame, records in live.refresh().items():
+    ...             curves = frame.curves(records = records)
+    ...         time.sleep(5)
+    """
+    def __init__(self, path, lazy = False):
+        self.path = str(path)
+        self.lazy = lazy
+        self.files = []
+        self.counters = core.stats()
+
+        source = core.source(self.path)
+        with self.counters:
+            self.sulpos = core.findsul(source.mmap)
+            vrlpos = core.findvrl(source.mmap, self.sulpos + 80)
+
+        self.index = core.tail_index(self.path, vrlpos)
+        # all the logical files read from the same stream, with record
+        # indices into the whole file
+        self.stream = core.stream(source)
+        try:
+            self.refresh()
+        except:
+            self.stream.close()
+            raise
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, type, value, traceback):
+        self.close()
+
+    def close(self):
+        """ Close the file handle """
+        self.stream.close()
+
+    @property
+    def partial(self):
+        """ True if the last record is only partially written """
+        return self.index.partial
+
+    @property
+    def stats(self):
+        """ Counters and timings of the refreshes, see dlis.stats """
+        return self.counters.asdict()
+
+    def refresh(self):
+        """ Index the records appended since the last refresh
+
+        Returns
+        -------
+
+        records : dict of Frame -> np.ndarray of int32
+            The new FDATA records of every frame, which can be read with
+            Frame.curves(records = ...)
+        """
+        with self.counters:
+            tells, residuals, explicits = self.index.refresh()
+        if not tells: return {}
+
+        base = len(self.index) - len(tells)
+        self.stream.remap()
+        self.stream.extend(tells, residuals)
+
+        exi = [i for i, explicit in enumerate(explicits) if explicit != 0]
+        indices = [base + i for i in exi]
+        records = self.stream.extract_batch(indices, encrypted = False)
+
+        # split the new records in runs that belong to the same logical file,
+        # which are (file, explicits, explicit records, implicits), where file
+        # is None for new logical files
+        current = self.files[-1] if self.files else None
+        runs = [[current, [], [], []]]
+        types = records.types
+        k = 0
+        for i, explicit in enumerate(explicits):
+            if explicit == 0:
+                runs[-1][3].append(i)
+                continue
+
+            f, exis, _, implicits = runs[-1]
+            started = f is not None or exis or implicits
+            if types[k] == 0 and started:
+                runs.append([None, [], [], []])
+
+            runs[-1][1].append(base + i)
+            runs[-1][2].append(records[k])
+            k += 1
+
+        appended = defaultdict(list)
+        for f, exis, recs, implicits in runs:
+            if f is None and not exis: continue
+
+            if f is None:
+                f = dlis(self.stream, exis, None, defaultdict(noindices),
+                         sul_offset = self.sulpos, lazy = True)
+                self.files.append(f)
+                if not self.lazy: f.loadtypes(list(f.unparsed.keys()))
+            elif recs:
+                f.explicit_indices.extend(exis)
+                f.attic = None
+                f.cache.invalidate(None)
+                for rec, settype in zip(recs, core.set_types(recs)):
+                    if settype is None: continue
+                    f.unparsed.setdefault(settype, []).append(rec)
+
+                if not self.lazy: f.loadtypes(list(f.unparsed.keys()))
+                relink(f)
+
+            with self.counters:
+                groups = findfdata(self.index.file,
+                                   implicits,
+                                   tells,
+                                   residuals)
+
+            for fingerprint, indices in groups:
+                indices = indices + np.int32(base)
+                f.fdata_index[fingerprint] = np.concatenate(
+                    (f.fdata_index[fingerprint], indices)
+                )
+                appended[(f, fingerprint)].append(indices)
+
+        frames = {}
+        for (f, fingerprint), indices in appended.items():
+            indices = np.concatenate(indices)
+            # the cached curves and records of the frame are incomplete
+            f.cache.invalidate(fingerprint)
+            frame = f.objectsof('FRAME').get(fingerprint)
+            if frame is None: continue
+            # the sparse index of the frame does not cover the new records
+            frame._sparseindex = None
+            frames[frame] = indices
+
+        return frames
+
+def relink(f):
+    """ For internal use.
+    Link all the loaded objects of f again, e.g. after new objects are added
+    """
+    pool = lazypool(f)
+    for objects in list(f._indexedobjects.values()):
+        for obj in list(objects.values()):
+            obj.link(pool)
+
+def scan(path):
+    """ For internal use.
+    Index the physical file at path, and extract its explicit records
+    """
+    source = core.source(path)
+    mmap = source.mmap
+
+    counters = core.stats()
+    with counters:
+        sulpos = core.findsul(mmap)
+        vrlpos = core.findvrl(mmap, sulpos + 80)
+        tells, residuals, explicits = core.findoffsets(mmap, vrlpos)
+    exi = [i for i, explicit in enumerate(explicits) if explicit != 0]
+
+    # Encrypted records are never parsed, so only their headers are read, and
+    # their bodies are left on disk, see dlis.encrypted_records
+    stream = core.stream(source)
+    try:
+        stream.reindex(tells, residuals)
+        records = stream.extract_batch(exi, encrypted = False)
+        counters.merge(stream.stats)
+    finally:
+        stream.close()
+
+    return {
+        'path'      : path,
+        'source'    : source,
+        'mmap'      : mmap,
+        'sulpos'    : sulpos,
+        'tells'     : tells,
+        'residuals' : residuals,
+        'explicits' : explicits,
+        'exi'       : exi,
+        'records'   : records,
+        # The first record is not a FILE-HEADER, so the first logical file is
+        # (probably) segmented across this and the previous physical file
+        'segmented' : len(records) == 0 or records.types[0] != 0,
+        'stats'     : counters,
+    }
+
+def findfdata(mmap, candidates, tells, residuals):
+    """ For internal use.
+    The FDATA among candidates, as (fingerprint, record indices) of every
+    frame, see core.groupfdata. The records are grouped in the extension, and
+    the indices are int32 arrays over the groups, so no python objects are
+    made per record.
+    """
+    groups = core.groupfdata(mmap, candidates, tells, residuals)
+    return [(g.fingerprint, np.frombuffer(g, dtype = np.int32))
+            for g in groups]
+
+def noindices():
+    """ For internal use.
+    The FDATA records of a frame without any, for dlis.fdata_index
+    """
+    return np.empty(0, dtype = np.int32)
+
+def assemble_logical_file(pieces, lazy):
+    """ For internal use.
+    Open the stream of a logical file made up of pieces, which are (scan,
+    partition) pairs of the physical files it spans, and find its FDATA.
+    Unless lazy, the objects are parsed too.
+    """
+    counters = core.stats()
+    for s, _ in pieces:
+        counters.merge(s['stats'])
+
+    if len(pieces) == 1:
+        s, part = pieces[0]
+        tells = part['tells']
+        residuals = part['residuals']
+        explicits = part['explicits']
+        records = part['records']
+        with counters:
+            groups = findfdata(s['mmap'],
+                part['implicits'], part['tells'], part['residuals'])
+        stream = core.stream(s['source'])
+    else:
+        # The physical files are laid out back-to-back in the stream, so the
+        # tells of every file are shifted by the offset of the file
+        stream = core.stream([s['source'] for s, _ in pieces])
+        tells, residuals, explicits = [], [], []
+        merged = OrderedDict()
+        try:
+            for (s, part), offset in zip(pieces, stream.offsets):
+                first = len(tells)
+                with counters:
+                    found = findfdata(s['mmap'],
+                        part['implicits'], part['tells'], part['residuals'])
+
+                tells.extend(tell + offset for tell in part['tells'])
+                residuals.extend(part['residuals'])
+                explicits.extend(i + first for i in part['explicits'])
+                for fingerprint, indices in found:
+                    xs = merged.setdefault(fingerprint, [])
+                    xs.append(indices + np.int32(first))
+        except:
+            stream.close()
+            raise
+        groups = [(fp, np.concatenate(xs)) for fp, xs in merged.items()]
+        records = None
+
+    try:
+        stream.reindex(tells, residuals)
+        if records is None:
+            records = stream.extract_batch(explicits, encrypted = False)
+        with counters:
+            sets = None if lazy else core.parse_flat_objects(records)
+    except:
+        stream.close()
+        raise
+
+    sul_offset = pieces[0][0]['sulpos']
+    return stream, explicits, records, groups, sul_offset, sets, counters
+
 class Batch(tuple):
     def __enter__(self):
         return self
@@ -661,12 +1473,14 @@ class Batch(tuple):
         return plumbing.Summary(info=buf.getvalue())
 
 
-def find_fileheaders(records, exi):
+def find_fileheaders(records, exi, segmented = False):
     # Logical files start whenever a FILE-HEADER is encountered. When a logical
     # file spans multiple physical files, the FILE-HEADER is not repeated.
     # This means that the first record may not be a FILE-HEADER. In that case
     # dlisio still creates a logical file, but warns that this logical file
-    # might be segmented, hence missing data.
+    # might be segmented, hence missing data. If the logical file is known to
+    # be segmented, i.e. it is stitched together with the previous physical
+    # file by load_many, there is nothing to warn about.
     msg =  'First logical file does not contain a fileheader. '
     msg += 'The logical file might be segmented into multiple physical files '
     msg += 'and data can be missing.'
@@ -678,16 +1492,16 @@ def find_fileheaders(records, exi):
     if not records:
         pivots.append(0)
 
-    for i, rec in enumerate(records):
+    # records is a core.record_batch, and the types can be read without
+    # copying out every record
+    for i, rectype in enumerate(records.types):
         # The first metadata record is not a file-header. The logical file
         # might be segmented.
-        #TODO: This logic will change when support for multiple physical files
-        # in a storage set is added
-        if i == 0 and rec.type != 0:
-            logging.warning(msg)
+        if i == 0 and rectype != 0:
+            if not segmented: logging.warning(msg)
             pivots.append(exi[i])
 
-        if rec.type == 0:
+        if rectype == 0:
             pivots.append(exi[i])
 
     return pivots
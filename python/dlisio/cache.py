@@ -0,0 +1,162 @@
+"""
+Size-bounded cache of decoded curves and extracted records
+
+Interactive use tends to read the same curves over and over, and every
+Channel.curves() or Frame.curves() call reads every FDATA record of the frame
+from the file, and decodes it. Every logical file has a cache (dlis.cache)
+that keeps the extracted FDATA records of a frame, and the curves decoded
+from them, until they are evicted to stay within the byte budget. Repeated
+reads then cost no I/O and no decoding, and reading the sibling channels of a
+cached frame costs no I/O, and only decodes the channel.
+
+Entries are evicted in least-recently-used order. Only reads of all the
+records of a frame are cached, i.e. not range or records queries.
+
+The cache is safe to use from many threads, e.g. when curves of the same file
+are read concurrently. The values are shared by everyone who gets them, and
+must not be modified.
+"""
+
+from collections import OrderedDict
+import threading
+
+# The default byte budget of the cache of every logical file
+BUDGET = 128 * 1024 * 1024
+
+class Cache(object):
+    """ LRU cache with a byte budget
+
+    Every entry is keyed by a tuple where the first element is the owner,
+    typically the fingerprint of a frame, so that all the entries of the owner
+    can be discarded at once.
+
+    Attributes
+    ----------
+
+    budget : int
+        Maximum number of bytes held by the cache. Setting it evicts entries
+        until the cache is within the new budget. A budget of 0 disables the
+        cache, i.e. nothing is cached, not even values of 0 bytes.
+
+    nbytes : int
+        Number of bytes currently held
+
+    hits, misses, evictions : int
+        Number of lookups that found an entry, lookups that did not, and
+        entries evicted to make room for others
+    """
+    def __init__(self, budget = None):
+        self.lock = threading.RLock()
+        self.entries = OrderedDict()
+        self.nbytes = 0
+        self.hits = 0
+        self.misses = 0
+        self.evictions = 0
+        self._budget = BUDGET if budget is None else budget
+
+    def __len__(self):
+        return len(self.entries)
+
+    def __contains__(self, key):
+        with self.lock:
+            return key in self.entries
+
+    @property
+    def budget(self):
+        return self._budget
+
+    @budget.setter
+    def budget(self, value):
+        if value < 0:
+            raise ValueError('budget must be >= 0, was {}'.format(value))
+        with self.lock:
+            self._budget = value
+            self.shrink(value)
+
+    def get(self, key):
+        """ The value of key, or None if it is not cached """
+        with self.lock:
+            entry = self.entries.get(key)
+            if entry is None:
+                self.misses += 1
+                return None
+
+            self.hits += 1
+            self.entries.move_to_end(key)
+            return entry[0]
+
+    def put(self, key, value, nbytes):
+        """ Cache value, which holds nbytes bytes, under key
+
+        Values larger than the budget are not cached at all, instead of
+        evicting everything else to make room for them.
+
+        Returns
+        -------
+        cached : bool
+        """
+        with self.lock:
+            if not self.fits(nbytes): return False
+
+            self.discard(key)
+            self.shrink(self._budget - nbytes)
+            self.entries[key] = (value, nbytes)
+            self.nbytes += nbytes
+            return True
+
+    def fits(self, nbytes):
+        """ True if a value of nbytes bytes would be cached by put """
+        return self._budget > 0 and nbytes <= self._budget
+
+    def discard(self, key):
+        """ Remove key, if it is cached """
+        with self.lock:
+            entry = self.entries.pop(key, None)
+            if entry is not None: self.nbytes -= entry[1]
+
+    def invalidate(self, owner):
+        """ Remove all entries of owner, e.g. when the records of a frame
+        change
+        """
+        with self.lock:
+            for key in [k for k in self.entries if k[0] == owner]:
+                self.discard(key)
+
+    def shrink(self, nbytes):
+        """ Evict the least recently used entries until at most nbytes are
+        held
+        """
+        with self.lock:
+            while self.entries and self.nbytes > nbytes:
+                _, (_, size) = self.entries.popitem(last = False)
+                self.nbytes -= size
+                self.evictions += 1
+
+    def clear(self):
+        """ Remove all entries. The statistics are kept """
+        with self.lock:
+            self.entries.clear()
+            self.nbytes = 0
+
+    @property
+    def stats(self):
+        """ The number of entries and bytes held, the budget, and the hits,
+        misses and evictions
+
+        Returns
+        -------
+        stats : dict
+        """
+        with self.lock:
+            return {
+                'entries'   : len(self.entries),
+                'bytes'     : self.nbytes,
+                'budget'    : self._budget,
+                'hits'      : self.hits,
+                'misses'    : self.misses,
+                'evictions' : self.evictions,
+            }
+
+    def __repr__(self):
+        msg = 'Cache(entries: {}, bytes: {}, budget: {})'
+        return msg.format(len(self.entries), self.nbytes, self._budget)
@@ -2,16 +2,571 @@
 Supporing methods for dlis class.
 Are moved into separate file in order not to clutter interface
 """
+from collections import OrderedDict
+import os
+
 import numpy as np
 from . import core
+from . import reprc
 
-def curves(dlis, frame, dtype, pre_fmt, fmt, post_fmt):
+def curves(dlis, frame, dtype, pre_fmt, fmt, post_fmt, threads = None,
+           indices = None):
     """ For internal use.
     Reads curves for provided frame and position defined by frame format:
     pre_fmt (to skip), fmt (to read), post_fmt (to skip)
+
+    threads is the number of threads to read with. By default, use one thread
+    per CPU, but don't bother spinning up threads for small frames - FDATA
+    records are usually only a few hundred bytes, and starting a thread costs
+    more than decoding a few thousand of them
+
+    Files that are not memory-mapped are always decoded by a single thread,
+    whatever threads is, while the records are read ahead in the background
+
+    indices are the records to read, and defaults to all the FDATA records of
+    the frame
+
+    The output has one row per frame, also when some records hold more than
+    one, see fdata_plan
     """
-    indices = dlis.fdata_index[frame.fingerprint]
-    #note: shape is wrong for multiple data in one frame
-    a = np.empty(shape = len(indices), dtype = dtype)
-    core.read_fdata(pre_fmt, fmt, post_fmt, dlis.file, indices, a)
+    if indices is not None:
+        if threads is None: threads = readthreads(len(indices))
+        def decode(a, plan):
+            core.read_fdata(pre_fmt, fmt, post_fmt, dlis.file, indices, a,
+                            threads, plan)
+        return planned(dlis, frame, dtype, decode, indices)
+
+    def read(source, a, threads, plan):
+        core.read_fdata(pre_fmt, fmt, post_fmt, *source, a, threads, plan)
+
+    key = ('curves', pre_fmt, fmt, post_fmt, dtype)
+    return cached(dlis, frame, key, dtype, read, threads)
+
+def columns(dlis, frame, dtype, fmts, selected, threads = None,
+            indices = None):
+    """ For internal use.
+    Reads the curves of a subset of the channels in provided frame. fmts is the
+    format string of every channel in the frame, and selected the (increasing)
+    positions of the channels to read. Only the selected channels are decoded,
+    and the bytes of the others are skipped without scanning them, as long as
+    they are fixed-width.
+
+    See curves
+    """
+    if indices is not None:
+        if threads is None: threads = readthreads(len(indices))
+        def decode(a, plan):
+            core.read_fdata_columns(fmts, selected, dlis.file, indices, a,
+                                    threads, plan)
+        return planned(dlis, frame, dtype, decode, indices)
+
+    def read(source, a, threads, plan):
+        core.read_fdata_columns(fmts, selected, *source, a, threads, plan)
+
+    key = ('columns', tuple(fmts), tuple(selected), dtype)
+    return cached(dlis, frame, key, dtype, read, threads)
+
+def fdata_plan(dlis, frame, indices = None):
+    """ For internal use.
+    The row plan (see core.fdata_plan) of the FDATA records of frame, or of
+    the records at indices, or None if every record holds exactly one frame.
+
+    The frames in a record are counted without decoding them, but it still
+    takes a pass over the records, so the plan of all the records of a frame is
+    kept in dlis.cache, and the records at indices are only counted if the
+    frame has records with more than one frame. Frames with variable-sized
+    values (e.g. strings) can not be counted without decoding them, and are
+    assumed to have one frame per record.
+
+    Most files have one frame per record, so the records are usually not
+    planned up front, see planned.
+    """
+    key = (frame.fingerprint, 'plan')
+    if key in dlis.cache:
+        plan = dlis.cache.get(key)
+    else:
+        try:
+            records = dlis.fdata_index[frame.fingerprint]
+            plan = core.plan_fdata(dlis.file, records, frame.fmtstr())
+        except ValueError:
+            plan = None
+
+        if plan is not None and plan.uniform: plan = None
+        dlis.cache.put(key, plan, 0 if plan is None else plan.nbytes)
+
+    if plan is None or indices is None: return plan
+    return core.plan_fdata(dlis.file, indices, frame.fmtstr())
+
+def planned(dlis, frame, dtype, read, indices = None):
+    """ For internal use.
+    Decode the FDATA records of frame, or the records at indices, with
+    read(a, plan) into a new array a of dtype, and return a. plan is from
+    fdata_plan.
+
+    Unless the frame is already known to have records with more than one
+    frame, the records are read as if they all hold one, without planning
+    them first. Only if read reports a record with more frames is the frame
+    planned, and the records read again, so files with one frame per record
+    never pay for the extra pass over the records.
+    """
+    records = indices
+    if records is None: records = dlis.fdata_index[frame.fingerprint]
+
+    key = (frame.fingerprint, 'plan')
+    if key in dlis.cache:
+        plan = fdata_plan(dlis, frame, indices)
+    else:
+        a = np.empty(shape = len(records), dtype = dtype)
+        try:
+            read(a, None)
+        except core.MultipleFramesError:
+            plan = fdata_plan(dlis, frame, indices)
+            if plan is None: raise
+        else:
+            if indices is None: dlis.cache.put(key, None, 0)
+            return a
+
+    rows = len(records) if plan is None else plan.rows
+    a = np.empty(shape = rows, dtype = dtype)
+    read(a, plan)
     return a
+
+def fdata_batch(dlis, frame):
+    """ For internal use.
+    All the FDATA records of frame, as a record batch, from dlis.cache. The
+    records are extracted and cached if the cache has room for them, and
+    otherwise None is returned.
+    """
+    cache = dlis.cache
+    key = (frame.fingerprint, 'fdata')
+    batch = cache.get(key)
+    if batch is not None: return batch
+
+    # A record is about the size of the row it decodes into, so use that to
+    # not extract records only to find that they don't fit in the cache
+    indices = dlis.fdata_index[frame.fingerprint]
+    if not cache.fits(len(indices) * frame.dtype.itemsize): return None
+
+    batch = dlis.file.extract_batch(indices)
+    if not cache.put(key, batch, batch.nbytes): return None
+    return batch
+
+def cached(dlis, frame, key, dtype, read, threads = None):
+    """ For internal use.
+    Read curves of all the FDATA records of frame, through dlis.cache. key
+    identifies the curves among the cached entries of the frame, and
+    read(source, a, threads, plan) decodes the records into a, where source is
+    either (batch,) or (stream, indices), and plan is from fdata_plan.
+
+    The cached array is read-only, and never handed out. The curves are
+    always a copy of it, so modifying them does not affect later reads.
+    """
+    cache = dlis.cache
+    key = (frame.fingerprint,) + key
+    a = cache.get(key)
+    if a is not None: return a.copy()
+
+    indices = dlis.fdata_index[frame.fingerprint]
+    if threads is None: threads = readthreads(len(indices))
+
+    batch = None
+    if cache.fits(len(indices) * dtype.itemsize):
+        batch = fdata_batch(dlis, frame)
+
+    def decode(a, plan):
+        if batch is None:
+            read((dlis.file, indices), a, threads, plan)
+            return
+
+        # reading from a batch counts to the current stats, not the stream's
+        with dlis.counters:
+            read((batch,), a, threads, plan)
+
+    a = planned(dlis, frame, dtype, decode)
+    a.flags.writeable = False
+    if not cache.put(key, a, a.nbytes):
+        a.flags.writeable = True
+        return a
+    return a.copy()
+
+def materialize(dlis, frame):
+    """ For internal use.
+    Decode all the channels of frame in a single pass over its records, into
+    one contiguous column per channel, see Frame.materialize.
+
+    The columns are kept in dlis.cache, if they fit, and are read-only, so
+    Frame.materialize hands them out without copying. Channel.curves copies
+    its column, as it returns a writable array.
+    """
+    key = (frame.fingerprint, 'materialized', frame.dtype)
+    if key in dlis.cache: return dlis.cache.get(key)
+
+    indices = dlis.fdata_index[frame.fingerprint]
+    names = frame.dtype.names
+    fmts = [ch.fmtstr() for ch in frame.channels]
+    selected = list(range(len(frame.channels)))
+
+    out = OrderedDict()
+    try:
+        reader = core.column_reader(dlis.file, indices, fmts, selected)
+    except ValueError:
+        # Some channel can't be decoded as a column, e.g. validated floats,
+        # so decode the structured array (still in one pass) and split it
+        a = curves(dlis, frame, frame.dtype, '', frame.fmtstr(), '',
+                   indices = indices)
+        for name in names:
+            out[name] = np.ascontiguousarray(a[name])
+    else:
+        strings = [fmt[:1] in ('s', 'S', 'Q') for fmt in fmts]
+        def read(rows):
+            bufs = [None if isstr else np.empty(shape = rows,
+                                                dtype = ch.dtype)
+                    for ch, isstr in zip(frame.channels, strings)]
+            return reader.read(bufs, rows), bufs
+
+        n, bufs = read(len(indices))
+        if reader.tell() < len(reader):
+            # Some records hold more than one frame, so plan the records to
+            # get the number of rows, and read them all again
+            plan = fdata_plan(dlis, frame)
+            if plan is None:
+                msg = "multiple frames in one FDATA, in frame '{}' with " \
+                      "variable-sized values"
+                raise NotImplementedError(msg.format(frame.name))
+            reader = core.column_reader(dlis.file, indices, fmts, selected)
+            n, bufs = read(plan.rows)
+
+        for k, ch in enumerate(frame.channels):
+            if not strings[k]:
+                out[names[k]] = bufs[k][:n]
+                continue
+
+            offsets, data = reader.strings(k)
+            offsets = np.frombuffer(offsets, dtype = np.int32)
+            if len(offsets) == 0: offsets = np.zeros(1, dtype = np.int32)
+            dimension = int(np.prod(ch.dimension))
+            out[names[k]] = StringColumn(offsets, data, dimension)
+
+    nbytes = 0
+    for column in out.values():
+        if isinstance(column, StringColumn):
+            nbytes += column.offsets.nbytes + len(column.data)
+            column = column.offsets
+        else:
+            nbytes += column.nbytes
+        # offsets from frombuffer are read-only already
+        if column.flags.writeable: column.flags.writeable = False
+
+    dlis.cache.put(key, out, nbytes)
+    return out
+
+def materialized(dlis, frame):
+    """ For internal use.
+    The columns of frame from materialize, if they are cached, otherwise None
+    """
+    key = (frame.fingerprint, 'materialized', frame.dtype)
+    if key not in dlis.cache: return None
+    return dlis.cache.get(key)
+
+def native_dtype(channel):
+    """ For internal use.
+    The dtype of channel, as read by native_curves
+    """
+    base = reprc.native_dtype.get(channel.reprc)
+    if base is None: return channel.dtype
+
+    if channel.dimension == [1]: return np.dtype(base)
+    return np.dtype((base, tuple(channel.dimension)))
+
+def native_curves(dlis, frame, selected, threads = None, indices = None):
+    """ For internal use.
+    Reads the selected channels of the frame, with validated floats and object
+    names decoded as plain numbers, see Frame.native_curves
+    """
+    if indices is None: indices = dlis.fdata_index[frame.fingerprint]
+    if threads is None: threads = readthreads(len(indices))
+
+    names = frame.dtype.names
+    dtype = np.dtype([
+        (names[i], native_dtype(frame.channels[i])) for i in selected
+    ])
+    fmts = [ch.fmtstr() for ch in frame.channels]
+
+    obnames = []
+    def decode(a, plan):
+        nonlocal obnames
+        obnames = core.read_fdata_native(fmts, selected, dlis.file, indices,
+                                         a, threads, plan)
+
+    a = planned(dlis, frame, dtype, decode, indices)
+    return a, obnames
+
+class SparseIndex(object):
+    """ For internal use.
+    Sparse index of the FDATA records of a frame
+
+    The records are grouped in blocks of blocksize consecutive records, and
+    for every block the smallest and largest index value in it is recorded.
+    The index values are the values of the index channel, or the frame
+    numbers if the frame has no index channel. Blocks are small, so keeping
+    the index around is cheap, even for frames with millions of samples.
+
+    Attributes
+    ----------
+
+    blocksize : int
+
+    mins, maxs : np.ndarray
+        Smallest and largest index value of every block, ignoring NaN
+    """
+    def __init__(self, blocksize, mins, maxs):
+        self.blocksize = blocksize
+        self.mins = mins
+        self.maxs = maxs
+
+    def candidates(self, low, high):
+        """ Positions of the records in the blocks that overlap [low, high]
+        """
+        overlap = (self.maxs >= low) & (self.mins <= high)
+        blocks = np.flatnonzero(overlap)
+        offsets = np.arange(self.blocksize)
+        return (blocks[:, None] * self.blocksize + offsets).ravel()
+
+def indexvalues(dlis, frame, indices):
+    """ For internal use.
+    The index values of the records in indices, i.e. the values of the index
+    channel, or the frame numbers if the frame has no index channel
+    """
+    framenos = np.empty(shape = len(indices), dtype = np.int32)
+    if frame.index_type is None:
+        core.read_fdata_index("", dlis.file, indices, framenos, None)
+        return framenos
+
+    index = frame.channels[0]
+    if index.dtype.shape:
+        msg = "index channel {} in frame '{}' is not scalar"
+        raise ValueError(msg.format(index.name, frame.name))
+
+    values = np.empty(shape = len(indices), dtype = index.dtype)
+    core.read_fdata_index(index.fmtstr(), dlis.file, indices, framenos, values)
+    return values
+
+def sparseindex(dlis, frame, blocksize = 64):
+    """ For internal use.
+    Build the SparseIndex of frame, by reading the index value of every
+    record. Only the first few bytes of the records are decoded.
+    """
+    indices = dlis.fdata_index[frame.fingerprint]
+    values = indexvalues(dlis, frame, indices)
+
+    if len(values) == 0:
+        empty = np.empty(shape = 0, dtype = values.dtype)
+        return SparseIndex(blocksize, empty, empty)
+
+    starts = np.arange(0, len(values), blocksize)
+    mins = np.fmin.reduceat(values, starts)
+    maxs = np.fmax.reduceat(values, starts)
+    return SparseIndex(blocksize, mins, maxs)
+
+def inrange(dlis, frame, low, high):
+    """ For internal use.
+    The FDATA records of frame with index values in [low, high]. Only the
+    records in the overlapping blocks of the sparse index are read.
+    """
+    if frame._sparseindex is None:
+        frame._sparseindex = sparseindex(dlis, frame)
+
+    indices = dlis.fdata_index[frame.fingerprint]
+    positions = frame._sparseindex.candidates(low, high)
+    positions = positions[positions < len(indices)]
+    candidates = [indices[i] for i in positions]
+
+    values = indexvalues(dlis, frame, candidates)
+    mask = (values >= low) & (values <= high)
+    return [i for i, keep in zip(candidates, mask) if keep]
+
+def readthreads(records):
+    """ For internal use.
+    Default number of threads to read FDATA records with, see curves
+    """
+    records_per_thread = 1024
+    cpus = os.cpu_count() or 1
+    return max(1, min(cpus, records // records_per_thread))
+
+def iter_curves(dlis, frame, dtype, pre_fmt, fmt, post_fmt, rows = 4096,
+                prefetch = True, drop_behind = False):
+    """ For internal use.
+    Generator of the curves for the provided frame, in blocks of at most rows
+    samples, see curves.
+
+    Blocks are decoded into buffers that are re-used for the next blocks, so
+    memory use is bounded no matter how many samples there are. When prefetch
+    is True, the next block is decoded in the background while the caller
+    works on the current one. When drop_behind is True, the records of a block
+    are dropped from the page cache once the block is decoded.
+    """
+    if rows < 1:
+        raise ValueError('rows must be positive, was {}'.format(rows))
+
+    indices = dlis.fdata_index[frame.fingerprint]
+
+    try:
+        reader = core.frame_reader(dlis.file, indices, pre_fmt, fmt, post_fmt)
+        reader.drop_behind = drop_behind
+    except ValueError:
+        # The curves are not plain numbers, and must be read with the
+        # interpreter in read_fdata. Do it one block at a time to at least
+        # bound the memory
+        buf = np.empty(shape = rows, dtype = dtype)
+        for i in range(0, len(indices), rows):
+            block = indices[i:i + rows]
+            a = buf[:len(block)]
+            core.read_fdata(pre_fmt, fmt, post_fmt, dlis.file, block, a)
+            yield a
+        return
+
+    if not prefetch:
+        buf = np.empty(shape = rows, dtype = dtype)
+        n = reader.read(buf)
+        while n > 0:
+            yield buf[:n]
+            n = reader.read(buf)
+        return
+
+    current = np.empty(shape = rows, dtype = dtype)
+    following = np.empty(shape = rows, dtype = dtype)
+    try:
+        reader.prefetch(current)
+        n = reader.wait()
+        while n > 0:
+            reader.prefetch(following)
+            yield current[:n]
+            n = reader.wait()
+            current, following = following, current
+    finally:
+        # the generator may be closed while a block is still being decoded,
+        # so make sure no one writes to the buffers after they're released
+        reader.wait()
+
+class StringColumn(object):
+    """ A column of strings
+
+    The strings are stored back-to-back in data, like in arrow's string
+    arrays, and the k-th string is data[offsets[k]:offsets[k + 1]]. Every
+    sample has dimension strings, i.e. the strings of sample i are the strings
+    [i * dimension, (i + 1) * dimension).
+
+    Attributes
+    ----------
+
+    offsets : np.ndarray of int32
+    data : bytes
+    dimension : int
+    """
+    def __init__(self, offsets, data, dimension = 1):
+        self.offsets = offsets
+        self.data = data
+        self.dimension = dimension
+
+    def __len__(self):
+        return (len(self.offsets) - 1) // self.dimension
+
+    def values(self):
+        """ All the strings, decoded, as a flat list """
+        offsets, data = self.offsets, self.data
+        return [decode(data[offsets[k]:offsets[k + 1]])
+                for k in range(len(offsets) - 1)]
+
+    def tolist(self):
+        """ The samples, as a list of str, or of lists of str if dimension > 1
+        """
+        values = self.values()
+        if self.dimension == 1: return values
+
+        d = self.dimension
+        return [values[i:i + d] for i in range(0, len(values), d)]
+
+    def utf8(self):
+        """ This column, with all strings valid UTF-8
+
+        Strings that are not UTF-8 are decoded like the strings in curves,
+        i.e. a latin-1 degree sign is fixed up, and any remaining invalid
+        bytes are replaced.
+        """
+        try:
+            self.data.decode('utf-8')
+            return self
+        except UnicodeDecodeError:
+            pass
+
+        values = []
+        for value in self.values():
+            if isinstance(value, bytes):
+                value = value.decode('utf-8', errors = 'replace')
+            values.append(value.encode('utf-8'))
+
+        offsets = np.zeros(len(values) + 1, dtype = np.int32)
+        np.cumsum([len(v) for v in values], out = offsets[1:])
+        return StringColumn(offsets, b''.join(values), self.dimension)
+
+def decode(value):
+    """ For internal use.
+    Decode a string like the strings in curves, i.e. as UTF-8, with the
+    latin-1 degree sign fixed up, or as bytes if that does not work either
+    """
+    try:
+        return value.decode('utf-8')
+    except UnicodeDecodeError:
+        pass
+
+    try:
+        return value.replace(b'\xb0', b'\xc2\xb0').decode('utf-8')
+    except UnicodeDecodeError:
+        return value
+
+def iter_columns(dlis, frame, selected, rows = 65536, drop_behind = False):
+    """ For internal use.
+    Generator of the curves of the selected channels (positions) of frame,
+    column by column, in blocks of at most rows samples.
+
+    Every block is an OrderedDict of label -> column, where the column is an
+    np.ndarray for numeric channels, and a StringColumn for strings. The
+    columns are decoded straight from the FDATA, without going through a
+    structured array. Unlike iter_curves, the buffers are not re-used, so the
+    columns can be handed over to e.g. arrow without copying. drop_behind is
+    like for iter_curves.
+    """
+    if rows < 1:
+        raise ValueError('rows must be positive, was {}'.format(rows))
+
+    indices = dlis.fdata_index[frame.fingerprint]
+    fmts = [ch.fmtstr() for ch in frame.channels]
+    reader = core.column_reader(dlis.file, indices, fmts, selected)
+    reader.drop_behind = drop_behind
+
+    names = frame.dtype.names
+    channels = [frame.channels[i] for i in selected]
+    strings = [fmts[i][:1] in ('s', 'S', 'Q') for i in selected]
+
+    # Records usually hold a single frame, so the records left is the number
+    # of rows left, until a block has more rows than records
+    multiframe = False
+    while reader.tell() < len(reader):
+        start = reader.tell()
+        n = rows if multiframe else min(rows, len(reader) - start)
+        bufs = [None if isstr else np.empty(shape = n, dtype = ch.dtype)
+                for ch, isstr in zip(channels, strings)]
+        n = reader.read(bufs, n)
+        if reader.tell() - start < n: multiframe = True
+
+        block = OrderedDict()
+        for k, (i, ch) in enumerate(zip(selected, channels)):
+            if strings[k]:
+                offsets, data = reader.strings(k)
+                offsets = np.frombuffer(offsets, dtype = np.int32)
+                dimension = int(np.prod(ch.dimension))
+                block[names[i]] = StringColumn(offsets, data, dimension)
+            else:
+                block[names[i]] = bufs[k][:n]
+
+        yield block
@@ -0,0 +1,168 @@
+"""
+Export of frames to columnar formats, i.e. arrow record batches, arrow IPC
+(feather) files and parquet.
+
+The curves are decoded column by column straight from the FDATA (see
+Frame.iter_columns), and handed over to arrow without copying, so there is no
+intermediate structured array, and no python objects per sample. This module
+requires pyarrow, which is not a dependency of dlisio itself, and is only
+imported when used.
+"""
+from collections import OrderedDict
+
+import numpy as np
+
+from .dlisutils import StringColumn
+
+def arrow_array(column):
+    """ Make an arrow array of a column from Frame.iter_columns
+
+    Numeric columns are zero-copy views of the numpy array. Multi-dimensional
+    samples become FixedSizeList arrays of the flattened sample, and complex
+    numbers FixedSizeList arrays of (real, imag) pairs. String columns become
+    string arrays, or FixedSizeList arrays of strings when there are
+    multiple strings per sample.
+
+    Parameters
+    ----------
+    column : np.ndarray or dlisio.dlisutils.StringColumn
+
+    Returns
+    -------
+    array : pyarrow.Array
+    """
+    import pyarrow as pa
+
+    if isinstance(column, StringColumn):
+        column = column.utf8()
+        size = len(column.offsets) - 1
+        values = pa.StringArray.from_buffers(size,
+                                             pa.py_buffer(column.offsets),
+                                             pa.py_buffer(column.data))
+        if column.dimension == 1: return values
+        return pa.FixedSizeListArray.from_arrays(values, column.dimension)
+
+    a = np.ascontiguousarray(column)
+    if np.iscomplexobj(a):
+        a = a.view(a.real.dtype).reshape(a.shape + (2,))
+
+    if a.ndim == 1: return pa.array(a)
+
+    width = int(np.prod(a.shape[1:]))
+    values = pa.array(a.reshape(-1))
+    return pa.FixedSizeListArray.from_arrays(values, width)
+
+def empty_block(frame, channels = None):
+    """ For internal use.
+    A block like the ones from Frame.iter_columns, but with no samples
+    """
+    names = frame.dtype.names
+    if channels is None: selected = range(len(frame.channels))
+    else:                selected = frame.channelpositions(channels)
+
+    out = OrderedDict()
+    for i in selected:
+        ch = frame.channels[i]
+        if ch.fmtstr()[:1] in ('s', 'S', 'Q'):
+            offsets = np.zeros(1, dtype = np.int32)
+            dimension = int(np.prod(ch.dimension))
+            out[names[i]] = StringColumn(offsets, b'', dimension)
+        else:
+            out[names[i]] = np.empty(shape = 0, dtype = ch.dtype)
+
+    return out
+
+def record_batches(frame, rows = 65536, channels = None):
+    """ The curves of frame, as arrow record batches
+
+    Parameters
+    ----------
+    frame : dlisio.plumbing.Frame
+
+    rows : int, optional
+        Maximum number of samples in every batch
+
+    channels : list of Channel or str, optional
+        Only export these channels, see Frame.curves
+
+    Yields
+    ------
+    batch : pyarrow.RecordBatch
+        The columns are named like the fields in frame.dtype
+    """
+    import pyarrow as pa
+
+    for block in frame.iter_columns(rows = rows, channels = channels):
+        arrays = [arrow_array(column) for column in block.values()]
+        yield pa.RecordBatch.from_arrays(arrays, names = list(block.keys()))
+
+def schema(frame, channels = None):
+    """ The arrow schema of the record batches of frame
+
+    Returns
+    -------
+    schema : pyarrow.Schema
+    """
+    import pyarrow as pa
+
+    block = empty_block(frame, channels)
+    arrays = [arrow_array(column) for column in block.values()]
+    return pa.RecordBatch.from_arrays(arrays, names = list(block.keys())).schema
+
+def write_parquet(frame, where, rows = 65536, channels = None, **kwargs):
+    """ Write the curves of frame to a parquet file
+
+    The curves are written one record batch at a time, i.e. one row group per
+    batch, so memory use is bounded by the batch size.
+
+    Parameters
+    ----------
+    frame : dlisio.plumbing.Frame
+
+    where : str or file-like
+        Destination, see pyarrow.parquet.ParquetWriter
+
+    rows : int, optional
+        Maximum number of samples in every row group
+
+    channels : list of Channel or str, optional
+        Only export these channels, see Frame.curves
+
+    **kwargs
+        Passed on to pyarrow.parquet.ParquetWriter, e.g. compression
+
+    Examples
+    --------
+
+    >>> with dlisio.load(path) as (f, *_):
+    ...     for frame in f.frames:
+    ...         dlisio.export.write_parquet(frame, frame.name + '.parquet')
+    """
+    import pyarrow as pa
+    import pyarrow.parquet as pq
+
+    with pq.ParquetWriter(where, schema(frame, channels), **kwargs) as writer:
+        for batch in record_batches(frame, rows = rows, channels = channels):
+            writer.write_table(pa.Table.from_batches([batch]))
+
+def write_ipc(frame, sink, rows = 65536, channels = None):
+    """ Write the curves of frame to an arrow IPC (feather v2) file
+
+    Parameters
+    ----------
+    frame : dlisio.plumbing.Frame
+
+    sink : str or file-like
+        Destination, see pyarrow.ipc.new_file
+
+    rows : int, optional
+        Maximum number of samples in every record batch
+
+    channels : list of Channel or str, optional
+        Only export these channels, see Frame.curves
+    """
+    import pyarrow as pa
+
+    with pa.ipc.new_file(sink, schema(frame, channels)) as writer:
+        for batch in record_batches(frame, rows = rows, channels = channels):
+            writer.write_batch(batch)
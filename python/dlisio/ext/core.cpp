@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <bitset>
 #include <cerrno>
 #include <cstdint>
@@ -8,6 +9,7 @@
 #include <iterator>
 #include <memory>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include <vector>
 #include <limits>
@@ -24,7 +26,9 @@ namespace py = pybind11;
 using namespace py::literals;
 
 #include <dlisio/ext/exception.hpp>
+#include <dlisio/ext/frame.hpp>
 #include <dlisio/ext/io.hpp>
+#include <dlisio/ext/stats.hpp>
 #include <dlisio/ext/types.hpp>
 
 namespace pybind11 { namespace detail {
@@ -211,6 +215,86 @@ template <> struct type_caster< dl::origin > : dlis_caster< dl::origin > {};
 template <> struct type_caster< dl::status > : dlis_caster< dl::status > {};
 template <> struct type_caster< dl::units  > : dlis_caster< dl::units  > {};
 
+/*
+ * Attribute values are small_vectors, which are converted to lists just like
+ * std::vector is by pybind's list_caster, reading the values straight from
+ * the vector, wherever they are stored.
+ */
+template < typename T >
+struct type_caster< dl::small_vector< T > > {
+    using value_conv = make_caster< T >;
+    PYBIND11_TYPE_CASTER(dl::small_vector< T >,
+                         _("List[") + value_conv::name + _("]"));
+
+    template < typename Vec >
+    static handle cast( Vec&& src, return_value_policy policy, handle parent ) {
+        if (!std::is_lvalue_reference< Vec >::value)
+            policy = return_value_policy_override< T >::policy(policy);
+
+        list l(src.size());
+        std::size_t index = 0;
+        for (auto&& value : src) {
+            auto x = reinterpret_steal< object >(
+                value_conv::cast(forward_like< Vec >(value), policy, parent)
+            );
+            if (!x) return handle();
+            /* PyList_SET_ITEM steals the reference */
+            PyList_SET_ITEM(l.ptr(), (ssize_t) index++, x.release().ptr());
+        }
+        return l.release();
+    }
+
+    /* values are never converted from python, just like dlis_caster */
+    bool load( handle, bool ) { return false; }
+};
+
+/*
+ * Record indices are lists of ints, or int32 arrays, like the FDATA indices
+ * from groupfdata, which are kept as arrays. Arrays are copied straight from
+ * their buffer, rather than converted one element at a time.
+ */
+template <>
+struct type_caster< std::vector< int > > :
+    list_caster< std::vector< int >, int > {
+
+    bool load( handle src, bool convert ) {
+        if (load_int32_buffer( src )) return true;
+        return list_caster< std::vector< int >, int >::load( src, convert );
+    }
+
+private:
+    bool load_int32_buffer( handle src ) {
+        if (not PyObject_CheckBuffer( src.ptr() )) return false;
+
+        Py_buffer view;
+        const auto flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT;
+        if (PyObject_GetBuffer( src.ptr(), &view, flags ) != 0) {
+            PyErr_Clear();
+            return false;
+        }
+
+        /* numpy's int32 is 'l' on platforms where long is 32 bits */
+        const std::string fmt = view.format ? view.format : "B";
+        const auto native = fmt.size() == 1
+                         or (fmt.size() == 2 and (fmt[0] == '@' or
+                                                  fmt[0] == '='));
+        const auto code = fmt.back();
+        const auto ok = native
+                    and (code == 'i' or code == 'l')
+                    and view.itemsize == sizeof( int )
+                    and view.ndim == 1;
+
+        if (ok) {
+            const auto* first = static_cast< const int* >( view.buf );
+            const auto n = static_cast< std::size_t >( view.shape[ 0 ] );
+            this->value.assign( first, first + n );
+        }
+
+        PyBuffer_Release( &view );
+        return ok;
+    }
+};
+
 }} // namespace pybind11::detail
 
 namespace {
@@ -295,321 +379,913 @@ std::string fingerprint(const std::string& type,
     return ref.fingerprint();
 }
 
-void read_fdata(const char* pre_fmt,
-                const char* fmt,
-                const char* post_fmt,
-                dl::stream& file,
-                const std::vector< int >& indices,
-                py::object dstobj)
+/*
+ * Read a single row by interpreting the format string one value at a time.
+ * This handles all the types that must be converted to python objects, or
+ * have a different in-memory representation in numpy, and advances dst past
+ * the written values.
+ */
+const char* read_row(const char* fmt,
+                     const char* ptr,
+                     const char* end,
+                     char*& dst)
+noexcept (false) {
+    auto assert_overflow = [end](const char* ptr, int skip) {
+        if (ptr + skip > end) {
+            const auto msg = "corrupted record: fmtstr would read past end";
+            throw std::runtime_error(msg);
+        }
+    };
+
+    int src_skip, dst_skip;
+    for (auto* f = fmt; *f; ++f) {
+        /*
+         * Supporting bounded-length identifiers in frame data is
+         * slightly more difficult than it immediately seem like, and
+         * this implementation relies on a few assumptions that may not
+         * hold.
+         *
+         * 1. numpy structured arrays interpret unicode on the fly
+         *
+         * On my amd64 linux:
+         * >>> dt = np.dtype('U5')
+         * >>> dt.itemsize
+         * 20
+         * >>> np.array(['foo'], dtype = dt)[0]
+         * 'foo'
+         * >>> np.array(['foobar'], dtype = dt)[0]
+         * 'fooba'
+         *
+         * Meaning it supports string lengths of [0, n]. It apparently
+         * (and maybe rightly so) uses null termination, or the bounded
+         * length, which ever comes first.
+         *
+         * 2. numpy stores characters as int32 Py_UNICODE
+         * Numpy seems to always use uint32, and not Py_UNICODE, which
+         * can be both 16 and 32 bits [1]. Since it's an integer it's
+         * endian sensitive, and widening from char works. This is not
+         * really documented by numpy.
+         *
+         * 3. numpy stores no metadata with the string
+         * It is assumed, and seems necessary from the interface, that
+         * there is no in-band metadata stored about the strings when
+         * used in structured arrays. This means we can just write the
+         * unicode ourselves, and have numpy interpret it correctly.
+         *
+         * --
+         * Units is just an IDENT in disguise, so it can very well take
+         * the same code path.
+         *
+         * [1] http://docs.h5py.org/en/stable/strings.html#what-about-numpy-s-u-type
+         *     NumPy also has a Unicode type, a UTF-32 fixed-width
+         *     format (4-byte characters). HDF5 has no support for wide
+         *     characters. Rather than trying to hack around this and
+         *     “pretend” to support it, h5py will raise an error when
+         *     attempting to create datasets or attributes of this
+         *     type.
+         *
+         */
+         auto swap_pointer = [&](py::object obj)
+         {
+             PyObject* p;
+             std::memcpy(&p, dst, sizeof(p));
+             Py_DECREF(p);
+             p = obj.inc_ref().ptr();
+             std::memcpy(dst, &p, sizeof(p));
+             dst += sizeof(p);
+         };
+
+         if (*f == DLIS_FMT_FSING1) {
+            float v;
+            float a;
+            ptr = dlis_fsing1(ptr, &v, &a);
+            auto t = py::make_tuple(v, a);
+
+            swap_pointer(t);
+            continue;
+        }
+
+         if (*f == DLIS_FMT_FSING2) {
+            float v;
+            float a;
+            float b;
+            ptr = dlis_fsing2(ptr, &v, &a, &b);
+            auto t = py::make_tuple(v, a, b);
+
+            swap_pointer(t);
+            continue;
+        }
+
+         if (*f == DLIS_FMT_FDOUB1) {
+            double v;
+            double a;
+            ptr = dlis_fdoub1(ptr, &v, &a);
+            auto t = py::make_tuple(v, a);
+
+            swap_pointer(t);
+            continue;
+        }
+
+         if (*f == DLIS_FMT_FDOUB2) {
+            double v;
+            double a;
+            double b;
+            ptr = dlis_fdoub2(ptr, &v, &a, &b);
+            auto t = py::make_tuple(v, a, b);
+
+            swap_pointer(t);
+            continue;
+        }
+
+        if (*f == DLIS_FMT_IDENT || *f == DLIS_FMT_UNITS) {
+            constexpr auto chars = 255;
+            constexpr auto ident_size = chars * sizeof(std::uint32_t);
+
+            std::int32_t len;
+            char tmp[chars];
+            ptr = dlis_ident(ptr, &len, tmp);
+
+            /*
+             * From reading the numpy source, it looks like they put
+             * and interpret the unicode buffer in the array directly,
+             * and pad with zero. This means the string is both null
+             * and length terminated, whichever comes first.
+             */
+            std::memset(dst, 0, ident_size);
+            for (auto i = 0; i < len; ++i) {
+                const auto x = std::uint32_t(tmp[i]);
+                std::memcpy(dst + i * sizeof(x), &x, sizeof(x));
+            }
+            dst += ident_size;
+            continue;
+        }
+
+        if (*f == DLIS_FMT_ASCII) {
+            std::int32_t len;
+            ptr = dlis_uvari(ptr, &len);
+            auto ascii = py::str(ptr, len);
+            ptr += len;
+
+            /*
+             * Numpy seems to default initalize object types even in
+             * the case of np.empty to None [1]. The refcount is surely
+             * increased, so decref it before replacing the pointer
+             * with a fresh str.
+             *
+             * [1] Array of uninitialized (arbitrary) data of the given
+             *     shape, dtype, and order. Object arrays will be
+             *     initialized to None.
+             *     https://docs.scipy.org/doc/numpy/reference/generated/numpy.empty.html
+             */
+            swap_pointer(ascii);
+            continue;
+        }
+
+        if (*f == DLIS_FMT_OBNAME) {
+            std::int32_t origin;
+            std::uint8_t copy;
+            std::int32_t idlen;
+            char id[255];
+            ptr = dlis_obname(ptr, &origin, &copy, &idlen, id);
+
+            const auto name = dl::obname {
+                dl::origin(origin),
+                dl::ushort(copy),
+                dl::ident(std::string(id, idlen)),
+            };
+
+            swap_pointer(py::cast(name));
+            continue;
+        }
+
+        if (*f == DLIS_FMT_OBJREF) {
+            std::int32_t idlen;
+            char id[255];
+            std::int32_t origin;
+            std::uint8_t copy;
+            std::int32_t objnamelen;
+            char objname[255];
+            ptr = dlis_objref(ptr,
+                              &idlen,
+                              id,
+                              &origin,
+                              &copy,
+                              &objnamelen,
+                              objname);
+
+            const auto name = dl::objref {
+                dl::ident(std::string(id, idlen)),
+                dl::obname {
+                    dl::origin(origin),
+                    dl::ushort(copy),
+                    dl::ident(std::string(objname, objnamelen)),
+                },
+            };
+
+            swap_pointer(py::cast(name));
+            continue;
+        }
+
+        if (*f == DLIS_FMT_ATTREF) {
+            std::int32_t id1len;
+            char id1[255];
+            std::int32_t origin;
+            std::uint8_t copy;
+            std::int32_t objnamelen;
+            char objname[255];
+            std::int32_t id2len;
+            char id2[255];
+            ptr = dlis_attref(ptr,
+                              &id1len,
+                              id1,
+                              &origin,
+                              &copy,
+                              &objnamelen,
+                              objname,
+                              &id2len,
+                              id2);
+
+            const auto ref = dl::attref {
+                dl::ident(std::string(id1, id1len)),
+                dl::obname {
+                    dl::origin(origin),
+                    dl::ushort(copy),
+                    dl::ident(std::string(objname, objnamelen)),
+                },
+                dl::ident(std::string(id2, id2len)),
+            };
+
+            swap_pointer(py::cast(ref));
+            continue;
+        }
+
+        if (*f == DLIS_FMT_DTIME) {
+            int Y, TZ, M, D, H, MN, S, MS;
+            ptr = dlis_dtime(ptr, &Y, &TZ, &M, &D, &H, &MN, &S, &MS);
+            Y = dlis_year(Y);
+            const auto US = MS * 1000;
+
+            PyObject* p;
+            std::memcpy(&p, dst, sizeof(p));
+            Py_DECREF(p);
+            p = PyDateTime_FromDateAndTime(Y, M, D, H, MN, S, US);
+            if (!p) throw py::error_already_set();
+            std::memcpy(dst, &p, sizeof(p));
+            dst += sizeof(p);
+            continue;
+        }
+
+        const char localfmt[] = {*f, '\0'};
+        dlis_packflen(localfmt, ptr, &src_skip, &dst_skip);
+        assert_overflow(ptr, src_skip);
+        dlis_packf(localfmt, ptr, dst);
+        dst += dst_skip;
+        ptr += src_skip;
+    }
+
+    return ptr;
+}
+
+/*
+ * The objects of the flat set as a dict, exactly like object_set.objects, but
+ * built straight from the flat set, without making an intermediary object_set
+ */
+py::dict flat_objects(const dl::flat_object_set& set) noexcept (false) {
+    /*
+     * labels are the same for all objects, so only make the python strings
+     * once
+     */
+    std::vector< py::str > labels;
+    labels.reserve(set.strings.size());
+    for (std::size_t i = 0; i < set.strings.size(); ++i)
+        labels.push_back(py::str(set.strings.at(i)));
+
+    py::dict objects;
+    for (const auto& object : set.objects) {
+        py::dict obj;
+        for (const auto& attr : set.tmpl)
+            obj[labels[attr.label]] = dl::flat_value(set, attr);
+
+        const auto* first = set.attributes.data() + object.first;
+        for (auto* attr = first; attr != first + object.size; ++attr) {
+            const auto& label = labels[attr->label];
+            if (attr->absent) obj.attr("pop")(label, py::none());
+            else              obj[label] = dl::flat_value(set, *attr);
+        }
+
+        const auto name = dl::obname{
+            dl::origin{ object.origin },
+            dl::ushort{ object.copy },
+            dl::ident{ set.strings.at(object.id) },
+        };
+        objects[py::cast(name)] = obj;
+    }
+
+    return objects;
+}
+
+/*
+ * Read the projected columns of the frame in a single FDATA record into dst,
+ * and advance dst past the written rows. Without a plan the record must hold
+ * exactly one row (frame), and with a plan exactly the rows planned for it,
+ * which is record k of the plan (see dl::fdata_plan).
+ *
+ * Rows that only have numbers are decoded with the compiled layouts, and never
+ * touch python objects, so this is safe to call without holding the GIL.
+ * Object names in interned projections are looked up in names.
+ */
+void read_fdata_record(const dl::frame_projection& projection,
+                       const dl::record_view& record,
+                       char*& dst,
+                       dl::obname_table* names = nullptr,
+                       const dl::fdata_plan* plan = nullptr,
+                       int k = 0)
+noexcept (false) {
+    if (record.isencrypted()) {
+        throw dl::not_implemented("encrypted FDATA record");
+    }
+
+    const auto rows = plan ? plan->rows(k) : 1;
+    const auto mismatch = [&](const std::string& frames) {
+        return std::runtime_error("FDATA record " + std::to_string(k)
+                                + " of the plan holds " + frames
+                                + " frames, but the plan has "
+                                + std::to_string(rows));
+    };
+
+    const auto* ptr = record.begin();
+    const auto* end = record.end();
+
+    /* read fingerprint */
+    std::int32_t origin;
+    std::uint8_t copy;
+    ptr = dlis_obname(ptr, &origin, &copy, nullptr, nullptr);
+
+    /* get frame number and slots */
+    std::int64_t row = 0;
+    for (; ptr < end; ++row) {
+        /*
+         * Check before decoding, as dst only has room for the expected rows
+         */
+        if (row == rows) {
+            if (not plan)
+                throw multiple_frames("multiple frames in one FDATA");
+            throw mismatch("more than " + std::to_string(rows));
+        }
+
+        std::int32_t frameno;
+        ptr = dlis_uvari(ptr, &frameno);
+
+        if (projection.numeric) {
+            ptr = dl::project_row(projection, ptr, end, dst, names);
+            dst += projection.dst_size;
+        } else {
+            for (const auto& column : projection.columns) {
+                ptr = dl::skip(column.before, ptr, end);
+                if (column.layout.numeric) {
+                    ptr = dl::unpack_row(column.layout, ptr, end, dst);
+                    dst += column.layout.dst_size;
+                } else {
+                    ptr = read_row(column.fmt.c_str(), ptr, end, dst);
+                }
+            }
+            ptr = dl::skip(projection.after, ptr, end);
+        }
+    }
+
+    if (row == rows) return;
+    if (not plan) throw std::runtime_error("FDATA record without frames");
+    throw mismatch(std::to_string(row));
+}
+
+/*
+ * Read the frames of nrecords records into dst, where fetch(k, record) reads
+ * the k-th record. If concurrent is true, fetch can be called from multiple
+ * threads at once. What fetch counts to counters is collected per thread, and
+ * added once per thread.
+ *
+ * Without a plan every record must hold exactly one frame. With a plan, dst
+ * must hold plan->rows() rows, and the records may hold any number of frames.
+ *
+ * The names are shared by all rows, so interned projections are always read
+ * with a single thread.
+ */
+template < typename Fetch >
+void read_fdata(const dl::frame_projection& projection,
+                int nrecords,
+                bool concurrent,
+                Fetch fetch,
+                dl::stats* counters,
+                py::object dstobj,
+                int threads,
+                dl::obname_table* names = nullptr,
+                const dl::fdata_plan* plan = nullptr)
 noexcept (false) {
-    // TODO: reverse fingerprint to skip bytes ahead-of-time
     /*
      * TODO: error has already been checked (in python), but should be more
      * thorough
-     *
-     * TODO: veriy that format string is valid
      */
     auto dstb = py::buffer(dstobj);
     auto info = dstb.request(true);
     auto* dst = static_cast< char* >(info.ptr);
 
-    dl::record record;
-    int expected_frameno = 1;
-    for (auto i : indices) {
-        /* get record */
-        file.at(i, record);
-
-        if (record.isencrypted()) {
-            throw dl::not_implemented("encrypted FDATA record");
+    if (plan) {
+        if (plan->records() != std::size_t(nrecords)) {
+            const auto msg = "read_fdata: plan is of "
+                           + std::to_string(plan->records())
+                           + " records, expected "
+                           + std::to_string(nrecords);
+            throw std::invalid_argument(msg);
         }
 
-        const auto* ptr = record.data.data();
-        const auto* end = ptr + record.data.size();
+        if (info.size < plan->rows()) {
+            const auto msg = "read_fdata: dst holds "
+                           + std::to_string(info.size)
+                           + " rows, but the plan has "
+                           + std::to_string(plan->rows());
+            throw std::invalid_argument(msg);
+        }
+    }
 
-        /* read fingerprint */
-        std::int32_t origin;
-        std::uint8_t copy;
-        ptr = dlis_obname(ptr, &origin, &copy, nullptr, nullptr);
+    threads = (std::min)(threads, nrecords);
 
-        /* get frame number and slots */
-        while (ptr < end) {
-            std::int32_t frameno;
-            ptr = dlis_uvari(ptr, &frameno);
+    /*
+     * Reading (and decoding) in parallel is only possible when the records can
+     * be read concurrently, which they can from a memory-mapped stream or a
+     * record batch, and the row can be written without creating python
+     * objects.
+     */
+    const auto serial = threads <= 1
+                     or not concurrent
+                     or not projection.numeric
+                     or projection.interned;
+
+    if (serial) {
+        /* numeric rows never make python objects, so the GIL is not needed */
+        std::unique_ptr< py::gil_scoped_release > nogil;
+        if (projection.numeric) nogil.reset(new py::gil_scoped_release());
+
+        dl::stats_batch batch(counters);
+        dl::record_view record;
+        for (int k = 0; k < nrecords; ++k) {
+            fetch(k, record);
+            read_fdata_record(projection, record, dst, names, plan, k);
+        }
+        return;
+    }
 
-            if (frameno != expected_frameno) {
-                // TODO: warning
-                // const auto msg = 'Non-sequential frames. expected = {}, current = {}'
+    /*
+     * Every record holds exactly one frame, or the frames given by the plan,
+     * and every frame is projection.dst_size bytes in memory, so the
+     * destination of every record is known up front. Partition the records in
+     * contiguous chunks, and let every thread write to its own slice of the
+     * output array.
+     */
+    std::vector< std::exception_ptr > errors(threads);
+    {
+        py::gil_scoped_release nogil;
+
+        const auto chunk = (nrecords + threads - 1) / threads;
+        const auto worker = [&](int id) noexcept (true) {
+            try {
+                const auto first = id * chunk;
+                const auto last = (std::min)(first + chunk, nrecords);
+                const auto start = (std::min)(first, nrecords);
+                const auto row = plan ? plan->first[start] : start;
+                auto* out = dst + std::size_t(row) * projection.dst_size;
+
+                dl::stats_batch batch(counters);
+                dl::record_view record;
+                for (auto k = first; k < last; ++k) {
+                    fetch(k, record);
+                    read_fdata_record(projection, record, out, nullptr,
+                                      plan, k);
+                }
+            } catch (...) {
+                errors[id] = std::current_exception();
             }
+        };
 
-            auto assert_overflow = [end](const char* ptr, int skip) {
-                if (ptr + skip > end) {
-                    const auto msg = "corrupted record: fmtstr would read past end";
-                    throw std::runtime_error(msg);
-                }
-            };
+        std::vector< std::thread > pool;
+        pool.reserve(threads - 1);
+        for (int id = 1; id < threads; ++id)
+            pool.emplace_back(worker, id);
 
-            int src_skip, dst_skip;
-            dlis_packflen(pre_fmt, ptr, &src_skip, nullptr);
-            assert_overflow(ptr, src_skip);
-            ptr += src_skip;
-
-            for (auto* f = fmt; *f; ++f) {
-                /*
-                 * Supporting bounded-length identifiers in frame data is
-                 * slightly more difficult than it immediately seem like, and
-                 * this implementation relies on a few assumptions that may not
-                 * hold.
-                 *
-                 * 1. numpy structured arrays interpret unicode on the fly
-                 *
-                 * On my amd64 linux:
-                 * >>> dt = np.dtype('U5')
-                 * >>> dt.itemsize
-                 * 20
-                 * >>> np.array(['foo'], dtype = dt)[0]
-                 * 'foo'
-                 * >>> np.array(['foobar'], dtype = dt)[0]
-                 * 'fooba'
-                 *
-                 * Meaning it supports string lengths of [0, n]. It apparently
-                 * (and maybe rightly so) uses null termination, or the bounded
-                 * length, which ever comes first.
-                 *
-                 * 2. numpy stores characters as int32 Py_UNICODE
-                 * Numpy seems to always use uint32, and not Py_UNICODE, which
-                 * can be both 16 and 32 bits [1]. Since it's an integer it's
-                 * endian sensitive, and widening from char works. This is not
-                 * really documented by numpy.
-                 *
-                 * 3. numpy stores no metadata with the string
-                 * It is assumed, and seems necessary from the interface, that
-                 * there is no in-band metadata stored about the strings when
-                 * used in structured arrays. This means we can just write the
-                 * unicode ourselves, and have numpy interpret it correctly.
-                 *
-                 * --
-                 * Units is just an IDENT in disguise, so it can very well take
-                 * the same code path.
-                 *
-                 * [1] http://docs.h5py.org/en/stable/strings.html#what-about-numpy-s-u-type
-                 *     NumPy also has a Unicode type, a UTF-32 fixed-width
-                 *     format (4-byte characters). HDF5 has no support for wide
-                 *     characters. Rather than trying to hack around this and
-                 *     “pretend” to support it, h5py will raise an error when
-                 *     attempting to create datasets or attributes of this
-                 *     type.
-                 *
-                 */
-                 auto swap_pointer = [&](py::object obj)
-                 {
-                     PyObject* p;
-                     std::memcpy(&p, dst, sizeof(p));
-                     Py_DECREF(p);
-                     p = obj.inc_ref().ptr();
-                     std::memcpy(dst, &p, sizeof(p));
-                     dst += sizeof(p);
-                 };
-
-                 if (*f == DLIS_FMT_FSING1) {
-                    float v;
-                    float a;
-                    ptr = dlis_fsing1(ptr, &v, &a);
-                    auto t = py::make_tuple(v, a);
-
-                    swap_pointer(t);
-                    continue;
-                }
+        worker(0);
+        for (auto& t : pool) t.join();
+    }
 
-                 if (*f == DLIS_FMT_FSING2) {
-                    float v;
-                    float a;
-                    float b;
-                    ptr = dlis_fsing2(ptr, &v, &a, &b);
-                    auto t = py::make_tuple(v, a, b);
+    for (const auto& err : errors) {
+        if (err) std::rethrow_exception(err);
+    }
+}
 
-                    swap_pointer(t);
-                    continue;
-                }
+void read_fdata(const dl::frame_projection& projection,
+                dl::stream& file,
+                const std::vector< int >& indices,
+                py::object dstobj,
+                int threads,
+                dl::obname_table* names = nullptr,
+                const dl::fdata_plan* plan = nullptr)
+noexcept (false) {
+    const auto nrecords = int(indices.size());
+    const auto nrows = plan ? plan->rows() : nrecords;
+    auto* counters = file.statistics().get();
+    dl::scoped_timer timer(counters, dl::phase::read_fdata);
 
-                 if (*f == DLIS_FMT_FDOUB1) {
-                    double v;
-                    double a;
-                    ptr = dlis_fdoub1(ptr, &v, &a);
-                    auto t = py::make_tuple(v, a);
+    /*
+     * Without a mapping the records must be read one at a time anyway, so
+     * have the reads issued ahead of decoding, in large chunks. The readahead
+     * hands out the records in order, from a single thread, so the records
+     * are then decoded serially (concurrent is false) no matter threads -
+     * only the reads themselves are done in parallel, by the readahead.
+     */
+    if (not file.mapped()) {
+        dl::readahead records(file, indices);
+        const auto fetch = [&](int, dl::record_view& record) {
+            records.next(record);
+        };
+        read_fdata(projection, nrecords, false, fetch, counters, dstobj,
+                   threads, names, plan);
+        dl::count(counters, dl::counter::frames_decoded, nrows);
+        return;
+    }
 
-                    swap_pointer(t);
-                    continue;
-                }
+    const auto fetch = [&](int k, dl::record_view& record) {
+        file.at(indices[k], record);
+    };
 
-                 if (*f == DLIS_FMT_FDOUB2) {
-                    double v;
-                    double a;
-                    double b;
-                    ptr = dlis_fdoub2(ptr, &v, &a, &b);
-                    auto t = py::make_tuple(v, a, b);
+    read_fdata(projection, nrecords, true, fetch, counters, dstobj, threads,
+               names, plan);
+    dl::count(counters, dl::counter::frames_decoded, nrows);
+}
 
-                    swap_pointer(t);
-                    continue;
-                }
+/*
+ * Read the frames of already extracted records. The records are read straight
+ * from the batch, without copying
+ */
+void read_fdata(const dl::frame_projection& projection,
+                const dl::record_batch& batch,
+                py::object dstobj,
+                int threads,
+                const dl::fdata_plan* plan = nullptr)
+noexcept (false) {
+    const auto fetch = [&](int k, dl::record_view& record) {
+        record = batch.view(k);
+    };
+
+    const auto nrecords = int(batch.size());
+    dl::scoped_timer timer(dl::phase::read_fdata);
+    read_fdata(projection, nrecords, true, fetch, nullptr, dstobj, threads,
+               nullptr, plan);
+    dl::count(dl::counter::frames_decoded, plan ? plan->rows() : nrecords);
+}
 
-                if (*f == DLIS_FMT_IDENT || *f == DLIS_FMT_UNITS) {
-                    constexpr auto chars = 255;
-                    constexpr auto ident_size = chars * sizeof(std::uint32_t);
-
-                    std::int32_t len;
-                    char tmp[chars];
-                    ptr = dlis_ident(ptr, &len, tmp);
-
-                    /*
-                     * From reading the numpy source, it looks like they put
-                     * and interpret the unicode buffer in the array directly,
-                     * and pad with zero. This means the string is both null
-                     * and length terminated, whichever comes first.
-                     */
-                    std::memset(dst, 0, ident_size);
-                    for (auto i = 0; i < len; ++i) {
-                        const auto x = std::uint32_t(tmp[i]);
-                        std::memcpy(dst + i * sizeof(x), &x, sizeof(x));
-                    }
-                    dst += ident_size;
-                    continue;
-                }
+void read_fdata(const char* pre_fmt,
+                const char* fmt,
+                const char* post_fmt,
+                dl::stream& file,
+                const std::vector< int >& indices,
+                py::object dstobj,
+                int threads,
+                const dl::fdata_plan* plan)
+noexcept (false) {
+    const auto projection = dl::compile_projection(pre_fmt, fmt, post_fmt);
+    read_fdata(projection, file, indices, dstobj, threads, nullptr, plan);
+}
 
-                if (*f == DLIS_FMT_ASCII) {
-                    std::int32_t len;
-                    ptr = dlis_uvari(ptr, &len);
-                    auto ascii = py::str(ptr, len);
-                    ptr += len;
-
-                    /*
-                     * Numpy seems to default initalize object types even in
-                     * the case of np.empty to None [1]. The refcount is surely
-                     * increased, so decref it before replacing the pointer
-                     * with a fresh str.
-                     *
-                     * [1] Array of uninitialized (arbitrary) data of the given
-                     *     shape, dtype, and order. Object arrays will be
-                     *     initialized to None.
-                     *     https://docs.scipy.org/doc/numpy/reference/generated/numpy.empty.html
-                     */
-                    swap_pointer(ascii);
-                    continue;
-                }
+void read_fdata_batch(const char* pre_fmt,
+                      const char* fmt,
+                      const char* post_fmt,
+                      const dl::record_batch& batch,
+                      py::object dstobj,
+                      int threads,
+                      const dl::fdata_plan* plan)
+noexcept (false) {
+    const auto projection = dl::compile_projection(pre_fmt, fmt, post_fmt);
+    read_fdata(projection, batch, dstobj, threads, plan);
+}
 
-                if (*f == DLIS_FMT_OBNAME) {
-                    std::int32_t origin;
-                    std::uint8_t copy;
-                    std::int32_t idlen;
-                    char id[255];
-                    ptr = dlis_obname(ptr, &origin, &copy, &idlen, id);
-
-                    const auto name = dl::obname {
-                        dl::origin(origin),
-                        dl::ushort(copy),
-                        dl::ident(std::string(id, idlen)),
-                    };
-
-                    swap_pointer(py::cast(name));
-                    continue;
-                }
+/*
+ * Read only the selected channels of a frame, where fmts is the format string
+ * of every channel in the frame
+ */
+void read_fdata_columns(const std::vector< std::string >& fmts,
+                        const std::vector< int >& selected,
+                        dl::stream& file,
+                        const std::vector< int >& indices,
+                        py::object dstobj,
+                        int threads,
+                        const dl::fdata_plan* plan)
+noexcept (false) {
+    const auto projection = dl::compile_projection(fmts, selected);
+    read_fdata(projection, file, indices, dstobj, threads, nullptr, plan);
+}
 
-                if (*f == DLIS_FMT_OBJREF) {
-                    std::int32_t idlen;
-                    char id[255];
-                    std::int32_t origin;
-                    std::uint8_t copy;
-                    std::int32_t objnamelen;
-                    char objname[255];
-                    ptr = dlis_objref(ptr,
-                                      &idlen,
-                                      id,
-                                      &origin,
-                                      &copy,
-                                      &objnamelen,
-                                      objname);
-
-                    const auto name = dl::objref {
-                        dl::ident(std::string(id, idlen)),
-                        dl::obname {
-                            dl::origin(origin),
-                            dl::ushort(copy),
-                            dl::ident(std::string(objname, objnamelen)),
-                        },
-                    };
-
-                    swap_pointer(py::cast(name));
-                    continue;
-                }
+void read_fdata_columns_batch(const std::vector< std::string >& fmts,
+                              const std::vector< int >& selected,
+                              const dl::record_batch& batch,
+                              py::object dstobj,
+                              int threads,
+                              const dl::fdata_plan* plan)
+noexcept (false) {
+    const auto projection = dl::compile_projection(fmts, selected);
+    read_fdata(projection, batch, dstobj, threads, plan);
+}
 
-                if (*f == DLIS_FMT_ATTREF) {
-                    std::int32_t id1len;
-                    char id1[255];
-                    std::int32_t origin;
-                    std::uint8_t copy;
-                    std::int32_t objnamelen;
-                    char objname[255];
-                    std::int32_t id2len;
-                    char id2[255];
-                    ptr = dlis_attref(ptr,
-                                      &id1len,
-                                      id1,
-                                      &origin,
-                                      &copy,
-                                      &objnamelen,
-                                      objname,
-                                      &id2len,
-                                      id2);
-
-                    const auto ref = dl::attref {
-                        dl::ident(std::string(id1, id1len)),
-                        dl::obname {
-                            dl::origin(origin),
-                            dl::ushort(copy),
-                            dl::ident(std::string(objname, objnamelen)),
-                        },
-                        dl::ident(std::string(id2, id2len)),
-                    };
-
-                    swap_pointer(py::cast(ref));
-                    continue;
-                }
+/*
+ * Like read_fdata_columns, but with validated floats as plain floats, and
+ * object names as int32 codes (see dl::compile_layout), so that no python
+ * objects are made for them. The names are shared by all rows, so frames with
+ * object names are read with a single thread, but without holding the GIL.
+ *
+ * Returns the interned object names, i.e. the code of a name is its position
+ * in the list.
+ */
+std::vector< dl::obname >
+read_fdata_native(const std::vector< std::string >& fmts,
+                  const std::vector< int >& selected,
+                  dl::stream& file,
+                  const std::vector< int >& indices,
+                  py::object dstobj,
+                  int threads,
+                  const dl::fdata_plan* plan)
+noexcept (false) {
+    const auto projection = dl::compile_projection(fmts, selected, true);
+    if (not projection.numeric) {
+        throw std::invalid_argument(
+            "read_fdata_native: frame has channels that are not numbers, "
+            "validated floats or object names"
+        );
+    }
 
-                if (*f == DLIS_FMT_DTIME) {
-                    int Y, TZ, M, D, H, MN, S, MS;
-                    ptr = dlis_dtime(ptr, &Y, &TZ, &M, &D, &H, &MN, &S, &MS);
-                    Y = dlis_year(Y);
-                    const auto US = MS * 1000;
-
-                    PyObject* p;
-                    std::memcpy(&p, dst, sizeof(p));
-                    Py_DECREF(p);
-                    p = PyDateTime_FromDateAndTime(Y, M, D, H, MN, S, US);
-                    if (!p) throw py::error_already_set();
-                    std::memcpy(dst, &p, sizeof(p));
-                    dst += sizeof(p);
-                    continue;
-                }
+    dl::obname_table names;
+    read_fdata(projection, file, indices, dstobj, threads, &names, plan);
+    return names.names();
+}
 
-                const char localfmt[] = {*f, '\0'};
-                dlis_packflen(localfmt, ptr, &src_skip, &dst_skip);
-                assert_overflow(ptr, src_skip);
-                dlis_packf(localfmt, ptr, dst);
-                dst += dst_skip;
-                ptr += src_skip;
-            }
-            expected_frameno = frameno + 1;
+/*
+ * Read the frame number, and the values of the first channels described by
+ * fmt, of every record. Only the start of the frames is read, and the rest is
+ * not decoded or validated, which makes this a lot faster than read_fdata for
+ * building an index of the frames. Records that hold more than one frame are
+ * indexed by their first frame.
+ *
+ * fmt must be numeric. If it is empty, only the frame numbers are read, and
+ * dst may be None.
+ */
+void read_fdata_index(const char* fmt,
+                      dl::stream& file,
+                      const std::vector< int >& indices,
+                      py::object framenosobj,
+                      py::object dstobj)
+noexcept (false) {
+    const auto layout = dl::compile_layout(fmt);
+    if (not layout.numeric) {
+        const auto msg = std::string("non-numeric index format '")
+                       + fmt + "'";
+        throw std::invalid_argument(msg);
+    }
+
+    auto framenosb = py::buffer(framenosobj);
+    auto framenosinfo = framenosb.request(true);
+    if (framenosinfo.itemsize != sizeof(std::int32_t)
+        or framenosinfo.size < py::ssize_t(indices.size())) {
+        throw std::invalid_argument("framenos must hold an int32 per record");
+    }
+    auto* framenos = static_cast< std::int32_t* >(framenosinfo.ptr);
+
+    char* dst = nullptr;
+    if (layout.dst_size > 0) {
+        auto dstb = py::buffer(dstobj);
+        auto info = dstb.request(true);
+        const auto size = info.size * info.itemsize;
+        if (size < py::ssize_t(indices.size()) * layout.dst_size) {
+            throw std::invalid_argument("dst too small for index values");
+        }
+        dst = static_cast< char* >(info.ptr);
+    }
+
+    py::gil_scoped_release nogil;
+    dl::stats_batch batch(file.statistics().get());
+    dl::record_view record;
+    for (auto i : indices) {
+        file.at(i, record);
+        if (record.isencrypted()) {
+            throw dl::not_implemented("encrypted FDATA record");
+        }
+
+        const auto* ptr = record.begin();
+        const auto* end = record.end();
+
+        std::int32_t origin;
+        std::uint8_t copy;
+        ptr = dlis_obname(ptr, &origin, &copy, nullptr, nullptr);
+        if (ptr >= end) {
+            const auto msg = "corrupted record: fmtstr would read past end";
+            throw std::runtime_error(msg);
+        }
+        ptr = dlis_uvari(ptr, framenos++);
+
+        if (dst) {
+            dl::unpack_row(layout, ptr, end, dst);
+            dst += layout.dst_size;
+        }
+    }
+}
+
+/*
+ * The python side of dl::frame_reader
+ *
+ * The buffer being prefetched into is written to by another thread, so keep a
+ * reference to it until the prefetch is waited for. The reader must be
+ * destroyed (which waits for any pending prefetch) before the buffer is
+ * released, which is why pending is declared first.
+ */
+struct frame_reader {
+    frame_reader(dl::stream& file,
+                 std::vector< int > indices,
+                 const std::string& pre_fmt,
+                 const std::string& fmt,
+                 const std::string& post_fmt)
+        : reader(file, std::move(indices), pre_fmt, fmt, post_fmt)
+    {}
+
+    py::object pending;
+    dl::frame_reader reader;
+
+    /* get the destination and the number of rows it can hold */
+    std::pair< char*, int > rows(py::object dstobj) noexcept (false) {
+        auto dstb = py::buffer(dstobj);
+        auto info = dstb.request(true);
+        const auto size = info.size * info.itemsize;
+        const auto n = size / this->reader.row_size();
+        if (n == 0) {
+            std::string msg =
+                  "buffer too small: size (which is "
+                + std::to_string( size ) + ") < "
+                + "row size (which is "
+                + std::to_string( this->reader.row_size() ) + ")"
+            ;
+            throw std::invalid_argument( msg );
+        }
+
+        const auto maxrows = (std::numeric_limits< int >::max)();
+        const auto rows = int((std::min)(std::size_t(n), std::size_t(maxrows)));
+        return { static_cast< char* >(info.ptr), rows };
+    }
+
+    int read(py::object dstobj) noexcept (false) {
+        const auto dst = this->rows(dstobj);
+        py::gil_scoped_release nogil;
+        return this->reader.read(dst.first, dst.second);
+    }
+
+    void prefetch(py::object dstobj) noexcept (false) {
+        const auto dst = this->rows(dstobj);
+        {
+            py::gil_scoped_release nogil;
+            this->reader.prefetch(dst.first, dst.second);
+        }
+        this->pending = dstobj;
+    }
+
+    int wait() noexcept (false) {
+        int n;
+        try {
+            py::gil_scoped_release nogil;
+            n = this->reader.wait();
+        } catch (...) {
+            this->pending = py::none();
+            throw;
+        }
+        this->pending = py::none();
+        return n;
+    }
+};
 
-            dlis_packflen(post_fmt, ptr, &src_skip, nullptr);
-            assert_overflow(ptr, src_skip);
-            ptr += src_skip;
+/*
+ * The python side of dl::column_reader. The columns are read into one buffer
+ * per fixed-size column, and string columns are handed out as the offsets and
+ * data of the last block read.
+ */
+struct column_reader {
+    column_reader(dl::stream& file,
+                  std::vector< int > indices,
+                  const std::vector< std::string >& fmts,
+                  const std::vector< int >& selected)
+        : reader(file,
+                 std::move(indices),
+                 dl::compile_projection(fmts, selected))
+    {}
+
+    dl::column_reader reader;
+
+    int read(py::list dstobjs, int rows) noexcept (false) {
+        const auto ncolumns = this->reader.columns();
+        if (dstobjs.size() != ncolumns) {
+            std::string msg =
+                  "expected one buffer per column (which is "
+                + std::to_string( ncolumns ) + "), was "
+                + std::to_string( dstobjs.size() )
+            ;
+            throw std::invalid_argument( msg );
+        }
 
-            if (ptr != end) {
-                // TODO: lift this restriction (realloc buffers)
-                auto msg = "multiple frames in one FDATA";
-                throw dl::not_implemented(msg);
+        if (rows < 0) {
+            std::string msg =
+                "expected rows (which is " + std::to_string( rows ) + ") >= 0"
+            ;
+            throw std::invalid_argument( msg );
+        }
+
+        /*
+         * The number of rows must be explicit - string columns have no
+         * buffer, and a selection of only strings would otherwise read the
+         * rest of the frames in one go
+         */
+        std::vector< char* > dst(ncolumns, nullptr);
+        for (std::size_t k = 0; k < ncolumns; ++k) {
+            const auto colsize = this->reader.column_size(k);
+            if (this->reader.strings_column(k) or colsize == 0) continue;
+
+            auto dstb = py::buffer(dstobjs[k]);
+            auto info = dstb.request(true);
+            const auto size = std::size_t(info.size * info.itemsize);
+            if (size / colsize < std::size_t(rows)) {
+                std::string msg =
+                      "buffer of column " + std::to_string( k ) + " too "
+                    + "small: holds " + std::to_string( size / colsize )
+                    + " rows, expected " + std::to_string( rows )
+                ;
+                throw std::invalid_argument( msg );
             }
+            dst[k] = static_cast< char* >(info.ptr);
         }
+
+        py::gil_scoped_release nogil;
+        return this->reader.read(dst, rows);
+    }
+
+    py::tuple strings(std::size_t k) const noexcept (false) {
+        const auto& column = this->reader.strings(k);
+        const auto* offsets = column.offsets.data();
+        const auto size = column.offsets.size() * sizeof(*offsets);
+        return py::make_tuple(
+            py::bytes(reinterpret_cast< const char* >(offsets), size),
+            py::bytes(column.data.data(), column.data.size())
+        );
+    }
+};
+
+/*
+ * The stats entered with a with-statement in this thread, innermost last.
+ * With-statements always nest, so a stack per thread is enough. The stats is
+ * kept alive for as long as it is current.
+ */
+struct entered_stats {
+    std::shared_ptr< dl::stats > target;
+    std::unique_ptr< dl::stats_scope > scope;
+};
+
+thread_local std::vector< entered_stats > entered;
+
+py::dict asdict(const dl::stats& s) noexcept (false) {
+    const dl::counter counters[] = {
+        dl::counter::bytes_indexed,
+        dl::counter::records_indexed,
+        dl::counter::records_read,
+        dl::counter::segments_read,
+        dl::counter::records_stitched,
+        dl::counter::bytes_copied,
+        dl::counter::objects_parsed,
+        dl::counter::frames_decoded,
+        dl::counter::records_skipped,
+        dl::counter::bytes_skipped,
+    };
+
+    const dl::phase phases[] = {
+        dl::phase::findoffsets,
+        dl::phase::extract,
+        dl::phase::parse_objects,
+        dl::phase::findfdata,
+        dl::phase::read_fdata,
+    };
+
+    py::dict d;
+    for (auto c : counters)
+        d[dl::name(c)] = s.get(c);
+
+    py::dict seconds;
+    py::dict calls;
+    for (auto p : phases) {
+        seconds[dl::name(p)] = s.seconds(p);
+        calls[dl::name(p)] = s.calls(p);
     }
+
+    d["seconds"] = seconds;
+    d["calls"] = calls;
+    return d;
 }
 
 }
@@ -629,9 +1305,125 @@ PYBIND11_MODULE(core, m) {
         }
     });
 
+    py::register_exception< multiple_frames >( m,
+                                               "MultipleFramesError",
+                                               PyExc_NotImplementedError );
+
     m.def( "storage_label", storage_label );
     m.def("fingerprint", fingerprint);
-    m.def("read_fdata", read_fdata);
+    m.def("read_fdata",
+        static_cast< void (*)(const char*,
+                              const char*,
+                              const char*,
+                              dl::stream&,
+                              const std::vector< int >&,
+                              py::object,
+                              int,
+                              const dl::fdata_plan*) >(read_fdata),
+        "pre_fmt"_a,
+        "fmt"_a,
+        "post_fmt"_a,
+        "file"_a,
+        "indices"_a,
+        "dst"_a,
+        "threads"_a = 1,
+        "plan"_a = py::none()
+    );
+    m.def("read_fdata", read_fdata_batch,
+        "pre_fmt"_a,
+        "fmt"_a,
+        "post_fmt"_a,
+        "batch"_a,
+        "dst"_a,
+        "threads"_a = 1,
+        "plan"_a = py::none()
+    );
+    m.def("read_fdata_index", read_fdata_index,
+        "fmt"_a,
+        "file"_a,
+        "indices"_a,
+        "framenos"_a,
+        "dst"_a
+    );
+    m.def("read_fdata_columns", read_fdata_columns,
+        "fmts"_a,
+        "selected"_a,
+        "file"_a,
+        "indices"_a,
+        "dst"_a,
+        "threads"_a = 1,
+        "plan"_a = py::none()
+    );
+    m.def("read_fdata_columns", read_fdata_columns_batch,
+        "fmts"_a,
+        "selected"_a,
+        "batch"_a,
+        "dst"_a,
+        "threads"_a = 1,
+        "plan"_a = py::none()
+    );
+    m.def("read_fdata_native", read_fdata_native,
+        "fmts"_a,
+        "selected"_a,
+        "file"_a,
+        "indices"_a,
+        "dst"_a,
+        "threads"_a = 1,
+        "plan"_a = py::none()
+    );
+
+    py::class_< frame_reader >( m, "frame_reader" )
+        .def( py::init< dl::stream&,
+                        std::vector< int >,
+                        const std::string&,
+                        const std::string&,
+                        const std::string& >(),
+              "file"_a,
+              "indices"_a,
+              "pre_fmt"_a,
+              "fmt"_a,
+              "post_fmt"_a,
+              py::keep_alive< 1, 2 >() )
+        .def_property_readonly( "rowsize", [](const frame_reader& r) {
+            return r.reader.row_size();
+        })
+        .def( "__len__", [](const frame_reader& r) {
+            return r.reader.size();
+        })
+        .def( "tell", [](const frame_reader& r) { return r.reader.tell(); })
+        .def( "seek", []( frame_reader& r, std::size_t row ) {
+            r.reader.seek( row );
+        })
+        .def_property( "drop_behind",
+            [](const frame_reader& r) { return r.reader.drop_behind(); },
+            [](frame_reader& r, bool enable) { r.reader.drop_behind(enable); }
+        )
+        .def( "read",     &frame_reader::read,     "dst"_a )
+        .def( "prefetch", &frame_reader::prefetch, "dst"_a )
+        .def( "wait",     &frame_reader::wait )
+    ;
+
+    py::class_< column_reader >( m, "column_reader" )
+        .def( py::init< dl::stream&,
+                        std::vector< int >,
+                        const std::vector< std::string >&,
+                        const std::vector< int >& >(),
+              "file"_a,
+              "indices"_a,
+              "fmts"_a,
+              "selected"_a,
+              py::keep_alive< 1, 2 >() )
+        .def( "__len__", [](const column_reader& r) {
+            return r.reader.size();
+        })
+        .def( "tell", [](const column_reader& r) { return r.reader.tell(); })
+        .def_property( "drop_behind",
+            [](const column_reader& r) { return r.reader.drop_behind(); },
+            [](column_reader& r, bool enable) { r.reader.drop_behind(enable); }
+        )
+        .def( "read",    &column_reader::read,    "dst"_a, "rows"_a )
+        .def( "strings", &column_reader::strings, "column"_a )
+    ;
 
     /*
      * TODO: support constructor with kwargs
@@ -756,6 +1548,17 @@ PYBIND11_MODULE(core, m) {
         })
     ;
 
+    py::class_< dl::flat_object_set >( m, "flat_object_set" )
+        .def_property_readonly( "type", []( const dl::flat_object_set& s ) {
+            return s.strings.at( s.type );
+        })
+        .def_property_readonly( "name", []( const dl::flat_object_set& s ) {
+            return s.strings.at( s.name );
+        })
+        .def_property_readonly( "objects", flat_objects )
+        .def( "unflatten", dl::unflatten )
+    ;
+
     py::enum_< dl::representation_code >( m, "reprc" )
         .value( "fshort", dl::representation_code::fshort )
         .value( "fsingl", dl::representation_code::fsingl )
@@ -804,9 +1607,147 @@ PYBIND11_MODULE(core, m) {
         })
     ;
 
+    py::class_< dl::record_extent >( m, "record_extent" )
+        .def_readonly( "index",      &dl::record_extent::index )
+        .def_readonly( "tell",       &dl::record_extent::tell )
+        .def_readonly( "size",       &dl::record_extent::size )
+        .def_readonly( "segments",   &dl::record_extent::segments )
+        .def_readonly( "type",       &dl::record_extent::type )
+        .def_readonly( "consistent", &dl::record_extent::consistent )
+        .def_property_readonly( "explicit",  &dl::record_extent::isexplicit )
+        .def_property_readonly( "encrypted", &dl::record_extent::isencrypted )
+        .def( "__repr__", []( const dl::record_extent& e ) {
+            return "dlisio.core.record_extent(index={}, tell={}, size={}, "
+                   "type={}, encrypted={})"_s
+                    .format( e.index,
+                             e.tell,
+                             e.size,
+                             e.type,
+                             e.isencrypted() )
+                    ;
+        })
+    ;
+
+    py::class_< dl::record_batch >( m, "record_batch", py::buffer_protocol() )
+        .def( py::init<>() )
+        .def( "__len__", []( const dl::record_batch& batch ) {
+            return batch.size();
+        })
+        .def( "__getitem__", []( const dl::record_batch& batch, long i ) {
+            const auto size = long(batch.size());
+            if (i < 0) i += size;
+            if (i < 0 or i >= size)
+                throw py::index_error( "record_batch index out of range" );
+
+            dl::record rec;
+            rec.type       = batch.types[ i ];
+            rec.attributes = batch.attributes[ i ];
+            rec.consistent = batch.consistent[ i ];
+            rec.data.assign( batch.begin( i ), batch.end( i ) );
+            return rec;
+        })
+        .def( "__getitem__", []( const dl::record_batch& batch,
+                                 py::slice slice ) {
+            std::size_t start, stop, step, len;
+            if (not slice.compute( batch.size(), &start, &stop, &step, &len ))
+                throw py::error_already_set();
+
+            dl::record_batch sub;
+            for (std::size_t k = 0, i = start; k < len; ++k, i += step) {
+                sub.data.insert( sub.data.end(),
+                                 batch.begin( i ),
+                                 batch.end( i ) );
+                sub.offsets.push_back( sub.data.size() );
+                sub.types.push_back( batch.types[ i ] );
+                sub.attributes.push_back( batch.attributes[ i ] );
+                sub.consistent.push_back( batch.consistent[ i ] );
+            }
+            return sub;
+        })
+        .def_readonly( "offsets", &dl::record_batch::offsets )
+        .def_readonly( "types", &dl::record_batch::types )
+        .def_property_readonly( "encrypted", []( const dl::record_batch& b ) {
+            std::vector< bool > encrypted( b.size() );
+            for (std::size_t i = 0; i < b.size(); ++i)
+                encrypted[ i ] = b.isencrypted( i );
+            return encrypted;
+        })
+        .def_property_readonly( "nbytes", []( const dl::record_batch& b ) {
+            /* the bodies, and the offset and headers of every record */
+            return b.data.size()
+                 + b.offsets.size() * sizeof(b.offsets.front())
+                 + b.types.size() * sizeof(b.types.front())
+                 + b.attributes.size() + b.consistent.size();
+        })
+        .def_buffer( []( dl::record_batch& batch ) -> py::buffer_info {
+            const auto fmt = py::format_descriptor< char >::format();
+            return py::buffer_info(
+                batch.data.data(),
+                sizeof(char),
+                fmt,
+                1,
+                { batch.data.size() },
+                { 1 }
+            );
+        })
+    ;
+
+    py::class_< dl::stats, std::shared_ptr< dl::stats > >( m, "stats" )
+        .def( py::init<>() )
+        .def_property_readonly_static( "enabled", []( py::object ) {
+            return DLISIO_STATS != 0;
+        })
+        .def( "asdict", asdict )
+        .def( "merge", &dl::stats::merge )
+        .def( "reset", &dl::stats::reset )
+        .def( "__enter__", []( std::shared_ptr< dl::stats > s ) {
+            entered_stats e;
+            e.target = s;
+            e.scope.reset( new dl::stats_scope( s.get() ) );
+            entered.push_back( std::move( e ) );
+            return s;
+        })
+        .def( "__exit__", []( const dl::stats& s, py::args ) {
+            if (entered.empty() or entered.back().target.get() != &s) {
+                const auto msg = "stats.__exit__: not the innermost stats";
+                throw std::logic_error( msg );
+            }
+            entered.pop_back();
+        })
+        .def( "__repr__", []( const dl::stats& s ) {
+            return "dlisio.core.stats(" + py::str(asdict(s)).cast< std::string >()
+                 + ")";
+        })
+    ;
+
+    py::class_< dl::source, std::shared_ptr< dl::source > >( m, "source" )
+        .def( py::init< const std::string&, bool >(),
+              "path"_a,
+              "mapped"_a = true )
+        .def_property_readonly( "path", &dl::source::path )
+        .def_property_readonly( "mapped", &dl::source::mapped )
+        .def_property_readonly( "size", &dl::source::size )
+        .def_property_readonly( "mmap",
+                                &dl::source::mapping,
+                                py::return_value_policy::reference_internal )
+        .def( "close", &dl::source::close )
+    ;
+
     py::class_< dl::stream >( m, "stream" )
-        .def( py::init< const std::string& >() )
+        .def( py::init< const std::string&, bool >(),
+              "path"_a,
+              "mapped"_a = false )
+        .def( py::init< const std::vector< std::string >& >(), "paths"_a )
+        .def( py::init< std::shared_ptr< dl::source > >(), "source"_a )
+        .def( py::init< std::vector< std::shared_ptr< dl::source > > >(),
+              "sources"_a )
+        .def_property_readonly( "mapped", &dl::stream::mapped )
+        .def_property_readonly( "offsets", &dl::stream::offsets )
+        .def_property_readonly( "sources", &dl::stream::sources )
+        .def_property_readonly( "stats", &dl::stream::statistics )
         .def( "reindex", &dl::stream::reindex )
+        .def( "extend", &dl::stream::extend )
+        .def( "remap", &dl::stream::remap )
         .def( "__getitem__", [](dl::stream& o, int i) { return o.at(i); })
         .def( "close", &dl::stream::close )
         .def( "get", []( dl::stream& s, py::buffer b, long long off, int n ) {
@@ -833,8 +1774,33 @@ PYBIND11_MODULE(core, m) {
             }
             return recs;
         })
+        .def( "extract_batch", [](dl::stream& s,
+                                  const std::vector< int >& indices,
+                                  bool encrypted,
+                                  const std::vector< int >& types) {
+            dl::extract_policy policy;
+            policy.encrypted = encrypted;
+            policy.types = types;
+
+            dl::record_batch batch;
+            py::gil_scoped_release nogil;
+            s.extract( indices, batch, policy );
+            return batch;
+        }, "indices"_a,
+           "encrypted"_a = true,
+           "types"_a = std::vector< int >()
+        )
+        .def( "extent", &dl::stream::extent )
     ;
 
+    /*
+     * The batch overloads must be registered first, as pybind11 would
+     * otherwise happily convert the batch to a list of records
+     */
+    m.def( "parse_objects", []( const dl::record_batch& batch ) {
+        return dl::parse_objects( batch );
+    });
+
     m.def( "parse_objects", []( const std::vector< dl::record >& recs ) {
         std::vector< dl::object_set > objects;
         for (const auto& rec : recs) {
@@ -846,19 +1812,195 @@ PYBIND11_MODULE(core, m) {
         return objects;
     });
 
+    m.def( "parse_flat_objects", []( const dl::record_batch& batch ) {
+        std::vector< dl::flat_object_set > sets;
+        py::gil_scoped_release nogil;
+        sets.reserve( batch.size() );
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            if (batch.isencrypted( i )) continue;
+            sets.push_back( dl::parse_flat_objects( batch.begin( i ),
+                                                    batch.end( i ) ) );
+        }
+        return sets;
+    });
+
+    m.def( "parse_flat_objects", []( const std::vector< dl::record >& recs ) {
+        std::vector< dl::flat_object_set > sets;
+        for (const auto& rec : recs) {
+            if (rec.isencrypted()) continue;
+            auto begin = rec.data.data();
+            auto end = begin + rec.data.size();
+            sets.push_back( dl::parse_flat_objects( begin, end ) );
+        }
+        return sets;
+    });
+
+    py::class_< dl::object_filter >( m, "object_filter" )
+        .def( py::init< std::vector< std::string >,
+                        std::vector< std::string >,
+                        const std::string& >(),
+              "types"_a = std::vector< std::string >(),
+              "names"_a = std::vector< std::string >(),
+              "pattern"_a = "" )
+        .def_property_readonly( "types",   &dl::object_filter::types )
+        .def_property_readonly( "names",   &dl::object_filter::names )
+        .def_property_readonly( "pattern", &dl::object_filter::pattern )
+        .def( "__repr__", []( const dl::object_filter& f ) {
+            return "dlisio.core.object_filter(types={}, names={}, "
+                   "pattern='{}')"_s
+                    .format( f.types(), f.names(), f.pattern() )
+                    ;
+        })
+    ;
+
+    m.def( "parse_flat_objects", []( const dl::record_batch& batch,
+                                     const dl::object_filter& filter ) {
+        py::gil_scoped_release nogil;
+        return dl::parse_flat_objects( batch, filter );
+    });
+
+    m.def( "parse_flat_objects", []( const std::vector< dl::record >& recs,
+                                     const dl::object_filter& filter ) {
+        return dl::parse_flat_objects( recs, filter );
+    });
+
+    m.def( "set_types", []( const dl::record_batch& batch ) {
+        py::list types;
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            if (batch.isencrypted( i )) {
+                types.append( py::none() );
+                continue;
+            }
+            types.append( dl::parse_set_type( batch.begin( i ),
+                                              batch.end( i ) ) );
+        }
+        return types;
+    });
+
+    m.def( "set_types", []( const std::vector< dl::record >& recs ) {
+        py::list types;
+        for (const auto& rec : recs) {
+            if (rec.isencrypted()) {
+                types.append( py::none() );
+                continue;
+            }
+            auto begin = rec.data.data();
+            auto end = begin + rec.data.size();
+            types.append( dl::parse_set_type( begin, end ) );
+        }
+        return types;
+    });
+
+    /*
+     * Indexing does not touch any python objects, so release the GIL, so that
+     * many files can be indexed concurrently from python threads
+     */
+    const auto nogil = py::call_guard< py::gil_scoped_release >();
+
     py::class_< mio::mmap_source >( m, "mmap_source" )
         .def( py::init<>() )
-        .def( "map", dl::map_source )
+        .def( "map", dl::map_source, nogil )
+    ;
+
+    m.def( "findsul", dl::findsul, nogil );
+    m.def( "findvrl", dl::findvrl, nogil );
+    m.def("findfdata", dl::findfdata, nogil);
+
+    py::class_< dl::fdata_group >( m, "fdata_group", py::buffer_protocol() )
+        .def_readonly( "fingerprint", &dl::fdata_group::fingerprint )
+        .def( "__len__", []( const dl::fdata_group& g ) {
+            return g.records.size();
+        })
+        .def_buffer( []( dl::fdata_group& g ) -> py::buffer_info {
+            const auto fmt = py::format_descriptor< std::int32_t >::format();
+            return py::buffer_info(
+                g.records.data(),
+                sizeof(std::int32_t),
+                fmt,
+                1,
+                { g.records.size() },
+                { sizeof(std::int32_t) }
+            );
+        })
+    ;
+
+    m.def("groupfdata", dl::groupfdata, nogil);
+
+    py::class_< dl::fdata_plan >( m, "fdata_plan", py::buffer_protocol() )
+        .def_property_readonly( "rows", []( const dl::fdata_plan& p ) {
+            return p.rows();
+        })
+        .def_property_readonly( "uniform", &dl::fdata_plan::uniform )
+        .def_property_readonly( "nbytes", []( const dl::fdata_plan& p ) {
+            return p.first.size() * sizeof(std::int64_t);
+        })
+        .def( "__len__", &dl::fdata_plan::records )
+        .def_buffer( []( dl::fdata_plan& p ) -> py::buffer_info {
+            const auto fmt = py::format_descriptor< std::int64_t >::format();
+            return py::buffer_info(
+                p.first.data(),
+                sizeof(std::int64_t),
+                fmt,
+                1,
+                { p.first.size() },
+                { sizeof(std::int64_t) }
+            );
+        })
+        .def( "__repr__", []( const dl::fdata_plan& p ) {
+            return "dlisio.core.fdata_plan(records: {}, rows: {})"_s
+                    .format( p.records(), p.rows() )
+                    ;
+        })
     ;
 
-    m.def( "findsul", dl::findsul );
-    m.def( "findvrl", dl::findvrl );
-    m.def("findfdata", dl::findfdata);
+    m.def("plan_fdata",
+        static_cast< dl::fdata_plan (*)(dl::stream&,
+                                        const std::vector< int >&,
+                                        const std::string&) >(dl::plan_fdata),
+        "file"_a,
+        "indices"_a,
+        "fmt"_a,
+        nogil
+    );
+    m.def("plan_fdata",
+        static_cast< dl::fdata_plan (*)(const dl::record_batch&,
+                                        const std::string&) >(dl::plan_fdata),
+        "batch"_a,
+        "fmt"_a,
+        nogil
+    );
 
-    m.def( "findoffsets", []( mio::mmap_source& file, long long from ) {
-        const auto ofs = dl::findoffsets( file, from );
+    m.def( "findoffsets", []( mio::mmap_source& file,
+                              long long from,
+                              int threads ) {
+        dl::stream_offsets ofs;
+        {
+            py::gil_scoped_release nogil;
+            ofs = dl::findoffsets( file, from, threads );
+        }
         return py::make_tuple( ofs.tells, ofs.residuals, ofs.explicits );
-    });
+    }, "file"_a, "offset"_a, "threads"_a = 1);
+
+    py::class_< dl::tail_index >( m, "tail_index" )
+        .def( py::init< const std::string&, long long >(),
+              "path"_a,
+              "offset"_a )
+        .def( "refresh", []( dl::tail_index& index ) {
+            dl::stream_offsets ofs;
+            {
+                py::gil_scoped_release nogil;
+                ofs = index.refresh();
+            }
+            return py::make_tuple( ofs.tells, ofs.residuals, ofs.explicits );
+        })
+        .def_property_readonly( "file", &dl::tail_index::file,
+                                py::return_value_policy::reference_internal )
+        .def_property_readonly( "indexed", &dl::tail_index::indexed )
+        .def_property_readonly( "partial", &dl::tail_index::partial )
+        .def( "__len__", []( const dl::tail_index& index ) {
+            return index.offsets().tells.size();
+        })
+    ;
 
     m.def( "marks", [] ( const std::string& path ) {
         mio::mmap_source file;
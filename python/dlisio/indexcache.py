@@ -0,0 +1,236 @@
+"""
+On-disk cache of the record index of a file
+
+Loading a file means scanning all of it to find the offsets of every logical
+record, and then reading the header of every implicit record to map them to
+frames. For large files this is by far the most expensive part of load, and
+the result only depends on the contents of the file. The index can then be
+written to a sidecar file and read back the next time the same file is
+loaded, instead of scanning.
+
+The sidecar is a versioned binary format, all little-endian:
+
+    magic       8 bytes, b'DLISIDX\\0'
+    version     u32
+    key         u64 file size, i64 mtime (ns), 16 bytes content hash
+    sulpos      i64
+    vrlpos      i64
+    records     u64 n, followed by
+                n * i64 tells, n * i32 residuals, n * i32 explicits
+    partitions  u32 count, and for every logical file
+                u32 frames, and for every frame
+                u32 length, utf-8 fingerprint,
+                u32 m, m * i32 record indices
+
+A sidecar is only used if the key matches the file, i.e. the file has the same
+size and mtime, and the same hash of a sample of its contents. A sidecar that
+is stale, from a different version, or otherwise unreadable is ignored.
+"""
+
+import array
+import hashlib
+import os
+import struct
+import sys
+import tempfile
+
+import numpy as np
+
+MAGIC = b'DLISIDX\0'
+VERSION = 2
+
+# sample this many chunks of chunksize bytes, evenly spread out over the
+# file, for the content hash
+SAMPLES = 16
+CHUNKSIZE = 64 * 1024
+
+class Index(object):
+    """ The index of a file, as found by load
+
+    Attributes
+    ----------
+
+    sulpos : int
+        Offset of the storage unit label
+
+    vrlpos : int
+        Offset of the first visible record
+
+    tells, residuals, explicits : list of int
+        See core.findoffsets
+
+    fdata : list of list of (str, np.ndarray of int32)
+        The (frame fingerprint, record indices) of every frame, for every
+        logical file, see core.groupfdata
+    """
+    def __init__(self, sulpos, vrlpos, tells, residuals, explicits, fdata):
+        self.sulpos    = sulpos
+        self.vrlpos    = vrlpos
+        self.tells     = tells
+        self.residuals = residuals
+        self.explicits = explicits
+        self.fdata     = fdata
+
+def filekey(path):
+    """ Key identifying the contents of path
+
+    The key is the size and modification time of the file, and a hash of a
+    sample of its contents. Hashing the whole file would defeat the purpose
+    of the cache, but sampling catches files that have been rewritten without
+    changing size or mtime.
+
+    Returns
+    -------
+
+    key : bytes
+    """
+    st = os.stat(path)
+    size = st.st_size
+    mtime = getattr(st, 'st_mtime_ns', int(st.st_mtime * 1e9))
+
+    digest = hashlib.blake2b(digest_size = 16)
+    with open(path, 'rb') as f:
+        stride = max(size // SAMPLES, CHUNKSIZE)
+        for offset in range(0, size, stride):
+            f.seek(offset)
+            digest.update(f.read(CHUNKSIZE))
+
+        # always include the tail, as that is usually where a growing file
+        # changes
+        f.seek(max(size - CHUNKSIZE, 0))
+        digest.update(f.read(CHUNKSIZE))
+
+    return struct.pack('<Qq', size, mtime) + digest.digest()
+
+def typed(typecode, xs):
+    """ Pack a list of ints as a little-endian array """
+    a = array.array(typecode, xs)
+    if sys.byteorder == 'big': a.byteswap()
+    return a.tobytes()
+
+def untyped(typecode, buf):
+    """ Unpack a little-endian array to a list of ints """
+    a = array.array(typecode)
+    a.frombytes(buf)
+    if sys.byteorder == 'big': a.byteswap()
+    return a.tolist()
+
+class Reader(object):
+    def __init__(self, buf):
+        self.buf = buf
+        self.pos = 0
+
+    def take(self, n):
+        if self.pos + n > len(self.buf):
+            raise ValueError('unexpected end of index')
+        chunk = self.buf[self.pos:self.pos + n]
+        self.pos += n
+        return chunk
+
+    def unpack(self, fmt):
+        return struct.unpack(fmt, self.take(struct.calcsize(fmt)))
+
+def dumps(key, index):
+    """ Serialize index to the sidecar format """
+    n = len(index.tells)
+    if len(index.residuals) != n or len(index.explicits) != n:
+        raise ValueError('tells, residuals and explicits differ in length')
+
+    chunks = [
+        MAGIC,
+        struct.pack('<I', VERSION),
+        key,
+        struct.pack('<qqQ', index.sulpos, index.vrlpos, n),
+        # array's q and i are not guaranteed to be 8 and 4 bytes, but they are
+        # on every platform python supports
+        typed('q', index.tells),
+        typed('i', index.residuals),
+        typed('i', index.explicits),
+        struct.pack('<I', len(index.fdata)),
+    ]
+
+    for part in index.fdata:
+        chunks.append(struct.pack('<I', len(part)))
+        for fingerprint, records in part:
+            fp = fingerprint.encode('utf-8')
+            chunks.append(struct.pack('<I', len(fp)))
+            chunks.append(fp)
+            chunks.append(struct.pack('<I', len(records)))
+            chunks.append(np.asarray(records, dtype = '<i4').tobytes())
+
+    return b''.join(chunks)
+
+def loads(key, buf):
+    """ Deserialize an index from the sidecar format
+
+    Returns
+    -------
+
+    index : Index or None
+        None if the index is from a different version, or the key does not
+        match
+    """
+    r = Reader(buf)
+    if r.take(len(MAGIC)) != MAGIC:
+        raise ValueError('not a dlisio index')
+
+    version, = r.unpack('<I')
+    if version != VERSION: return None
+    if r.take(len(key)) != key: return None
+
+    sulpos, vrlpos, n = r.unpack('<qqQ')
+    tells     = untyped('q', r.take(n * 8))
+    residuals = untyped('i', r.take(n * 4))
+    explicits = untyped('i', r.take(n * 4))
+
+    fdata = []
+    partitions, = r.unpack('<I')
+    for _ in range(partitions):
+        frames, = r.unpack('<I')
+        part = []
+        for _ in range(frames):
+            length, = r.unpack('<I')
+            fingerprint = r.take(length).decode('utf-8')
+            count, = r.unpack('<I')
+            records = np.frombuffer(r.take(count * 4), dtype = '<i4')
+            part.append((fingerprint, records.astype(np.int32)))
+        fdata.append(part)
+
+    return Index(sulpos, vrlpos, tells, residuals, explicits, fdata)
+
+def read(path, key):
+    """ Read the index from the sidecar in path
+
+    Returns
+    -------
+
+    index : Index or None
+        None if there is no sidecar, or if it is stale or unreadable
+    """
+    try:
+        with open(path, 'rb') as f:
+            buf = f.read()
+    except (IOError, OSError):
+        return None
+
+    try:
+        return loads(key, buf)
+    except (ValueError, UnicodeDecodeError, struct.error):
+        return None
+
+def write(path, key, index):
+    """ Write the index to the sidecar in path
+
+    The sidecar is written to a temporary file first and then moved in place,
+    so that concurrent readers never see a partially-written index.
+    """
+    buf = dumps(key, index)
+    directory = os.path.dirname(os.path.abspath(path))
+    fd, tmp = tempfile.mkstemp(dir = directory, suffix = '.tmp')
+    try:
+        with os.fdopen(fd, 'wb') as f:
+            f.write(buf)
+        os.replace(tmp, path)
+    except:
+        os.remove(tmp)
+        raise
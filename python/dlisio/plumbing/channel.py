@@ -1,6 +1,6 @@
 from .basicobject import BasicObject
 from ..reprc import dtype, fmt
-from ..dlisutils import curves
+from ..dlisutils import curves, iter_curves, materialized
 from .valuetypes import scalar, vector
 from .linkage import obname, objref
 from .utils import *
@@ -171,10 +171,25 @@ class Channel(BasicObject):
 
         return self._fmtstr
 
-    def curves(self):
+    def curves(self, threads = None):
         """
         Returns a numpy ndarray with the curves-values.
 
+        Parameters
+        ----------
+
+        threads : int, optional
+            Number of threads used to read the curves. By default, frames with
+            many samples are read with one thread per CPU. Only curves of plain
+            numbers, i.e. no strings or validated floats, are read in
+            parallel.
+
+        Notes
+        -----
+
+        If the frame is materialized (see Frame.materialize), the curve is a
+        copy of its column, and no records are read or decoded.
+
         Examples
         --------
 
@@ -214,8 +229,58 @@ class Channel(BasicObject):
         curves : np.ndarray
         """
         frame = self.frame
+        columns = materialized(frame.file, frame)
+        if columns is not None:
+            # The frame is materialized, see Frame.materialize. The column
+            # is shared with the cache, so hand out a (writable) copy of it
+            pos = [i for i, ch in enumerate(frame.channels) if ch == self]
+            column = columns[frame.dtype.names[pos[-1]]]
+            if isinstance(column, np.ndarray): return column.copy()
+
+        pre_fmt, fmt, post_fmt = frame.fmtstrchannel(self)
+        return curves(frame.file, frame, self.dtype, pre_fmt, fmt, post_fmt,
+                      threads = threads)
+
+    def iter_curves(self, rows = 4096, prefetch = True, drop_behind = False):
+        """
+        Iterate over the curve, a block of samples at a time
+
+        Parameters
+        ----------
+
+        rows : int, optional
+            Maximum number of samples in each block
+
+        prefetch : bool, optional
+            Read the next block in the background while the current one is
+            being processed
+
+        drop_behind : bool, optional
+            Drop the FDATA of every block from the OS page cache once it is
+            decoded, see Frame.iter_curves
+
+        Notes
+        -----
+
+        The yielded arrays are views of buffers that are re-used for later
+        blocks, make a copy to keep a block around.
+
+        See also
+        --------
+
+        Frame.iter_curves : Iterate over all the curves in a Frame
+
+        Yields
+        ------
+        curves : np.ndarray
+        """
+        frame = self.frame
         pre_fmt, fmt, post_fmt = frame.fmtstrchannel(self)
-        return curves(frame.file, frame, self.dtype, pre_fmt, fmt, post_fmt)
+        return iter_curves(frame.file, frame, self.dtype,
+                           pre_fmt, fmt, post_fmt,
+                           rows = rows,
+                           prefetch = prefetch,
+                           drop_behind = drop_behind)
 
     def describe_attr(self, buf, width, indent, exclude):
         describe_description(buf, self.long_name, width, indent, exclude)
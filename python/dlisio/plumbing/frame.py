@@ -1,11 +1,13 @@
 from .basicobject import BasicObject
-from ..dlisutils import curves
+from ..dlisutils import curves, columns, iter_curves, iter_columns, inrange
+from ..dlisutils import native_curves, materialize
 from .valuetypes import scalar, vector, boolean
 from .linkage import obname
 from .utils import *
 
 import numpy as np
 import logging
+from collections import OrderedDict
 
 
 class Frame(BasicObject):
@@ -114,6 +116,9 @@ class Frame(BasicObject):
         # arrays from all channels.
         self._dtype      = None
 
+        # Sparse index of the FDATA records, built on the first range query
+        self._sparseindex = None
+
         # Instance-specific dtype label formatter on duplicated mnemonics.
         # Defaults to Frame.dtype_format
         self.dtype_fmt = self.dtype_format
@@ -275,10 +280,39 @@ class Frame(BasicObject):
 
         return self._fmtstr
 
-    def curves(self):
+    def curves(self, threads = None, channels = None, range = None,
+               records = None):
         """
         Returns a structured numpy array of all the curves
 
+        Parameters
+        ----------
+
+        threads : int, optional
+            Number of threads used to read the curves. By default, frames with
+            many samples are read with one thread per CPU. Only curves of plain
+            numbers, i.e. no strings or validated floats, are read in
+            parallel.
+
+        channels : list of Channel or str, optional
+            Only read the curves of these channels, given as Channel objects,
+            or by their name in the dtype. The curves are returned in the
+            order they appear in the frame. Only the selected channels are
+            decoded, so reading a few channels of a wide frame is much faster
+            than reading all of them and then selecting.
+
+        range : tuple of (low, high), optional
+            Only read the samples with an index in the closed interval [low,
+            high], i.e. index channel values for frames with an index, and
+            frame numbers otherwise. Only the FDATA records that overlap the
+            range are read, using a sparse index of the index values that is
+            built on the first range query.
+
+        records : list of int or np.ndarray of int32, optional
+            Only read these FDATA records, e.g. the records appended to a
+            file that is still being written, from dlisio.follow.refresh.
+            Can not be combined with range.
+
         Examples
         --------
 
@@ -299,6 +333,22 @@ class Frame(BasicObject):
             (16680259., 852606.)
         ])
 
+        Read the samples between depth 2500 and 2600 (in the units of the
+        index channel), without reading the whole frame
+
+        >>> curves = frame.curves(range = (2500, 2600))
+
+        If only a few of the channels are needed, ask for them up front to
+        avoid reading the rest
+
+        >>> frame.curves(channels = ['CHANN2', 'CHANN3'])
+        array([
+            (16677259., 852606.),
+            (16678259., 852606.),
+            (16679259., 852606.),
+            (16680259., 852606.)
+        ])
+
 
         Do a horizontal slice of all Channels, i.e. read a subset of samples
         from all channels
@@ -391,7 +441,250 @@ class Frame(BasicObject):
         curves : np.ndarray
 
         """
-        return curves(self.file, self, self.dtype, "", self.fmtstr(), "")
+        indices = records
+        if range is not None:
+            if records is not None:
+                raise ValueError('range and records can not be combined')
+            low, high = sorted(range)
+            indices = inrange(self.file, self, low, high)
+
+        if channels is None:
+            return curves(self.file, self, self.dtype, "", self.fmtstr(), "",
+                          threads = threads, indices = indices)
+
+        selected = self.channelpositions(channels)
+        dtype = np.dtype([
+            (self.dtype.names[i], self.dtype[i]) for i in selected
+        ])
+        fmts = [ch.fmtstr() for ch in self.channels]
+        return columns(self.file, self, dtype, fmts, selected,
+                       threads = threads, indices = indices)
+
+    def channelpositions(self, channels):
+        """Positions of channels in this Frame
+
+        Channels are given either as Channel objects, or by their label in
+        dtype. The positions are sorted, and duplicates removed.
+
+        Returns
+        -------
+        positions : list of int
+        """
+        names = self.dtype.names
+        positions = set()
+        for channel in channels:
+            if isinstance(channel, str):
+                try:
+                    positions.add(names.index(channel))
+                except ValueError:
+                    msg = "no channel '{}' in frame '{}', expected one of {}"
+                    raise ValueError(msg.format(channel, self.name, names))
+                continue
+
+            for i, ch in enumerate(self.channels):
+                if ch is channel: break
+            else:
+                msg = "{} is not in frame '{}'"
+                raise ValueError(msg.format(channel, self.name))
+            positions.add(i)
+
+        return sorted(positions)
+
+    def iter_curves(self, rows = 4096, prefetch = True, drop_behind = False):
+        """
+        Iterate over the curves, a block of samples at a time
+
+        Reading all the curves with curves() needs memory for all the samples
+        at once, which for long logs or large image channels might be more
+        than what is available. iter_curves reads and yields blocks of at most
+        rows samples, so that only a small, fixed number of blocks live in
+        memory at the same time.
+
+        Parameters
+        ----------
+
+        rows : int, optional
+            Maximum number of samples in each block
+
+        prefetch : bool, optional
+            Read the next block in the background while the current one is
+            being processed
+
+        drop_behind : bool, optional
+            Drop the FDATA of every block from the OS page cache once it is
+            decoded, so that streaming a file much larger than memory does not
+            evict everything else. Leave it off if the file is read again soon,
+            e.g. for the other frames of the logical file
+
+        Notes
+        -----
+
+        The yielded arrays are views of buffers that are re-used for later
+        blocks. To keep a block around after the next one is requested, make a
+        copy of it.
+
+        Examples
+        --------
+
+        Compute the mean of a curve without reading it all into memory
+
+        >>> total, count = 0.0, 0
+        >>> for block in frame.iter_curves(rows = 1000):
+        ...     total += block['CHANN1'].sum()
+        ...     count += len(block)
+        >>> mean = total / count
+
+        Keep the blocks, e.g. to concatenate them later
+
+        >>> blocks = [block.copy() for block in frame.iter_curves()]
+
+        See also
+        --------
+
+        Frame.curves : Read all the curves in one go
+
+        Yields
+        ------
+        curves : np.ndarray
+            Structured array of at most rows samples, like curves()
+        """
+        return iter_curves(self.file, self, self.dtype, "", self.fmtstr(), "",
+                           rows = rows,
+                           prefetch = prefetch,
+                           drop_behind = drop_behind)
+
+    def iter_columns(self, rows = 65536, channels = None, drop_behind = False):
+        """
+        Iterate over the curves column by column, a block of samples at a time
+
+        Like iter_curves, but every block is a dict of one array per channel,
+        rather than a structured array, which is what columnar formats like
+        arrow and parquet want. The columns are decoded straight from the
+        FDATA, so there is no structured array to transpose, and strings are
+        not made into python objects.
+
+        Only channels of plain numbers and strings are supported.
+
+        Parameters
+        ----------
+
+        rows : int, optional
+            Maximum number of samples in each block
+
+        channels : list of Channel or str, optional
+            Only read these channels, see curves
+
+        drop_behind : bool, optional
+            Drop the FDATA of every block from the OS page cache once it is
+            decoded, see iter_curves
+
+        Notes
+        -----
+
+        Unlike iter_curves, every block is a new set of arrays, which can be
+        kept without copying.
+
+        Examples
+        --------
+
+        >>> for block in frame.iter_columns(rows = 1000):
+        ...     depth = block['TDEP']
+
+        Yields
+        ------
+        columns : OrderedDict of str -> np.ndarray or StringColumn
+            Label (as in dtype) to the samples of the channel. Strings are
+            StringColumn, see dlisio.dlisutils.StringColumn
+        """
+        if channels is None: selected = list(range(len(self.channels)))
+        else:                selected = self.channelpositions(channels)
+        return iter_columns(self.file, self, selected,
+                            rows = rows,
+                            drop_behind = drop_behind)
+
+    def materialize(self):
+        """
+        Decode all the curves of the frame into one column per channel
+
+        All the channels are decoded in a single pass over the FDATA records,
+        into one contiguous array per channel, which is what reading many
+        channels of a frame one at a time wants. The columns are kept in the
+        cache of the logical file (see dlis.cache) if they fit, and
+        Channel.curves of the channels of the frame are then served from them,
+        with no I/O and no decoding, only a copy of the column.
+
+        Notes
+        -----
+
+        The numeric columns are read-only, as they are shared with the cache,
+        and returned without copying. Make a copy to modify them.
+
+        Examples
+        --------
+
+        >>> columns = frame.materialize()
+        >>> columns['TDEP']
+        array([...])
+        >>> frame.channels[0].curves() # no I/O
+
+        Returns
+        -------
+        columns : OrderedDict of str -> np.ndarray or StringColumn
+            Label (as in dtype) to the samples of the channel, see
+            iter_columns
+        """
+        columns = materialize(self.file, self)
+        return OrderedDict(columns)
+
+    def native_curves(self, threads = None, channels = None):
+        """
+        Returns the curves as a structured numpy array of plain numbers
+
+        Like curves, but channels of validated floats and object names are
+        decoded into numbers, rather than into a python object per sample.
+        Reading these channels is then about as fast as reading plain floats,
+        and the array uses a lot less memory.
+
+        Validated floats (FSING1, FDOUB1) are sub-structured pairs of
+        ('V', 'A'), i.e. value and absolute error, and two-way validated
+        floats (FSING2, FDOUB2) triples of ('V', 'A', 'B'), i.e. value and
+        bounds. Object names are int32 codes, like a categorical, and the
+        names are in the returned list, i.e. the name of code k is names[k].
+        All object name channels in the frame share the same list of names.
+
+        Frames with other channels that are not plain numbers, e.g. strings,
+        are not supported.
+
+        Parameters
+        ----------
+
+        threads : int, optional
+            Number of threads used to read the curves, see curves. Frames with
+            object names are always read with a single thread.
+
+        channels : list of Channel or str, optional
+            Only read the curves of these channels, see curves
+
+        Examples
+        --------
+
+        >>> curves, names = frame.native_curves()
+        >>> curves['TENS'].dtype
+        dtype([('V', '<f4'), ('A', '<f4')])
+        >>> curves['TENS']['V']
+        array([...], dtype=float32)
+        >>> names[curves['TOOL'][0]]
+        dlisio.core.obname(id='TOOL-A', origin=2, copynum=0)
+
+        Returns
+        -------
+        curves : np.ndarray
+        names : list of dlisio.core.obname
+        """
+        if channels is None: selected = list(range(len(self.channels)))
+        else:                selected = self.channelpositions(channels)
+
+        return native_curves(self.file, self, selected, threads = threads)
 
     def fmtstrchannel(self, channel):
         """Generate format-strings for one Frame channel
@@ -421,9 +714,11 @@ class Frame(BasicObject):
 
     def link(self, objects):
         super().link(objects)
+        # the dtype is made from the linked channels
+        self._dtype = None
         for ch in self.channels:
             try:
-                if ch.frame:
+                if ch.frame is not None and ch.frame is not self:
                     msg = ("Frame {} contract is broken. "
                            "Channel {} already belongs to frame {}. "
                            "Assigning a new one")
@@ -70,3 +70,17 @@ dtype = {
     26     : '?',                    #Boolean status
     27     : 'U255',                 #Units expression
 }
+
+""" reprc -> native type-string
+The type-strings of the representation codes that are decoded differently by
+Frame.native_curves, i.e. without making python objects of every sample.
+Validated floats become sub-structured (value, error) pairs, or (value, lower,
+upper) triples, and object names int32 codes, see Frame.native_curves.
+"""
+native_dtype = {
+    3      : [('V', 'f4'), ('A', 'f4')],                 #FSING1
+    4      : [('V', 'f4'), ('A', 'f4'), ('B', 'f4')],    #FSING2
+    8      : [('V', 'f8'), ('A', 'f8')],                 #FDOUB1
+    9      : [('V', 'f8'), ('A', 'f8'), ('B', 'f8')],    #FDOUB2
+    23     : 'i4',                                       #OBNAME
+}
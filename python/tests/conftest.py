@@ -8,6 +8,39 @@ def DWL206():
     with dlisio.load('data/206_05a-_3_DWL_DWL_WIRE_258276498.DLIS') as (f,):
         yield f
 
+class FileIndex(object):
+    """
+    The record index of a file, found with the core functions like
+    dlisio.load does, for tests of the core functions themselves
+    """
+    def __init__(self, path):
+        self.path = path
+        self.mmap = dlisio.core.mmap_source()
+        self.mmap.map(path)
+        self.sulpos = dlisio.core.findsul(self.mmap)
+        self.vrlpos = dlisio.core.findvrl(self.mmap, self.sulpos + 80)
+        offsets = dlisio.core.findoffsets(self.mmap, self.vrlpos)
+        self.tells, self.residuals, self.explicits = offsets
+
+    @property
+    def indices(self):
+        """ Indices of all the records """
+        return list(range(len(self.tells)))
+
+    @property
+    def explicit(self):
+        """ Indices of the explicitly formatted records """
+        return [i for i, x in enumerate(self.explicits) if x != 0]
+
+    @property
+    def implicit(self):
+        """ Indices of the implicitly formatted records, i.e. FDATA """
+        return [i for i, x in enumerate(self.explicits) if x == 0]
+
+@pytest.fixture(scope="module", name="DWL206_index")
+def DWL206_index():
+    return FileIndex('data/206_05a-_3_DWL_DWL_WIRE_258276498.DLIS')
+
 
 @pytest.fixture(scope="module")
 def merge_files_oneLR():
@@ -1,5 +1,6 @@
 import pytest
 import numpy as np
+import os
 from datetime import datetime
 
 import dlisio
@@ -390,3 +391,176 @@ def test_record_attributes():
     assert np.array(rec3)[1] == 8
 
     stream.close()
+
+def test_parallel_findoffsets(tmpdir, DWL206_index):
+    path = DWL206_index.path
+    vrlpos = DWL206_index.vrlpos
+
+    # repeat the visible records until the file is large enough to be split
+    # in chunks
+    with open(path, 'rb') as f:
+        content = f.read()
+    head, body = content[:vrlpos], content[vrlpos:]
+    repeat = (8 * 1024 * 1024) // len(body) + 1
+
+    big = str(tmpdir.join('big.dlis'))
+    with open(big, 'wb') as f:
+        f.write(head + body * repeat)
+
+    mmap = dlisio.core.mmap_source()
+    mmap.map(big)
+    expected = dlisio.core.findoffsets(mmap, vrlpos)
+    for threads in [2, 3, 8]:
+        assert dlisio.core.findoffsets(mmap, vrlpos, threads) == expected
+
+def test_groupfdata_same_as_findfdata(DWL206_index):
+    mmap = DWL206_index.mmap
+    tells, residuals = DWL206_index.tells, DWL206_index.residuals
+    implicits = DWL206_index.implicit
+
+    pairs = dlisio.core.findfdata(mmap, implicits, tells, residuals)
+    expected = {}
+    for fingerprint, i in pairs:
+        expected.setdefault(fingerprint, []).append(i)
+
+    groups = dlisio.core.groupfdata(mmap, implicits, tells, residuals)
+    assert len(groups) > 1
+    # the groups are ordered by the first record of the frame
+    assert [g.fingerprint for g in groups] == list(expected.keys())
+
+    for g in groups:
+        records = np.asarray(g)
+        assert records.dtype == np.int32
+        assert len(g) == len(records)
+        assert records.tolist() == expected[g.fingerprint]
+
+def test_mapped_stream_same_as_fstream(DWL206_index):
+    path = DWL206_index.path
+    sulpos = DWL206_index.sulpos
+    tells, residuals = DWL206_index.tells, DWL206_index.residuals
+    indices = DWL206_index.indices
+
+    plain = dlisio.open(path)
+    mapped = dlisio.open(path, mapped = True)
+    try:
+        assert not plain.mapped
+        assert mapped.mapped
+
+        plain.reindex(tells, residuals)
+        mapped.reindex(tells, residuals)
+
+        expected = plain.extract(indices)
+        result = mapped.extract(indices)
+        assert len(expected) == len(result)
+        for exp, res in zip(expected, result):
+            assert exp.type == res.type
+            assert exp.explicit == res.explicit
+            assert exp.consistent == res.consistent
+            assert bytes(memoryview(exp)) == bytes(memoryview(res))
+
+        buffer1, buffer2 = bytearray(80), bytearray(80)
+        plain.get(buffer1, sulpos, 80)
+        mapped.get(buffer2, sulpos, 80)
+        assert buffer1 == buffer2
+    finally:
+        plain.close()
+        mapped.close()
+
+def test_shared_source_same_as_fstream(DWL206_index):
+    path = DWL206_index.path
+    tells, residuals = DWL206_index.tells, DWL206_index.residuals
+    indices = DWL206_index.indices
+
+    plain = dlisio.open(path)
+    plain.reindex(tells, residuals)
+    expected = plain.extract(indices)
+    plain.close()
+
+    for mapped in [False, True]:
+        source = dlisio.core.source(path, mapped = mapped)
+        assert source.mapped == mapped
+        assert source.size == os.path.getsize(path)
+
+        first = dlisio.core.stream(source)
+        second = dlisio.core.stream(source)
+        assert first.mapped == mapped
+        first.reindex(tells, residuals)
+        second.reindex(tells, residuals)
+
+        # the streams read independently of each other, even when reads are
+        # interleaved
+        for i in indices:
+            j = len(indices) - 1 - i
+            a, b = first[i], second[j]
+            assert bytes(memoryview(a)) == bytes(memoryview(expected[i]))
+            assert bytes(memoryview(b)) == bytes(memoryview(expected[j]))
+
+        first.close()
+        with pytest.raises(RuntimeError):
+            _ = first[0]
+
+        result = second.extract(indices)
+        for exp, res in zip(expected, result):
+            assert bytes(memoryview(exp)) == bytes(memoryview(res))
+        second.close()
+
+def test_extract_batch_same_as_extract(DWL206_index):
+    path = DWL206_index.path
+    tells, residuals = DWL206_index.tells, DWL206_index.residuals
+    indices = DWL206_index.explicit
+
+    for mapped in [False, True]:
+        stream = dlisio.open(path, mapped = mapped)
+        try:
+            stream.reindex(tells, residuals)
+            expected = stream.extract(indices)
+            batch = stream.extract_batch(indices)
+        finally:
+            stream.close()
+
+        assert len(batch) == len(expected)
+        assert batch.types == [rec.type for rec in expected]
+        assert batch.offsets[0] == 0
+        assert batch.offsets[-1] == len(memoryview(batch))
+
+        for exp, res in zip(expected, batch):
+            assert exp.type == res.type
+            assert exp.explicit == res.explicit
+            assert exp.consistent == res.consistent
+            assert bytes(memoryview(exp)) == bytes(memoryview(res))
+
+        assert bytes(memoryview(batch[-1])) == bytes(memoryview(expected[-1]))
+        assert len(batch[2:5]) == 3
+        assert batch[2:5].types == batch.types[2:5]
+
+        expected_sets = dlisio.core.parse_objects(expected)
+        batch_sets = dlisio.core.parse_objects(batch)
+        assert len(expected_sets) == len(batch_sets)
+        for exp, res in zip(expected_sets, batch_sets):
+            assert exp.type == res.type
+            assert exp.name == res.name
+            assert len(exp.objects) == len(res.objects)
+
+        assert dlisio.core.set_types(batch) == dlisio.core.set_types(expected)
+
+def test_flat_objects_same_as_parse_objects(DWL206_index):
+    path = DWL206_index.path
+    tells, residuals = DWL206_index.tells, DWL206_index.residuals
+    indices = DWL206_index.explicit
+
+    stream = dlisio.open(path, mapped = True)
+    try:
+        stream.reindex(tells, residuals)
+        batch = stream.extract_batch(indices)
+    finally:
+        stream.close()
+
+    expected = dlisio.core.parse_objects(batch)
+    flat = dlisio.core.parse_flat_objects(batch)
+    assert len(expected) == len(flat)
+
+    for exp, res in zip(expected, flat):
+        assert exp.type == res.type
+        assert exp.name == res.name
+        assert exp.objects == res.objects
+        assert exp.objects == res.unflatten().objects
@@ -163,119 +163,102 @@ def test_units():
     assert curves[0][0] == 'unit'
 
 
-@pytest.mark.xfail(strict=True)
 def test_fshort_x2():
     fpath = 'data/chap4-7/iflr/reprcodes-x2/01-fshort.dlis'
     curves = load_curves(fpath)
     assert curves[0][0] == -1
     assert curves[1][0] == 153
 
-@pytest.mark.xfail(strict=True)
 def test_fsingl_x2():
     fpath = 'data/chap4-7/iflr/reprcodes-x2/02-fsingl.dlis'
     curves = load_curves(fpath)
     assert curves[0][0] == 5.5
     assert curves[1][0] == -13.75
 
-@pytest.mark.xfail(strict=True)
 def test_fsing1_x2():
     fpath = 'data/chap4-7/iflr/reprcodes-x2/03-fsing1.dlis'
     curves = load_curves(fpath)
     assert curves[0][0] == (-2, 2)
     assert curves[1][0] == (-2, 3.5)
 
-@pytest.mark.xfail(strict=True)
 def test_fsing2_x2():
     fpath = 'data/chap4-7/iflr/reprcodes-x2/04-fsing2.dlis'
     curves = load_curves(fpath)
     assert curves[0][0] == (117, -13.25, 32444)
     assert curves[1][0] == (3524454, 10, 20)
 
-@pytest.mark.xfail(strict=True)
 def test_isingl_x2():
     fpath = 'data/chap4-7/iflr/reprcodes-x2/05-isingl.dlis'
     curves = load_curves(fpath)
     assert curves[0][0] == -12
     assert curves[1][0] == 65536.5
 
-@pytest.mark.xfail(strict=True)
 def test_vsingl_x2():
     fpath = 'data/chap4-7/iflr/reprcodes-x2/06-vsingl.dlis'
     curves = load_curves(fpath)
     assert curves[0][0] == 0.125
     assert curves[1][0] == -26.5
 
-@pytest.mark.xfail(strict=True)
 def test_fdoubl_x2():
     fpath = 'data/chap4-7/iflr/reprcodes-x2/07-fdoubl.dlis'
     curves = load_curves(fpath)
     assert curves[0][0] == 900000000000000.5
     assert curves[1][0] == -153
 
-@pytest.mark.xfail(strict=True)
 def test_fdoub1_x2():
     fpath = 'data/chap4-7/iflr/reprcodes-x2/08-fdoub1.dlis'
     curves = load_curves(fpath)
     assert curves[0][0] == (-13.5, -27670)
     assert curves[1][0] == (5673345, 14)
 
-@pytest.mark.xfail(strict=True)
 def test_fdoub2_x2():
     fpath = 'data/chap4-7/iflr/reprcodes-x2/09-fdoub2.dlis'
     curves = load_curves(fpath)
     assert curves[0][0] == (6728332223, -45.75, -0.0625)
     assert curves[1][0] == (95637722454, 20, 5)
 
-@pytest.mark.xfail(strict=True)
 def test_csingl_x2():
     fpath = 'data/chap4-7/iflr/reprcodes-x2/10-csingl.dlis'
     curves = load_curves(fpath)
     assert curves[0][0] == complex(93, -14)
     assert curves[1][0] == complex(67, -37)
 
-@pytest.mark.xfail(strict=True)
 def test_cdoubl_x2():
     fpath = 'data/chap4-7/iflr/reprcodes-x2/11-cdoubl.dlis'
     curves = load_curves(fpath)
     assert curves[0][0] == complex(125533556, -4.75)
     assert curves[1][0] == complex(67, -37)
 
-@pytest.mark.xfail(strict=True)
 def test_sshort_x2():
     fpath = 'data/chap4-7/iflr/reprcodes-x2/12-sshort.dlis'
     curves = load_curves(fpath)
     assert curves[0][0] == 89
     assert curves[1][0] == -89
 
-@pytest.mark.xfail(strict=True)
 def test_snorm_x2():
     fpath = 'data/chap4-7/iflr/reprcodes-x2/13-snorm.dlis'
     curves = load_curves(fpath)
     assert curves[0][0] == -153
     assert curves[1][0] == 153
 
-@pytest.mark.xfail(strict=True)
 def test_slong_x2():
     fpath = 'data/chap4-7/iflr/reprcodes-x2/14-slong.dlis'
     curves = load_curves(fpath)
     assert curves[0][0] == 2147483647
     assert curves[1][0] == -1
 
-@pytest.mark.xfail(strict=True)
 def test_ushort_x2():
     fpath = 'data/chap4-7/iflr/reprcodes-x2/15-ushort.dlis'
     curves = load_curves(fpath)
     assert curves[0][0] == 6
     assert curves[1][0] == 217
 
-@pytest.mark.xfail(strict=True)
 def test_unorm_x2():
     fpath = 'data/chap4-7/iflr/reprcodes-x2/16-unorm.dlis'
     curves = load_curves(fpath)
     assert curves[0][0] == 32921
     assert curves[1][0] == 256
 
-@pytest.mark.xfail(strict=True)
 def test_ulong_x2():
     fpath = 'data/chap4-7/iflr/reprcodes-x2/17-ulong.dlis'
     curves = load_curves(fpath)
@@ -303,7 +286,6 @@ def test_ascii_x2():
     assert curves[0][0] == "Theory of mind"
     assert curves[1][0] == "this looks terrible"
 
-@pytest.mark.xfail(strict=True)
 def test_dtime_x2():
     fpath = 'data/chap4-7/iflr/reprcodes-x2/21-dtime.dlis'
     curves = load_curves(fpath)
@@ -340,7 +322,6 @@ def test_attref_x2():
     assert curves[0][0] == ex1_attref
     assert curves[1][0] == ex2_attref
 
-@pytest.mark.xfail(strict=True)
 def test_status_x2():
     fpath = 'data/chap4-7/iflr/reprcodes-x2/26-status.dlis'
     curves = load_curves(fpath)
@@ -355,6 +336,77 @@ def test_units_x2():
     assert curves[1][0] == "unit2"
 
 
+def test_fdata_plan():
+    fpath = 'data/chap4-7/iflr/reprcodes-x2/01-fshort.dlis'
+    with dlisio.load(fpath) as (f, *_):
+        frame = f.object('FRAME', 'FRAME-REPRCODE', 10, 0)
+        indices = f.fdata_index[frame.fingerprint]
+        plan = dlisio.core.plan_fdata(f.file, indices, frame.fmtstr())
+
+        assert len(plan) == 1
+        assert plan.rows == 2
+        assert not plan.uniform
+        assert memoryview(plan).tolist() == [0, 2]
+
+def test_x2_readers():
+    # the readers continue in the record when it holds more than one frame
+    fpath = 'data/chap4-7/iflr/reprcodes-x2/01-fshort.dlis'
+    with dlisio.load(fpath) as (f, *_):
+        frame = f.object('FRAME', 'FRAME-REPRCODE', 10, 0)
+        name = frame.dtype.names[0]
+
+        blocks = list(frame.iter_curves(rows = 1))
+        assert [len(b) for b in blocks] == [1, 1]
+        assert blocks[1][0][0] == 153
+
+        blocks = list(frame.iter_columns(rows = 1))
+        assert [len(b[name]) for b in blocks] == [1, 1]
+
+        columns = frame.materialize()
+        assert columns[name].tolist() == [-1, 153]
+
+        a, _ = frame.native_curves()
+        assert len(a) == 2
+
+def test_fdata_plan_mismatch():
+    # records must hold exactly the rows in the plan, no more and no fewer
+    x1 = 'data/chap4-7/iflr/reprcodes/01-fshort.dlis'
+    x2 = 'data/chap4-7/iflr/reprcodes-x2/01-fshort.dlis'
+    with dlisio.load(x1) as (f1, *_), dlisio.load(x2) as (f2, *_):
+        def setup(f):
+            frame = f.object('FRAME', 'FRAME-REPRCODE', 10, 0)
+            indices = f.fdata_index[frame.fingerprint]
+            plan = dlisio.core.plan_fdata(f.file, indices, frame.fmtstr())
+            def read(plan):
+                a = np.empty(shape = 2, dtype = frame.dtype)
+                dlisio.core.read_fdata('', frame.fmtstr(), '', f.file,
+                                       indices, a, 1, plan)
+            return plan, read
+
+        plan1, read1 = setup(f1)
+        plan2, read2 = setup(f2)
+        assert plan1.rows == 1
+        assert plan2.rows == 2
+
+        with pytest.raises(dlisio.core.MultipleFramesError):
+            read2(None)
+
+        with pytest.raises(RuntimeError) as exc:
+            read2(plan1)
+        assert 'more than 1 frames, but the plan has 1' in str(exc.value)
+
+        with pytest.raises(RuntimeError) as exc:
+            read1(plan2)
+        assert 'holds 1 frames, but the plan has 2' in str(exc.value)
+
+def test_fdata_plan_variable_size():
+    fpath = 'data/chap4-7/iflr/reprcodes-x2/20-ascii.dlis'
+    with dlisio.load(fpath) as (f, *_):
+        frame = f.object('FRAME', 'FRAME-REPRCODE', 10, 0)
+        indices = f.fdata_index[frame.fingerprint]
+        with pytest.raises(ValueError):
+            _ = dlisio.core.plan_fdata(f.file, indices, frame.fmtstr())
+
 def test_all_reprcodes():
     fpath = 'data/chap4-7/iflr/all-reprcodes.dlis'
     curves = load_curves(fpath)
@@ -521,7 +573,121 @@ def test_fdata_tuple_dimension():
         assert curves[0][0][1] == (43, 0.0625, 0.0625)
         assert curves[0][0][2] == (71, 0.5, 0.5)
 
-@pytest.mark.xfail(strict=True)
+def load_columns(fpath):
+    with dlisio.load(fpath) as (f, *_):
+        frame = f.object('FRAME', 'FRAME-REPRCODE', 10, 0)
+        blocks = list(frame.iter_columns())
+        assert len(blocks) == 1
+        return list(blocks[0].values())
+
+def test_iter_columns_strings():
+    ident, = load_columns('data/chap4-7/iflr/reprcodes/19-ident.dlis')
+    assert ident.tolist() == ['VALUE']
+
+    ascii, = load_columns('data/chap4-7/iflr/reprcodes/20-ascii.dlis')
+    assert ascii.tolist() == ['Thou shalt not kill']
+    assert len(ascii) == 1
+
+    units, = load_columns('data/chap4-7/iflr/reprcodes/27-units.dlis')
+    assert units.tolist() == ['unit']
+
+def test_iter_columns_only_strings(tmpdir):
+    # 19-ident.dlis with two more FDATA (frames 2 and 3) appended
+    with open('data/chap4-7/iflr/reprcodes/19-ident.dlis', 'rb') as f:
+        b = bytearray(f.read())
+
+    fdata = b[b.rindex(b'\x0a\x00\x0eFRAME-REPRCODE') - 4:]
+    for frameno, value in [(2, b'OTHER'), (3, b'THIRD')]:
+        record = bytearray(fdata)
+        record[21] = frameno
+        record[23:] = value
+        b += record
+
+    vrl = len(b) - 80
+    b[80], b[81] = vrl // 256, vrl % 256
+
+    path = str(tmpdir.join('ident-x3.dlis'))
+    with open(path, 'wb') as f:
+        f.write(b)
+
+    with dlisio.load(path) as (f, *_):
+        frame = f.object('FRAME', 'FRAME-REPRCODE', 10, 0)
+        columns = [column for column, in
+                   (block.values() for block in frame.iter_columns(rows = 1))]
+        assert [column.tolist() for column in columns] == [
+            ['VALUE'], ['OTHER'], ['THIRD']
+        ]
+
+def test_iter_columns_numbers():
+    fshort, = load_columns('data/chap4-7/iflr/reprcodes/01-fshort.dlis')
+    assert fshort[0] == -1
+
+    uvari, = load_columns('data/chap4-7/iflr/reprcodes/18-uvari.dlis')
+    assert uvari[0] == 257
+
+def test_iter_columns_unsupported_reprc():
+    fpath = 'data/chap4-7/iflr/reprcodes/23-obname.dlis'
+    with dlisio.load(fpath) as (f, *_):
+        frame = f.object('FRAME', 'FRAME-REPRCODE', 10, 0)
+        with pytest.raises(ValueError):
+            _ = list(frame.iter_columns())
+
+def test_iter_columns_dimension():
+    fpath = 'data/chap4-7/iflr/multidimensions-ints-various.dlis'
+
+    with dlisio.load(fpath) as (f, *_):
+        frame = f.object('FRAME', 'FRAME-DIMENSION', 11, 0)
+        curves = frame.curves()
+        block, = list(frame.iter_columns())
+
+        assert list(block.keys()) == list(curves.dtype.names)
+        for name, column in block.items():
+            np.testing.assert_array_equal(column, curves[name])
+
+def load_native(fpath):
+    with dlisio.load(fpath) as (f, *_):
+        frame = f.object('FRAME', 'FRAME-REPRCODE', 10, 0)
+        return frame.native_curves()
+
+def test_native_validated_floats():
+    fpath = 'data/chap4-7/iflr/reprcodes/03-fsing1.dlis'
+    curves, _ = load_native(fpath)
+    assert curves.dtype[0] == np.dtype([('V', 'f4'), ('A', 'f4')])
+    assert curves[0][0] == (-2, 2)
+    assert curves[curves.dtype.names[0]]['V'][0] == -2
+
+    fpath = 'data/chap4-7/iflr/reprcodes/04-fsing2.dlis'
+    curves, _ = load_native(fpath)
+    assert curves[0][0] == (117, -13.25, 32444)
+
+    fpath = 'data/chap4-7/iflr/reprcodes/08-fdoub1.dlis'
+    curves, _ = load_native(fpath)
+    assert curves.dtype[0] == np.dtype([('V', 'f8'), ('A', 'f8')])
+    assert curves[0][0] == (-13.5, -27670)
+
+    fpath = 'data/chap4-7/iflr/reprcodes/09-fdoub2.dlis'
+    curves, _ = load_native(fpath)
+    assert curves[0][0] == (6728332223, -45.75, -0.0625)
+
+def test_native_obname():
+    fpath = 'data/chap4-7/iflr/reprcodes/23-obname.dlis'
+    curves, names = load_native(fpath)
+    assert curves.dtype[0] == np.dtype('i4')
+    assert curves[0][0] == 0
+    assert len(names) == 1
+    assert names[0] == (18, 5, 'OBNAME_I')
+
+def test_native_plain_numbers():
+    fpath = 'data/chap4-7/iflr/reprcodes/02-fsingl.dlis'
+    curves, names = load_native(fpath)
+    assert curves[0][0] == 5.5
+    assert names == []
+
+def test_native_unsupported_reprc():
+    fpath = 'data/chap4-7/iflr/reprcodes/20-ascii.dlis'
+    with pytest.raises(ValueError):
+        _ = load_native(fpath)
+
 def test_fdata_dimensions_in_multifdata():
     fpath = 'data/chap4-7/iflr/multidimensions-multifdata.dlis'
 
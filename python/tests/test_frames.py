@@ -18,6 +18,287 @@ def test_frame_getitem(DWL206):
     assert curves['TDEP'][0] == 852606.0
     assert curves[0]['TDEP'] == 852606.0
 
+def test_frame_curves_threads(DWL206, monkeypatch):
+    # read from the file every time, not from the cache
+    monkeypatch.setattr(DWL206.cache, 'budget', 0)
+    frame = DWL206.object('FRAME', '2000T', 2, 0)
+    serial = frame.curves(threads = 1)
+
+    for threads in [2, 3, 64]:
+        np.testing.assert_array_equal(frame.curves(threads = threads), serial)
+
+    channel = DWL206.object('CHANNEL', 'TDEP', 2, 0)
+    np.testing.assert_array_equal(channel.curves(threads = 4), serial['TDEP'])
+
+def test_frame_curves_cached(DWL206, monkeypatch):
+    monkeypatch.setattr(DWL206, 'cache', dlisio.cache.Cache())
+    frame = DWL206.object('FRAME', '2000T', 2, 0)
+
+    expected = frame.curves()
+    before = DWL206.stats
+
+    # the second read costs no I/O and no decoding, and modifying the curves
+    # does not modify the cache
+    curves = frame.curves()
+    np.testing.assert_array_equal(curves, expected)
+    curves['TIME'][:] = 0
+    np.testing.assert_array_equal(frame.curves(), expected)
+
+    after = DWL206.stats
+    assert after['records_read'] == before['records_read']
+    assert after['frames_decoded'] == before['frames_decoded']
+    assert after['cache']['hits'] == 2
+
+    # the sibling channels are decoded from the cached records
+    for name in ['TIME', 'TDEP']:
+        channel = DWL206.object('CHANNEL', name, 2, 0)
+        np.testing.assert_array_equal(channel.curves(), expected[name])
+        np.testing.assert_array_equal(channel.curves(), expected[name])
+
+    channels = frame.curves(channels = ['TDEP'])
+    np.testing.assert_array_equal(channels['TDEP'], expected['TDEP'])
+
+    stats = DWL206.stats
+    assert stats['records_read'] == before['records_read']
+    if dlisio.core.stats.enabled:
+        decoded = stats['frames_decoded'] - before['frames_decoded']
+        assert decoded == 3 * len(expected)
+
+    # shrinking the budget evicts the least recently used entries
+    cache = DWL206.cache
+    assert cache.nbytes <= cache.budget
+    cache.budget = cache.nbytes // 2
+    assert cache.nbytes <= cache.budget
+    assert cache.stats['evictions'] > 0
+    np.testing.assert_array_equal(frame.curves(), expected)
+
+def test_frame_materialize(DWL206, monkeypatch):
+    monkeypatch.setattr(DWL206, 'cache', dlisio.cache.Cache())
+    frame = DWL206.object('FRAME', '2000T', 2, 0)
+    expected = frame.curves()
+
+    columns = frame.materialize()
+    assert list(columns.keys()) == list(frame.dtype.names)
+    for name, column in columns.items():
+        np.testing.assert_array_equal(column, expected[name])
+        assert column.flags['C_CONTIGUOUS']
+        with pytest.raises(ValueError):
+            column[0] = 0
+
+    # the channels are served from the materialized columns, which the
+    # returned curves do not share
+    before = DWL206.stats
+    for ch in frame.channels:
+        curves = ch.curves()
+        np.testing.assert_array_equal(curves, expected[ch.name])
+        assert curves.flags.writeable
+
+    after = DWL206.stats
+    assert after['records_read'] == before['records_read']
+    assert after['frames_decoded'] == before['frames_decoded']
+
+def test_cache_lru():
+    cache = dlisio.cache.Cache(budget = 10)
+    assert cache.put(('a', 1), 'x', 4)
+    assert cache.put(('a', 2), 'y', 4)
+    assert cache.get(('a', 1)) == 'x'
+
+    # ('a', 2) is the least recently used
+    assert cache.put(('b', 1), 'z', 4)
+    assert ('a', 2) not in cache
+    assert cache.get(('a', 2)) is None
+    assert cache.nbytes == 8
+    assert cache.stats == {
+        'entries'   : 2,
+        'bytes'     : 8,
+        'budget'    : 10,
+        'hits'      : 1,
+        'misses'    : 1,
+        'evictions' : 1,
+    }
+
+    # too large values are not cached at all
+    assert not cache.put(('b', 2), 'w', 11)
+    assert len(cache) == 2
+
+    cache.invalidate('a')
+    assert list(cache.entries) == [('b', 1)]
+
+    cache.budget = 0
+    assert len(cache) == 0
+    assert cache.nbytes == 0
+
+    # a disabled cache holds nothing, not even empty values
+    assert not cache.fits(0)
+    assert not cache.put(('c', 1), None, 0)
+    assert len(cache) == 0
+
+    with pytest.raises(ValueError):
+        cache.budget = -1
+
+def test_frame_curves_unmapped_stream(DWL206, DWL206_index):
+    path = DWL206_index.path
+    frame = DWL206.object('FRAME', '2000T', 2, 0)
+    expected = frame.curves()
+    indices = DWL206.fdata_index[frame.fingerprint]
+
+    tells, residuals = DWL206_index.tells, DWL206_index.residuals
+
+    stream = dlisio.open(path, mapped = False)
+    try:
+        stream.reindex(tells, residuals)
+        curves = np.empty(shape = len(indices), dtype = expected.dtype)
+        fmt = frame.fmtstr()
+        dlisio.core.read_fdata('', fmt, '', stream, indices, curves, 4)
+    finally:
+        stream.close()
+
+    np.testing.assert_array_equal(curves, expected)
+
+def test_frame_iter_columns(DWL206):
+    frame = DWL206.object('FRAME', '2000T', 2, 0)
+    curves = frame.curves()
+
+    blocks = list(frame.iter_columns(rows = 7))
+    assert len(blocks) == (len(curves) + 6) // 7
+    for name in curves.dtype.names:
+        column = np.concatenate([block[name] for block in blocks])
+        np.testing.assert_array_equal(column, curves[name])
+
+    block, = list(frame.iter_columns(channels = ['TDEP'], rows = len(curves)))
+    assert list(block.keys()) == ['TDEP']
+    np.testing.assert_array_equal(block['TDEP'], curves['TDEP'])
+
+def test_frame_native_curves(DWL206):
+    frame = DWL206.object('FRAME', '2000T', 2, 0)
+    curves, names = frame.native_curves()
+    np.testing.assert_array_equal(curves, frame.curves())
+    assert names == []
+
+    curves, _ = frame.native_curves(channels = ['TDEP'], threads = 2)
+    np.testing.assert_array_equal(curves, frame.curves(channels = ['TDEP']))
+
+def test_frame_export_arrow(DWL206, tmpdir):
+    pa = pytest.importorskip('pyarrow')
+    pq = pytest.importorskip('pyarrow.parquet')
+
+    frame = DWL206.object('FRAME', '2000T', 2, 0)
+    curves = frame.curves()
+
+    batches = list(dlisio.export.record_batches(frame, rows = 10))
+    table = pa.Table.from_batches(batches)
+    assert table.schema == dlisio.export.schema(frame)
+    assert table.column_names == list(curves.dtype.names)
+    for name in curves.dtype.names:
+        np.testing.assert_array_equal(table.column(name).to_numpy(),
+                                      curves[name])
+
+    path = str(tmpdir.join('2000T.parquet'))
+    dlisio.export.write_parquet(frame, path, rows = 10)
+    assert pq.read_table(path).equals(table)
+
+    path = str(tmpdir.join('2000T.arrow'))
+    dlisio.export.write_ipc(frame, path, channels = ['TDEP'])
+    with pa.ipc.open_file(path) as reader:
+        result = reader.read_all()
+    np.testing.assert_array_equal(result.column('TDEP').to_numpy(),
+                                  curves['TDEP'])
+
+def test_frame_curves_channels(DWL206):
+    frame = DWL206.object('FRAME', '2000T', 2, 0)
+    full = frame.curves()
+
+    curves = frame.curves(channels = ['TDEP', 'TIME'])
+    assert curves.dtype.names == ('TIME', 'TDEP')
+    np.testing.assert_array_equal(curves['TIME'], full['TIME'])
+    np.testing.assert_array_equal(curves['TDEP'], full['TDEP'])
+
+    channels = frame.channels
+    curves = frame.curves(channels = [channels[-1], channels[0]], threads = 3)
+    assert curves.dtype.names == (full.dtype.names[0], full.dtype.names[-1])
+    for name in curves.dtype.names:
+        np.testing.assert_array_equal(curves[name], full[name])
+
+    with pytest.raises(ValueError):
+        frame.curves(channels = ['NOT-A-CHANNEL'])
+
+def test_frame_curves_range(DWL206):
+    frame = DWL206.object('FRAME', '2000T', 2, 0)
+    full = frame.curves()
+    index = full[frame.dtype.names[0]]
+
+    low, high = np.percentile(index, [20, 30])
+    curves = frame.curves(range = (low, high))
+    mask = (index >= low) & (index <= high)
+    assert 0 < len(curves) < len(full)
+    np.testing.assert_array_equal(curves, full[mask])
+
+    # the order of the bounds does not matter
+    np.testing.assert_array_equal(frame.curves(range = (high, low)), curves)
+
+    tdep = frame.curves(range = (low, high), channels = ['TDEP'])
+    np.testing.assert_array_equal(tdep['TDEP'], full['TDEP'][mask])
+
+    outside = index.max() + 1
+    assert len(frame.curves(range = (outside, outside + 1))) == 0
+
+    everything = frame.curves(range = (index.min(), index.max()))
+    np.testing.assert_array_equal(everything, full)
+
+def test_frame_curves_range_framenos():
+    # without an index channel, the range is over frame numbers
+    fpath = 'data/chap4-7/iflr/reprcodes/02-fsingl.dlis'
+    with dlisio.load(fpath) as (f, *_):
+        frame = f.object('FRAME', 'FRAME-REPRCODE', 10, 0)
+        assert frame.index_type is None
+
+        full = frame.curves()
+        np.testing.assert_array_equal(frame.curves(range = (0, 100)), full)
+        assert len(frame.curves(range = (-10, -1))) == 0
+
+def test_frame_iter_curves(DWL206):
+    frame = DWL206.object('FRAME', '2000T', 2, 0)
+    expected = frame.curves()
+
+    for rows in [1, 7, 100, len(expected), 10000]:
+        for prefetch in [True, False]:
+            blocks = [b.copy() for b in frame.iter_curves(rows, prefetch)]
+            assert all(len(b) <= rows for b in blocks)
+            np.testing.assert_array_equal(np.concatenate(blocks), expected)
+
+    channel = DWL206.object('CHANNEL', 'TDEP', 2, 0)
+    blocks = [b.copy() for b in channel.iter_curves(rows = 50)]
+    np.testing.assert_array_equal(np.concatenate(blocks), expected['TDEP'])
+
+    with pytest.raises(ValueError):
+        next(frame.iter_curves(rows = 0))
+
+def test_frame_iter_drop_behind(DWL206):
+    frame = DWL206.object('FRAME', '2000T', 2, 0)
+    expected = frame.curves()
+
+    # dropping the pages behind the reader must not change what is read, also
+    # when the file is read again afterwards
+    for _ in range(2):
+        blocks = [b.copy() for b in frame.iter_curves(7, drop_behind = True)]
+        np.testing.assert_array_equal(np.concatenate(blocks), expected)
+
+    blocks = list(frame.iter_columns(rows = 7, drop_behind = True))
+    for name in expected.dtype.names:
+        column = np.concatenate([block[name] for block in blocks])
+        np.testing.assert_array_equal(column, expected[name])
+
+    np.testing.assert_array_equal(frame.curves(), expected)
+
+def test_frame_iter_curves_close_early(DWL206):
+    frame = DWL206.object('FRAME', '2000T', 2, 0)
+    expected = frame.curves()
+
+    blocks = frame.iter_curves(rows = 10)
+    first = next(blocks).copy()
+    blocks.close()
+    np.testing.assert_array_equal(first, expected[:10])
+
 def makeframe():
     frame = dlisio.plumbing.Frame()
     frame.name = 'MAINFRAME'
@@ -144,15 +144,15 @@ def test_padbytes_encrypted():
 def test_load_fdata_VR_aligned():
     with dlisio.load('data/chap2/fdata-vr-aligned.dlis') as (f, *_):
         assert len(f.fdata_index) == 1
-        assert f.fdata_index['T.FRAME-I.DLIS-FRAME-O.3-C.1'] == [0]
+        assert f.fdata_index['T.FRAME-I.DLIS-FRAME-O.3-C.1'].tolist() == [0]
 
 def test_load_fdata_many_in_same_VR():
     with dlisio.load('data/chap2/fdata-many-in-same-vr.dlis') as (f, *_):
         assert len(f.fdata_index) == 2
-        assert f.fdata_index['T.FRAME-I.DLIS-FRAME-O.3-C.1'] == [0, 1]
+        assert f.fdata_index['T.FRAME-I.DLIS-FRAME-O.3-C.1'].tolist() == [0, 1]
         ident = '3'*255
         fingerprint = 'T.FRAME-I.'+ident+'-O.1073741823-C.255'
-        assert f.fdata_index[fingerprint] == [3]
+        assert f.fdata_index[fingerprint].tolist() == [3]
 
 def test_3lrs_in_lr_in_vr():
     with dlisio.load('data/chap2/example-record.dlis'):
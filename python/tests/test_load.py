@@ -1,3 +1,4 @@
+import numpy as np
 import pytest
 
 import dlisio
@@ -25,6 +26,40 @@ def fpath(tmpdir_factory, merge_files_manyLR):
     merge_files_manyLR(path, content)
     return path
 
+@pytest.fixture(scope="module")
+def storage_set(tmpdir_factory, merge_files_manyLR):
+    # The second logical file of fpath, segmented across two physical files
+    # and followed by the third, file-header only, logical file
+    root = tmpdir_factory.mktemp('storage-set')
+    first = str(root.join('first.dlis'))
+    second = str(root.join('second.dlis'))
+    merge_files_manyLR(first, [
+        'data/chap4-7/eflr/envelope.dlis.part',
+        'data/chap4-7/eflr/file-header2.dlis.part',
+        'data/chap4-7/eflr/origin2.dlis.part',
+        'data/chap4-7/eflr/channel-inc.dlis.part',
+        'data/chap4-7/eflr/frame-inc.dlis.part',
+        'data/chap4-7/eflr/fdata-frame-inc-1.dlis.part',
+    ])
+    merge_files_manyLR(second, [
+        'data/chap4-7/eflr/envelope.dlis.part',
+        'data/chap4-7/eflr/frame.dlis.part',
+        'data/chap4-7/eflr/fdata-frame-inc-2.dlis.part',
+        'data/chap4-7/eflr/file-header.dlis.part',
+    ])
+    return [first, second]
+
+def assert_same_logical_file(f, expected):
+    assert f.explicit_indices == expected.explicit_indices
+    assert f.fdata_index.keys() == expected.fdata_index.keys()
+    for fingerprint, records in expected.fdata_index.items():
+        np.testing.assert_array_equal(f.fdata_index[fingerprint], records)
+
+    for t, objects in expected.indexedobjects.items():
+        assert set(f.indexedobjects[t]) == set(objects)
+        for fingerprint, obj in objects.items():
+            assert f.indexedobjects[t][fingerprint].attic == obj.attic
+
 def test_context_manager(fpath):
     f, *_ = dlisio.load(fpath)
     _ = f.fileheader
@@ -74,7 +109,7 @@ def test_partitioning(fpath):
         assert not f1.fdata_index
 
         assert f2.explicit_indices == [0, 1, 2, 3, 5]
-        assert f2.fdata_index[key] == [4, 6]
+        assert f2.fdata_index[key].tolist() == [4, 6]
 
         assert f3.explicit_indices == [0]
         assert not f3.fdata_index
@@ -123,6 +158,27 @@ def test_objects_with_encrypted_records(tmpdir_factory, merge_files_manyLR):
         assert len(f1_channel.dimension) == 3
         assert len(f2_channel.dimension) == 1
 
+        # the bodies of the encrypted records are never read, but their
+        # headers are still in the attic
+        for f in [f1, f2]:
+            encrypted = f.encrypted_records()
+            assert len(encrypted) == 1
+            assert encrypted[0].encrypted
+            assert encrypted[0].explicit
+            assert encrypted[0].type == 2
+            assert encrypted[0].size > 0
+
+            k = f.explicit_indices.index(encrypted[0].index)
+            assert f.attic.encrypted[k]
+            assert f.attic.types[k] == 2
+            assert len(memoryview(f.attic[k])) == 0
+
+            if dlisio.core.stats.enabled:
+                assert f.stats['records_skipped'] == 2
+                assert f.stats['bytes_skipped'] == sum(
+                    e.size for g in [f1, f2] for e in g.encrypted_records()
+                )
+
 def test_link(fpath):
     with dlisio.load(fpath) as (f1, f2, _):
         frame1  = f1.object('FRAME', 'FRAME1', 10, 0)
@@ -148,6 +204,361 @@ def test_curves(fpath):
         assert curves['INC-CH1'][1] == 100
         assert curves[1]['INC-CH1'] == 100
 
+def test_logical_files_share_source(fpath):
+    with dlisio.load(fpath) as files:
+        sources = [f.file.sources for f in files]
+        assert all(len(x) == 1 for x in sources)
+        assert all(x[0].mapped for x in sources)
+        assert all(x[0].path == fpath for x in sources)
+
+        # closing one logical file only releases its share of the source, the
+        # others can still be read
+        f1, f2, _ = files
+        f1.close()
+        frame = f2.object('FRAME', 'FRAME-INC', 10, 0)
+        curves = frame.curves()
+        assert curves['INC-CH1'][0] == 150
+        assert curves['INC-CH1'][1] == 100
+
+def test_index_sidecar(fpath, tmpdir):
+    index = str(tmpdir.join('manylogfiles.dlis.idx'))
+    key = dlisio.core.fingerprint('FRAME', 'FRAME-INC', 10, 0)
+
+    def check(files):
+        f1, f2, f3 = files
+        assert f1.explicit_indices == [0, 1, 2]
+        assert f2.explicit_indices == [0, 1, 2, 3, 5]
+        assert f2.fdata_index[key].tolist() == [4, 6]
+        assert f3.explicit_indices == [0]
+
+        frame = f2.object('FRAME', 'FRAME-INC', 10, 0)
+        curves = frame.curves()
+        assert curves['INC-CH1'][0] == 150
+        assert curves['INC-CH1'][1] == 100
+
+    # the first load scans the file and writes the index
+    with dlisio.load(fpath, index = index) as files:
+        check(files)
+
+    with open(index, 'rb') as f:
+        cached = f.read()
+        assert cached.startswith(dlisio.indexcache.MAGIC)
+
+    # the second load reads the index, and leaves it be
+    with dlisio.load(fpath, index = index) as files:
+        check(files)
+
+    with open(index, 'rb') as f:
+        assert f.read() == cached
+
+def test_index_sidecar_stale(fpath, tmpdir):
+    index = str(tmpdir.join('stale.idx'))
+
+    # an index for a different file is ignored and replaced
+    with dlisio.load('data/chap4-7/iflr/all-reprcodes.dlis', index = index):
+        pass
+
+    with dlisio.load(fpath, index = index) as (_, f2, _):
+        key = dlisio.core.fingerprint('FRAME', 'FRAME-INC', 10, 0)
+        assert f2.fdata_index[key].tolist() == [4, 6]
+
+    key = dlisio.indexcache.filekey(fpath)
+    with open(index, 'rb') as f:
+        assert dlisio.indexcache.loads(key, f.read()) is not None
+
+    # so is garbage
+    with open(index, 'wb') as f:
+        f.write(b'garbage')
+
+    with dlisio.load(fpath, index = index) as (_, f2, _):
+        key = dlisio.core.fingerprint('FRAME', 'FRAME-INC', 10, 0)
+        assert f2.fdata_index[key].tolist() == [4, 6]
+
+def test_lazy(fpath):
+    with dlisio.load(fpath) as eager, dlisio.load(fpath, lazy = True) as lazy:
+        for e, l in zip(eager, lazy):
+            assert len(l.unparsed) > 0
+
+            # accessing channels parses channels, and frames for the
+            # channel -> frame back-link, but not the file header
+            assert len(l.channels) == len(e.channels)
+            assert 'CHANNEL' not in l.unparsed
+            assert 'FRAME' not in l.unparsed
+            assert 'FILE-HEADER' in l.unparsed or e.fileheader is None
+
+            for ch in l.channels:
+                fp = ch.fingerprint
+                assert ch.attic == e.indexedobjects['CHANNEL'][fp].attic
+
+            assert ((l.fileheader is None and e.fileheader is None)
+                 or l.fileheader.attic == e.fileheader.attic)
+
+            lobjects = {t : set(v) for t, v in l.indexedobjects.items() if v}
+            eobjects = {t : set(v) for t, v in e.indexedobjects.items() if v}
+            assert lobjects == eobjects
+            assert not l.unparsed
+
+        _, f2, _ = lazy
+        frame = f2.object('FRAME', 'FRAME-INC', 10, 0)
+        curves = frame.curves()
+        assert curves['INC-CH1'][0] == 150
+        assert curves['INC-CH1'][1] == 100
+
+def test_load_types():
+    path = 'data/206_05a-_3_DWL_DWL_WIRE_258276498.DLIS'
+    types = ['CHANNEL', 'FRAME']
+    with dlisio.load(path) as (e, *_):
+        for lazy in [False, True]:
+            with dlisio.load(path, types = types, lazy = lazy) as (f, *_):
+                loaded = [t for t, v in f.indexedobjects.items() if v]
+                assert sorted(loaded) == types
+                assert not f.tools
+                assert f.fileheader is None
+
+                for t in types:
+                    objects = e.indexedobjects[t]
+                    assert set(f.indexedobjects[t]) == set(objects)
+                    for fingerprint, obj in objects.items():
+                        attic = f.indexedobjects[t][fingerprint].attic
+                        assert attic == obj.attic
+
+                frame = f.object('FRAME', '2000T', 2, 0)
+                expected = e.object('FRAME', '2000T', 2, 0)
+                assert ([ch.fingerprint for ch in frame.channels] ==
+                        [ch.fingerprint for ch in expected.channels])
+                np.testing.assert_array_equal(frame.curves(),
+                                              expected.curves())
+
+def test_load_names():
+    path = 'data/206_05a-_3_DWL_DWL_WIRE_258276498.DLIS'
+    with dlisio.load(path) as (e, *_):
+        expected = [ch for ch in e.channels if ch.name == 'TDEP']
+        assert expected
+
+        with dlisio.load(path, types = ['CHANNEL'],
+                         names = ['TDEP']) as (f, *_):
+            assert sorted(ch.fingerprint for ch in f.channels) == sorted(
+                   ch.fingerprint for ch in expected)
+            for ch in f.channels:
+                fingerprint = ch.fingerprint
+                assert ch.attic == e.indexedobjects['CHANNEL'][fingerprint].attic
+
+        # like match, the pattern is anchored at the start of the name, and
+        # not case-sensitive
+        matched = {o.fingerprint for o in e.match('t.ep', type = '.*')}
+        with dlisio.load(path, names = 't.ep') as (f, *_):
+            loaded = {fp for v in f.indexedobjects.values() for fp in v}
+            assert loaded == matched
+
+def test_load_names_invalid_pattern():
+    path = 'data/206_05a-_3_DWL_DWL_WIRE_258276498.DLIS'
+    with pytest.raises(ValueError):
+        _ = dlisio.load(path, names = '(')
+
+def test_load_many(fpath):
+    paths = [fpath, 'data/206_05a-_3_DWL_DWL_WIRE_258276498.DLIS']
+
+    with dlisio.load(paths[0]) as head, dlisio.load(paths[1]) as tail:
+        expected = list(head) + list(tail)
+
+        with dlisio.load_many(paths, threads = 2) as files:
+            assert len(files) == len(expected)
+            for f, e in zip(files, expected):
+                assert_same_logical_file(f, e)
+
+            frame = files[-1].object('FRAME', '2000T', 2, 0)
+            e = expected[-1].object('FRAME', '2000T', 2, 0)
+            np.testing.assert_array_equal(frame.curves(), e.curves())
+
+def test_load_many_segmented(fpath, storage_set):
+    with dlisio.load(fpath) as (_, e2, e3):
+        with dlisio.load_many(storage_set) as (f1, f2):
+            assert_same_logical_file(f1, e2)
+            assert_same_logical_file(f2, e3)
+
+            # the stitched logical file reads frames from both physical files
+            frame = f1.object('FRAME', 'FRAME-INC', 10, 0)
+            curves = frame.curves()
+            assert curves['INC-CH1'][0] == 150
+            assert curves['INC-CH1'][1] == 100
+
+            assert f1.storage_label() == e2.storage_label()
+
+def test_load_many_segmented_lazy(storage_set):
+    with dlisio.load_many(storage_set, lazy = True) as (f1, _):
+        assert 'FRAME' in f1.unparsed
+        frame = f1.object('FRAME', 'FRAME-INC', 10, 0)
+        curves = frame.curves()
+        assert curves['INC-CH1'][0] == 150
+        assert curves['INC-CH1'][1] == 100
+
+def test_load_many_closes_on_error(fpath, monkeypatch):
+    failing = 'data/206_05a-_3_DWL_DWL_WIRE_258276498.DLIS'
+    assemble = dlisio.assemble_logical_file
+    opened = []
+
+    def assemble_or_fail(pieces, lazy):
+        s, _ = pieces[0]
+        if s['path'] == failing:
+            raise RuntimeError('assemble failed')
+        logical = assemble(pieces, lazy)
+        opened.append(logical[0])
+        return logical
+
+    monkeypatch.setattr(dlisio, 'assemble_logical_file', assemble_or_fail)
+    with pytest.raises(RuntimeError, match = 'assemble failed'):
+        _ = dlisio.load_many([fpath, failing], threads = 2)
+
+    # the logical files that were assembled are closed again
+    assert len(opened) > 0
+    for stream in opened:
+        with pytest.raises(RuntimeError, match = 'closed'):
+            _ = stream[0]
+
+def test_raw_objectsets_cached(fpath):
+    with dlisio.load(fpath) as (f, *_):
+        sets = f.raw_objectsets()
+        sets.clear()
+
+        again = f.raw_objectsets()
+        assert len(again) > 0
+        assert again is not sets
+
+def assert_same_objects(f, expected):
+    for t, objects in expected.indexedobjects.items():
+        assert set(f.indexedobjects[t]) == set(objects)
+        for fingerprint, obj in objects.items():
+            assert f.indexedobjects[t][fingerprint].attic == obj.attic
+
+def test_follow(fpath, tmpdir):
+    with open(fpath, 'rb') as f:
+        content = f.read()
+
+    # start with the storage unit label, and a bit more
+    path = str(tmpdir.join('live.dlis'))
+    with open(path, 'wb') as f:
+        f.write(content[:120])
+
+    appended = {}
+    with dlisio.follow(path) as live:
+        # grow the file by a few bytes at the time, so that most refreshes see
+        # a partially written record
+        for end in range(120, len(content) + 97, 97):
+            with open(path, 'ab') as f:
+                f.write(content[end:end + 97])
+
+            for frame, records in live.refresh().items():
+                appended.setdefault(frame.fingerprint, []).extend(records)
+                np.testing.assert_array_equal(
+                    frame.curves(records = records),
+                    frame.curves()[-len(records):],
+                )
+
+        assert not live.partial
+        assert live.refresh() == {}
+
+        with dlisio.load(fpath) as expected:
+            assert len(live.files) == len(expected)
+            for f, e in zip(live.files, expected):
+                assert_same_objects(f, e)
+                for fingerprint, records in e.fdata_index.items():
+                    assert len(f.fdata_index[fingerprint]) == len(records)
+
+            _, f2, _ = live.files
+            frame = f2.object('FRAME', 'FRAME-INC', 10, 0)
+            records = f2.fdata_index[frame.fingerprint]
+            assert appended[frame.fingerprint] == records.tolist()
+
+            e = expected[1].object('FRAME', 'FRAME-INC', 10, 0)
+            np.testing.assert_array_equal(frame.curves(), e.curves())
+
+def test_follow_partial(fpath, tmpdir):
+    with open(fpath, 'rb') as f:
+        content = f.read()
+
+    path = str(tmpdir.join('live.dlis'))
+    with open(path, 'wb') as f:
+        f.write(content[:-1])
+
+    with dlisio.follow(path) as live:
+        assert live.partial
+        indexed = live.index.indexed
+        assert indexed < len(content)
+
+        with open(path, 'ab') as f:
+            f.write(content[-1:])
+
+        live.refresh()
+        assert not live.partial
+        assert live.index.indexed == len(content)
+
+def test_stats(fpath):
+    stats_keys = [
+        'bytes_indexed',
+        'records_indexed',
+        'records_read',
+        'segments_read',
+        'records_stitched',
+        'bytes_copied',
+        'objects_parsed',
+        'frames_decoded',
+        'records_skipped',
+        'bytes_skipped',
+    ]
+
+    with dlisio.load(fpath) as (_, f2, _):
+        stats = f2.stats
+        for key in stats_keys:
+            assert key in stats
+
+        for phase in ['findoffsets', 'extract', 'parse_objects', 'findfdata',
+                      'read_fdata', 'load', 'create', 'link']:
+            assert phase in stats['seconds']
+            assert phase in stats['calls']
+
+        assert stats['calls']['load'] == 1
+        assert stats['seconds']['load'] > 0
+
+        if not dlisio.core.stats.enabled:
+            assert all(stats[key] == 0 for key in stats_keys)
+            return
+
+        assert stats['bytes_indexed'] > 0
+        assert stats['records_indexed'] > 0
+        assert stats['records_read'] > 0
+        assert stats['segments_read'] >= stats['records_read']
+        assert stats['objects_parsed'] > 0
+        assert stats['calls']['findoffsets'] == 1
+        assert stats['frames_decoded'] == 0
+
+        frame = f2.object('FRAME', 'FRAME-INC', 10, 0)
+        frame.curves()
+        stats = f2.stats
+        assert stats['frames_decoded'] == 2
+        assert stats['calls']['read_fdata'] > 0
+
+def test_stats_scope(DWL206_index):
+    outer = dlisio.core.stats()
+    inner = dlisio.core.stats()
+
+    mmap = DWL206_index.mmap
+    vrlpos = DWL206_index.vrlpos
+    with outer:
+        with inner:
+            dlisio.core.findoffsets(mmap, vrlpos)
+        dlisio.core.findoffsets(mmap, vrlpos)
+
+    outer = outer.asdict()
+    inner = inner.asdict()
+    if not dlisio.core.stats.enabled:
+        assert outer['calls']['findoffsets'] == 0
+        return
+
+    assert inner['calls']['findoffsets'] == 1
+    assert outer['calls']['findoffsets'] == 1
+    assert outer['records_indexed'] == inner['records_indexed']
+    assert outer['records_indexed'] > 0
+
 def test_wellref_coordinates():
     wellref = dlisio.plumbing.wellref.Wellref()
     wellref.attic = {